@@ -0,0 +1,16 @@
+// Example "quickjs" job script: byte, line and word counts of each chunk.
+// Runs in the VM embedded in employees, or under Node via volcom_runner.js;
+// neither offers require(), so it only uses volcom.decode.
+//
+//   {"command":"submit_job","job_id":"stats","script":"./scripts/chunk_stats.js",
+//    "chunk_dir":"./stats_chunks","runtime":"quickjs"}
+
+function processChunk(chunk) {
+    const bytes = new Uint8Array(chunk);
+    let lines = 0;
+    for (let i = 0; i < bytes.length; i++) {
+        if (bytes[i] === 10) lines++;
+    }
+    const words = volcom.decode(chunk).split(/\s+/).filter((word) => word.length > 0).length;
+    return { status: 'success', bytes: bytes.length, lines: lines, words: words };
+}
@@ -0,0 +1,37 @@
+// Example native plugin: byte and line counts of each chunk.
+//
+//   cc -shared -fPIC -O2 -I../../volcom_agents byte_stats.c -o byte_stats.so
+//
+// Submit it like a script, {"command":"submit_job",...,"script":"./scripts/native/byte_stats.so"}.
+
+#include "volcom_plugin.h"
+#include <stdio.h>
+
+static int byte_stats_process(void* state, const volcom_plugin_buffer_t* in, volcom_plugin_buffer_t* out) {
+
+    (void)state;
+    const unsigned char *bytes = in->data;
+    size_t lines = 0;
+    for (size_t i = 0; i < in->len; i++) {
+        if (bytes[i] == '\n') lines++;
+    }
+    int len = snprintf(out->data, out->capacity, "{\"status\":\"success\",\"bytes\":%zu,\"lines\":%zu}",
+                       in->len, lines);
+    if (len < 0) return -1;
+    if ((size_t)len >= out->capacity) {
+        out->len = (size_t)len + 1; // snprintf needs room for the NUL
+        return VOLCOM_PLUGIN_GROW;
+    }
+    out->len = (size_t)len;
+    return VOLCOM_PLUGIN_OK;
+}
+
+static const volcom_plugin_t byte_stats = {
+    .abi_version = VOLCOM_PLUGIN_ABI_VERSION,
+    .name = "byte_stats",
+    .process = byte_stats_process,
+};
+
+const volcom_plugin_t* volcom_plugin_entry(void) {
+    return &byte_stats;
+}
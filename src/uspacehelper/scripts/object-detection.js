@@ -18,7 +18,8 @@ try {
   console.log('[NODE] Canvas module not available, using TensorFlow only');
 }
 
-const SOCKET_PATH = '/tmp/volcom_unix_socket';
+// Set per job runtime by the employee (VOLCOM_SOCKET_PATH)
+const SOCKET_PATH = process.env.VOLCOM_SOCKET_PATH || '/tmp/volcom_unix_socket';
 
 // <--------- EDIT --------->
 // Import modules you want here
@@ -28,135 +29,148 @@ const cocoSsd = require('@tensorflow-models/coco-ssd');
 
 // Load model once globally
 let modelPromise = cocoSsd.load();
+
+// Frames the employee may send in one batch message (see detectBatch), 1 to
+// take them one at a time
+const MAX_BATCH = 8;
 // <--------- END EDIT --------->
 
 // <--------- DO NOT EDIT --------->
 // Clean up the socket file if it exists
 if (fs.existsSync(SOCKET_PATH)) fs.unlinkSync(SOCKET_PATH);
 
+// Runtime socket framing, batch messages and readiness handshake (volcom_frame.js)
+const { frameReader, writeFrame, batchHeader, writeBatchFrame, writeReadyLine, signalReady } = require('volcom_frame');
+
+writeReadyLine({ status: 'starting' });
+
 const server = net.createServer((socket) => {
   console.log('[NODE] Client connected');
 
-  let buffer = Buffer.alloc(0);
-  let isProcessing = false;
+  // The employee keeps more than one message in the socket, the chain answers
+  // them in the order they came
+  let pending = Promise.resolve();
+  let batch = null; // Frames of a batch message still arriving
 
-  socket.on('data', (data) => {
-    buffer = Buffer.concat([buffer, data]);
-    console.log(`[NODE] Received ${data.length} bytes, total buffer: ${buffer.length} bytes`);
-    
-    // Try to parse as complete JSON message
-    try {
-      const bufferString = buffer.toString('utf8');
-      const jsonData = JSON.parse(bufferString);
-      
-      // If we successfully parsed JSON, process it immediately
-      console.log('[NODE] Received complete JSON message, processing...');
-      if (!isProcessing) {
-        processJsonData(socket, jsonData);
-      }
-    } catch (jsonError) {
-      // Not complete JSON yet, or not JSON at all
-      // Check if we received the end-of-data marker (fallback for binary data)
-      const bufferString = buffer.toString('utf8');
-      const endMarkerIndex = bufferString.indexOf('\n<<END_OF_DATA>>\n');
-      
-      if (endMarkerIndex !== -1) {
-        console.log('[NODE] End-of-data marker received, processing buffer...');
-        // Extract only the image data (before the marker)
-        const imageBuffer = buffer.slice(0, endMarkerIndex);
-        
-        if (!isProcessing && imageBuffer.length > 0) {
-          processData(socket, imageBuffer);
-        }
+  socket.on('data', frameReader((message) => {
+    console.log(`[NODE] Received ${message.length} byte message`);
+    if (batch) {
+      batch.frames.push(message);
+      if (batch.frames.length === batch.size) {
+        const frames = batch.frames;
+        batch = null;
+        pending = pending.then(() => handleBatch(socket, frames));
       }
+      return;
     }
-  });
+    const size = batchHeader(message);
+    if (size > 0) {
+      batch = { size, frames: [] };
+      return;
+    }
+    pending = pending.then(() => handleMessage(socket, message));
+  }));
 
   socket.on('end', () => {
     console.log('[NODE] Client ended connection');
-    // Only process if we haven't processed with the end marker
-    if (!isProcessing && buffer.length > 0) {
-      console.log('[NODE] Processing buffer from connection end (fallback)...');
-      processData(socket, buffer);
-    }
   });
 
-  async function processData(clientSocket, dataBuffer) {
-    if (isProcessing) {
-      console.log('[NODE] Already processing, skipping...');
-      return;
+  async function handleMessage(clientSocket, message) {
+    const jsonData = parseJson(message);
+    if (jsonData) {
+      reply(clientSocket, await processJsonData(jsonData));
+    } else {
+      reply(clientSocket, await processData(message));
     }
-    
-    isProcessing = true;
-    console.log(`[NODE] Processing ${dataBuffer.length} bytes of data...`);
+  }
 
+  // Raw images of a batch are detected together, JSON frames one by one
+  async function handleBatch(clientSocket, frames) {
+    console.log(`[NODE] Processing a batch of ${frames.length} frames...`);
+    const parsed = frames.map(parseJson);
+    const images = frames.filter((frame, i) => !parsed[i]);
+    let detections;
     try {
-      // Check if the socket is still writable
-      if (clientSocket.destroyed || !clientSocket.writable) {
-        console.log('[NODE] Socket is not writable, skipping response');
-        return;
-      }
+      detections = await detectBatch(images);
+    } catch (err) {
+      console.error('[NODE] Batch detection failed:', err);
+      detections = images.map(() => err);
+    }
 
-      const detectionResult = await detectFromBuffer(dataBuffer);
-      const response = {
-        status: 'success',
-        objects: detectionResult.length,
-        predictions: detectionResult,
+    const responses = [];
+    let next = 0;
+    for (let i = 0; i < frames.length; i++) {
+      const response = parsed[i] ? await processJsonData(parsed[i]) : detectionResponse(detections[next++]);
+      responses.push(JSON.stringify(response));
+    }
+    if (!clientSocket.destroyed && clientSocket.writable) {
+      writeBatchFrame(clientSocket, responses);
+    } else {
+      console.log('[NODE] Socket is not writable, skipping response');
+    }
+  }
+
+  function parseJson(message) {
+    try {
+      return JSON.parse(message.toString('utf8'));
+    } catch (jsonError) {
+      return null; // Not JSON, the message is the raw image
+    }
+  }
+
+  function reply(clientSocket, response) {
+    if (!clientSocket.destroyed && clientSocket.writable) {
+      writeFrame(clientSocket, JSON.stringify(response));
+    } else {
+      console.log('[NODE] Socket is not writable, skipping response');
+    }
+  }
+
+  // The predictions found in a frame, or the error that stopped it
+  function detectionResponse(detectionResult) {
+    if (detectionResult instanceof Error) {
+      return {
+        status: 'error',
+        message: detectionResult.message,
         timestamp: new Date().toISOString()
       };
+    }
+    return {
+      status: 'success',
+      objects: detectionResult.length,
+      predictions: detectionResult,
+      timestamp: new Date().toISOString()
+    };
+  }
+
+  async function processData(dataBuffer) {
+    console.log(`[NODE] Processing ${dataBuffer.length} bytes of data...`);
+
+    try {
+      const response = detectionResponse(await detectFromBuffer(dataBuffer));
       console.log('[NODE] Detection completed:', response);
-      
-      // Send response back to client if socket is still open
-      if (!clientSocket.destroyed && clientSocket.writable) {
-        clientSocket.write(JSON.stringify(response));
-        clientSocket.end(); // End the connection after sending response
-      }
+      return response;
     } catch (err) {
       console.error('[NODE] Detection failed:', err);
-      const errorResponse = {
-        status: 'error',
-        message: err.message,
-        timestamp: new Date().toISOString()
-      };
-      
-      // Send error response if socket is still open
-      if (!clientSocket.destroyed && clientSocket.writable) {
-        clientSocket.write(JSON.stringify(errorResponse));
-        clientSocket.end();
-      }
-    } finally {
-      isProcessing = false;
+      return detectionResponse(err);
     }
   }
 
-  async function processJsonData(clientSocket, jsonData) {
-    if (isProcessing) {
-      console.log('[NODE] Already processing, skipping...');
-      return;
-    }
-    
-    isProcessing = true;
+  async function processJsonData(jsonData) {
     console.log('[NODE] Processing JSON data:', jsonData.type);
 
     try {
-      // Check if the socket is still writable
-      if (clientSocket.destroyed || !clientSocket.writable) {
-        console.log('[NODE] Socket is not writable, skipping response');
-        return;
-      }
-
-      let detectionResult;
-      
       if (jsonData.type === 'image_detection' && jsonData.image_data) {
         // Convert base64 back to buffer
         const imageBuffer = Buffer.from(jsonData.image_data, 'base64');
         console.log(`[NODE] Decoded image buffer size: ${imageBuffer.length} bytes`);
-        detectionResult = await detectFromBuffer(imageBuffer);
+        const detectionResult = await detectFromBuffer(imageBuffer);
         
         // Create annotated image
         const annotatedImageBase64 = await createAnnotatedImage(imageBuffer, detectionResult);
         
-        const response = {
+        console.log('[NODE] Detection and annotation completed');
+        return {
           status: 'success',
           objects: detectionResult.length,
           predictions: detectionResult,
@@ -164,32 +178,12 @@ const server = net.createServer((socket) => {
           timestamp: new Date().toISOString(),
           original_timestamp: jsonData.timestamp
         };
-        console.log('[NODE] Detection and annotation completed');
-        
-        // Send response back to client if socket is still open
-        if (!clientSocket.destroyed && clientSocket.writable) {
-          clientSocket.write(JSON.stringify(response));
-          clientSocket.end(); // End the connection after sending response
-        }
-        return;
       } else {
         throw new Error('Invalid JSON format. Expected type: "image_detection" with image_data field');
       }
     } catch (err) {
       console.error('[NODE] JSON Detection failed:', err);
-      const errorResponse = {
-        status: 'error',
-        message: err.message,
-        timestamp: new Date().toISOString()
-      };
-      
-      // Send error response if socket is still open
-      if (!clientSocket.destroyed && clientSocket.writable) {
-        clientSocket.write(JSON.stringify(errorResponse));
-        clientSocket.end();
-      }
-    } finally {
-      isProcessing = false;
+      return detectionResponse(err);
     }
   }
 
@@ -200,6 +194,10 @@ const server = net.createServer((socket) => {
 
 server.listen(SOCKET_PATH, () => {
   console.log(`[NODE] Listening on Unix socket: ${SOCKET_PATH}`);
+  // Ready once the model is loaded, so the first chunk does not wait for it
+  modelPromise.then(
+    () => signalReady({ model_loaded: true, max_batch: MAX_BATCH }),
+    (err) => signalReady({ model_loaded: false, error: String((err && err.message) || err) }));
 });
 
 // Cleanup
@@ -296,12 +294,7 @@ async function detectFromBuffer(imageBuffer) {
     // Clean up tensor
     imageTensor.dispose();
     
-    // Format predictions for better readability
-    const formattedPredictions = predictions.map(pred => ({
-      class: pred.class,
-      score: Math.round(pred.score * 100) / 100, // Round to 2 decimal places
-      bbox: pred.bbox.map(coord => Math.round(coord))
-    }));
+    const formattedPredictions = formatPredictions(predictions);
     
     console.log('[NODE] Detection complete. Found', formattedPredictions.length, 'objects');
     return formattedPredictions;
@@ -312,6 +305,110 @@ async function detectFromBuffer(imageBuffer) {
   }
 }
 
+// Format predictions for better readability
+function formatPredictions(predictions) {
+  return predictions.map(pred => ({
+    class: pred.class,
+    score: Math.round(pred.score * 100) / 100, // Round to 2 decimal places
+    bbox: pred.bbox.map(coord => Math.round(coord))
+  }));
+}
+
+// Batched detection: decoded frames of the same size are stacked into one
+// tensor and go through the model once. Returns, per buffer, its formatted
+// predictions or the Error that stopped it. Frames that do not decode here go
+// through detectFromBuffer and its fallbacks.
+async function detectBatch(imageBuffers) {
+  const model = await modelPromise;
+  const results = new Array(imageBuffers.length);
+  const tensors = [];
+  const sizes = new Map(); // "height,width,channels" -> indexes of its frames
+  imageBuffers.forEach((buffer, i) => {
+    try {
+      tensors[i] = tf.node.decodeImage(buffer, 3);
+    } catch (decodeError) {
+      return;
+    }
+    const key = tensors[i].shape.join(',');
+    if (!sizes.has(key)) sizes.set(key, []);
+    sizes.get(key).push(i);
+  });
+
+  try {
+    for (const indexes of sizes.values()) {
+      const stacked = batchedInference && indexes.length > 1
+        ? await detectStacked(model, indexes.map(i => tensors[i]))
+        : null;
+      for (let n = 0; n < indexes.length; n++) {
+        results[indexes[n]] = stacked ? stacked[n] : formatPredictions(await model.detect(tensors[indexes[n]]));
+      }
+    }
+  } finally {
+    tensors.forEach(tensor => tensor && tensor.dispose());
+  }
+
+  for (let i = 0; i < imageBuffers.length; i++) {
+    if (results[i] !== undefined) continue;
+    try {
+      results[i] = await detectFromBuffer(imageBuffers[i]);
+    } catch (err) {
+      results[i] = err;
+    }
+  }
+  console.log(`[NODE] Batch of ${imageBuffers.length} frames complete`);
+  return results;
+}
+
+// One run of coco-ssd's graph over a [frames, height, width, 3] tensor, then
+// the per-image steps of model.detect() (best class per box, non-max
+// suppression) on each frame's slice of the output. Returns null, and stops
+// trying, when the graph only takes one image at a time.
+let batchedInference = true;
+const DETECT_MAX_BOXES = 20; // model.detect() defaults
+const DETECT_MIN_SCORE = 0.5;
+
+async function detectStacked(model, images) {
+  const [height, width] = images[0].shape;
+  const batched = tf.stack(images);
+  let result;
+  try {
+    result = await model.model.executeAsync(batched);
+  } catch (err) {
+    console.log('[NODE] Model does not take batches, detecting frames one by one:', err.message);
+    batchedInference = false;
+    return null;
+  } finally {
+    batched.dispose();
+  }
+
+  // calculateMaxScores and buildDetectedObjects are coco-ssd internals, a
+  // version without them falls back like a graph without batches
+  try {
+    const [frames, numBoxes, numClasses] = result[0].shape;
+    const scores = result[0].dataSync();
+    const boxes = result[1].dataSync();
+
+    const found = [];
+    for (let n = 0; n < frames; n++) {
+      const frameScores = scores.subarray(n * numBoxes * numClasses, (n + 1) * numBoxes * numClasses);
+      const frameBoxes = boxes.subarray(n * numBoxes * 4, (n + 1) * numBoxes * 4);
+      const [maxScores, classes] = model.calculateMaxScores(frameScores, numBoxes, numClasses);
+      const indexTensor = tf.tidy(() => tf.image.nonMaxSuppression(
+        tf.tensor2d(frameBoxes, [numBoxes, 4]), maxScores, DETECT_MAX_BOXES, DETECT_MIN_SCORE, DETECT_MIN_SCORE));
+      const indexes = indexTensor.dataSync();
+      indexTensor.dispose();
+      found.push(formatPredictions(model.buildDetectedObjects(width, height, frameBoxes, maxScores, indexes, classes)));
+    }
+    return found;
+  } catch (err) {
+    console.log('[NODE] Cannot split the batched output, detecting frames one by one:', err.message);
+    batchedInference = false;
+    return null;
+  } finally {
+    tf.dispose(result);
+  }
+}
+
 // Function to create annotated image with bounding boxes
 async function createAnnotatedImage(imageBuffer, predictions) {
   try {
@@ -2,38 +2,23 @@ const net = require('net');
 const fs = require('fs');
 const path = require('path');
 
-const SOCKET_PATH = '/tmp/volcom_unix_socket';
+// Set per job runtime by the employee (VOLCOM_SOCKET_PATH)
+const SOCKET_PATH = process.env.VOLCOM_SOCKET_PATH || '/tmp/volcom_unix_socket';
 
 // Clean up the socket file if it exists
 if (fs.existsSync(SOCKET_PATH)) fs.unlinkSync(SOCKET_PATH);
 
+// Runtime socket framing and readiness handshake (volcom_frame.js)
+const { frameReader, writeFrame, writeReadyLine, signalReady } = require('volcom_frame');
+
+writeReadyLine({ status: 'starting' });
+
 const server = net.createServer((socket) => {
     console.log('[NODE] Client connected to Unix socket server');
-    
-    let buffer = Buffer.alloc(0);
 
-    socket.on('data', (data) => {
-        buffer = Buffer.concat([buffer, data]);
-        
-        // Check if we have a complete message (assuming text messages)
-        const messageStr = buffer.toString('utf8');
-        if (messageStr.includes('\n') || messageStr.includes('\0')) {
-            const messages = messageStr.split(/[\n\0]/);
-            
-            for (let i = 0; i < messages.length - 1; i++) {
-                if (messages[i].trim()) {
-                    processMessage(messages[i].trim(), socket);
-                }
-            }
-            
-            // Keep the last incomplete message in buffer
-            buffer = Buffer.from(messages[messages.length - 1]);
-        } else {
-            // Process the complete buffer as a single message
-            processMessage(messageStr, socket);
-            buffer = Buffer.alloc(0);
-        }
-    });
+    socket.on('data', frameReader((message) => {
+        processMessage(message.toString('utf8'), socket);
+    }));
 
     socket.on('end', () => {
         console.log('[NODE] Client disconnected from Unix socket server');
@@ -46,6 +31,7 @@ const server = net.createServer((socket) => {
 
 server.listen(SOCKET_PATH, () => {
     console.log(`[NODE] Unix Socket Server listening on ${SOCKET_PATH}`);
+    signalReady({ model_loaded: true }); // Nothing to load
 });
 
 function processMessage(message, socket) {
@@ -65,7 +51,7 @@ function processMessage(message, socket) {
                 timestamp: new Date().toISOString()
             };
             
-            socket.write(JSON.stringify(response));
+            writeFrame(socket, JSON.stringify(response));
             return;
         }
         
@@ -87,7 +73,7 @@ function processJsonData(data, socket) {
         timestamp: new Date().toISOString()
     };
     
-    socket.write(JSON.stringify(response));
+    writeFrame(socket, JSON.stringify(response));
 }
 
 function processBinaryData(dataPoint, socket) {
@@ -110,7 +96,7 @@ function processBinaryData(dataPoint, socket) {
         console.log('[NODE] Sending success message:', successMessage);
         
         // Send success message back to the client
-        socket.write(JSON.stringify(successMessage));
+        writeFrame(socket, JSON.stringify(successMessage));
         
     } catch (error) {
         console.error('[ERROR][NODE] Error saving file:', error);
@@ -122,7 +108,7 @@ function processBinaryData(dataPoint, socket) {
             error: error.message
         };
         
-        socket.write(JSON.stringify(errorMessage));
+        writeFrame(socket, JSON.stringify(errorMessage));
     }
 }
 
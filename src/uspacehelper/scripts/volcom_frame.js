@@ -0,0 +1,130 @@
+// Wire protocol between the employee and its runtime scripts, shared by
+// unix_socket.js, object-detection.js and volcom_runner.js. The employee puts
+// this directory on NODE_PATH, so job scripts shipped to its script cache can
+// require('volcom_frame') too.
+const fs = require('fs');
+
+// Runtime socket framing: every message is a 4-byte big-endian length and that
+// many bytes, in both directions (send_frame/recv_frame in volcom_net). With
+// the top bit of the length set, the bytes are a path to a file holding the
+// message (a memfd of the employee under /proc, or a /dev/shm spool file), so
+// large chunks and results do not pass through the socket.
+const FRAME_FD = 0x80000000;
+const FRAME_SHM_PREFIX = '/dev/shm/volcom_';
+const FRAME_SHM_MIN = 256 * 1024; // Smaller results are cheaper inline
+let frameSpoolSeq = 0;
+
+// Returns a 'data' listener that calls onMessage with each complete message
+function frameReader(onMessage) {
+    const header = Buffer.alloc(4);
+    let headerFill = 0;
+    let body = null;
+    let bodyFill = 0;
+    let byPath = false;
+
+    return (data) => {
+        let offset = 0;
+        while (offset < data.length) {
+            if (!body) {
+                const n = Math.min(4 - headerFill, data.length - offset);
+                data.copy(header, headerFill, offset, offset + n);
+                headerFill += n;
+                offset += n;
+                if (headerFill < 4) break;
+                const word = header.readUInt32BE(0);
+                byPath = word >= FRAME_FD;
+                body = Buffer.allocUnsafe(byPath ? word - FRAME_FD : word); // Sized once per message
+                bodyFill = 0;
+                headerFill = 0;
+            }
+            const n = Math.min(body.length - bodyFill, data.length - offset);
+            data.copy(body, bodyFill, offset, offset + n);
+            bodyFill += n;
+            offset += n;
+            if (bodyFill < body.length) break;
+            const message = byPath ? fs.readFileSync(body.toString('utf8')) : body;
+            body = null;
+            onMessage(message);
+        }
+    };
+}
+
+function writeFrame(socket, payload) {
+    let body = Buffer.isBuffer(payload) ? payload : Buffer.from(payload, 'utf8');
+    let word = body.length;
+    if (body.length >= FRAME_SHM_MIN) {
+        // The employee maps the file and unlinks it
+        const spoolPath = `${FRAME_SHM_PREFIX}${process.pid}_${frameSpoolSeq++}`;
+        try {
+            fs.writeFileSync(spoolPath, body);
+            body = Buffer.from(spoolPath, 'utf8');
+            word = FRAME_FD + body.length;
+        } catch (err) {
+            // No /dev/shm, send it inline
+        }
+    }
+    const header = Buffer.alloc(4);
+    header.writeUInt32BE(word, 0);
+    socket.cork();
+    socket.write(header);
+    socket.write(body);
+    socket.uncork();
+}
+
+// Batch messages: a {"type":"frame_batch","frames":K} frame, then K frames,
+// all answered by one frame holding each result as a 4-byte big-endian length
+// and that many bytes. The employee only batches for scripts that announce
+// max_batch when they are ready. Returns K, or 0 for any other message.
+function batchHeader(message) {
+    if (message.length > 64) return 0;
+    try {
+        const header = JSON.parse(message.toString('utf8'));
+        return header.type === 'frame_batch' && header.frames > 0 ? header.frames : 0;
+    } catch (err) {
+        return 0;
+    }
+}
+
+function writeBatchFrame(socket, payloads) {
+    const parts = [];
+    for (const payload of payloads) {
+        const body = Buffer.isBuffer(payload) ? payload : Buffer.from(payload, 'utf8');
+        const length = Buffer.alloc(4);
+        length.writeUInt32BE(body.length, 0);
+        parts.push(length, body);
+    }
+    writeFrame(socket, Buffer.concat(parts));
+}
+
+// Readiness handshake: the employee passes a pipe in VOLCOM_READY_FD. The
+// runtime announces itself at once and writes "ready" when it can take chunks;
+// the employee connects and starts feeding chunks on that line.
+const READY_FD = process.env.VOLCOM_READY_FD ? parseInt(process.env.VOLCOM_READY_FD, 10) : -1;
+
+function writeReadyLine(fields) {
+    if (READY_FD < 0) return;
+    try {
+        fs.writeSync(READY_FD, JSON.stringify(Object.assign({ pid: process.pid }, fields)) + '\n');
+    } catch (err) {
+        // The employee stopped waiting, it falls back to connecting
+    }
+}
+
+function signalReady(fields) {
+    writeReadyLine(Object.assign({ status: 'ready' }, fields));
+    if (READY_FD >= 0) {
+        try { fs.closeSync(READY_FD); } catch (err) { /* already closed */ }
+    }
+}
+
+module.exports = {
+    FRAME_FD,
+    FRAME_SHM_PREFIX,
+    FRAME_SHM_MIN,
+    frameReader,
+    writeFrame,
+    batchHeader,
+    writeBatchFrame,
+    writeReadyLine,
+    signalReady,
+};
@@ -0,0 +1,72 @@
+// Runs a "quickjs" job script under Node, for employees built without the
+// embedded VM (employee/quickjs_runtime.c). The script in VOLCOM_JOB_SCRIPT
+// gets the same contract as in the VM: it defines processChunk(chunk), called
+// with each chunk as an ArrayBuffer, and optionally init(). The result is sent
+// as is when it is a string, an ArrayBuffer or a typed array, as JSON
+// otherwise. volcom.decode(buffer) and console.log are all it can rely on.
+const net = require('net');
+const fs = require('fs');
+const vm = require('vm');
+
+const SOCKET_PATH = process.env.VOLCOM_SOCKET_PATH || '/tmp/volcom_unix_socket';
+const JOB_SCRIPT = process.env.VOLCOM_JOB_SCRIPT;
+
+if (fs.existsSync(SOCKET_PATH)) fs.unlinkSync(SOCKET_PATH);
+
+// Runtime socket framing and readiness handshake, as in unix_socket.js
+const { frameReader, writeFrame, writeReadyLine, signalReady } = require('./volcom_frame');
+
+writeReadyLine({ status: 'starting' });
+
+// The job script runs as a classic script in this context, like JS_Eval in
+// the VM, so its top-level functions become globals
+globalThis.volcom = {
+    decode: (buffer) => Buffer.from(buffer).toString('utf8'),
+};
+try {
+    vm.runInThisContext(fs.readFileSync(JOB_SCRIPT, 'utf8'), { filename: JOB_SCRIPT });
+} catch (err) {
+    console.error(`[RUNNER] Script ${JOB_SCRIPT} failed to load:`, err);
+    process.exit(1);
+}
+const processChunk = globalThis.processChunk;
+if (typeof processChunk !== 'function') {
+    console.error(`[RUNNER] ${JOB_SCRIPT} defines no processChunk function`);
+    process.exit(1);
+}
+if (typeof globalThis.init === 'function') {
+    try {
+        globalThis.init();
+    } catch (err) {
+        console.error('[RUNNER] init failed:', err);
+    }
+}
+
+// A failed chunk gets an empty frame, as from a plugin host
+function encodeResult(result) {
+    if (result === undefined || result === null) return Buffer.alloc(0);
+    if (typeof result === 'string') return Buffer.from(result, 'utf8');
+    if (result instanceof ArrayBuffer) return Buffer.from(result);
+    if (ArrayBuffer.isView(result)) return Buffer.from(result.buffer, result.byteOffset, result.byteLength);
+    return Buffer.from(JSON.stringify(result), 'utf8');
+}
+
+function runChunk(message) {
+    try {
+        const chunk = message.buffer.slice(message.byteOffset, message.byteOffset + message.length);
+        return encodeResult(processChunk(chunk));
+    } catch (err) {
+        console.error('[RUNNER] processChunk failed:', err);
+        return Buffer.alloc(0);
+    }
+}
+
+const server = net.createServer((socket) => {
+    socket.on('data', frameReader((message) => writeFrame(socket, runChunk(message))));
+    socket.on('error', (err) => console.error('[RUNNER] Socket error:', err));
+});
+
+server.listen(SOCKET_PATH, () => {
+    console.log(`[RUNNER] ${JOB_SCRIPT} listening on ${SOCKET_PATH}`);
+    signalReady({ model_loaded: true });
+});
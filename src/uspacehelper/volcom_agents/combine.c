@@ -0,0 +1,165 @@
+#define _GNU_SOURCE
+
+#include "volcom_agents.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cjson/cJSON.h>
+
+// Combine functions for map-reduce jobs.
+//
+// A combine job's map script returns one JSON object per chunk. Employees fold
+// those objects into a partial aggregate with the job's combine function and
+// upload only the partial; the employer merges partials from all employees.
+// The function must be associative, so folding on the employee, at a relay and
+// on the employer in any grouping gives the same aggregate.
+//
+// "merge" combines two JSON values structurally:
+//   objects  merged key by key, keys missing on one side are copied
+//   numbers  summed, except under keys named "min"/"max" or ending in
+//            "_min"/"_max", which keep the minimum/maximum
+//   arrays   concatenated
+//   other    the first value is kept (e.g. a "status" string)
+// so {"count":2,"per_class":{"car":1},"speed_max":40} style results aggregate
+// without any reduce code on the employer.
+
+static bool has_suffix(const char* name, const char* suffix) {
+
+    size_t len = strlen(name);
+    size_t suffix_len = strlen(suffix);
+    return len >= suffix_len && strcmp(name + len - suffix_len, suffix) == 0;
+}
+
+int combine_parse(const char* name, combine_kind_t* kind) {
+
+    if (!name || !kind) return -1;
+    if (name[0] == '\0' || strcmp(name, "none") == 0) {
+        *kind = COMBINE_NONE;
+        return 0;
+    }
+    if (strcmp(name, "merge") == 0) {
+        *kind = COMBINE_MERGE;
+        return 0;
+    }
+    return -1;
+}
+
+const char* combine_name(combine_kind_t kind) {
+
+    return kind == COMBINE_MERGE ? "merge" : "none";
+}
+
+static void merge_number(cJSON* into, const cJSON* from) {
+
+    const char *key = into->string ? into->string : "";
+    double value;
+    if (strcmp(key, "min") == 0 || has_suffix(key, "_min")) {
+        value = from->valuedouble < into->valuedouble ? from->valuedouble : into->valuedouble;
+    } else if (strcmp(key, "max") == 0 || has_suffix(key, "_max")) {
+        value = from->valuedouble > into->valuedouble ? from->valuedouble : into->valuedouble;
+    } else {
+        value = into->valuedouble + from->valuedouble;
+    }
+    cJSON_SetNumberValue(into, value);
+}
+
+// Fold from into into. Returns 0, or -1 if memory ran out.
+int combine_merge(struct cJSON* into, const struct cJSON* from) {
+
+    if (!into || !from) return -1;
+
+    if (cJSON_IsObject(into) && cJSON_IsObject(from)) {
+        const cJSON *item = NULL;
+        cJSON_ArrayForEach(item, from) {
+            if (!item->string) continue;
+            cJSON *existing = cJSON_GetObjectItemCaseSensitive(into, item->string);
+            if (existing) {
+                if (combine_merge(existing, item) != 0) return -1;
+                continue;
+            }
+            cJSON *copy = cJSON_Duplicate(item, 1);
+            if (!copy) return -1;
+            cJSON_AddItemToObject(into, item->string, copy);
+        }
+    } else if (cJSON_IsNumber(into) && cJSON_IsNumber(from)) {
+        merge_number(into, from);
+    } else if (cJSON_IsArray(into) && cJSON_IsArray(from)) {
+        const cJSON *item = NULL;
+        cJSON_ArrayForEach(item, from) {
+            cJSON *copy = cJSON_Duplicate(item, 1);
+            if (!copy) return -1;
+            cJSON_AddItemToArray(into, copy);
+        }
+    }
+    // Strings, booleans, null and mismatched types keep the first value
+    return 0;
+}
+
+// Partials are merged like a binary counter: levels[i] holds the aggregate of
+// 2^i partials, and adding one carries upward. Every partial takes part in
+// O(log n) merges of similarly sized aggregates instead of being folded into
+// one ever-growing value, which keeps merging cheap when aggregates grow
+// (concatenated arrays, many distinct keys).
+void combine_tree_init(combine_tree_t* tree) {
+
+    if (tree) memset(tree, 0, sizeof(*tree));
+}
+
+int combine_tree_add(combine_tree_t* tree, struct cJSON* value) {
+
+    if (!tree || !value) return -1;
+
+    cJSON *carry = value;
+    for (int level = 0; level < COMBINE_TREE_LEVELS; level++) {
+        if (!tree->levels[level]) {
+            tree->levels[level] = carry;
+            tree->partials++;
+            return 0;
+        }
+        // The older aggregate stays on the left so arrays keep arrival order
+        cJSON *older = tree->levels[level];
+        tree->levels[level] = NULL;
+        if (combine_merge(older, carry) != 0) {
+            cJSON_Delete(older);
+            cJSON_Delete(carry);
+            return -1;
+        }
+        cJSON_Delete(carry);
+        carry = older;
+    }
+
+    // 2^32 partials, keep the result in the top level
+    int top = COMBINE_TREE_LEVELS - 1;
+    tree->levels[top] = carry;
+    tree->partials++;
+    return 0;
+}
+
+// Aggregate of everything added so far (a new value, the tree is unchanged)
+struct cJSON* combine_tree_result(const combine_tree_t* tree) {
+
+    if (!tree) return NULL;
+
+    cJSON *result = NULL;
+    for (int level = COMBINE_TREE_LEVELS - 1; level >= 0; level--) {
+        if (!tree->levels[level]) continue;
+        if (!result) {
+            result = cJSON_Duplicate(tree->levels[level], 1);
+            if (!result) return NULL;
+        } else if (combine_merge(result, tree->levels[level]) != 0) {
+            cJSON_Delete(result);
+            return NULL;
+        }
+    }
+    return result ? result : cJSON_CreateObject();
+}
+
+void combine_tree_cleanup(combine_tree_t* tree) {
+
+    if (!tree) return;
+    for (int level = 0; level < COMBINE_TREE_LEVELS; level++) {
+        cJSON_Delete(tree->levels[level]);
+        tree->levels[level] = NULL;
+    }
+    tree->partials = 0;
+}
@@ -0,0 +1,264 @@
+#define _GNU_SOURCE
+#include "volcom_agents.h"
+#include "volcom_plugin.h"
+#include "../volcom_net/volcom_net.h"
+#include "../volcom_rcsmngr/volcom_rcsmngr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+
+// Plugin host: one worker of a native job runtime.
+//
+// The employee forks a host per worker instead of starting Node. The child
+// keeps nothing of the employee but its readiness pipe, loads the plugin and
+// serves the worker's runtime socket like a script would: one frame in, one
+// frame out. Chunks passed by descriptor are mapped and handed to process()
+// as they are; results of PLUGIN_SHM_MIN bytes or more are written by the
+// plugin straight into a memfd that goes back by descriptor. A crashing plugin
+// takes down its host only: the worker stops using it, and the employer
+// resends the chunk when it times out.
+//
+// The fork is not followed by exec: glibc resets its allocator, stdio and
+// loader locks in the child, so dlopen and malloc are safe there.
+//
+// Hosts of quickjs jobs load no shared object: the plugin is the embedded VM
+// of quickjs_runtime.c, which runs the job script.
+
+#define PLUGIN_SHM_MIN (256 * 1024) // Smaller results are cheaper inline
+#define PLUGIN_OUTPUT_SIZE (64 * 1024)
+
+#define PLUGIN_PARENT_CHECK_MS 1000
+
+#ifdef VOLCOM_WITH_QUICKJS
+const volcom_plugin_t* quickjs_runtime_plugin(const char* script_path); // quickjs_runtime.c
+#endif
+
+static volatile sig_atomic_t host_stopping = 0;
+static pid_t employee_pid = 0;
+
+static void on_stop_signal(int sig) {
+    (void)sig;
+    host_stopping = 1;
+}
+
+// Close every descriptor above keep, which is moved to 3 first
+static int isolate_descriptors(int keep) {
+
+    if (keep >= 0 && keep != 3) {
+        if (dup2(keep, 3) < 0) return -1;
+    }
+    int first = keep >= 0 ? 4 : 3;
+#ifdef SYS_close_range
+    if (syscall(SYS_close_range, first, ~0U, 0) == 0) return keep >= 0 ? 3 : -1;
+#endif
+    long max_fd = sysconf(_SC_OPEN_MAX);
+    for (long fd = first; fd < (max_fd > 0 ? max_fd : 1024); fd++) {
+        close((int)fd);
+    }
+    return keep >= 0 ? 3 : -1;
+}
+
+static void announce(int ready_fd, const char* line) {
+
+    if (ready_fd < 0) return;
+    ssize_t written = write(ready_fd, line, strlen(line));
+    (void)written;
+}
+
+static int listen_on(const char* socket_path) {
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    unlink(socket_path);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 1) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Block until fd is readable; false once the host is told to stop or the
+// employee is gone. PR_SET_PDEATHSIG would follow the thread that forked the
+// host, which exits as soon as the runtime is up.
+static bool wait_readable(int fd) {
+
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    while (!host_stopping && getppid() == employee_pid) {
+        int ready = poll(&pfd, 1, PLUGIN_PARENT_CHECK_MS);
+        if (ready > 0) return true;
+        if (ready < 0 && errno != EINTR) return false;
+    }
+    return false;
+}
+
+// Run one chunk and send its result. Failed chunks get an empty frame, which
+// the worker drops like an empty script response.
+static protocol_status_t serve_chunk(int conn_fd, const volcom_plugin_t* plugin, const char* name, void* state,
+                                     const protocol_frame_t* chunk, volcom_plugin_buffer_t* scratch) {
+
+    const volcom_plugin_buffer_t in = { .data = chunk->data, .len = chunk->len, .capacity = chunk->len };
+    volcom_plugin_buffer_t out = { .data = scratch->data, .len = 0, .capacity = scratch->capacity };
+    int status = plugin->process(state, &in, &out);
+    if (status != VOLCOM_PLUGIN_GROW) {
+        if (status != VOLCOM_PLUGIN_OK || out.len > out.capacity) {
+            fprintf(stderr, "[Plugin] %s failed a chunk (%d)\n", name, status);
+            return send_frame(conn_fd, "", 0);
+        }
+        return send_frame(conn_fd, out.data, (uint32_t)out.len);
+    }
+
+    size_t needed = out.len;
+    if (needed > PROTOCOL_FRAME_MAX) {
+        fprintf(stderr, "[Plugin] %s asked for %zu bytes of output\n", name, needed);
+        return send_frame(conn_fd, "", 0);
+    }
+
+    if (needed < PLUGIN_SHM_MIN) {
+        void *grown = realloc(scratch->data, needed);
+        if (!grown) return send_frame(conn_fd, "", 0);
+        scratch->data = grown;
+        scratch->capacity = needed;
+        out = (volcom_plugin_buffer_t){ .data = grown, .len = 0, .capacity = needed };
+        status = plugin->process(state, &in, &out);
+        bool ok = status == VOLCOM_PLUGIN_OK && out.len <= out.capacity;
+        return ok ? send_frame(conn_fd, out.data, (uint32_t)out.len) : send_frame(conn_fd, "", 0);
+    }
+
+    // Large result: the plugin writes into a memfd the worker maps
+    int result_fd = memfd_create("volcom_plugin_result", MFD_CLOEXEC);
+    void *map = MAP_FAILED;
+    if (result_fd >= 0 && ftruncate(result_fd, (off_t)needed) == 0) {
+        map = mmap(NULL, needed, PROT_READ | PROT_WRITE, MAP_SHARED, result_fd, 0);
+    }
+    protocol_status_t sent;
+    if (map == MAP_FAILED) {
+        sent = send_frame(conn_fd, "", 0);
+    } else {
+        out = (volcom_plugin_buffer_t){ .data = map, .len = 0, .capacity = needed };
+        status = plugin->process(state, &in, &out);
+        munmap(map, needed);
+        bool ok = status == VOLCOM_PLUGIN_OK && out.len <= needed && ftruncate(result_fd, (off_t)out.len) == 0;
+        sent = ok ? send_frame_fd(conn_fd, result_fd) : send_frame(conn_fd, "", 0);
+    }
+    if (result_fd >= 0) close(result_fd);
+    return sent;
+}
+
+// The plugin a host runs: the shared object at path, or the built-in VM for a quickjs script
+static const volcom_plugin_t* load_plugin(script_runtime_t engine, const char* path) {
+
+#ifdef VOLCOM_WITH_QUICKJS
+    if (engine == SCRIPT_RUNTIME_QUICKJS) return quickjs_runtime_plugin(path);
+#else
+    (void)engine;
+#endif
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    volcom_plugin_entry_fn entry = handle ? (volcom_plugin_entry_fn)dlsym(handle, VOLCOM_PLUGIN_ENTRY) : NULL;
+    const volcom_plugin_t *plugin = entry ? entry() : NULL;
+    if (!plugin) {
+        fprintf(stderr, "[Plugin] Cannot load %s: %s\n", path, handle ? "no " VOLCOM_PLUGIN_ENTRY : dlerror());
+    }
+    return plugin;
+}
+
+// Body of the host process, never returns
+static void plugin_host_main(const char* job_id, script_runtime_t engine, const char* plugin_path,
+                             const char* socket_path, int ready_fd) {
+
+    prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0);
+    ready_fd = isolate_descriptors(ready_fd);
+
+    struct sigaction stop = { .sa_handler = on_stop_signal };
+    sigemptyset(&stop.sa_mask);
+    sigaction(SIGTERM, &stop, NULL);
+    sigaction(SIGINT, &stop, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    announce(ready_fd, "{\"status\":\"starting\"}\n");
+
+    const volcom_plugin_t *plugin = load_plugin(engine, plugin_path);
+    if (!plugin) _exit(1);
+    if (plugin->abi_version != VOLCOM_PLUGIN_ABI_VERSION || !plugin->process) {
+        fprintf(stderr, "[Plugin] %s is built for ABI %u, this host runs %u\n", plugin_path,
+                plugin->abi_version, VOLCOM_PLUGIN_ABI_VERSION);
+        _exit(1);
+    }
+    const char *name = plugin->name ? plugin->name : plugin_path;
+
+    void *state = NULL;
+    if (plugin->init && plugin->init(&state, job_id) != 0) {
+        fprintf(stderr, "[Plugin] %s failed to initialise for job %s\n", plugin_path, job_id);
+        _exit(1);
+    }
+
+    volcom_plugin_buffer_t scratch = { .data = malloc(PLUGIN_OUTPUT_SIZE), .capacity = PLUGIN_OUTPUT_SIZE };
+    int listen_fd = listen_on(socket_path);
+    if (listen_fd < 0 || !scratch.data) {
+        fprintf(stderr, "[Plugin] Cannot listen on %s\n", socket_path);
+        _exit(1);
+    }
+    announce(ready_fd, "{\"status\":\"ready\",\"model_loaded\":true}\n");
+    if (ready_fd >= 0) close(ready_fd);
+
+    // The worker connects once and never reconnects, the host ends with its connection
+    long chunks = 0;
+    int conn_fd = wait_readable(listen_fd) ? accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC) : -1;
+    close(listen_fd);
+    unlink(socket_path);
+    while (conn_fd >= 0 && wait_readable(conn_fd)) {
+        protocol_frame_t chunk;
+        if (recv_frame(conn_fd, &chunk) != PROTOCOL_OK) break;
+        protocol_status_t sent = serve_chunk(conn_fd, plugin, name, state, &chunk, &scratch);
+        free_frame(&chunk);
+        if (sent != PROTOCOL_OK) break;
+        chunks++;
+    }
+    if (conn_fd >= 0) close(conn_fd);
+
+    if (plugin->destroy) plugin->destroy(state);
+    printf("[Plugin] %s stopped after %ld chunks\n", name, chunks);
+    fflush(stdout);
+    _exit(0);
+}
+
+// Start a plugin host for one worker of a native or quickjs runtime in the
+// main cgroup, the counterpart of run_node_in_cgroup
+pid_t run_plugin_in_cgroup(struct volcom_rcsmngr_s *manager, const char *job_id, script_runtime_t engine,
+                           const char *plugin_path, const char *socket_path, int ready_fd) {
+
+    fflush(stdout);
+    fflush(stderr);
+    pid_t parent = getpid();
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("[Employee] fork failed");
+        return -1;
+    }
+    if (pid == 0) {
+        employee_pid = parent;
+        plugin_host_main(job_id, engine, plugin_path, socket_path, ready_fd);
+    }
+
+    if (volcom_add_pid_to_cgroup(manager, manager->main_cgroup.name, pid) == 0) {
+        printf("[Employee] Plugin host %d for job %s added to cgroup '%s'\n", pid, job_id, manager->main_cgroup.name);
+    } else {
+        printf("[Employee] Failed to add plugin host %d to cgroup\n", pid);
+    }
+    return pid;
+}
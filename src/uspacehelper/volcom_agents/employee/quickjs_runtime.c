@@ -0,0 +1,281 @@
+#include "volcom_agents.h"
+
+#ifdef VOLCOM_WITH_QUICKJS
+
+#include "volcom_plugin.h"
+#include "quickjs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Embedded QuickJS runtime for small job scripts.
+//
+// Built in when the employee is compiled with VOLCOM_WITH_QUICKJS (make
+// QUICKJS_DIR=<quickjs source tree>). It is a plugin that plugin_host.c runs
+// without dlopen: every worker of a "quickjs" job is a host process whose VM
+// is created and has evaluated the job script before the worker connects, so
+// chunks only ever meet a warm VM. A job script defines
+//
+//   function processChunk(chunk) { ... }   // chunk: ArrayBuffer
+//   function init() { ... }                 // optional, once per VM
+//
+// and returns a string, an ArrayBuffer or typed array, or any other value,
+// which is sent as JSON. The chunk's ArrayBuffer wraps the host's mapping of
+// the employee's buffer, no copy is made, and it is detached once
+// processChunk returns. volcom.decode(buffer) gives its UTF-8 text and
+// console.log prints to the host's stdout. Without QuickJS the employee runs
+// the same scripts under Node with scripts/volcom_runner.js.
+
+#define QUICKJS_MEMORY_LIMIT (256 * 1024 * 1024)
+
+typedef struct {
+    JSRuntime* rt;
+    JSContext* ctx;
+    JSValue process_chunk;
+    // A result too large for the output buffer, kept for the call that
+    // process() is given room for, so the script runs once per chunk
+    JSValue pending;
+    const uint8_t* pending_data;
+    size_t pending_len;
+} quickjs_state_t;
+
+static char quickjs_script_path[512];
+
+static void print_exception(JSContext* ctx, const char* what) {
+
+    JSValue exception = JS_GetException(ctx);
+    const char *text = JS_ToCString(ctx, exception);
+    fprintf(stderr, "[QuickJS] %s: %s\n", what, text ? text : "unknown error");
+    if (text) JS_FreeCString(ctx, text);
+    JS_FreeValue(ctx, exception);
+}
+
+static JSValue js_console_log(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
+
+    (void)this_val;
+    for (int i = 0; i < argc; i++) {
+        const char *text = JS_ToCString(ctx, argv[i]);
+        if (!text) return JS_EXCEPTION;
+        fputs(i > 0 ? " " : "", stdout);
+        fputs(text, stdout);
+        JS_FreeCString(ctx, text);
+    }
+    fputc('\n', stdout);
+    return JS_UNDEFINED;
+}
+
+// volcom.decode(buffer): the UTF-8 text of an ArrayBuffer
+static JSValue js_volcom_decode(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
+
+    (void)this_val;
+    size_t len = 0;
+    uint8_t *bytes = argc > 0 ? JS_GetArrayBuffer(ctx, &len, argv[0]) : NULL;
+    if (!bytes) return JS_ThrowTypeError(ctx, "volcom.decode expects an ArrayBuffer");
+    return JS_NewStringLen(ctx, (const char*)bytes, len);
+}
+
+static void add_host_functions(JSContext* ctx) {
+
+    JSValue global = JS_GetGlobalObject(ctx);
+    JSValue console = JS_NewObject(ctx);
+    JS_SetPropertyStr(ctx, console, "log", JS_NewCFunction(ctx, js_console_log, "log", 1));
+    JS_SetPropertyStr(ctx, console, "error", JS_NewCFunction(ctx, js_console_log, "error", 1));
+    JS_SetPropertyStr(ctx, global, "console", console);
+    JSValue volcom = JS_NewObject(ctx);
+    JS_SetPropertyStr(ctx, volcom, "decode", JS_NewCFunction(ctx, js_volcom_decode, "decode", 1));
+    JS_SetPropertyStr(ctx, global, "volcom", volcom);
+    JS_FreeValue(ctx, global);
+}
+
+static char* read_script(const char* path, size_t* len) {
+
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *source = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    if (source && fread(source, 1, (size_t)size, file) != (size_t)size) {
+        free(source);
+        source = NULL;
+    }
+    fclose(file);
+    if (source) {
+        source[size] = '\0';
+        *len = (size_t)size;
+    }
+    return source;
+}
+
+static void quickjs_destroy(void* opaque) {
+
+    quickjs_state_t *state = opaque;
+    if (!state) return;
+    JS_FreeValue(state->ctx, state->pending);
+    JS_FreeValue(state->ctx, state->process_chunk);
+    JS_FreeContext(state->ctx);
+    JS_FreeRuntime(state->rt);
+    free(state);
+}
+
+static int quickjs_init(void** opaque, const char* job_id) {
+
+    size_t source_len = 0;
+    char *source = read_script(quickjs_script_path, &source_len);
+    if (!source) {
+        fprintf(stderr, "[QuickJS] Cannot read %s for job %s\n", quickjs_script_path, job_id);
+        return -1;
+    }
+
+    quickjs_state_t *state = calloc(1, sizeof(*state));
+    if (state) state->rt = JS_NewRuntime();
+    if (state && state->rt) state->ctx = JS_NewContext(state->rt);
+    if (!state || !state->ctx) {
+        if (state && state->rt) JS_FreeRuntime(state->rt);
+        free(state);
+        free(source);
+        return -1;
+    }
+    state->process_chunk = JS_UNDEFINED;
+    state->pending = JS_UNDEFINED;
+    JS_SetMemoryLimit(state->rt, QUICKJS_MEMORY_LIMIT);
+    add_host_functions(state->ctx);
+
+    JSValue evaluated = JS_Eval(state->ctx, source, source_len, quickjs_script_path, JS_EVAL_TYPE_GLOBAL);
+    free(source);
+    if (JS_IsException(evaluated)) {
+        print_exception(state->ctx, "Script failed to load");
+        quickjs_destroy(state);
+        return -1;
+    }
+    JS_FreeValue(state->ctx, evaluated);
+
+    JSValue global = JS_GetGlobalObject(state->ctx);
+    state->process_chunk = JS_GetPropertyStr(state->ctx, global, "processChunk");
+    JSValue init = JS_GetPropertyStr(state->ctx, global, "init");
+    JS_FreeValue(state->ctx, global);
+    if (!JS_IsFunction(state->ctx, state->process_chunk)) {
+        fprintf(stderr, "[QuickJS] %s defines no processChunk function\n", quickjs_script_path);
+        JS_FreeValue(state->ctx, init);
+        quickjs_destroy(state);
+        return -1;
+    }
+    if (JS_IsFunction(state->ctx, init)) {
+        JSValue done = JS_Call(state->ctx, init, JS_UNDEFINED, 0, NULL);
+        if (JS_IsException(done)) print_exception(state->ctx, "init failed");
+        JS_FreeValue(state->ctx, done);
+    }
+    JS_FreeValue(state->ctx, init);
+
+    *opaque = state;
+    return 0;
+}
+
+// Bytes of a processChunk result, held by state->pending until copied out
+static int result_bytes(quickjs_state_t* state, JSValue result) {
+
+    JSContext *ctx = state->ctx;
+    if (JS_IsUndefined(result) || JS_IsNull(result)) {
+        JS_FreeValue(ctx, result);
+        state->pending = JS_UNDEFINED;
+        state->pending_data = NULL;
+        state->pending_len = 0;
+        return 0;
+    }
+
+    if (JS_IsString(result)) {
+        state->pending = result;
+    } else if (JS_IsObject(result) && (state->pending_data = JS_GetArrayBuffer(ctx, &state->pending_len, result))) {
+        state->pending = result;
+        return 0;
+    } else if (JS_IsObject(result)) {
+        JS_FreeValue(ctx, JS_GetException(ctx)); // Not an ArrayBuffer
+        size_t offset = 0, length = 0, element = 0;
+        JSValue buffer = JS_GetTypedArrayBuffer(ctx, result, &offset, &length, &element);
+        if (!JS_IsException(buffer)) {
+            size_t size = 0;
+            uint8_t *bytes = JS_GetArrayBuffer(ctx, &size, buffer);
+            JS_FreeValue(ctx, result);
+            if (!bytes || offset + length > size) {
+                JS_FreeValue(ctx, buffer);
+                return -1;
+            }
+            state->pending = buffer;
+            state->pending_data = bytes + offset;
+            state->pending_len = length;
+            return 0;
+        }
+        JS_FreeValue(ctx, JS_GetException(ctx)); // Not a typed array either
+        state->pending = JS_JSONStringify(ctx, result, JS_UNDEFINED, JS_UNDEFINED);
+        JS_FreeValue(ctx, result);
+        if (JS_IsException(state->pending)) {
+            print_exception(ctx, "Result is not serialisable");
+            state->pending = JS_UNDEFINED;
+            return -1;
+        }
+    } else {
+        state->pending = JS_JSONStringify(ctx, result, JS_UNDEFINED, JS_UNDEFINED);
+        JS_FreeValue(ctx, result);
+    }
+
+    // Strings are handed out as UTF-8; the converted copy replaces the value
+    size_t len = 0;
+    const char *text = JS_ToCStringLen(ctx, &len, state->pending);
+    JS_FreeValue(ctx, state->pending);
+    state->pending = JS_UNDEFINED;
+    if (!text) return -1;
+    state->pending = JS_NewArrayBufferCopy(ctx, (const uint8_t*)text, len);
+    JS_FreeCString(ctx, text);
+    state->pending_data = JS_GetArrayBuffer(ctx, &state->pending_len, state->pending);
+    return state->pending_data || len == 0 ? 0 : -1;
+}
+
+static int quickjs_process(void* opaque, const volcom_plugin_buffer_t* in, volcom_plugin_buffer_t* out) {
+
+    quickjs_state_t *state = opaque;
+    JSContext *ctx = state->ctx;
+
+    if (JS_IsUndefined(state->pending)) {
+        // No copy: the ArrayBuffer is the host's mapping of the chunk
+        JSValue chunk = JS_NewArrayBuffer(ctx, (uint8_t*)in->data, in->len, NULL, NULL, 0);
+        JSValue result = JS_Call(ctx, state->process_chunk, JS_UNDEFINED, 1, (JSValueConst*)&chunk);
+        // A script returning the chunk itself is read before it is detached,
+        // the mapping outlives every call for this chunk
+        int status = 0;
+        if (JS_IsException(result)) {
+            print_exception(ctx, "processChunk failed");
+            status = -1;
+        } else {
+            status = result_bytes(state, result);
+        }
+        JS_DetachArrayBuffer(ctx, chunk);
+        JS_FreeValue(ctx, chunk);
+        if (status != 0) return -1;
+    }
+
+    out->len = state->pending_len;
+    if (state->pending_len > out->capacity) return VOLCOM_PLUGIN_GROW;
+    if (state->pending_len > 0) memcpy(out->data, state->pending_data, state->pending_len);
+    JS_FreeValue(ctx, state->pending);
+    state->pending = JS_UNDEFINED;
+    state->pending_data = NULL;
+    state->pending_len = 0;
+    return VOLCOM_PLUGIN_OK;
+}
+
+static const volcom_plugin_t quickjs_plugin = {
+    .abi_version = VOLCOM_PLUGIN_ABI_VERSION,
+    .name = "quickjs",
+    .init = quickjs_init,
+    .process = quickjs_process,
+    .destroy = quickjs_destroy,
+};
+
+// The built-in plugin running script_path, for a plugin host process
+const volcom_plugin_t* quickjs_runtime_plugin(const char* script_path) {
+
+    snprintf(quickjs_script_path, sizeof(quickjs_script_path), "%s", script_path);
+    return &quickjs_plugin;
+}
+
+#endif // VOLCOM_WITH_QUICKJS
@@ -9,12 +9,18 @@
 #include <unistd.h>
 #include <stdbool.h>
 #include <string.h>
+#include <ctype.h>
 #include <signal.h>
 #include <pthread.h>
 #include <sys/socket.h>
 #include <sys/select.h>
+#include <sys/epoll.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <fcntl.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <errno.h>
@@ -25,23 +31,126 @@
 #define RESOURCE_THRESHOLD_PERCENT 80.0
 #define EMPLOYEE_PORT 12345
 
-int run_node_in_cgroup(struct volcom_rcsmngr_s *manager, const char *task_name, const char *script_path);
+pid_t run_node_in_cgroup(struct volcom_rcsmngr_s *manager, const char *task_name, const char *script_path,
+                         const char *job_script, const char *socket_path, int ready_fd);
 
 // Forward declarations
-static int send_result_to_employer(int sockfd, const result_info_t* result);
+static void flush_partial(job_runtime_t* runtime);
+static int send_result_to_employer(int sockfd, const result_info_t* result, long* calls);
 static int receive_task_from_employer(int sockfd, received_task_t* task);
 
 // Global state for employee mode
 static bool employee_running = false;
 static pthread_t broadcaster_thread;
-static pthread_t worker_thread;
 static result_queue_t result_queue; // Global result queue
 static agent_status_t employee_status;
-static bool is_node_started = false;
-static bool unix_socket_connected = false;
 
-// Buffer for data chunks
-static task_buffer_t data_chunk_buffer; // Buffer for incoming data chunks
+// Where this employee listens and announces itself. Several employees can share
+// a host (e.g. over loopback) by giving each its own employee_port.
+static int employee_port = EMPLOYEE_PORT;
+static char runtime_socket_base[40] = "/tmp/volcom_unix_socket"; // Leaves room for a job id
+static int runtime_workers = 1; // Script processes per job runtime, one per allocated CPU
+static volatile long last_cold_start_ms = -1; // Until the latest runtime's first worker was ready, broadcast
+
+// Bytes of queued results held in memory, see queue_result
+static size_t result_memory_used = 0;
+static size_t result_memory_limit = 64 * 1024 * 1024;
+static pthread_mutex_t result_memory_mutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile bool memory_pressured = false; // Sampled by the broadcast thread, see update_admission
+
+// Workers block on the chunk buffer and the connection loop on its sockets plus
+// this pipe, which queue_result pokes; the idle wait only bounds shutdown and
+// the combine flush check.
+#define WORKER_IDLE_WAIT_MS 1000
+#define WORKER_SHARE_RECHECK_MS 10
+static int result_wakeup[2] = {-1, -1};
+
+// Messages a worker keeps in its script's socket (pipeline_depth, 1 is lockstep)
+#define WORKER_PIPELINE_DEPTH 2
+static int pipeline_depth = WORKER_PIPELINE_DEPTH;
+
+// A script that announces max_batch gets as many buffered chunks per message
+// as it works through in batch_latency_ms, at its running time per chunk
+#define BATCH_LATENCY_MS 500
+#define BATCH_COST_WEIGHT 0.3 // Share of the latest message in the running time per chunk
+static int batch_latency_ms = BATCH_LATENCY_MS;
+
+// A chunk passes through stages on their own threads, each handing on through
+// a bounded queue: the connection loop receives it into the job's chunk
+// buffer, a worker thread sends it to a script, the worker's collector turns
+// the response into a queued result, and the connection loop uploads that.
+// The status line shows what each stage holds for the next one and how often
+// it stalled: a full chunk buffer, a script left without input, a full result
+// queue, a failed upload.
+typedef enum {
+    STAGE_RECEIVE,
+    STAGE_RUNTIME,
+    STAGE_COLLECT,
+    STAGE_UPLOAD,
+    STAGE_COUNT
+} employee_stage_t;
+
+static long stage_stalls[STAGE_COUNT];
+static pthread_mutex_t stage_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Chunks and runtime responses live in pooled buffers, budgeted from the
+// cgroup's memory.max. A chunk waits up to CHUNK_POOL_WAIT_MS for room, which
+// stalls the employer's connection; a response that finds no room within
+// FRAME_POOL_WAIT_MS is received into plain memory rather than blocking the
+// worker (its result is then queued or spilled like any other).
+#define CHUNK_POOL_MIN_SIZE (64 * 1024)
+#define FRAME_POOL_MIN_SIZE (4 * 1024)
+#define CHUNK_POOL_WAIT_MS 10000
+#define FRAME_POOL_WAIT_MS 100
+#define BUFFER_POOL_DEFAULT_MB 256
+static buffer_pool_t chunk_pool;
+static buffer_pool_t frame_pool;
+
+// One runtime per job this employee currently hosts
+static job_runtime_t job_runtimes[MAX_JOB_RUNTIMES];
+static pthread_mutex_t runtimes_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Employers served at once, each on its own connection with its own job
+// runtimes (and so its own chunk queues). Only the main loop opens and closes
+// connections; id, weight and virtual_ms change under share_mutex.
+#define MAX_EMPLOYERS 8
+#define EMPLOYER_MAX_WEIGHT 100
+#define CHUNK_BUFFER_SLOTS 50 // Per job runtime
+#define SCRIPT_CACHE_DIR "/tmp/volcom_scripts" // Job scripts kept by SHA-256, see store_job_script
+
+// Small results for one employer are coalesced into a single result_batch
+// message, sent once result_batch_max of them or result_batch_kb of payload
+// are waiting, or result_batch_linger_ms after the first one arrived
+#define RESULT_BATCH_LIMIT 64
+static int result_batch_max = 32;
+static size_t result_batch_bytes = 64 * 1024;
+static int result_batch_linger_ms = 2;
+
+typedef struct {
+    unsigned id;                    // 0 while the slot is free
+    int fd;
+    char ip[INET_ADDRSTRLEN];
+    int weight;                     // From the employer's initial_config, default 1
+    double virtual_ms;              // Processing time its chunks got, divided by weight
+    result_info_t batch[RESULT_BATCH_LIMIT]; // Results waiting to go out together
+    int batch_count;
+    size_t batch_bytes;
+    struct timespec batch_started;
+    long results_sent;
+    long frames_sent;
+    long send_calls;
+} employer_conn_t;
+static employer_conn_t employers[MAX_EMPLOYERS];
+static unsigned next_employer_id = 1;
+#define EMPLOYEE_EVENT_ACCEPT MAX_EMPLOYERS        // epoll tokens past the employer slots
+#define EMPLOYEE_EVENT_RESULTS (MAX_EMPLOYERS + 1)
+
+// Chunks of all employers share runtime_workers dispatch slots: a worker
+// holding a chunk waits until a slot is free and its employer has had the
+// least weighted processing time of those waiting.
+static pthread_mutex_t share_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t share_changed = PTHREAD_COND_INITIALIZER;
+static int share_busy = 0;
 
 // TODO: Move to a config file
 struct unix_socket_config_s client_socket_config = {
@@ -60,19 +169,172 @@ static void employee_signal_handler(int sig) {
     printf("\n[Employee] Stopping broadcast and exiting...\n");
 }
 
-// Get memory usage percent
-static double get_current_memory_percent(void) {
-    struct memory_info_s mem = get_memory_info();
-    return calculate_memory_usage_percent(mem);
+// ============================================================================
+// ADMISSION CONTROL
+// ============================================================================
+// Credits are the chunk slots this employee offers, broadcast as "slots".
+// Every broadcast the avg10 PSI of the host and of the volcom cgroup, and the
+// cgroup's memory.current against memory.max, are divided by their limits;
+// the largest ratio is the pressure. At 1 or more the share of credits
+// offered halves, below ADMISSION_RELEASE it grows back by ADMISSION_STEP_UP,
+// and in between it holds, so a host hovering near a limit does not flap.
+// New employers are turned away only while no credit is offered. Without
+// PSI, host memory use against RESOURCE_THRESHOLD_PERCENT stands in.
+#define ADMISSION_CPU_SOME_LIMIT 50.0       // % of time runnable tasks waited for a CPU
+#define ADMISSION_MEMORY_SOME_LIMIT 20.0    // % of time some tasks stalled on memory
+#define ADMISSION_MEMORY_FULL_LIMIT 5.0     // % of time all tasks stalled on memory
+#define ADMISSION_IO_FULL_LIMIT 20.0
+#define ADMISSION_MEMORY_USE_LIMIT 0.9      // memory.current / memory.max
+#define ADMISSION_RELEASE 0.6
+#define ADMISSION_STEP_UP 0.25
+
+typedef struct {
+    double pressure;            // Largest signal over its limit
+    double memory_pressure;     // Same, memory signals only
+    const char *cause;
+} pressure_sample_t;
+
+static double admission_share = 1.0;        // Of the full credits, broadcast thread only
+static volatile int admission_credits = 0;  // None until run_employee_mode offers the full credits
+
+static void weigh_signal(pressure_sample_t* sample, double value, double limit, const char* cause, bool memory) {
+
+    double ratio = value / limit;
+    if (ratio > sample->pressure) {
+        sample->pressure = ratio;
+        sample->cause = cause;
+    }
+    if (memory && ratio > sample->memory_pressure) sample->memory_pressure = ratio;
+}
+
+static pressure_sample_t sample_pressure(struct volcom_rcsmngr_s* manager, double mem_percent) {
+
+    static const char *resources[] = { "cpu", "memory", "io" };
+    static const char *causes[2][3] = {
+        { "host cpu", "host memory", "host io" },
+        { "cgroup cpu", "cgroup memory", "cgroup io" }
+    };
+    pressure_sample_t sample = { 0.0, 0.0, "none" };
+    bool have_psi = false;
+
+    for (int scope = 0; scope < 2; scope++) {
+        for (int i = 0; i < 3; i++) {
+            char path[MAX_PATH_LEN + 32];
+            if (scope == 0) {
+                snprintf(path, sizeof(path), "/proc/pressure/%s", resources[i]);
+            } else {
+                snprintf(path, sizeof(path), "%s/%s.pressure", manager->main_cgroup.path, resources[i]);
+            }
+            struct volcom_pressure_s psi;
+            if (volcom_read_pressure(path, &psi) != 0) continue;
+            have_psi = true;
+            if (i == 0) {
+                weigh_signal(&sample, psi.some_avg10, ADMISSION_CPU_SOME_LIMIT, causes[scope][i], false);
+            } else if (i == 1) {
+                weigh_signal(&sample, psi.some_avg10, ADMISSION_MEMORY_SOME_LIMIT, causes[scope][i], true);
+                weigh_signal(&sample, psi.full_avg10, ADMISSION_MEMORY_FULL_LIMIT, causes[scope][i], true);
+            } else {
+                weigh_signal(&sample, psi.full_avg10, ADMISSION_IO_FULL_LIMIT, causes[scope][i], false);
+            }
+        }
+    }
+
+    unsigned long memory_current = 0;
+    unsigned long memory_max = 0;
+    if (volcom_get_memory_current(manager->main_cgroup.path, &memory_current) == 0 &&
+        volcom_get_memory_limit(manager->main_cgroup.path, &memory_max) == 0 && memory_max > 0) {
+        weigh_signal(&sample, (double)memory_current / memory_max, ADMISSION_MEMORY_USE_LIMIT, "cgroup memory use", true);
+    }
+    if (!have_psi) {
+        weigh_signal(&sample, mem_percent, RESOURCE_THRESHOLD_PERCENT, "host memory use", true);
+    }
+    return sample;
+}
+
+// Chunks in the largest message a worker currently sends
+static int widest_batch(void) {
+
+    int widest = 1;
+    for (int i = 0; i < MAX_JOB_RUNTIMES; i++) {
+        if (!job_runtimes[i].in_use) continue;
+        for (int w = 0; w < job_runtimes[i].worker_count; w++) {
+            if (job_runtimes[i].workers[w].batch_frames > widest) widest = job_runtimes[i].workers[w].batch_frames;
+        }
+    }
+    return widest;
+}
+
+static void update_admission(const pressure_sample_t* sample) {
+
+    if (sample->pressure >= 1.0) {
+        admission_share /= 2;
+    } else if (sample->pressure < ADMISSION_RELEASE) {
+        admission_share += ADMISSION_STEP_UP;
+        if (admission_share > 1.0) admission_share = 1.0;
+    }
+
+    // One message in flight per worker plus two chunks waiting, a batch counting all its chunks
+    int full_credits = runtime_workers * widest_batch() + 2;
+    if (full_credits > CHUNK_BUFFER_SLOTS) full_credits = CHUNK_BUFFER_SLOTS;
+    int credits = (int)(admission_share * full_credits + 0.5);
+    if (credits != admission_credits) {
+        printf("[Employee] Offering %d of %d credits (pressure %.2f, highest: %s)\n", credits, full_credits,
+               sample->pressure, sample->cause);
+    }
+    admission_credits = credits;
+    memory_pressured = sample->memory_pressure >= 1.0;
 }
 
 // Broadcast thread
+static void count_stall(employee_stage_t stage) {
+
+    pthread_mutex_lock(&stage_mutex);
+    stage_stalls[stage]++;
+    pthread_mutex_unlock(&stage_mutex);
+}
+
+// Queue depths are sampled without their locks, they only feed the log
+static void print_stage_status(void) {
+
+    static const char *names[STAGE_COUNT] = { "receive", "runtime", "collect", "upload" };
+    long depth[STAGE_COUNT] = {0};
+    pthread_mutex_lock(&runtimes_mutex);
+    for (int i = 0; i < MAX_JOB_RUNTIMES; i++) {
+        job_runtime_t *runtime = &job_runtimes[i];
+        if (!runtime->in_use) continue;
+        depth[STAGE_RECEIVE] += runtime->chunk_buffer.count;
+        for (int w = 0; w < runtime->worker_count; w++) {
+            depth[STAGE_RUNTIME] += runtime->workers[w].in_flight_count;
+        }
+    }
+    pthread_mutex_unlock(&runtimes_mutex);
+    depth[STAGE_COLLECT] = result_queue.count;
+    for (int i = 0; i < MAX_EMPLOYERS; i++) {
+        if (employers[i].id != 0) depth[STAGE_UPLOAD] += employers[i].batch_count;
+    }
+
+    char line[256];
+    int len = 0;
+    pthread_mutex_lock(&stage_mutex);
+    for (int i = 0; i < STAGE_COUNT && len < (int)sizeof(line); i++) {
+        len += snprintf(line + len, sizeof(line) - len, "%s%s %ld queued, %ld stalls", i > 0 ? "; " : "",
+                        names[i], depth[i], stage_stalls[i]);
+    }
+    pthread_mutex_unlock(&stage_mutex);
+    printf("[Employee] Stages: %s\n", line);
+}
+
 static void* broadcast_loop(void* arg) {
-    (void)arg;
+    struct volcom_rcsmngr_s *manager = arg;
 
     char ip[64] = "Unknown";
     get_local_ip(ip, sizeof(ip));
 
+    const char *address_setting = get_volcom_config_value("discovery_address");
+    const char *port_setting = get_volcom_config_value("discovery_port");
+    const char *discovery_address = address_setting ? address_setting : DISCOVERY_BROADCAST_ADDRESS;
+    int discovery_port = port_setting ? atoi(port_setting) : DISCOVERY_PORT;
+
     while (employee_running) {
         struct memory_info_s mem_info = get_memory_info();
         struct cpu_info_s cpu_info = get_cpu_info();
@@ -81,6 +343,8 @@ static void* broadcast_loop(void* arg) {
         double mem_percent = calculate_memory_usage_percent(mem_info);
         double cpu_percent = cpu_info.overall_usage.usage_percent;
         unsigned long free_mem_mb = mem_info.free / 1024;
+        pressure_sample_t pressure = sample_pressure(manager, mem_percent);
+        update_admission(&pressure);
 
         // Construct JSON broadcast message
         char message[1024];
@@ -95,6 +359,10 @@ static void* broadcast_loop(void* arg) {
               "\"cpu_percent\":%.2f,"
               "\"cpu_model\":\"%s\","
               "\"logical_cores\":%d,"
+              "\"port\":%d,"
+              "\"slots\":%d,"
+              "\"pressure\":%.2f,"
+              "\"cold_start_ms\":%ld,"
               "\"timestamp\":%ld"
             "}",
             employee_status.agent_id,
@@ -104,16 +372,18 @@ static void* broadcast_loop(void* arg) {
             cpu_percent,
             cpu_info.model,
             cpu_info.logical_processors,
+            employee_port,
+            admission_credits,
+            pressure.pressure,
+            last_cold_start_ms,
             time(NULL)
         );
 
-        if (mem_percent < RESOURCE_THRESHOLD_PERCENT) {
-            send_udp_broadcast(message);
-            printf("[Employee] Broadcasting: Memory %.2f%%, CPU %.2f%%\n", 
-                   mem_percent, cpu_percent);
-        } else {
-            printf("[Employee] Broadcasting paused - high memory usage: %.2f%%\n", mem_percent);
-        }
+        // Zero credits still goes out, so employers stop sending instead of losing the node
+        send_discovery_message(message, discovery_address, discovery_port);
+        printf("[Employee] Broadcasting: Memory %.2f%%, CPU %.2f%%, pressure %.2f, %d credits\n",
+               mem_percent, cpu_percent, pressure.pressure, admission_credits);
+        print_stage_status();
 
         free_cpu_usage(&cpu_info);
         sleep(BROADCAST_INTERVAL);
@@ -123,298 +393,1028 @@ static void* broadcast_loop(void* arg) {
 }
 
 // ============================================================================
-// HELPER FUNCTIONS FOR JSON HANDLING
+// CORE WORKER THREAD - PROCESSES DATA CHUNKS VIA UNIX SOCKET
 // ============================================================================
 
-// Function to receive complete JSON response from Unix socket
-static ssize_t receive_complete_json_response(char *buffer, size_t buffer_size) {
-    if (!buffer || buffer_size == 0) {
+// Hand a task's payload back to the chunk pool, or free a malloc'd copy
+static void release_task_data(received_task_t* task) {
+
+    if (!task->data) return;
+    if (task->data_buffer) {
+        buffer_pool_release(task->data_buffer);
+        task->data_buffer = NULL;
+    } else {
+        free(task->data);
+    }
+    task->data = NULL;
+}
+
+// Runtime responses are received into frame pool buffers
+static void release_pooled_frame(void* owner) {
+
+    buffer_pool_release(owner);
+}
+
+static char* alloc_pooled_frame(void* ctx, size_t size, protocol_frame_t* frame) {
+
+    pool_buffer_t *buffer = buffer_pool_acquire(ctx, size, FRAME_POOL_WAIT_MS);
+    if (!buffer) return NULL;
+    frame->owner = buffer;
+    frame->release = release_pooled_frame;
+    return buffer->data;
+}
+
+// Size both pools from the cgroup's memory limit: a quarter of memory.max,
+// capped by buffer_pool_mb in volcom.conf. Chunks get three quarters of it.
+static int init_buffer_pools(struct volcom_rcsmngr_s *manager, unsigned long configured_max) {
+
+    unsigned long memory_max = configured_max;
+    unsigned long cgroup_max = 0;
+    if (volcom_get_memory_limit(manager->main_cgroup.path, &cgroup_max) == 0 && cgroup_max > 0) {
+        memory_max = cgroup_max;
+    }
+    size_t budget = (size_t)BUFFER_POOL_DEFAULT_MB * 1024 * 1024;
+    const char *pool_setting = get_volcom_config_value("buffer_pool_mb");
+    if (pool_setting && atoi(pool_setting) > 0) {
+        budget = (size_t)atoi(pool_setting) * 1024 * 1024;
+    }
+    if (memory_max > 0 && memory_max / 4 < budget) {
+        budget = memory_max / 4;
+    }
+
+    // Without memfds chunks still pool, but go to the runtime by content
+    int probe_fd = memfd_create("volcom_probe", MFD_CLOEXEC);
+    buffer_pool_backing_t chunk_backing = probe_fd >= 0 ? BUFFER_POOL_MEMFD : BUFFER_POOL_HEAP;
+    if (probe_fd >= 0) close(probe_fd);
+
+    if (buffer_pool_init(&chunk_pool, "volcom_chunk", chunk_backing, CHUNK_POOL_MIN_SIZE, budget / 4 * 3) != 0) {
         return -1;
     }
-    
-    memset(buffer, 0, buffer_size);
-    ssize_t total_bytes = 0;
-    int brace_count = 0;
-    bool in_string = false;
-    bool escape_next = false;
-    bool json_started = false;
-    
-    // Read response in chunks until we have a complete JSON object
-    while (total_bytes < (ssize_t)buffer_size - 1) {
-        char temp_buffer[1024];
-        ssize_t chunk_bytes = unix_socket_client_receive_message(temp_buffer, sizeof(temp_buffer) - 1);
-        
-        if (chunk_bytes <= 0) {
-            if (total_bytes > 0) {
-                // We have some data, might be complete
-                break;
+    if (buffer_pool_init(&frame_pool, "volcom_frame", BUFFER_POOL_HEAP, FRAME_POOL_MIN_SIZE, budget / 4) != 0) {
+        buffer_pool_cleanup(&chunk_pool);
+        return -1;
+    }
+    printf("[Employee] Buffer pools: %zu KB for chunks, %zu KB for responses\n",
+           budget / 4 * 3 / 1024, budget / 4 / 1024);
+    return 0;
+}
+
+static void cleanup_buffer_pools(void) {
+
+    buffer_pool_print_stats(&chunk_pool);
+    buffer_pool_print_stats(&frame_pool);
+    buffer_pool_cleanup(&chunk_pool);
+    buffer_pool_cleanup(&frame_pool);
+}
+
+// Stop a worker's script process. Runs on the worker's thread; the last worker
+// of a runtime uploads what is left of the partial and frees the slot.
+static void shutdown_runtime_worker(runtime_worker_t* worker) {
+
+    job_runtime_t *runtime = worker->runtime;
+
+    pthread_mutex_lock(&worker->window_mutex);
+    worker->is_connected = false;
+    pthread_mutex_unlock(&worker->window_mutex);
+    unix_socket_conn_close(&worker->conn);
+    if (worker->pid > 0) {
+        kill(worker->pid, SIGTERM);
+        waitpid(worker->pid, NULL, 0);
+        worker->pid = 0;
+    }
+    unlink(worker->socket_path);
+    worker->is_started = false;
+
+    pthread_mutex_lock(&runtimes_mutex);
+    bool last_worker = --runtime->workers_running == 0;
+    pthread_mutex_unlock(&runtimes_mutex);
+    if (!last_worker) return;
+
+    pthread_mutex_lock(&runtime->partial_mutex);
+    flush_partial(runtime);
+    pthread_mutex_unlock(&runtime->partial_mutex);
+
+    long chunks_processed = 0;
+    for (int i = 0; i < runtime->worker_count; i++) {
+        chunks_processed += runtime->workers[i].chunks_processed;
+    }
+    printf("[Employee] Runtime for job %s stopped after %ld chunks on %d workers (urgent %ld, retry %ld, bulk %ld)\n",
+           runtime->job_id, chunks_processed, runtime->worker_count, runtime->chunk_buffer.taken[TASK_LANE_URGENT],
+           runtime->chunk_buffer.taken[TASK_LANE_RETRY], runtime->chunk_buffer.taken[TASK_LANE_BULK]);
+
+    received_task_t leftover;
+    while (get_task_from_buffer(&runtime->chunk_buffer, &leftover) == 0) {
+        release_task_data(&leftover);
+    }
+
+    // Every other worker is past its loop, none looks at a window any more
+    for (int i = 0; i < runtime->worker_count; i++) {
+        pthread_cond_destroy(&runtime->workers[i].window_changed);
+        pthread_mutex_destroy(&runtime->workers[i].window_mutex);
+    }
+
+    pthread_mutex_lock(&runtimes_mutex);
+    runtime->in_use = false;
+    pthread_mutex_unlock(&runtimes_mutex);
+}
+
+// A runtime takes chunks from the employer once any of its workers is connected
+static bool is_runtime_ready(const job_runtime_t* runtime) {
+
+    for (int i = 0; i < runtime->worker_count; i++) {
+        if (runtime->workers[i].is_started && runtime->workers[i].is_connected) return true;
+    }
+    return false;
+}
+
+static long elapsed_ms(const struct timespec* since) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000 + (now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+static employer_conn_t* find_employer(unsigned id) {
+
+    if (id == 0) return NULL;
+    for (int i = 0; i < MAX_EMPLOYERS; i++) {
+        if (employers[i].id == id) return &employers[i];
+    }
+    return NULL;
+}
+
+// Where a newcomer starts, so it cannot claim the time it was not connected.
+// Under share_mutex.
+static double min_virtual_ms(void) {
+
+    double min = -1.0;
+    for (int i = 0; i < MAX_EMPLOYERS; i++) {
+        if (employers[i].id != 0 && (min < 0 || employers[i].virtual_ms < min)) min = employers[i].virtual_ms;
+    }
+    return min < 0 ? 0.0 : min;
+}
+
+// Runtimes whose employer disconnected are charged like a newcomer. Under share_mutex.
+static double runtime_virtual_ms(const job_runtime_t* runtime) {
+
+    employer_conn_t *employer = find_employer(runtime->employer_id);
+    return employer ? employer->virtual_ms : min_virtual_ms();
+}
+
+static bool is_runtime_next(const job_runtime_t* runtime) {
+
+    double own = runtime_virtual_ms(runtime);
+    for (int i = 0; i < MAX_JOB_RUNTIMES; i++) {
+        if (job_runtimes[i].share_waiting > 0 && runtime_virtual_ms(&job_runtimes[i]) < own) return false;
+    }
+    return true;
+}
+
+static void acquire_worker_share(job_runtime_t* runtime) {
+
+    pthread_mutex_lock(&share_mutex);
+    runtime->share_waiting++;
+    while (share_busy >= runtime_workers || !is_runtime_next(runtime)) {
+        pthread_cond_wait(&share_changed, &share_mutex);
+    }
+    runtime->share_waiting--;
+    share_busy++;
+    pthread_cond_broadcast(&share_changed); // The next in line may fit in a slot still free
+    pthread_mutex_unlock(&share_mutex);
+}
+
+static void release_worker_share(job_runtime_t* runtime, long busy_ms) {
+
+    pthread_mutex_lock(&share_mutex);
+    share_busy--;
+    employer_conn_t *employer = find_employer(runtime->employer_id);
+    if (employer) employer->virtual_ms += (double)(busy_ms > 0 ? busy_ms : 1) / employer->weight;
+    pthread_cond_broadcast(&share_changed);
+    pthread_mutex_unlock(&share_mutex);
+}
+
+// Results wait for the employer in memory, in the buffer the runtime's
+// response was received into. A result is spilled to its result_filepath
+// instead when the in-memory results would exceed result_memory_limit or
+// memory is under pressure (see update_admission).
+static bool reserve_result_memory(size_t size) {
+
+    pthread_mutex_lock(&result_memory_mutex);
+    bool reserved = result_memory_used + size <= result_memory_limit;
+    if (reserved) result_memory_used += size;
+    pthread_mutex_unlock(&result_memory_mutex);
+    return reserved;
+}
+
+static void release_result(result_info_t* result) {
+
+    if (result->payload.data) {
+        pthread_mutex_lock(&result_memory_mutex);
+        result_memory_used -= result->payload.len;
+        pthread_mutex_unlock(&result_memory_mutex);
+        free_frame(&result->payload);
+    } else if (result->kind != RESULT_KIND_ACK && result->result_filepath[0] != '\0') {
+        unlink(result->result_filepath); // Spilled only to be sent
+    }
+}
+
+// Let the connection loop send what was just queued
+static void wake_result_sender(void) {
+    char wake = 1;
+    if (write(result_wakeup[1], &wake, 1) < 0 && errno != EAGAIN) {
+        perror("[Employee] result wakeup");
+    }
+}
+
+// Queue a result for the employer, taking ownership of payload
+static int queue_result(result_info_t* result, protocol_frame_t* payload) {
+
+    memset(&result->payload, 0, sizeof(result->payload));
+    if (!memory_pressured && reserve_result_memory(payload->len)) {
+        result->payload = *payload;
+    } else {
+        FILE *spill_file = fopen(result->result_filepath, "wb");
+        bool written = spill_file && fwrite(payload->data, 1, payload->len, spill_file) == payload->len;
+        if (spill_file && fclose(spill_file) != 0) written = false;
+        free_frame(payload);
+        if (!written) {
+            printf("[Employee] Failed to spill result for task %s to %s\n", result->task_id, result->result_filepath);
+            unlink(result->result_filepath);
+            return -1;
+        }
+        printf("[Employee] Memory pressure, result for task %s spilled to %s\n", result->task_id, result->result_filepath);
+    }
+    memset(payload, 0, sizeof(*payload));
+
+    if (add_result_to_queue(&result_queue, result) != 0) {
+        count_stall(STAGE_COLLECT);
+        release_result(result);
+        return -1;
+    }
+    wake_result_sender();
+    return 0;
+}
+
+// Value of a top-level string field, found by skipping over the rest of the
+// document without parsing it. Escapes are copied as they are.
+static bool find_top_level_string(const char* json, size_t len, const char* key, char* out, size_t out_size) {
+
+    size_t key_len = strlen(key);
+    int depth = 0;
+    bool expect_key = false;
+    for (size_t i = 0; i < len; i++) {
+        char c = json[i];
+        if (c == '{' || c == '[') {
+            depth++;
+            expect_key = c == '{' && depth == 1;
+        } else if (c == '}' || c == ']') {
+            depth--;
+        } else if (c == ',') {
+            expect_key = depth == 1;
+        } else if (c == '"') {
+            size_t start = ++i;
+            while (i < len && json[i] != '"') {
+                if (json[i] == '\\') i++;
+                i++;
             }
-            return chunk_bytes; // Error or no data
+            if (i >= len) return false;
+            if (!expect_key) continue;
+            expect_key = false;
+            if (i - start != key_len || strncmp(json + start, key, key_len) != 0) continue;
+
+            // The key matched, its value follows the colon
+            i++;
+            while (i < len && (json[i] == ' ' || json[i] == '\t' || json[i] == '\n' || json[i] == '\r' || json[i] == ':')) i++;
+            if (i >= len || json[i] != '"') return false;
+            size_t value_start = ++i;
+            while (i < len && json[i] != '"') {
+                if (json[i] == '\\') i++;
+                i++;
+            }
+            if (i >= len) return false;
+            size_t value_len = i - value_start;
+            if (value_len >= out_size) value_len = out_size - 1;
+            memcpy(out, json + value_start, value_len);
+            out[value_len] = '\0';
+            return true;
         }
-        
-        // Ensure null termination of chunk
-        temp_buffer[chunk_bytes] = '\0';
-        
-        // Check if we can fit this chunk
-        if (total_bytes + chunk_bytes >= (ssize_t)buffer_size) {
-            // Truncate to fit
-            chunk_bytes = buffer_size - total_bytes - 1;
+    }
+    return false;
+}
+
+// Results go back over the connection of the employer that owns the job
+static void address_result(result_info_t* result, const job_runtime_t* runtime) {
+
+    strncpy(result->job_id, runtime->job_id, sizeof(result->job_id) - 1);
+    strncpy(result->employer_ip, runtime->employer_ip, sizeof(result->employer_ip) - 1);
+    pthread_mutex_lock(&share_mutex); // Changes when a reconnected employer adopts the job
+    result->employer_id = runtime->employer_id;
+    pthread_mutex_unlock(&share_mutex);
+}
+
+// Combine jobs: upload the chunks folded so far as one partial result
+// {"tasks":[...],"value":...}. Caller holds the runtime's partial_mutex.
+static void flush_partial(job_runtime_t* runtime) {
+
+    if (!runtime->partial) return;
+
+    cJSON *partial = cJSON_CreateObject();
+    cJSON_AddItemToObject(partial, "tasks", runtime->partial_tasks);
+    cJSON_AddItemToObject(partial, "value", runtime->partial);
+    char *text = cJSON_PrintUnformatted(partial);
+
+    result_info_t result_info;
+    memset(&result_info, 0, sizeof(result_info));
+    snprintf(result_info.task_id, sizeof(result_info.task_id), "partial_%s_%ld", runtime->job_id, runtime->partial_seq);
+    snprintf(result_info.result_filepath, sizeof(result_info.result_filepath), "/tmp/node_partial_%s_%ld.json",
+             runtime->file_tag, runtime->partial_seq);
+    runtime->partial_seq++;
+    address_result(&result_info, runtime);
+    result_info.kind = RESULT_KIND_PARTIAL;
+    result_info.task_count = runtime->partial_count;
+
+    protocol_frame_t payload = { .data = text, .len = text ? (uint32_t)strlen(text) : 0 };
+    if (text && queue_result(&result_info, &payload) == 0) {
+        printf("[Employee] Partial result of job %s (%d chunks) queued for transmission to employer\n",
+               runtime->job_id, runtime->partial_count);
+    } else {
+        // The employer times the chunks out and sends them again
+        printf("[Employee] Failed to queue partial result of job %s\n", runtime->job_id);
+    }
+
+    cJSON_Delete(partial); // Owns partial and partial_tasks
+    runtime->partial = NULL;
+    runtime->partial_tasks = NULL;
+    runtime->partial_count = 0;
+}
+
+// Combine jobs: fold a chunk's response into the pending partial and tell the
+// employer the chunk is done with, so it can send the next one. The runtime's
+// workers share the partial.
+static void fold_into_partial(job_runtime_t* runtime, const received_task_t* data_chunk, const cJSON* response) {
+
+    pthread_mutex_lock(&runtime->partial_mutex);
+    if (!runtime->partial) {
+        runtime->partial = cJSON_Duplicate(response, 1);
+        runtime->partial_tasks = cJSON_CreateArray();
+        runtime->partial_started = time(NULL);
+        if (!runtime->partial || !runtime->partial_tasks) {
+            cJSON_Delete(runtime->partial);
+            cJSON_Delete(runtime->partial_tasks);
+            runtime->partial = runtime->partial_tasks = NULL;
+            pthread_mutex_unlock(&runtime->partial_mutex);
+            printf("[Employee] Out of memory folding result of task %s\n", data_chunk->task_id);
+            return;
         }
-        
-        // Copy chunk to main buffer
-        memcpy(buffer + total_bytes, temp_buffer, chunk_bytes);
-        total_bytes += chunk_bytes;
-        
-        // Parse through the new chunk to check for complete JSON
-        for (ssize_t i = total_bytes - chunk_bytes; i < total_bytes; i++) {
-            char c = buffer[i];
-            
-            if (escape_next) {
-                escape_next = false;
-                continue;
-            }
-            
-            if (in_string) {
-                if (c == '\\') {
-                    escape_next = true;
-                } else if (c == '"') {
-                    in_string = false;
-                }
-                continue;
+    } else if (combine_merge(runtime->partial, response) != 0) {
+        pthread_mutex_unlock(&runtime->partial_mutex);
+        printf("[Employee] Out of memory folding result of task %s\n", data_chunk->task_id);
+        return;
+    }
+    cJSON_AddItemToArray(runtime->partial_tasks, cJSON_CreateString(data_chunk->task_id));
+    runtime->partial_count++;
+
+    result_info_t ack;
+    memset(&ack, 0, sizeof(ack));
+    strncpy(ack.task_id, data_chunk->task_id, sizeof(ack.task_id) - 1);
+    address_result(&ack, runtime);
+    ack.kind = RESULT_KIND_ACK;
+    if (add_result_to_queue(&result_queue, &ack) != 0) {
+        printf("[Employee] Failed to queue acknowledgement for task %s\n", data_chunk->task_id);
+    } else {
+        wake_result_sender();
+    }
+
+    if (runtime->partial_count >= runtime->combine_batch) {
+        flush_partial(runtime);
+    }
+    pthread_mutex_unlock(&runtime->partial_mutex);
+}
+
+// Queue a runtime's response for the employer, taking ownership of response.
+// Only the top-level "status" is checked and the payload goes out as received;
+// combine jobs parse it to fold it into the partial.
+static void handle_runtime_response(job_runtime_t* runtime, const received_task_t* data_chunk, protocol_frame_t* response) {
+
+    if (runtime->combine != COMBINE_NONE) {
+        cJSON *response_json = cJSON_ParseWithLength(response->data, response->len);
+        free_frame(response);
+        if (!response_json || !cJSON_IsString(cJSON_GetObjectItem(response_json, "status"))) {
+            printf("[Employee] Invalid response for task %s, missing or invalid status field\n", data_chunk->task_id);
+            cJSON_Delete(response_json);
+            return;
+        }
+        fold_into_partial(runtime, data_chunk, response_json);
+        cJSON_Delete(response_json);
+        return;
+    }
+
+    // Plugin results are opaque, a failed chunk comes back empty
+    char status[32] = "plugin";
+    if (runtime->engine == SCRIPT_RUNTIME_NODE && !find_top_level_string(response->data, response->len, "status", status, sizeof(status))) {
+        printf("[Employee] Invalid response for task %s, missing or invalid status field\n", data_chunk->task_id);
+        printf("[Employee] Raw response preview: %.200s\n", response->data);
+        free_frame(response);
+        return;
+    }
+
+    result_info_t result_info;
+    memset(&result_info, 0, sizeof(result_info));
+    strncpy(result_info.task_id, data_chunk->task_id, sizeof(result_info.task_id) - 1);
+    address_result(&result_info, runtime);
+    int path_len = snprintf(result_info.result_filepath, sizeof(result_info.result_filepath),
+                            "/tmp/node_result_%s.json", data_chunk->task_id);
+    if (path_len < 0 || (size_t)path_len >= sizeof(result_info.result_filepath)) {
+        printf("[Employee] Task id %s too long for a result path\n", data_chunk->task_id);
+        free_frame(response);
+        return;
+    }
+
+    uint32_t size = response->len;
+    if (queue_result(&result_info, response) == 0) {
+        printf("[Employee] Result for task %s (%s, %u bytes) queued for transmission to employer\n",
+               data_chunk->task_id, status, size);
+    } else {
+        printf("[Employee] Failed to queue result for task %s\n", data_chunk->task_id);
+    }
+}
+
+// Stop using a worker's script after a broken frame. The message the script
+// was working on is dropped, the employer resends its chunks after the task
+// timeout; the others it was sent go back to the buffer for another worker. A
+// message still being sent is left to the worker thread.
+static void abandon_window(runtime_worker_t* worker) {
+
+    job_runtime_t *runtime = worker->runtime;
+    pthread_mutex_lock(&worker->window_mutex);
+    worker->is_connected = false;
+    int sent = worker->in_flight_sent;
+    if (sent > 0) {
+        int working_on = worker->message_frames[worker->message_head];
+        for (int i = 0; i < sent; i++) {
+            received_task_t *chunk = &worker->in_flight[(worker->in_flight_head + i) % worker->in_flight_capacity];
+            if (i < working_on) {
+                printf("[Employee] Chunk %s lost with job %s worker %d\n", chunk->task_id, runtime->job_id, worker->index);
+            } else if (!runtime->stopping && add_task_to_buffer(&runtime->chunk_buffer, chunk) == 0) {
+                continue; // The buffer now owns the data
             }
-            
-            // Not in string
-            switch (c) {
-                case '"':
-                    in_string = true;
-                    break;
-                case '{':
-                    if (!json_started) json_started = true;
-                    brace_count++;
-                    break;
-                case '}':
-                    brace_count--;
-                    if (json_started && brace_count == 0) {
-                        // Complete JSON object received
-                        buffer[total_bytes] = '\0';
-                        return total_bytes;
-                    }
-                    break;
+            release_task_data(chunk);
+        }
+        for (int dropped = 0; dropped < sent; worker->message_count--) {
+            dropped += worker->message_frames[worker->message_head];
+            worker->message_head = (worker->message_head + 1) % WORKER_PIPELINE_MAX;
+        }
+        worker->in_flight_head = (worker->in_flight_head + sent) % worker->in_flight_capacity;
+    }
+    worker->in_flight_count -= sent;
+    worker->in_flight_sent = 0;
+    bool ran_dry = sent > 0 && worker->in_flight_count == 0;
+    pthread_cond_broadcast(&worker->window_changed);
+    pthread_mutex_unlock(&worker->window_mutex);
+    if (ran_dry) release_worker_share(runtime, elapsed_ms(&worker->busy_since));
+}
+
+// Fit the next messages into batch_latency_ms at the script's running time per
+// chunk, from the time it spent on the message just answered
+static void adapt_batch(runtime_worker_t* worker, int frames, long busy_ms) {
+
+    double frame_ms = (double)busy_ms / frames;
+    worker->frame_ms = worker->frame_ms > 0 ? worker->frame_ms + BATCH_COST_WEIGHT * (frame_ms - worker->frame_ms)
+                                            : frame_ms;
+    int fit = worker->frame_ms > 0 ? (int)(batch_latency_ms / worker->frame_ms) : worker->max_batch;
+    if (fit < 1) fit = 1;
+    if (fit > worker->max_batch) fit = worker->max_batch;
+    if (fit != worker->batch_frames) {
+        printf("[Employee] Job %s worker %d now batches up to %d chunks (%.1f ms per chunk)\n",
+               worker->runtime->job_id, worker->index, fit, worker->frame_ms);
+    }
+    worker->batch_frames = fit;
+}
+
+// A batch response is one frame holding each chunk's result, in the order the
+// chunks were sent, as a 4-byte big-endian length and that many bytes. Each is
+// copied into a frame of its own, so its result is queued like any other.
+static int split_batch_response(const protocol_frame_t* response, int frames, protocol_frame_t* results) {
+
+    size_t offset = 0;
+    int count = 0;
+    while (count < frames && offset + sizeof(uint32_t) <= response->len) {
+        uint32_t len;
+        memcpy(&len, response->data + offset, sizeof(len));
+        len = ntohl(len);
+        offset += sizeof(len);
+        if (len > response->len - offset) break;
+        protocol_frame_t *result = &results[count];
+        memset(result, 0, sizeof(*result));
+        result->data = alloc_pooled_frame(&frame_pool, (size_t)len + 1, result);
+        if (!result->data) result->data = malloc((size_t)len + 1);
+        if (!result->data) break;
+        memcpy(result->data, response->data + offset, len);
+        result->data[len] = '\0';
+        result->len = len;
+        offset += len;
+        count++;
+    }
+    if (count == frames && offset == response->len) return 0;
+    for (int i = 0; i < count; i++) free_frame(&results[i]);
+    return -1;
+}
+
+// Queue the script's response to one chunk and let go of the chunk
+static void deliver_response(runtime_worker_t* worker, received_task_t* data_chunk, protocol_frame_t* response) {
+
+    if (response->len > 0) {
+        printf("[Employee] Node script response received (%u bytes)\n", response->len);
+        handle_runtime_response(worker->runtime, data_chunk, response);
+        worker->chunks_processed++;
+    } else {
+        printf("[Employee] Empty response from node script\n");
+        free_frame(response);
+    }
+    release_task_data(data_chunk);
+}
+
+// Collector of a worker: takes the script's responses, oldest message first,
+// and turns them into results while the script already works on the next one
+static void* collector_loop(void* arg) {
+    runtime_worker_t *worker = (runtime_worker_t*)arg;
+    job_runtime_t *runtime = worker->runtime;
+
+    for (;;) {
+        pthread_mutex_lock(&worker->window_mutex);
+        while (worker->in_flight_sent == 0 && worker->is_connected && employee_running && !runtime->stopping) {
+            struct timespec deadline;
+            deadline_after_ms(&deadline, WORKER_IDLE_WAIT_MS);
+            pthread_cond_timedwait(&worker->window_changed, &worker->window_mutex, &deadline);
+        }
+        bool answered_all = worker->in_flight_sent == 0;
+        pthread_mutex_unlock(&worker->window_mutex);
+        if (answered_all) break; // Stopping, or the connection is gone
+
+        // The response comes back inline (one sized receive into a pool buffer) or by descriptor (mapped)
+        protocol_frame_t response_frame;
+        protocol_status_t frame_status = recv_frame_alloc(worker->conn.sockfd, &response_frame,
+                                                          alloc_pooled_frame, &frame_pool);
+        if (frame_status != PROTOCOL_OK) {
+            // A broken frame leaves the stream out of step, stop using this worker
+            printf("[Employee] Failed to receive response from job %s worker %d\n", runtime->job_id, worker->index);
+            pthread_mutex_lock(&worker->window_mutex);
+            worker->is_connected = false;
+            pthread_mutex_unlock(&worker->window_mutex);
+            wake_task_buffer(&runtime->chunk_buffer);
+            break;
+        }
+
+        // The script started on the message once it was sent and the one
+        // before it answered
+        received_task_t chunks[WORKER_BATCH_MAX];
+        pthread_mutex_lock(&worker->window_mutex);
+        int frames = worker->message_frames[worker->message_head];
+        const struct timespec *sent_at = &worker->message_sent[worker->message_head];
+        const struct timespec *started = sent_at->tv_sec > worker->last_response.tv_sec ||
+            (sent_at->tv_sec == worker->last_response.tv_sec && sent_at->tv_nsec > worker->last_response.tv_nsec)
+            ? sent_at : &worker->last_response;
+        if (worker->max_batch > 1) adapt_batch(worker, frames, elapsed_ms(started));
+        clock_gettime(CLOCK_MONOTONIC, &worker->last_response);
+        worker->message_head = (worker->message_head + 1) % WORKER_PIPELINE_MAX;
+        worker->message_count--;
+        for (int i = 0; i < frames; i++) {
+            chunks[i] = worker->in_flight[(worker->in_flight_head + i) % worker->in_flight_capacity];
+        }
+        worker->in_flight_head = (worker->in_flight_head + frames) % worker->in_flight_capacity;
+        worker->in_flight_count -= frames;
+        worker->in_flight_sent -= frames;
+        bool ran_dry = worker->in_flight_count == 0;
+        pthread_cond_broadcast(&worker->window_changed);
+        pthread_mutex_unlock(&worker->window_mutex);
+
+        if (frames == 1) {
+            deliver_response(worker, &chunks[0], &response_frame);
+        } else {
+            protocol_frame_t results[WORKER_BATCH_MAX];
+            if (split_batch_response(&response_frame, frames, results) == 0) {
+                printf("[Employee] Batch response received (%u bytes for %d chunks)\n", response_frame.len, frames);
+                for (int i = 0; i < frames; i++) deliver_response(worker, &chunks[i], &results[i]);
+            } else {
+                // Only this frame is off, the stream is still in step
+                printf("[Employee] Malformed batch response from job %s worker %d, dropping %d chunks\n",
+                       runtime->job_id, worker->index, frames);
+                for (int i = 0; i < frames; i++) release_task_data(&chunks[i]);
             }
+            free_frame(&response_frame);
         }
-        
-        // If we haven't started seeing JSON yet, keep reading
-        if (!json_started) {
-            continue;
+        if (ran_dry) {
+            // Nothing was queued behind this chunk, the script waits for input
+            count_stall(STAGE_RUNTIME);
+            release_worker_share(runtime, elapsed_ms(&worker->busy_since));
         }
-        
-        // Small delay to avoid busy waiting
-        usleep(10000); // 10ms
     }
-    
-    buffer[total_bytes] = '\0';
-    return total_bytes;
+
+    abandon_window(worker);
+    return NULL;
 }
 
-// ============================================================================
-// CORE WORKER THREAD - PROCESSES DATA CHUNKS VIA UNIX SOCKET
-// ============================================================================
+// Whether a busy worker may queue another chunk behind the ones its script
+// has. Not while another runtime waits for a worker share, which it only gets
+// once this worker's window is empty.
+static bool may_queue_more(void) {
+
+    pthread_mutex_lock(&share_mutex);
+    bool contended = false;
+    for (int i = 0; i < MAX_JOB_RUNTIMES && !contended; i++) {
+        contended = job_runtimes[i].share_waiting > 0;
+    }
+    pthread_mutex_unlock(&share_mutex);
+    return !contended;
+}
+
+// Let the collector finish: on a job release it takes the responses still
+// due, on shutdown the script is cut off
+static void stop_collector(runtime_worker_t* worker) {
+
+    if (worker->has_collector) {
+        if (!employee_running) shutdown(worker->conn.sockfd, SHUT_RDWR);
+        pthread_mutex_lock(&worker->window_mutex);
+        pthread_cond_broadcast(&worker->window_changed);
+        pthread_mutex_unlock(&worker->window_mutex);
+        pthread_join(worker->collector, NULL);
+        worker->has_collector = false;
+    } else {
+        abandon_window(worker);
+    }
+    free(worker->in_flight);
+    worker->in_flight = NULL;
+}
 
-// Worker thread to process data chunks and communicate with node script
+// Send a chunk to the script as one frame, by descriptor when it is in a memfd
+static protocol_status_t send_chunk(int sockfd, const received_task_t* chunk) {
+
+    if (chunk->data_buffer && chunk->data_buffer->fd >= 0) return send_frame_fd(sockfd, chunk->data_buffer->fd);
+    return send_frame(sockfd, chunk->data, (uint32_t)chunk->data_size);
+}
+
+// Announce that the next frames chunks make up one batch, answered by a single
+// response (see split_batch_response)
+static protocol_status_t send_batch_header(int sockfd, int frames) {
+
+    char header[64];
+    int len = snprintf(header, sizeof(header), "{\"type\":\"frame_batch\",\"frames\":%d}", frames);
+    return send_frame(sockfd, header, (uint32_t)len);
+}
+
+// Worker thread of a script process: sends chunks from the job's buffer while
+// its collector thread takes the responses. Up to pipeline_depth messages are
+// in the script's socket at once, so the script never waits for the employee
+// to handle a response or fetch the next chunk. Every worker of a runtime takes
+// chunks from the same buffer, so a chunk goes to whichever script has room.
 static void* worker_loop(void* arg) {
-    (void)arg;
+    runtime_worker_t *worker = (runtime_worker_t*)arg;
+    job_runtime_t *runtime = worker->runtime;
     
-    while (employee_running) {
-        // Send buffered data chunks to node script when ready
-        if (is_node_started && unix_socket_connected) {
-            received_task_t data_chunk;
+    for (;;) {
+        // Read before checking the state wake_task_buffer announces
+        unsigned long wakeups = task_buffer_wakeups(&runtime->chunk_buffer);
+        if (!employee_running || runtime->stopping) break;
+
+        if (!worker->is_started || !worker->is_connected) {
+            // Until start_node_thread connects this worker or the runtime stops
+            wait_task_buffer_wakeup(&runtime->chunk_buffer, wakeups, WORKER_IDLE_WAIT_MS);
+            continue;
+        }
+        if (!worker->has_collector) {
+            // Sized once the script said how many chunks a message may carry
+            worker->in_flight_capacity = pipeline_depth * worker->max_batch;
+            worker->in_flight = calloc(worker->in_flight_capacity, sizeof(received_task_t));
+            if (!worker->in_flight || pthread_create(&worker->collector, NULL, collector_loop, worker) != 0) {
+                perror("[Employee] Failed to create response collector");
+                free(worker->in_flight);
+                worker->in_flight = NULL;
+                pthread_mutex_lock(&worker->window_mutex);
+                worker->is_connected = false;
+                pthread_mutex_unlock(&worker->window_mutex);
+                continue;
+            }
+            worker->has_collector = true;
+        }
+
+        // Wait for room in the script's window. Held back by another runtime,
+        // the worker rechecks soon: that runtime's turn does not signal here.
+        pthread_mutex_lock(&worker->window_mutex);
+        int in_flight = worker->in_flight_count;
+        bool window_full = worker->message_count >= pipeline_depth;
+        int batch_frames = worker->batch_frames;
+        pthread_mutex_unlock(&worker->window_mutex);
+        if (window_full || (in_flight > 0 && !may_queue_more())) {
+            pthread_mutex_lock(&worker->window_mutex);
+            if (worker->in_flight_count == in_flight && worker->is_connected) {
+                struct timespec deadline;
+                deadline_after_ms(&deadline, window_full ? WORKER_IDLE_WAIT_MS : WORKER_SHARE_RECHECK_MS);
+                pthread_cond_timedwait(&worker->window_changed, &worker->window_mutex, &deadline);
+            }
+            pthread_mutex_unlock(&worker->window_mutex);
+            continue;
+        }
+
+        // Sleeps until a chunk is buffered, then sends it to the node script at once
+        received_task_t batch[WORKER_BATCH_MAX];
+        if (wait_task_from_buffer(&runtime->chunk_buffer, &batch[0], wakeups, WORKER_IDLE_WAIT_MS) == 0) {
+            // A batching script also gets chunks already buffered behind this
+            // one, leaving their share to workers whose scripts have nothing
+            int frames = 1;
+            int idle_workers = 0;
+            for (int i = 0; i < runtime->worker_count; i++) {
+                runtime_worker_t *other = &runtime->workers[i];
+                if (other == worker) continue;
+                pthread_mutex_lock(&other->window_mutex);
+                if (other->is_connected && other->in_flight_count == 0) idle_workers++;
+                pthread_mutex_unlock(&other->window_mutex);
+            }
+            int share = 1 + get_task_buffer_count(&runtime->chunk_buffer) / (1 + idle_workers);
+            int wanted = batch_frames < share ? batch_frames : share;
+            while (frames < wanted && get_task_from_buffer(&runtime->chunk_buffer, &batch[frames]) == 0) frames++;
+
+            // A message behind others goes in while the collector cannot empty
+            // the window. An empty window stays empty until this thread fills
+            // it, after taking a worker share for the busy spell.
+            pthread_mutex_lock(&worker->window_mutex);
+            bool idle = worker->in_flight_count == 0;
+            if (idle) {
+                pthread_mutex_unlock(&worker->window_mutex);
+                acquire_worker_share(runtime);
+                clock_gettime(CLOCK_MONOTONIC, &worker->busy_since);
+                pthread_mutex_lock(&worker->window_mutex);
+            }
+            bool usable = worker->is_connected;
+            if (usable) {
+                for (int i = 0; i < frames; i++) {
+                    int slot = (worker->in_flight_head + worker->in_flight_count) % worker->in_flight_capacity;
+                    worker->in_flight[slot] = batch[i];
+                    worker->in_flight_count++;
+                }
+                int message = (worker->message_head + worker->message_count) % WORKER_PIPELINE_MAX;
+                worker->message_frames[message] = frames;
+                clock_gettime(CLOCK_MONOTONIC, &worker->message_sent[message]);
+                worker->message_count++;
+            }
+            int queued = worker->in_flight_count;
+            pthread_mutex_unlock(&worker->window_mutex);
+            if (!usable) {
+                // The collector gave up on this script in the meantime
+                for (int i = 0; i < frames; i++) {
+                    if (add_task_to_buffer(&runtime->chunk_buffer, &batch[i]) != 0) release_task_data(&batch[i]);
+                }
+                if (idle) release_worker_share(runtime, 0);
+                continue;
+            }
+            if (frames == 1) {
+                printf("[Employee] Sending data chunk %s to job %s worker %d via Unix socket (%d in flight)\n",
+                       batch[0].task_id, runtime->job_id, worker->index, queued);
+            } else {
+                printf("[Employee] Sending data chunks %s to %s to job %s worker %d as a batch of %d (%d in flight)\n",
+                       batch[0].task_id, batch[frames - 1].task_id, runtime->job_id, worker->index, frames, queued);
+            }
             
-            // Check for buffered data chunks to send to node
-            if (get_task_from_buffer(&data_chunk_buffer, &data_chunk) == 0) {
-                printf("[Employee] Sending data chunk %s to node script via Unix socket\n", data_chunk.task_id);
-                
-                // Send the actual file data to the node script
-                if (unix_socket_client_send_message((char*)data_chunk.data)) {
-                    printf("[Employee] Data chunk file content sent to node script\n");
-                    
-                    // Wait for response from node script - use larger buffer for responses with images
-                    char *response = malloc(2 * 1024 * 1024); // Increased to 2MB for larger responses
-                    if (!response) {
-                        printf("[Employee] Failed to allocate memory for response buffer\n");
-                        continue;
-                    }
-                    
-                    // Initialize buffer to ensure clean state
-                    memset(response, 0, 2 * 1024 * 1024);
-                    
-                    // Try to receive complete JSON response
-                    ssize_t bytes = receive_complete_json_response(response, 2 * 1024 * 1024 - 1);
-                    
-                    // Fallback to regular receive if the custom function fails
-                    if (bytes <= 0) {
-                        printf("[Employee] Complete JSON receive failed, trying regular receive...\n");
-                        bytes = unix_socket_client_receive_message(response, 2 * 1024 * 1024 - 1);
-                    }
-                    if (bytes > 0) {
-                        printf("[Employee] Node script response received (%zd bytes)\n", bytes);
-                        
-                        // Ensure null termination with safety check
-                        if (bytes < 2 * 1024 * 1024 - 1) {
-                            response[bytes] = '\0';
-                        } else {
-                            response[2 * 1024 * 1024 - 1] = '\0';
-                        }
-                        
-                        // Debug: Print first few characters of response
-                        printf("[Employee] Response preview (first 200 chars): %.200s\n", response);
-                        
-                        // Check if response looks like valid JSON (starts with { or [)
-                        char *trimmed_response = response;
-                        while (*trimmed_response && (*trimmed_response == ' ' || *trimmed_response == '\t' || *trimmed_response == '\n' || *trimmed_response == '\r')) {
-                            trimmed_response++;
-                        }
-                        
-                        if (*trimmed_response != '{' && *trimmed_response != '[') {
-                            printf("[Employee] Warning: Response doesn't appear to start with JSON: first char is '%c' (0x%02x)\n", 
-                                   *trimmed_response, (unsigned char)*trimmed_response);
-                        }
-                        
-                        // Parse response and add to result queue
-                        cJSON *response_json = cJSON_Parse(trimmed_response);
-                        if (response_json) {
-                            printf("[Employee] JSON parsed successfully\n");
-                            const cJSON *status = cJSON_GetObjectItem(response_json, "status");
-                            const cJSON *objects = cJSON_GetObjectItem(response_json, "objects");
-                            const cJSON *annotated_image = cJSON_GetObjectItem(response_json, "annotated_image");
-                            
-                            if (status && cJSON_IsString(status)) {
-                                printf("[Employee] Detection status: %s\n", status->valuestring);
-                                
-                                if (objects && cJSON_IsNumber(objects)) {
-                                    printf("[Employee] Objects detected: %d\n", (int)objects->valuedouble);
-                                }
-                                
-                                if (annotated_image && cJSON_IsString(annotated_image)) {
-                                    printf("[Employee] Annotated image data included (length: %zu)\n", 
-                                           strlen(annotated_image->valuestring));
-                                }
-                                
-                                // Create result info
-                                result_info_t result_info;
-                                memset(&result_info, 0, sizeof(result_info));
-                                strncpy(result_info.task_id, data_chunk.task_id, sizeof(result_info.task_id) - 1);
-                                strncpy(result_info.employer_ip, data_chunk.sender_id, sizeof(result_info.employer_ip) - 1);
-                                
-                                // Create result file with the complete JSON response
-                                char result_filename[512];
-                                snprintf(result_filename, sizeof(result_filename), "/tmp/node_result_%s.json", data_chunk.task_id);
-                                
-                                FILE *result_file = fopen(result_filename, "w");
-                                if (result_file) {
-                                    // Write the complete JSON response to file
-                                    fprintf(result_file, "%s", trimmed_response);
-                                    fclose(result_file);
-                                    
-                                    strncpy(result_info.result_filepath, result_filename, sizeof(result_info.result_filepath) - 1);
-                                    
-                                    printf("[Employee] Complete detection result saved to: %s\n", result_filename);
-                                    
-                                    // Add to result queue for sending back to employer
-                                    if (add_result_to_queue(&result_queue, &result_info) == 0) {
-                                        printf("[Employee] Detection result for task %s queued for transmission to employer\n", data_chunk.task_id);
-                                        printf("[Employee] Result includes: %s status, %d detected objects%s\n", 
-                                               status->valuestring,
-                                               objects ? (int)objects->valuedouble : 0,
-                                               annotated_image ? ", annotated image" : "");
-                                    } else {
-                                        printf("[Employee] Failed to queue detection result for task %s\n", data_chunk.task_id);
-                                    }
-                                } else {
-                                    printf("[Employee] Failed to create result file: %s\n", result_filename);
-                                    perror("fopen result file");
-                                }
-                            } else {
-                                printf("[Employee] Invalid response format - missing or invalid status field\n");
-                                printf("[Employee] Available JSON fields:\n");
-                                const cJSON *item = NULL;
-                                cJSON_ArrayForEach(item, response_json) {
-                                    if (item->string) {
-                                        printf("  - %s: %s\n", item->string, 
-                                               cJSON_IsString(item) ? item->valuestring : 
-                                               cJSON_IsNumber(item) ? "number" : "other");
-                                    }
-                                }
-                            }
-                            cJSON_Delete(response_json);
-                        } else {
-                            printf("[Employee] Failed to parse JSON response from Node.js script\n");
-                            printf("[Employee] Response size: %zd bytes\n", bytes);
-                            printf("[Employee] Raw response preview: %.500s...\n", response);
-                            
-                            // Check for common JSON parsing issues
-                            if (strlen(trimmed_response) == 0) {
-                                printf("[Employee] Error: Empty response received\n");
-                            } else if (trimmed_response[strlen(trimmed_response) - 1] != '}' && 
-                                      trimmed_response[strlen(trimmed_response) - 1] != ']') {
-                                printf("[Employee] Error: Response appears to be truncated (doesn't end with } or ])\n");
-                            }
-                            
-                            // Try to find JSON error position
-                            const char *error_ptr = cJSON_GetErrorPtr();
-                            if (error_ptr != NULL) {
-                                printf("[Employee] JSON parse error near: %.50s\n", error_ptr);
-                            }
-                            
-                            // Save the raw response for debugging
-                            char debug_filename[512];
-                            snprintf(debug_filename, sizeof(debug_filename), "/tmp/debug_response_%s.txt", data_chunk.task_id);
-                            FILE *debug_file = fopen(debug_filename, "w");
-                            if (debug_file) {
-                                fprintf(debug_file, "Response size: %zd bytes\n", bytes);
-                                fprintf(debug_file, "Raw response:\n%s", response);
-                                fclose(debug_file);
-                                printf("[Employee] Raw response saved to: %s for debugging\n", debug_filename);
-                            }
-                        }
-                        
-                        free(response);
-                    } else {
-                        printf("[Employee] Failed to receive response from node script\n");
-                    }
-                } else {
-                    printf("[Employee] Failed to send data chunk to node script, re-queuing\n");
-                    // Re-add to buffer for retry
-                    add_task_to_buffer(&data_chunk_buffer, &data_chunk);
+            // Each chunk goes as one frame, a batch behind a header announcing it
+            bool by_descriptor = batch[0].data_buffer && batch[0].data_buffer->fd >= 0;
+            protocol_status_t send_status = frames > 1 ? send_batch_header(worker->conn.sockfd, frames) : PROTOCOL_OK;
+            for (int i = 0; i < frames && send_status == PROTOCOL_OK; i++) {
+                send_status = send_chunk(worker->conn.sockfd, &batch[i]);
+            }
+            pthread_mutex_lock(&worker->window_mutex);
+            bool delivered = send_status == PROTOCOL_OK && worker->is_connected;
+            bool ran_dry = false;
+            if (delivered) {
+                worker->in_flight_sent += frames;
+            } else {
+                // Not sent, or sent to a script the collector gave up on: the
+                // message, still the newest in the window, goes back to the buffer
+                worker->in_flight_count -= frames;
+                worker->message_count--;
+                ran_dry = worker->in_flight_count == 0;
+                if (send_status != PROTOCOL_OK && worker->is_connected) {
+                    worker->is_connected = false;
+                    shutdown(worker->conn.sockfd, SHUT_RDWR); // Stops the collector
                 }
-                
-                // Clean up data chunk
-                if (data_chunk.data) {
-                    free(data_chunk.data);
+            }
+            pthread_cond_broadcast(&worker->window_changed);
+            pthread_mutex_unlock(&worker->window_mutex);
+
+            if (delivered && frames == 1) {
+                printf("[Employee] Data chunk %s sent to node script\n",
+                       by_descriptor ? "descriptor" : "content");
+            } else if (delivered) {
+                printf("[Employee] Batch of %d data chunks sent to node script\n", frames);
+            } else {
+                printf("[Employee] Failed to send data chunk to job %s worker %d, re-queuing\n",
+                       runtime->job_id, worker->index);
+                for (int i = 0; i < frames; i++) {
+                    if (add_task_to_buffer(&runtime->chunk_buffer, &batch[i]) != 0) release_task_data(&batch[i]);
                 }
+                if (ran_dry) release_worker_share(runtime, elapsed_ms(&worker->busy_since));
             }
         }
         
-        // Sleep briefly if no tasks to process
-        if (!is_node_started || !unix_socket_connected || is_task_buffer_empty(&data_chunk_buffer)) {
-            usleep(100000); // 100ms
+        // Bound how long folded chunks wait for a full batch
+        if (runtime->combine != COMBINE_NONE) {
+            pthread_mutex_lock(&runtime->partial_mutex);
+            if (runtime->partial && time(NULL) - runtime->partial_started >= COMBINE_FLUSH_SECONDS) {
+                flush_partial(runtime);
+            }
+            pthread_mutex_unlock(&runtime->partial_mutex);
         }
     }
     
-    printf("[Employee] Worker thread stopped\n");
+    stop_collector(worker);
+    printf("[Employee] Worker %d of job %s stopped after %ld chunks\n", worker->index, runtime->job_id,
+           worker->chunks_processed);
+    shutdown_runtime_worker(worker);
     return NULL;
 }
 
+// Reap the worker threads of a stopped runtime so its slot can be reused
+static void join_runtime_workers(job_runtime_t* runtime) {
+
+    if (runtime->worker_count == 0) return;
+    for (int i = 0; i < runtime->worker_count; i++) {
+        if (runtime->workers[i].has_thread) {
+            pthread_join(runtime->workers[i].thread, NULL);
+            runtime->workers[i].has_thread = false;
+        }
+    }
+    cleanup_task_buffer(&runtime->chunk_buffer);
+    pthread_mutex_destroy(&runtime->partial_mutex);
+    runtime->worker_count = 0;
+}
+
+// Find the runtime hosting the employer's job_id, creating it (and its
+// workers) if needed. Chunks may be buffered in a new runtime before its
+// script has been started. A job whose employer disconnected is adopted by
+// the next connection from the same address that asks for it.
+static job_runtime_t* get_job_runtime(employer_conn_t* employer, const char* job_id, bool create) {
+
+    pthread_mutex_lock(&runtimes_mutex);
+
+    job_runtime_t *free_slot = NULL;
+    job_runtime_t *orphan = NULL;
+    bool id_taken = false; // Another employer runs a job with the same id
+    for (int i = 0; i < MAX_JOB_RUNTIMES; i++) {
+        job_runtime_t *runtime = &job_runtimes[i];
+        if (runtime->in_use && !runtime->stopping && strcmp(runtime->job_id, job_id) == 0) {
+            if (runtime->employer_id == employer->id) {
+                pthread_mutex_unlock(&runtimes_mutex);
+                return runtime;
+            }
+            if (!find_employer(runtime->employer_id) && strcmp(runtime->employer_ip, employer->ip) == 0) {
+                orphan = runtime;
+            }
+            id_taken = true;
+        }
+        if (!runtime->in_use && !free_slot) free_slot = runtime;
+    }
+    if (orphan) {
+        pthread_mutex_lock(&share_mutex);
+        orphan->employer_id = employer->id;
+        pthread_mutex_unlock(&share_mutex);
+        pthread_mutex_unlock(&runtimes_mutex);
+        printf("[Employee] Employer %s reconnected, job %s carries on\n", employer->ip, job_id);
+        return orphan;
+    }
+
+    if (!create || !free_slot) {
+        pthread_mutex_unlock(&runtimes_mutex);
+        if (create) printf("[Employee] Cannot host job %s: all %d runtime slots in use\n", job_id, MAX_JOB_RUNTIMES);
+        return NULL;
+    }
+
+    // Reap the workers of the job that used this slot before
+    join_runtime_workers(free_slot);
+
+    memset(free_slot, 0, sizeof(*free_slot));
+    strncpy(free_slot->job_id, job_id, sizeof(free_slot->job_id) - 1);
+    if (id_taken) {
+        snprintf(free_slot->file_tag, sizeof(free_slot->file_tag), "%s-%d", free_slot->job_id,
+                 (int)(free_slot - job_runtimes));
+    } else {
+        strncpy(free_slot->file_tag, job_id, sizeof(free_slot->file_tag) - 1);
+    }
+    free_slot->employer_id = employer->id;
+    strncpy(free_slot->employer_ip, employer->ip, sizeof(free_slot->employer_ip) - 1);
+    for (int i = 0; i < runtime_workers; i++) {
+        // Worker 0 keeps the job's socket path, the others add their index
+        runtime_worker_t *worker = &free_slot->workers[i];
+        const char *separator = strcmp(free_slot->file_tag, DEFAULT_JOB_ID) == 0 ? "" : "_";
+        const char *job_suffix = strcmp(free_slot->file_tag, DEFAULT_JOB_ID) == 0 ? "" : free_slot->file_tag;
+        int len = i == 0
+            ? snprintf(worker->socket_path, sizeof(worker->socket_path), "%s%s%s",
+                       runtime_socket_base, separator, job_suffix)
+            : snprintf(worker->socket_path, sizeof(worker->socket_path), "%s%s%s.%d",
+                       runtime_socket_base, separator, job_suffix, i);
+        if (len < 0 || (size_t)len >= sizeof(worker->socket_path)) {
+            pthread_mutex_unlock(&runtimes_mutex);
+            printf("[Employee] Socket path for job %s is too long\n", job_id);
+            return NULL;
+        }
+        worker->runtime = free_slot;
+        worker->index = i;
+        unix_socket_conn_init(&worker->conn, worker->socket_path);
+    }
+
+    if (init_task_buffer(&free_slot->chunk_buffer, CHUNK_BUFFER_SLOTS) != 0) {
+        pthread_mutex_unlock(&runtimes_mutex);
+        return NULL;
+    }
+    pthread_mutex_init(&free_slot->partial_mutex, NULL);
+    // Workers decrement workers_running under runtimes_mutex, so none can
+    // finish before all of them are counted
+    for (int i = 0; i < runtime_workers; i++) {
+        runtime_worker_t *worker = &free_slot->workers[i];
+        // Workers look at each other's windows, so these live as long as the runtime
+        pthread_mutex_init(&worker->window_mutex, NULL);
+        pthread_cond_init(&worker->window_changed, NULL);
+        if (pthread_create(&worker->thread, NULL, worker_loop, worker) != 0) {
+            perror("[Employee] Failed to create runtime worker");
+            pthread_cond_destroy(&worker->window_changed);
+            pthread_mutex_destroy(&worker->window_mutex);
+            break;
+        }
+        worker->has_thread = true;
+        free_slot->worker_count++;
+        free_slot->workers_running++;
+    }
+    if (free_slot->worker_count == 0) {
+        cleanup_task_buffer(&free_slot->chunk_buffer);
+        pthread_mutex_destroy(&free_slot->partial_mutex);
+        pthread_mutex_unlock(&runtimes_mutex);
+        return NULL;
+    }
+    free_slot->in_use = true;
+
+    pthread_mutex_unlock(&runtimes_mutex);
+    printf("[Employee] Hosting runtime for job %s of employer %s with %d workers (socket %s)\n", free_slot->job_id,
+           employer->ip, free_slot->worker_count, free_slot->workers[0].socket_path);
+    return free_slot;
+}
+
+// Stop every runtime and wait for the workers
+static void stop_all_job_runtimes(void) {
+
+    for (int i = 0; i < MAX_JOB_RUNTIMES; i++) {
+        job_runtimes[i].stopping = true;
+        if (job_runtimes[i].in_use) wake_task_buffer(&job_runtimes[i].chunk_buffer);
+    }
+    for (int i = 0; i < MAX_JOB_RUNTIMES; i++) {
+        join_runtime_workers(&job_runtimes[i]);
+    }
+}
+
 // ============================================================================
 // RESULT TRANSMISSION TO EMPLOYER
 // ============================================================================
-static int send_result_to_employer(int sockfd, const result_info_t* result) {
+// The task_result message announcing a result of size payload bytes
+static cJSON* result_metadata(const result_info_t* result, uint32_t size) {
+    cJSON *metadata = cJSON_CreateObject();
+    cJSON_AddStringToObject(metadata, "type", "task_result");
+    cJSON_AddStringToObject(metadata, "task_id", result->task_id);
+    cJSON_AddNumberToObject(metadata, "result_size", size);
+    if (result->job_id[0]) {
+        cJSON_AddStringToObject(metadata, "job_id", result->job_id);
+    }
+    if (result->kind == RESULT_KIND_ACK) {
+        // A chunk folded into a partial: metadata and an empty payload
+        cJSON_AddBoolToObject(metadata, "combined", true);
+    } else if (result->kind == RESULT_KIND_PARTIAL) {
+        cJSON_AddBoolToObject(metadata, "partial", true);
+        cJSON_AddNumberToObject(metadata, "task_count", result->task_count);
+    }
+    return metadata;
+}
+
+// calls, when given, is increased by the number of send calls made
+static int send_result_to_employer(int sockfd, const result_info_t* result, long* calls) {
     if (sockfd < 0 || !result) {
         return -1;
     }
-    
+
+    // Acknowledgements and results held in memory go out as metadata, size and
+    // payload in one sendmsg
+    if (result->kind == RESULT_KIND_ACK || result->payload.data) {
+        struct iovec piece = { .iov_base = result->payload.data, .iov_len = result->payload.len };
+        cJSON *metadata = result_metadata(result, result->payload.len);
+        protocol_status_t status = send_json_payload(sockfd, metadata, &piece, piece.iov_len > 0 ? 1 : 0, calls);
+        cJSON_Delete(metadata);
+        if (status != PROTOCOL_OK) {
+            printf("[Employee] Failed to send result for task %s. Connection may be lost.\n", result->task_id);
+            return -1;
+        }
+        if (result->kind != RESULT_KIND_ACK) {
+            printf("[Employee] Detection result transmission completed for task %s (%u bytes total)\n",
+                   result->task_id, result->payload.len);
+        }
+        return 0;
+    }
+
+    // Spilled results are read back from their file
     printf("[Employee] Sending detection result for task %s back to employer\n", result->task_id);
-    
-    // Check file size first
     FILE *file = fopen(result->result_filepath, "rb");
     if (!file) {
         printf("[Employee] Failed to open result file %s\n", result->result_filepath);
@@ -428,10 +1428,7 @@ static int send_result_to_employer(int sockfd, const result_info_t* result) {
     printf("[Employee] Result file size: %ld bytes\n", file_size);
     
     // 1. Send result metadata as JSON
-    cJSON *metadata = cJSON_CreateObject();
-    cJSON_AddStringToObject(metadata, "type", "task_result");
-    cJSON_AddStringToObject(metadata, "task_id", result->task_id);
-    cJSON_AddNumberToObject(metadata, "result_size", file_size);
+    cJSON *metadata = result_metadata(result, (uint32_t)file_size);
     
     if (send_json(sockfd, metadata) != PROTOCOL_OK) {
         printf("[Employee] Failed to send result metadata for task %s\n", result->task_id);
@@ -441,9 +1438,11 @@ static int send_result_to_employer(int sockfd, const result_info_t* result) {
     }
     printf("[Employee] Result metadata sent successfully\n");
     cJSON_Delete(metadata);
+    if (calls) *calls += 2;
     
     // 2. Send file size first
     uint32_t net_size = htonl((uint32_t)file_size);
+    if (calls) (*calls)++;
     if (send(sockfd, &net_size, sizeof(net_size), 0) != sizeof(net_size)) {
         printf("[Employee] Failed to send result file size for task %s\n", result->task_id);
         fclose(file);
@@ -464,6 +1463,7 @@ static int send_result_to_employer(int sockfd, const result_info_t* result) {
         if (bytes_read == 0) break;
         
         ssize_t bytes_sent = send(sockfd, buffer, bytes_read, 0);
+        if (calls) (*calls)++;
         if (bytes_sent <= 0) {
             printf("[Employee] Failed to send result file data for %s. Connection may be lost.\n", result->task_id);
             fclose(file);
@@ -499,73 +1499,291 @@ typedef struct {
 
 typedef struct {
     struct volcom_rcsmngr_s *manager;
+    job_runtime_t *runtime;
     char task_id[128];
     char config_filepath[512];
 } node_start_args_t;
 
-// Thread function to save a file
+// Thread function to save a file. It is written next to its final name and
+// renamed into place, so a runtime or a cache check never sees half of it.
 void* save_file_thread(void* arg) {
     file_save_args_t *args = (file_save_args_t*)arg;
-    FILE* f = fopen(args->filepath, "wb");
+    char temp_path[sizeof(args->filepath) + 8];
+    snprintf(temp_path, sizeof(temp_path), "%s.XXXXXX", args->filepath);
+    int fd = mkstemp(temp_path);
+    FILE* f = fd >= 0 ? fdopen(fd, "wb") : NULL;
     if (f) {
-        fwrite(args->data, 1, args->data_size, f);
-        fclose(f);
-        printf("[Employee] File saved to %s\n", args->filepath);
+        bool written = fwrite(args->data, 1, args->data_size, f) == args->data_size;
+        if (fclose(f) == 0 && written && rename(temp_path, args->filepath) == 0) {
+            printf("[Employee] File saved to %s\n", args->filepath);
+        } else {
+            perror("[Employee] Failed to save file");
+            unlink(temp_path);
+        }
     } else {
         perror("[Employee] Failed to save file");
+        if (fd >= 0) {
+            close(fd);
+            unlink(temp_path);
+        }
     }
     free(args->data);
     free(args);
     return NULL;
 }
 
-// Thread function to start node
+// The script cache is only used when it is a directory of ours that nobody
+// else can write to, or anyone could plant a script under a hash we load
+static bool script_cache_usable(void) {
+
+    if (mkdir(SCRIPT_CACHE_DIR, 0700) != 0 && errno != EEXIST) return false;
+    struct stat st;
+    if (lstat(SCRIPT_CACHE_DIR, &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != geteuid() ||
+        (st.st_mode & 077) != 0) {
+        printf("[Employee] %s is not a private directory, not caching scripts\n", SCRIPT_CACHE_DIR);
+        return false;
+    }
+    return true;
+}
+
+// Put a job's script where its runtime loads it, path is set to that file.
+// Scripts with a hash are kept in the cache under it, so the employer can skip
+// the transfer when another job ships the same script. A cached copy is only
+// used after its content checked out, and only content that matches its hash
+// goes in. Returns 1 when the employer offered a cached script that is not
+// here (or not intact). Takes over config->data.
+static int store_job_script(const job_runtime_t* runtime, received_task_t* config, char* path, size_t path_size) {
+
+    const char *suffix = config->engine == SCRIPT_RUNTIME_NATIVE ? "so" : "js";
+    bool by_hash = config->script_hash[0] != '\0' && script_cache_usable();
+    if (by_hash && config->data) {
+        sha256_ctx_t ctx;
+        unsigned char digest[SHA256_DIGEST_LEN];
+        char hex[SHA256_HEX_LEN + 1];
+        sha256_init(&ctx);
+        sha256_update(&ctx, config->data, config->data_size);
+        sha256_final(&ctx, digest);
+        sha256_hex(digest, hex);
+        if (strcmp(hex, config->script_hash) != 0) {
+            printf("[Employee] Script of job %s does not match its hash, not caching it\n", config->job_id);
+            by_hash = false;
+        }
+    }
+    if (by_hash) {
+        snprintf(path, path_size, "%s/%s.%s", SCRIPT_CACHE_DIR, config->script_hash, suffix);
+    } else {
+        snprintf(path, path_size, "/tmp/config_%s.%s", runtime->file_tag, suffix);
+    }
+
+    char cached_hash[SHA256_HEX_LEN + 1];
+    bool in_cache = by_hash && sha256_file_hex(path, cached_hash) == 0 && strcmp(cached_hash, config->script_hash) == 0;
+    if (config->script_cached) return in_cache ? 0 : 1;
+    if (in_cache) {
+        free(config->data); // Same content already on disk
+        config->data = NULL;
+        return 0;
+    }
+
+    file_save_args_t *save_args = malloc(sizeof(file_save_args_t));
+    if (!save_args) {
+        free(config->data);
+        config->data = NULL;
+        return -1;
+    }
+    strncpy(save_args->filepath, path, sizeof(save_args->filepath) - 1);
+    save_args->filepath[sizeof(save_args->filepath) - 1] = '\0';
+    save_args->data = config->data;
+    save_args->data_size = config->data_size;
+    config->data = NULL;
+    if (config->engine != SCRIPT_RUNTIME_NODE) {
+        save_file_thread(save_args); // Plugin hosts and the runner load it as soon as they start
+    } else {
+        pthread_t save_thread;
+        pthread_create(&save_thread, NULL, save_file_thread, save_args);
+        pthread_detach(save_thread);
+    }
+    return 0;
+}
+
+// Readiness handshake (see scripts/volcom_frame.js). Every script process gets
+// the write end of a pipe as VOLCOM_READY_FD and writes JSON lines to it:
+// {"status":"starting"} at once, {"status":"ready","model_loaded":...} when it
+// takes chunks, with "max_batch" when it takes batches of chunks (see
+// send_batch_header). The worker connects on "ready". Scripts that stay silent for
+// RUNTIME_READY_FALLBACK_MS, or close the pipe without a "ready", are polled
+// with connect attempts instead.
+#define RUNTIME_READY_TIMEOUT_MS 30000
+#define RUNTIME_READY_FALLBACK_MS 3000
+#define RUNTIME_CONNECT_RETRY_MS 250
+
+typedef struct {
+    int fd;             // Read end of the pipe, -1 once closed
+    bool announced;     // Sent "starting", so it will say when it is ready
+    bool ready;
+    bool model_loaded;
+    int max_batch;      // 0 when the script takes one chunk per message
+} runtime_readiness_t;
+
+// Read what a script wrote to its readiness pipe
+static void read_readiness(runtime_readiness_t* readiness) {
+
+    char buffer[512];
+    ssize_t n = read(readiness->fd, buffer, sizeof(buffer) - 1);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN)) return;
+    if (n <= 0) {
+        close(readiness->fd); // Exited, or closed it after "ready"
+        readiness->fd = -1;
+        return;
+    }
+    buffer[n] = '\0';
+
+    // Lines are short and written whole, so a read never splits one
+    char *save = NULL;
+    for (char *line = strtok_r(buffer, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        cJSON *message = cJSON_Parse(line);
+        const cJSON *status = cJSON_GetObjectItem(message, "status");
+        if (status && cJSON_IsString(status)) {
+            readiness->announced = true;
+            if (strcmp(status->valuestring, "ready") == 0) {
+                readiness->ready = true;
+                const cJSON *model_loaded = cJSON_GetObjectItem(message, "model_loaded");
+                readiness->model_loaded = !model_loaded || cJSON_IsTrue(model_loaded);
+                const cJSON *max_batch = cJSON_GetObjectItem(message, "max_batch");
+                if (cJSON_IsNumber(max_batch)) readiness->max_batch = max_batch->valueint;
+            }
+        }
+        cJSON_Delete(message);
+    }
+}
+
+// Native jobs always run in plugin hosts, quickjs jobs do when the VM is built in
+static bool runtime_uses_plugin_host(const job_runtime_t* runtime) {
+#ifdef VOLCOM_WITH_QUICKJS
+    return runtime->engine != SCRIPT_RUNTIME_NODE;
+#else
+    return runtime->engine == SCRIPT_RUNTIME_NATIVE;
+#endif
+}
+
+// Node script that hosts a quickjs job script when the VM is not built in
+static const char* script_runner_path(void) {
+    const char *runner = get_volcom_config_value("script_runner");
+    return runner ? runner : "scripts/volcom_runner.js";
+}
+
+// Thread function to start the node processes of a runtime, one per worker
 void* start_node_thread(void* arg) {
     node_start_args_t *args = (node_start_args_t*)arg;
+    job_runtime_t *runtime = args->runtime;
     
-    printf("[Employee] Starting node in thread...\n");
+    printf("[Employee] Starting %d %s for job %s in thread...\n", runtime->worker_count,
+           runtime_uses_plugin_host(runtime) ? "plugin hosts" : "node processes", runtime->job_id);
     
-    if (run_node_in_cgroup(args->manager, args->task_id, args->config_filepath) == 0) {
-        printf("[Employee] Node process started successfully.\n");
-        is_node_started = true;
-        
-        // Initialize Unix socket client
-        printf("[Employee] Initializing Unix socket client...\n");
-        if (!unix_socket_client_init(&client_socket_config)) {
-            fprintf(stderr, "[Employee] Failed to initialize Unix socket client\n");
-            free(args);
-            return NULL;
+    struct timespec start_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    runtime_readiness_t readiness[MAX_RUNTIME_WORKERS];
+    int started = 0;
+    for (int i = 0; i < runtime->worker_count; i++) {
+        runtime_worker_t *worker = &runtime->workers[i];
+        int pipe_fds[2] = {-1, -1};
+        readiness[i] = (runtime_readiness_t){ .fd = -1 };
+        if (pipe2(pipe_fds, O_CLOEXEC) != 0) {
+            perror("[Employee] Failed to create readiness pipe");
         }
-        
-        // Wait a bit for the node script to set up the socket server
-        printf("[Employee] Waiting for Node.js script to initialize socket server...\n");
-        sleep(3);
-        
-        // Try to connect to Unix socket after node starts
-        printf("[Employee] Attempting to connect to Unix socket...\n");
-        int retry_count = 0;
-        const int max_retries = 15;
-        
-        while (retry_count < max_retries && !unix_socket_connected && employee_running) {
-            if (unix_socket_client_connect()) {
-                unix_socket_connected = true;
-                printf("[Employee] Connected to Unix socket server successfully!\n");
-                break;
-            } else {
-                printf("[Employee] Waiting for Unix socket connection... (attempt %d/%d)\n", 
-                       retry_count + 1, max_retries);
-                sleep(1);
-                retry_count++;
+        pid_t pid;
+        if (runtime_uses_plugin_host(runtime)) {
+            pid = run_plugin_in_cgroup(args->manager, runtime->job_id, runtime->engine, args->config_filepath,
+                                       worker->socket_path, pipe_fds[1]);
+        } else if (runtime->engine == SCRIPT_RUNTIME_QUICKJS) {
+            // Same script contract as the embedded VM, under Node
+            pid = run_node_in_cgroup(args->manager, args->task_id, script_runner_path(), args->config_filepath,
+                                     worker->socket_path, pipe_fds[1]);
+        } else {
+            pid = run_node_in_cgroup(args->manager, args->task_id, args->config_filepath, NULL,
+                                     worker->socket_path, pipe_fds[1]);
+        }
+        if (pipe_fds[1] >= 0) close(pipe_fds[1]); // The script holds the only write end
+        if (pid > 0) {
+            worker->pid = pid;
+            worker->is_started = true;
+            readiness[i].fd = pipe_fds[0];
+            started++;
+        } else {
+            if (pipe_fds[0] >= 0) close(pipe_fds[0]);
+            fprintf(stderr, "[Employee] ERROR: Failed to start node for worker %d.\n", i);
+        }
+    }
+    
+    if (started > 0) {
+        printf("[Employee] %d node processes started, waiting for them to report ready...\n", started);
+
+        int connected = 0;
+        bool all_models_loaded = true;
+        while (connected < started && employee_running && !runtime->stopping &&
+               elapsed_ms(&start_time) < RUNTIME_READY_TIMEOUT_MS) {
+            struct pollfd poll_fds[MAX_RUNTIME_WORKERS];
+            int poll_workers[MAX_RUNTIME_WORKERS];
+            int poll_count = 0;
+            for (int i = 0; i < runtime->worker_count; i++) {
+                if (readiness[i].fd < 0 || runtime->workers[i].is_connected) continue;
+                poll_fds[poll_count] = (struct pollfd){ .fd = readiness[i].fd, .events = POLLIN };
+                poll_workers[poll_count++] = i;
+            }
+            if (poll(poll_fds, poll_count, RUNTIME_CONNECT_RETRY_MS) > 0) {
+                for (int p = 0; p < poll_count; p++) {
+                    if (poll_fds[p].revents) read_readiness(&readiness[poll_workers[p]]);
+                }
+            }
+
+            long waited_ms = elapsed_ms(&start_time);
+            for (int i = 0; i < runtime->worker_count; i++) {
+                runtime_worker_t *worker = &runtime->workers[i];
+                if (!worker->is_started || worker->is_connected) continue;
+                bool silent = !readiness[i].announced && waited_ms >= RUNTIME_READY_FALLBACK_MS;
+                bool gone_quiet = readiness[i].fd < 0 && !readiness[i].ready;
+                if (!readiness[i].ready && !silent && !gone_quiet) continue;
+                if (!unix_socket_conn_connect(&worker->conn)) continue;
+
+                // Batches start at one chunk and grow once the script's pace is known
+                worker->max_batch = readiness[i].max_batch > 1 ? readiness[i].max_batch : 1;
+                if (worker->max_batch > WORKER_BATCH_MAX) worker->max_batch = WORKER_BATCH_MAX;
+                pthread_mutex_lock(&worker->window_mutex);
+                worker->batch_frames = 1;
+                worker->is_connected = true;
+                pthread_mutex_unlock(&worker->window_mutex);
+                wake_task_buffer(&runtime->chunk_buffer);
+                connected++;
+                if (readiness[i].ready && !readiness[i].model_loaded) all_models_loaded = false;
+                if (connected == 1) {
+                    runtime->cold_start_ms = waited_ms;
+                    last_cold_start_ms = waited_ms;
+                }
+                printf("[Employee] Connected to job %s worker %d (%s) after %ld ms%s\n", runtime->job_id, i,
+                       worker->socket_path, waited_ms,
+                       readiness[i].ready ? (readiness[i].model_loaded ? ", model loaded" : ", model failed to load")
+                                          : ", without readiness signal");
+                if (worker->max_batch > 1) {
+                    printf("[Employee] Job %s worker %d takes batches of up to %d chunks\n", runtime->job_id, i,
+                           worker->max_batch);
+                }
             }
         }
-        
-        if (!unix_socket_connected) {
-            fprintf(stderr, "[Employee] Failed to connect to Unix socket after %d attempts\n", max_retries);
+
+        if (connected < started) {
+            fprintf(stderr, "[Employee] Only %d of %d workers connected after %ld ms\n", connected, started,
+                    elapsed_ms(&start_time));
+        } else {
+            printf("[Employee] Runtime for job %s ready: first worker after %ld ms, all %d after %ld ms%s\n",
+                   runtime->job_id, runtime->cold_start_ms, connected, elapsed_ms(&start_time),
+                   all_models_loaded ? "" : " (some models failed to load)");
         }
     } else {
         fprintf(stderr, "[Employee] ERROR: Failed to start the node.\n");
     }
-    
+
+    for (int i = 0; i < runtime->worker_count; i++) {
+        if (readiness[i].fd >= 0) close(readiness[i].fd);
+    }
     free(args);
     return NULL;
 }
@@ -573,119 +1791,345 @@ void* start_node_thread(void* arg) {
 // ============================================================================
 // COMMUNICATION HANDLING WITH EMPLOYER
 // ============================================================================
-static void handle_persistent_connection(int employer_fd, struct volcom_rcsmngr_s *manager) {
-    printf("[Employee] Now in persistent communication mode with employer.\n");
-    is_node_started = false;
-    while (employee_running) {
-        fd_set readfds;
-        struct timeval timeout;
-        FD_ZERO(&readfds);
-        FD_SET(employer_fd, &readfds);
-        timeout.tv_sec = 1;
-        timeout.tv_usec = 0;
-        int activity = select(employer_fd + 1, &readfds, NULL, NULL, &timeout);
-        if (activity < 0 && errno != EINTR) {
-            perror("[Employee] Select error");
-            break;
+// Handle one message from an employer; -1 when its connection must be closed
+static int handle_employer_message(employer_conn_t* employer, struct volcom_rcsmngr_s *manager) {
+    cJSON* initial_check = NULL;
+    if(recv_json_peek(employer->fd, &initial_check) != PROTOCOL_OK) {
+        printf("[Employee] Connection closed by employer %s.\n", employer->ip);
+        return -1;
+    }
+    const cJSON* msg_type_item = cJSON_GetObjectItem(initial_check, "message_type");
+    if (!msg_type_item || !cJSON_IsString(msg_type_item)) {
+        printf("[Employee] Invalid message format: missing 'message_type'.\n");
+        cJSON_Delete(initial_check);
+        return -1;
+    }
+    char* msg_type = msg_type_item->valuestring;
+    if (strcmp(msg_type, "initial_config") == 0) {
+        printf("[Employee] Receiving initial configuration...\n");
+        const cJSON* weight = cJSON_GetObjectItem(initial_check, "weight");
+        if (weight && cJSON_IsNumber(weight) && weight->valueint >= 1) {
+            pthread_mutex_lock(&share_mutex);
+            employer->weight = weight->valueint < EMPLOYER_MAX_WEIGHT ? weight->valueint : EMPLOYER_MAX_WEIGHT;
+            pthread_mutex_unlock(&share_mutex);
+        }
+        received_task_t config_task;
+        memset(&config_task, 0, sizeof(config_task));
+        job_runtime_t *runtime = NULL;
+        if (receive_task_from_employer(employer->fd, &config_task) == 0 &&
+            (runtime = get_job_runtime(employer, config_task.job_id, true)) != NULL) {
+            // Read by the worker when the next response comes in
+            runtime->combine_batch = config_task.combine_batch;
+            runtime->combine = config_task.combine;
         }
-        // 1. Check for incoming data from the employer
-        if (activity > 0 && FD_ISSET(employer_fd, &readfds)) {
-            cJSON* initial_check = NULL;
-            if(recv_json_peek(employer_fd, &initial_check) != PROTOCOL_OK) {
-                printf("[Employee] Connection closed by employer.\n");
-                break;
+        if (runtime && runtime->script_path[0] != '\0') {
+            // Reconnected employer re-sent the config of a job that is already running
+            printf("[Employee] Runtime for job %s already running, reusing it\n", config_task.job_id);
+            free(config_task.data);
+        } else if (runtime) {
+            char config_filepath[512];
+            int stored = store_job_script(runtime, &config_task, config_filepath, sizeof(config_filepath));
+            if (stored < 0) {
+                fprintf(stderr, "[Employee] Failed to store the script of job %s.\n", config_task.job_id);
+                cJSON_Delete(initial_check);
+                return 0;
             }
-            const cJSON* msg_type_item = cJSON_GetObjectItem(initial_check, "message_type");
-            if (!msg_type_item || !cJSON_IsString(msg_type_item)) {
-                printf("[Employee] Invalid message format: missing 'message_type'.\n");
+            if (stored == 1) {
+                // Chunks that arrive meanwhile are buffered until the runtime starts
+                printf("[Employee] Cached script of job %s is missing, asking employer %s for it\n",
+                       config_task.job_id, employer->ip);
                 cJSON_Delete(initial_check);
-                break;
+                return send_script_missing(employer->fd, config_task.job_id, config_task.script_hash);
+            }
+            if (config_task.script_cached) {
+                printf("[Employee] Using cached script %s for job %s\n", config_filepath, config_task.job_id);
             }
-            char* msg_type = msg_type_item->valuestring;
-            if (strcmp(msg_type, "initial_config") == 0) {
-                printf("[Employee] Receiving initial configuration...\n");
-                received_task_t config_task;
-                memset(&config_task, 0, sizeof(config_task));
-                if (receive_task_from_employer(employer_fd, &config_task) == 0) {
-                    char config_filepath[512];
-                    snprintf(config_filepath, sizeof(config_filepath), "/tmp/config_%s.js", config_task.task_id);
-                    // Save config in a thread
-                    file_save_args_t *save_args = malloc(sizeof(file_save_args_t));
-                    strcpy(save_args->filepath, config_filepath);
-                    save_args->data = config_task.data;
-                    save_args->data_size = config_task.data_size;
-                    pthread_t save_thread;
-                    pthread_create(&save_thread, NULL, save_file_thread, save_args);
-                    pthread_detach(save_thread);
-                    // Start node in a thread
-                    node_start_args_t *node_args = malloc(sizeof(node_start_args_t));
-                    node_args->manager = manager;
-                    strcpy(node_args->task_id, config_task.task_id);
-                    strcpy(node_args->config_filepath, config_filepath);
-                    pthread_t node_thread;
-                    pthread_create(&node_thread, NULL, start_node_thread, node_args);
-                    pthread_detach(node_thread);
-                    // Do not free config_task.data here, handled by thread
+            strncpy(runtime->script_path, config_filepath, sizeof(runtime->script_path) - 1);
+            runtime->engine = config_task.engine;
+            // Start node in a thread
+            node_start_args_t *node_args = malloc(sizeof(node_start_args_t));
+            node_args->manager = manager;
+            node_args->runtime = runtime;
+            strcpy(node_args->task_id, config_task.task_id);
+            strcpy(node_args->config_filepath, config_filepath);
+            pthread_t node_thread;
+            pthread_create(&node_thread, NULL, start_node_thread, node_args);
+            pthread_detach(node_thread);
+        } else {
+            fprintf(stderr, "[Employee] Failed to receive or host initial configuration.\n");
+            if (config_task.data) free(config_task.data);
+        }
+    } else if (strcmp(msg_type, "data_chunk") == 0) {
+        printf("[Employee] Receiving data chunk...\n");
+        received_task_t data_chunk;
+        memset(&data_chunk, 0, sizeof(data_chunk));
+        
+        if (receive_task_from_employer(employer->fd, &data_chunk) == 0) {
+            job_runtime_t *runtime = get_job_runtime(employer, data_chunk.job_id, true);
+            if (!runtime) {
+                printf("[Employee] No runtime for job %s, dropping data chunk %s\n", data_chunk.job_id, data_chunk.task_id);
+                release_task_data(&data_chunk);
+            } else if (!is_runtime_ready(runtime)) {
+                printf("[Employee] Node not ready yet, buffering data chunk %s\n", data_chunk.task_id);
+                // Add to data chunk buffer to wait for node to be ready
+                if (add_task_to_buffer(&runtime->chunk_buffer, &data_chunk) == 0) {
+                    printf("[Employee] Data chunk %s buffered successfully\n", data_chunk.task_id);
                 } else {
-                    fprintf(stderr, "[Employee] Failed to receive initial configuration.\n");
+                    printf("[Employee] Failed to buffer data chunk %s\n", data_chunk.task_id);
+                    count_stall(STAGE_RECEIVE);
+                    release_task_data(&data_chunk);
                 }
-            } else if (strcmp(msg_type, "data_chunk") == 0) {
-                printf("[Employee] Receiving data chunk...\n");
-                received_task_t data_chunk;
-                memset(&data_chunk, 0, sizeof(data_chunk));
-                
-                if (receive_task_from_employer(employer_fd, &data_chunk) == 0) {
-                    if (!is_node_started || !unix_socket_connected) {
-                        printf("[Employee] Node not ready yet, buffering data chunk %s\n", data_chunk.task_id);
-                        // Add to data chunk buffer to wait for node to be ready
-                        if (add_task_to_buffer(&data_chunk_buffer, &data_chunk) == 0) {
-                            printf("[Employee] Data chunk %s buffered successfully\n", data_chunk.task_id);
-                        } else {
-                            printf("[Employee] Failed to buffer data chunk %s\n", data_chunk.task_id);
-                            if (data_chunk.data) free(data_chunk.data);
-                        }
-                    } else {
-                        printf("[Employee] Node is ready, adding data chunk %s to processing queue\n", data_chunk.task_id);
-                        // Node is ready, add directly to processing buffer
-                        if (add_task_to_buffer(&data_chunk_buffer, &data_chunk) == 0) {
-                            printf("[Employee] Data chunk %s added to processing queue\n", data_chunk.task_id);
-                        } else {
-                            printf("[Employee] Failed to add data chunk %s to processing queue\n", data_chunk.task_id);
-                            if (data_chunk.data) free(data_chunk.data);
-                        }
-                    }
+            } else {
+                printf("[Employee] Node is ready, adding data chunk %s to processing queue\n", data_chunk.task_id);
+                // Node is ready, add directly to processing buffer
+                if (add_task_to_buffer(&runtime->chunk_buffer, &data_chunk) == 0) {
+                    printf("[Employee] Data chunk %s added to processing queue\n", data_chunk.task_id);
                 } else {
-                    printf("[Employee] Failed to receive data chunk or connection closed.\n");
-                    break;
+                    printf("[Employee] Failed to add data chunk %s to processing queue\n", data_chunk.task_id);
+                    count_stall(STAGE_RECEIVE);
+                    release_task_data(&data_chunk);
                 }
-            } else {
-                printf("[Employee] Unknown message type received: %s\n", msg_type);
-                cJSON* temp_json = NULL;
-                recv_json(employer_fd, &temp_json);
-                cJSON_Delete(temp_json);
             }
+        } else {
+            printf("[Employee] Failed to receive data chunk or connection closed.\n");
             cJSON_Delete(initial_check);
+            return -1;
         }
-        // 2. Check for and send any completed task results
-        if (!is_result_queue_empty(&result_queue)) {
-            result_info_t result_to_send;
-            if (get_result_from_queue(&result_queue, &result_to_send) == 0) {
-                printf("[Employee] Dequeued detection result for task %s to send to employer\n", result_to_send.task_id);
-                if (send_result_to_employer(employer_fd, &result_to_send) == 0) {
-                    printf("[Employee] Successfully sent detection result for task %s to employer\n", result_to_send.task_id);
-                    employee_status.tasks_completed++;
-                } else {
-                    printf("[Employee] Failed to send detection result for task %s. Re-queueing for retry.\n", result_to_send.task_id);
-                    add_result_to_queue(&result_queue, &result_to_send);
-                    employee_status.tasks_failed++;
+    } else if (strcmp(msg_type, "job_release") == 0) {
+        cJSON* release = NULL;
+        if (recv_json(employer->fd, &release) == PROTOCOL_OK) {
+            const cJSON* job_id = cJSON_GetObjectItem(release, "job_id");
+            job_runtime_t *runtime = (job_id && cJSON_IsString(job_id)) ? get_job_runtime(employer, job_id->valuestring, false) : NULL;
+            if (runtime) {
+                printf("[Employee] Employer released job %s, stopping its runtime\n", runtime->job_id);
+                runtime->stopping = true; // Worker finishes the current chunk and cleans up
+                wake_task_buffer(&runtime->chunk_buffer);
+            }
+        }
+        cJSON_Delete(release);
+    } else {
+        printf("[Employee] Unknown message type received: %s\n", msg_type);
+        cJSON* temp_json = NULL;
+        recv_json(employer->fd, &temp_json);
+        cJSON_Delete(temp_json);
+    }
+    cJSON_Delete(initial_check);
+    return 0;
+}
+
+// Several results in one result_batch message: the metadata of each in
+// "results", their payloads back to back in a single frame
+static int send_result_batch(int sockfd, const result_info_t* results, int count, long* calls) {
+    cJSON *batch = cJSON_CreateObject();
+    cJSON_AddStringToObject(batch, "type", "result_batch");
+    cJSON *entries = cJSON_CreateArray();
+    cJSON_AddItemToObject(batch, "results", entries);
+    struct iovec pieces[RESULT_BATCH_LIMIT];
+    int piece_count = 0;
+    for (int i = 0; i < count; i++) {
+        cJSON_AddItemToArray(entries, result_metadata(&results[i], results[i].payload.len));
+        if (results[i].payload.len > 0) {
+            pieces[piece_count++] = (struct iovec){ .iov_base = results[i].payload.data,
+                                                    .iov_len = results[i].payload.len };
+        }
+    }
+    protocol_status_t status = send_json_payload(sockfd, batch, pieces, piece_count, calls);
+    cJSON_Delete(batch);
+    return status == PROTOCOL_OK ? 0 : -1;
+}
+
+// Put the employer's unsent batch back on the queue
+static void requeue_result_batch(employer_conn_t* employer) {
+    for (int i = 0; i < employer->batch_count; i++) {
+        if (add_result_to_queue(&result_queue, &employer->batch[i]) != 0) {
+            release_result(&employer->batch[i]);
+        }
+    }
+    employer->batch_count = 0;
+    employer->batch_bytes = 0;
+}
+
+// Send what the employer has batched, a lone result in the plain format
+static int flush_result_batch(employer_conn_t* employer) {
+    int count = employer->batch_count;
+    if (count == 0) return 0;
+
+    int status = count == 1 ? send_result_to_employer(employer->fd, &employer->batch[0], &employer->send_calls)
+                            : send_result_batch(employer->fd, employer->batch, count, &employer->send_calls);
+    if (status != 0) {
+        printf("[Employee] Failed to send %d result(s) to employer %s. Re-queueing for retry.\n", count, employer->ip);
+        requeue_result_batch(employer);
+        employee_status.tasks_failed++;
+        return -1;
+    }
+    if (count > 1) {
+        printf("[Employee] Sent %d results (%zu bytes) to employer %s in one frame\n", count,
+               employer->batch_bytes, employer->ip);
+    }
+    for (int i = 0; i < count; i++) {
+        release_result(&employer->batch[i]);
+    }
+    employee_status.tasks_completed += count;
+    employer->results_sent += count;
+    employer->frames_sent++;
+    employer->batch_count = 0;
+    employer->batch_bytes = 0;
+    return 0;
+}
+
+// How long the main loop may sleep before a batch is due
+static int result_batch_wait_ms(void) {
+    int wait_ms = 1000;
+    for (int i = 0; i < MAX_EMPLOYERS; i++) {
+        if (employers[i].id == 0 || employers[i].batch_count == 0) continue;
+        long remaining = result_batch_linger_ms - elapsed_ms(&employers[i].batch_started);
+        if (remaining < wait_ms) wait_ms = remaining > 0 ? (int)remaining : 0;
+    }
+    return wait_ms;
+}
+
+// Send queued results over the connection each came from. A result whose
+// employer is gone waits for the employer to reconnect and adopt its job, and
+// is dropped once the job is gone too. Results held in memory are batched per
+// employer, spilled ones go on their own. Returns the connection a send
+// failed on, so the caller can close it, or NULL.
+static employer_conn_t* send_queued_results(void) {
+
+    result_info_t result_to_send;
+    for (int sent = 0; sent < result_queue.capacity && get_result_from_queue(&result_queue, &result_to_send) == 0; sent++) {
+        employer_conn_t *employer = find_employer(result_to_send.employer_id);
+        bool job_hosted = false;
+        if (!employer) {
+            pthread_mutex_lock(&runtimes_mutex);
+            for (int i = 0; i < MAX_JOB_RUNTIMES; i++) {
+                job_runtime_t *runtime = &job_runtimes[i];
+                if (runtime->in_use && strcmp(runtime->job_id, result_to_send.job_id) == 0 &&
+                    strcmp(runtime->employer_ip, result_to_send.employer_ip) == 0) {
+                    employer = find_employer(runtime->employer_id);
+                    job_hosted = true;
+                    if (employer) break;
                 }
             }
+            pthread_mutex_unlock(&runtimes_mutex);
+        }
+        if (!employer) {
+            if (job_hosted && add_result_to_queue(&result_queue, &result_to_send) == 0) continue;
+            printf("[Employee] Employer %s of task %s is gone, dropping its result\n", result_to_send.employer_ip,
+                   result_to_send.task_id);
+            release_result(&result_to_send);
+            continue;
+        }
+
+        if (result_to_send.kind != RESULT_KIND_ACK && !result_to_send.payload.data) {
+            // Keep the order: what is batched goes first
+            if (flush_result_batch(employer) != 0 ||
+                send_result_to_employer(employer->fd, &result_to_send, &employer->send_calls) != 0) {
+                if (add_result_to_queue(&result_queue, &result_to_send) != 0) {
+                    release_result(&result_to_send);
+                }
+                return employer;
+            }
+            release_result(&result_to_send);
+            employee_status.tasks_completed++;
+            employer->results_sent++;
+            employer->frames_sent++;
+            continue;
+        }
+
+        if (employer->batch_count == 0) clock_gettime(CLOCK_MONOTONIC, &employer->batch_started);
+        employer->batch[employer->batch_count++] = result_to_send;
+        employer->batch_bytes += result_to_send.payload.len;
+        if ((employer->batch_count >= result_batch_max || employer->batch_bytes >= result_batch_bytes) &&
+            flush_result_batch(employer) != 0) {
+            return employer;
+        }
+    }
+
+    for (int i = 0; i < MAX_EMPLOYERS; i++) {
+        employer_conn_t *employer = &employers[i];
+        if (employer->id != 0 && employer->batch_count > 0 &&
+            elapsed_ms(&employer->batch_started) >= result_batch_linger_ms && flush_result_batch(employer) != 0) {
+            return employer;
         }
     }
-    printf("[Employee] Connection with employer lost. Returning to listening mode.\n");
-    close(employer_fd);
+    return NULL;
 }
 
+// Take a new employer connection, unless the host is busy or every slot is taken
+static void accept_employer(int server_fd, int epoll_fd) {
+
+    struct sockaddr_in client_addr;
+    socklen_t addr_len = sizeof(client_addr);
+    // Script processes forked later must not hold the connection open
+    int employer_fd = accept4(server_fd, (struct sockaddr *)&client_addr, &addr_len, SOCK_CLOEXEC);
+    if (employer_fd < 0) {
+        if (errno != EINTR) {
+            perror("[Employee] Accept failed");
+        }
+        return;
+    }
+
+    char employer_ip[INET_ADDRSTRLEN] = {0};
+    inet_ntop(AF_INET, &client_addr.sin_addr, employer_ip, sizeof(employer_ip));
+    printf("[Employee] Connection accepted from employer at %s\n", employer_ip);
+
+    employer_conn_t *employer = NULL;
+    int connected = 1;
+    for (int i = 0; i < MAX_EMPLOYERS; i++) {
+        if (employers[i].id != 0) connected++;
+        else if (!employer) employer = &employers[i];
+    }
+
+    if (admission_credits == 0 || !employer) {
+        const char *reject_msg = employer ? "REJECT:HIGH_RESOURCE_USAGE" : "REJECT:TOO_MANY_EMPLOYERS";
+        send(employer_fd, reject_msg, strlen(reject_msg), 0);
+        if (employer) {
+            printf("[Employee] Connection rejected - no credits offered under pressure\n");
+        } else {
+            printf("[Employee] Connection rejected - already serving %d employers\n", MAX_EMPLOYERS);
+        }
+        close(employer_fd);
+        return;
+    }
+
+    struct epoll_event event = { .events = EPOLLIN, .data.u32 = (uint32_t)(employer - employers) };
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, employer_fd, &event) != 0) {
+        perror("[Employee] epoll_ctl");
+        close(employer_fd);
+        return;
+    }
+    pthread_mutex_lock(&share_mutex);
+    employer->virtual_ms = min_virtual_ms();
+    employer->id = next_employer_id++;
+    if (next_employer_id == 0) next_employer_id = 1;
+    employer->fd = employer_fd;
+    employer->weight = 1;
+    employer->batch_count = 0;
+    employer->batch_bytes = 0;
+    employer->results_sent = 0;
+    employer->frames_sent = 0;
+    employer->send_calls = 0;
+    strncpy(employer->ip, employer_ip, sizeof(employer->ip) - 1);
+    pthread_mutex_unlock(&share_mutex);
+    printf("[Employee] Serving employer %s (%d connected)\n", employer_ip, connected);
+}
+
+// Its jobs keep running, for the employer to adopt when it reconnects
+static void close_employer(employer_conn_t* employer, int epoll_fd) {
+
+    printf("[Employee] Connection with employer %s closed after %ld results in %ld frames (%ld send calls).\n",
+           employer->ip, employer->results_sent, employer->frames_sent, employer->send_calls);
+    requeue_result_batch(employer); // Held for the job's next employer, see send_queued_results
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, employer->fd, NULL);
+    close(employer->fd);
+    pthread_mutex_lock(&share_mutex);
+    employer->id = 0;
+    employer->fd = -1;
+    pthread_cond_broadcast(&share_changed); // Its waiting chunks are now charged like a newcomer's
+    pthread_mutex_unlock(&share_mutex);
+}
+
+// Script hashes end up in file names: a SHA-256 in lowercase hex
 // Proper task reception from employer
 static int receive_task_from_employer(int sockfd, received_task_t* task) {
     if (!task) return -1;
@@ -703,6 +2147,8 @@ static int receive_task_from_employer(int sockfd, received_task_t* task) {
     const cJSON *sender_id = cJSON_GetObjectItem(metadata, "sender_id");
     const cJSON *message_type = cJSON_GetObjectItem(metadata, "message_type");
     const cJSON *frame_no = cJSON_GetObjectItem(metadata, "frame_no");
+    const cJSON *job_id = cJSON_GetObjectItem(metadata, "job_id");
+    const cJSON *script_hash = cJSON_GetObjectItem(metadata, "script_hash");
 
     if (!task_id || !cJSON_IsString(task_id) ||
         !chunk_filename || !cJSON_IsString(chunk_filename) ||
@@ -724,9 +2170,36 @@ static int receive_task_from_employer(int sockfd, received_task_t* task) {
     } else {
         task->frame_no = -1; // Unknown or not provided
     }
+    // Employers without job support only ever run the default job
+    strncpy(task->job_id, (job_id && cJSON_IsString(job_id)) ? job_id->valuestring : DEFAULT_JOB_ID,
+            sizeof(task->job_id) - 1);
+    if (script_hash && cJSON_IsString(script_hash) && is_script_hash(script_hash->valuestring)) {
+        strncpy(task->script_hash, script_hash->valuestring, sizeof(task->script_hash) - 1);
+    }
+    task->script_cached = cJSON_IsTrue(cJSON_GetObjectItem(metadata, "script_cached")) && task->script_hash[0] != '\0';
+    const cJSON *runtime = cJSON_GetObjectItem(metadata, "runtime");
+    if (runtime && cJSON_IsString(runtime) && script_runtime_parse(runtime->valuestring, &task->engine) != 0) {
+        printf("[Employee] Unknown runtime '%s', running the script with node\n", runtime->valuestring);
+        task->engine = SCRIPT_RUNTIME_NODE;
+    }
+    const cJSON *combine = cJSON_GetObjectItem(metadata, "combine");
+    const cJSON *combine_batch = cJSON_GetObjectItem(metadata, "combine_batch");
+    if (combine && cJSON_IsString(combine) && combine_parse(combine->valuestring, &task->combine) != 0) {
+        printf("[Employee] Unknown combine function '%s', sending per-chunk results\n", combine->valuestring);
+        task->combine = COMBINE_NONE;
+    }
+    task->combine_batch = (combine_batch && cJSON_IsNumber(combine_batch) && combine_batch->valueint > 0)
+                          ? combine_batch->valueint : COMBINE_BATCH;
+    const cJSON *lane = cJSON_GetObjectItem(metadata, "lane");
+    if (!lane || !cJSON_IsString(lane) || task_lane_parse(lane->valuestring, &task->lane) != 0) {
+        task->lane = TASK_LANE_BULK;
+    }
 
-    printf("[Employee] Receiving task: %s, file: %s, frame_no: %d\n", task->task_id, task->chunk_filename, task->frame_no);
+    printf("[Employee] Receiving task: %s, file: %s, frame_no: %d, lane: %s\n", task->task_id, task->chunk_filename,
+           task->frame_no, task_lane_name(task->lane));
 
+    // Chunks land in a chunk pool buffer (a memfd) that is handed to the runtime as is
+    bool use_pool = strcmp(message_type->valuestring, "data_chunk") == 0;
     cJSON_Delete(metadata);
 
     // Receive file size
@@ -739,33 +2212,47 @@ static int receive_task_from_employer(int sockfd, received_task_t* task) {
     uint32_t file_size = ntohl(net_size);
     printf("[Employee] Expecting file of size: %u bytes\n", file_size);
 
+    if (file_size == 0 && task->script_cached) {
+        task->data = NULL; // The employer knows we already have this script
+        task->data_size = 0;
+        return 0;
+    }
+
     if (file_size == 0 || file_size > 100 * 1024 * 1024) { // Max 100MB
         printf("[Employee] Invalid file size: %u\n", file_size);
         return -1;
     }
 
-    // Allocate memory for file data
-    task->data = malloc(file_size);
-    if (!task->data) {
-        printf("[Employee] Failed to allocate memory for task data\n");
-        return -1;
+    // Allocate memory for file data. Waiting for the chunk pool leaves the
+    // payload in the socket, which pushes back on the employer.
+    task->data_buffer = NULL;
+    if (use_pool) {
+        task->data_buffer = buffer_pool_acquire(&chunk_pool, file_size, CHUNK_POOL_WAIT_MS);
+        if (!task->data_buffer) {
+            printf("[Employee] No room in the chunk buffer pool for task %s (%u bytes)\n", task->task_id, file_size);
+            return -1;
+        }
+        task->data = task->data_buffer->data;
+    } else {
+        task->data = malloc(file_size);
+        if (!task->data) {
+            printf("[Employee] Failed to allocate memory for task data\n");
+            return -1;
+        }
     }
     task->data_size = file_size;
 
-    // Receive file content
+    // Receive file content straight into its final buffer
     size_t total_received = 0;
     char *data_ptr = (char*)task->data;
 
     while (total_received < file_size) {
-        size_t remaining = file_size - total_received;
-        size_t to_receive = remaining < 4096 ? remaining : 4096;
-
-        ssize_t bytes_received = recv(sockfd, data_ptr + total_received, to_receive, 0);
+        ssize_t bytes_received = recv(sockfd, data_ptr + total_received, file_size - total_received, MSG_WAITALL);
+        if (bytes_received < 0 && errno == EINTR) continue;
         if (bytes_received <= 0) {
             printf("[Employee] Failed to receive file data (received %zu/%u bytes)\n", 
                    total_received, file_size);
-            free(task->data);
-            task->data = NULL;
+            release_task_data(task);
             return -1;
         }
 
@@ -775,22 +2262,6 @@ static int receive_task_from_employer(int sockfd, received_task_t* task) {
     printf("[Employee] Successfully received task file: %s (%u bytes)\n", 
            task->task_id, file_size);
 
-    // Save file to local storage
-    char local_filename[512];
-    snprintf(local_filename, sizeof(local_filename), "/tmp/employee_task_%s", task->task_id);
-
-    FILE *local_file = fopen(local_filename, "wb");
-    if (local_file) {
-        fwrite(task->data, 1, file_size, local_file);
-        fclose(local_file);
-        printf("[Employee] Task file saved as: %s\n", local_filename);
-
-        // Update chunk_filename to point to local file
-        strncpy(task->chunk_filename, local_filename, sizeof(task->chunk_filename) - 1);
-    } else {
-        printf("[Employee] Warning: Could not save task file locally\n");
-    }
-
     return 0;
 }
 
@@ -806,16 +2277,10 @@ int run_employee_mode(struct volcom_rcsmngr_s *manager) {
         return -1;
     }
 
-    // Initialize data chunk buffer
-    if (init_task_buffer(&data_chunk_buffer, 50) != 0) {
-        fprintf(stderr, "Failed to initialize data chunk buffer\n");
-        return -1;
-    }
-
-    // Initialize result queue
-    if (init_result_queue(&result_queue, 10) != 0) {
+    // Initialize result queue (chunk buffers belong to the job runtimes)
+    // Room for a result from every worker of every runtime
+    if (init_result_queue(&result_queue, MAX_JOB_RUNTIMES * MAX_RUNTIME_WORKERS) != 0) {
         fprintf(stderr, "Failed to initialize result queue\n");
-        cleanup_task_buffer(&data_chunk_buffer);
         return -1;
     }
 
@@ -839,91 +2304,178 @@ int run_employee_mode(struct volcom_rcsmngr_s *manager) {
 
     volcom_print_cgroup_info(manager);
 
+    // One script process per CPU given to the cgroup, unless volcom.conf says otherwise
+    runtime_workers = config.cpu_config.allocated_logical_processors;
+    const char *workers_setting = get_volcom_config_value("runtime_workers");
+    if (workers_setting && atoi(workers_setting) > 0) {
+        runtime_workers = atoi(workers_setting);
+    }
+    if (runtime_workers < 1) runtime_workers = 1;
+    if (runtime_workers > MAX_RUNTIME_WORKERS) runtime_workers = MAX_RUNTIME_WORKERS;
+    printf("[Employee] Running %d script workers per job\n", runtime_workers);
+
+    const char *depth_setting = get_volcom_config_value("pipeline_depth");
+    if (depth_setting && atoi(depth_setting) > 0) {
+        pipeline_depth = atoi(depth_setting) < WORKER_PIPELINE_MAX ? atoi(depth_setting) : WORKER_PIPELINE_MAX;
+    }
+    printf("[Employee] Keeping up to %d messages in each script's socket\n", pipeline_depth);
+
+    const char *latency_setting = get_volcom_config_value("batch_latency_ms");
+    if (latency_setting && atoi(latency_setting) > 0) {
+        batch_latency_ms = atoi(latency_setting);
+    }
+
+    const char *result_memory_setting = get_volcom_config_value("result_memory_mb");
+    if (result_memory_setting && atoi(result_memory_setting) >= 0) {
+        result_memory_limit = (size_t)atoi(result_memory_setting) * 1024 * 1024;
+    }
+
+    const char *batch_setting = get_volcom_config_value("result_batch_max");
+    if (batch_setting && atoi(batch_setting) > 0) {
+        result_batch_max = atoi(batch_setting) < RESULT_BATCH_LIMIT ? atoi(batch_setting) : RESULT_BATCH_LIMIT;
+    }
+    batch_setting = get_volcom_config_value("result_batch_kb");
+    if (batch_setting && atoi(batch_setting) > 0) {
+        result_batch_bytes = (size_t)atoi(batch_setting) * 1024;
+    }
+    batch_setting = get_volcom_config_value("result_batch_linger_ms");
+    if (batch_setting && atoi(batch_setting) >= 0) {
+        result_batch_linger_ms = atoi(batch_setting);
+    }
+
+    if (init_buffer_pools(manager, config.mem_config.allocated_memory_size_max) != 0) {
+        fprintf(stderr, "[Employee] Failed to initialize buffer pools\n");
+        cleanup_result_queue(&result_queue);
+        return -1;
+    }
+    if (pipe2(result_wakeup, O_NONBLOCK | O_CLOEXEC) != 0) {
+        perror("[Employee] pipe");
+        cleanup_result_queue(&result_queue);
+        cleanup_buffer_pools();
+        return -1;
+    }
+
     signal(SIGINT, employee_signal_handler);
     signal(SIGTERM, employee_signal_handler);
 
+    const char *port_setting = get_volcom_config_value("employee_port");
+    if (port_setting && atoi(port_setting) > 0) {
+        employee_port = atoi(port_setting);
+    }
+    if (employee_port != EMPLOYEE_PORT) {
+        // Runtime sockets of employees on the same host must not collide
+        snprintf(runtime_socket_base, sizeof(runtime_socket_base), "%s_%d",
+                 client_socket_config.socket_path, employee_port);
+    } else {
+        snprintf(runtime_socket_base, sizeof(runtime_socket_base), "%s", client_socket_config.socket_path);
+    }
+
     employee_running = true;
     employee_status = get_agent_status();
     employee_status.is_active = true;
 
-    // Start broadcaster thread
-    if (pthread_create(&broadcaster_thread, NULL, broadcast_loop, NULL) != 0) {
+    // Start broadcaster thread. Full credits until its first pressure sample.
+    admission_credits = runtime_workers + 2;
+    if (pthread_create(&broadcaster_thread, NULL, broadcast_loop, manager) != 0) {
         perror("Failed to create broadcaster thread");
         employee_running = false;
-        cleanup_task_buffer(&data_chunk_buffer);
+        close(result_wakeup[0]);
+        close(result_wakeup[1]);
+        cleanup_result_queue(&result_queue);
+        cleanup_buffer_pools();
         return -1;
     }
 
-    // Start worker thread
-    if (pthread_create(&worker_thread, NULL, worker_loop, NULL) != 0) {
-        perror("Failed to create worker thread");
-        employee_running = false;
-        pthread_cancel(broadcaster_thread);
-        cleanup_task_buffer(&data_chunk_buffer);
-        return -1;
-    }
+    // Job runtimes (and their worker threads) are started when a job's config arrives
 
-    printf("[Employee] Ready to accept task requests on port %d...\n", EMPLOYEE_PORT);
+    printf("[Employee] Ready to accept task requests on port %d...\n", employee_port);
 
     // Start TCP server for receiving tasks
-    int server_fd = start_tcp_server(EMPLOYEE_PORT);
+    int server_fd = start_tcp_server(employee_port);
     if (server_fd < 0) {
         fprintf(stderr, "[Employee] Failed to start TCP server\n");
         employee_running = false;
         pthread_cancel(broadcaster_thread);
-        pthread_cancel(worker_thread);
-        cleanup_task_buffer(&data_chunk_buffer);
+        close(result_wakeup[0]);
+        close(result_wakeup[1]);
+        cleanup_result_queue(&result_queue);
+        cleanup_buffer_pools();
+        return -1;
+    }
+
+    // One epoll set for the listening socket, every employer connection and
+    // the result wakeup
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    fcntl(server_fd, F_SETFD, FD_CLOEXEC);
+    struct epoll_event listen_event = { .events = EPOLLIN, .data.u32 = EMPLOYEE_EVENT_ACCEPT };
+    struct epoll_event result_event = { .events = EPOLLIN, .data.u32 = EMPLOYEE_EVENT_RESULTS };
+    if (epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_fd, &listen_event) != 0 ||
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, result_wakeup[0], &result_event) != 0) {
+        perror("[Employee] epoll");
+        if (epoll_fd >= 0) close(epoll_fd);
+        close(server_fd);
+        employee_running = false;
+        pthread_cancel(broadcaster_thread);
+        close(result_wakeup[0]);
+        close(result_wakeup[1]);
+        cleanup_result_queue(&result_queue);
+        cleanup_buffer_pools();
         return -1;
     }
 
-    // Main loop to accept connections
+    printf("[Employee] Waiting for employers to connect on port %d...\n", employee_port);
     while (employee_running) {
-        printf("[Employee] Waiting for an employer to connect on port %d...\n", EMPLOYEE_PORT);
-        
-        struct sockaddr_in client_addr;
-        socklen_t addr_len = sizeof(client_addr);
-        int employer_fd = accept(server_fd, (struct sockaddr *)&client_addr, &addr_len);
-        
-        if (employer_fd < 0) {
-            if (errno != EINTR) {
-                perror("[Employee] Accept failed");
-            }
-            continue;
+        struct epoll_event events[MAX_EMPLOYERS + 2];
+        int ready = epoll_wait(epoll_fd, events, MAX_EMPLOYERS + 2, result_batch_wait_ms());
+        if (ready < 0 && errno != EINTR) {
+            perror("[Employee] epoll_wait");
+            break;
         }
 
-        char employer_ip[INET_ADDRSTRLEN] = {0};
-        inet_ntop(AF_INET, &client_addr.sin_addr, employer_ip, sizeof(employer_ip));
-        printf("[Employee] Connection accepted from employer at %s\n", employer_ip);
-
-        double mem_percent = get_current_memory_percent();
+        // A connection accepted now may reuse the slot of one closed in this round
+        bool accept_pending = false;
+        for (int i = 0; i < ready; i++) {
+            uint32_t source = events[i].data.u32;
+            if (source == EMPLOYEE_EVENT_ACCEPT) {
+                accept_pending = true;
+            } else if (source == EMPLOYEE_EVENT_RESULTS) {
+                char drain[64];
+                while (read(result_wakeup[0], drain, sizeof(drain)) > 0) {}
+            } else if (employers[source].id != 0 && handle_employer_message(&employers[source], manager) != 0) {
+                close_employer(&employers[source], epoll_fd);
+            }
+        }
+        if (accept_pending) accept_employer(server_fd, epoll_fd);
 
-        if (mem_percent < RESOURCE_THRESHOLD_PERCENT) {
-            // Enter persistent communication loop
-            handle_persistent_connection(employer_fd, manager);
-        } else {
-            const char reject_msg[] = "REJECT:HIGH_RESOURCE_USAGE";
-            send(employer_fd, reject_msg, strlen(reject_msg), 0);
-            printf("[Employee] Connection rejected - high resource usage: %.2f%%\n", mem_percent);
-            close(employer_fd);
+        // Send the completed task results, several workers may have finished since the last round
+        employer_conn_t *failed;
+        while ((failed = send_queued_results()) != NULL) {
+            count_stall(STAGE_UPLOAD);
+            close_employer(failed, epoll_fd);
         }
     }
 
+    for (int i = 0; i < MAX_EMPLOYERS; i++) {
+        if (employers[i].id != 0) close_employer(&employers[i], epoll_fd);
+    }
+    close(epoll_fd);
+
     // Cleanup
     close(server_fd);
     pthread_cancel(broadcaster_thread);
-    pthread_cancel(worker_thread);
-    
     pthread_join(broadcaster_thread, NULL);
-    pthread_join(worker_thread, NULL);
 
-    // Cleanup Unix socket connection
-    if (unix_socket_connected) {
-        unix_socket_client_cleanup();
-        unix_socket_connected = false;
-    }
+    // Stop the job runtimes (closes their sockets and script processes)
+    stop_all_job_runtimes();
 
-    cleanup_task_buffer(&data_chunk_buffer);
+    result_info_t unsent;
+    while (get_result_from_queue(&result_queue, &unsent) == 0) {
+        release_result(&unsent);
+    }
+    close(result_wakeup[0]);
+    close(result_wakeup[1]);
     cleanup_result_queue(&result_queue);
+    cleanup_buffer_pools();
 
     printf("[Employee] Employee mode stopped\n");
     return 0;
@@ -937,7 +2489,9 @@ int run_hybrid_mode(void) {
     return -1;
 }
 
-int run_node_in_cgroup(struct volcom_rcsmngr_s *manager, const char *task_name, const char *script_path) {
+// job_script, when set, is the script the runner at script_path loads
+pid_t run_node_in_cgroup(struct volcom_rcsmngr_s *manager, const char *task_name, const char *script_path,
+                         const char *job_script, const char *socket_path, int ready_fd) {
 
     pid_t pid = fork();
 
@@ -978,11 +2532,39 @@ int run_node_in_cgroup(struct volcom_rcsmngr_s *manager, const char *task_name,
             strcpy(node_modules_path, "/home/dasun/node_global_modules/node_modules");
         }
         
+        // Scripts run from the script cache, not from scripts/, and find the
+        // shared framing module (volcom_frame.js) through NODE_PATH
+        const char *script_lib = get_volcom_config_value("script_lib_dir");
+        if (!script_lib) script_lib = "scripts";
+        char node_path[1024];
+        if (script_lib[0] != '/' && original_cwd) {
+            snprintf(node_path, sizeof(node_path), "%s/%s:%s", original_cwd, script_lib, node_modules_path);
+        } else {
+            snprintf(node_path, sizeof(node_path), "%s:%s", script_lib, node_modules_path);
+        }
+
         printf("Setting Node.js environment:\n");
-        printf("  NODE_PATH: %s\n", node_modules_path);
+        printf("  NODE_PATH: %s\n", node_path);
         
         // Set NODE_PATH
-        setenv("NODE_PATH", node_modules_path, 1);
+        setenv("NODE_PATH", node_path, 1);
+
+        // Each job runtime listens on its own socket
+        if (socket_path) {
+            setenv("VOLCOM_SOCKET_PATH", socket_path, 1);
+            printf("  VOLCOM_SOCKET_PATH: %s\n", socket_path);
+        }
+        if (job_script) {
+            setenv("VOLCOM_JOB_SCRIPT", job_script, 1);
+            printf("  VOLCOM_JOB_SCRIPT: %s\n", job_script);
+        }
+
+        // The readiness pipe is the one descriptor the script inherits
+        if (ready_fd >= 0 && fcntl(ready_fd, F_SETFD, 0) == 0) {
+            char ready_fd_text[16];
+            snprintf(ready_fd_text, sizeof(ready_fd_text), "%d", ready_fd);
+            setenv("VOLCOM_READY_FD", ready_fd_text, 1);
+        }
         
         // Also try setting NODE_MODULES_PATH (some applications use this)
         setenv("NODE_MODULES_PATH", node_modules_path, 1);
@@ -1017,7 +2599,7 @@ int run_node_in_cgroup(struct volcom_rcsmngr_s *manager, const char *task_name,
         printf("  Final NODE_PATH: %s\n", getenv("NODE_PATH"));
         printf("  Script to execute: %s\n", script_path);
         
-        execlp("node", "node", script_path);
+        execlp("node", "node", script_path, (char*)NULL);
         perror("execlp failed - Node.js not found or script error");
         
         if (original_cwd) free(original_cwd);
@@ -1039,6 +2621,6 @@ int run_node_in_cgroup(struct volcom_rcsmngr_s *manager, const char *task_name,
         // The Unix socket connection will be handled by start_node_thread
         // The process will be monitored separately
         
-        return 0; // Return success immediately
+        return pid; // Return immediately, the caller keeps the pid to stop the runtime
     }
 }
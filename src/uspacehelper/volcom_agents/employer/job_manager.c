@@ -0,0 +1,387 @@
+#define _GNU_SOURCE
+
+#include "volcom_agents.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <ctype.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <cjson/cJSON.h>
+
+// Job table and local control socket for the employer.
+//
+// Every job carries its own runtime script, chunk set, priority and weight.
+// Dispatch order between jobs uses stride scheduling: each dispatch advances
+// the job's pass by 1/weight and the next task always comes from the job with
+// the smallest pass within the highest waiting priority. Over any window a job
+// therefore receives dispatches in proportion to its weight, and a long job
+// cannot starve a short one that was submitted later.
+//
+// Jobs are submitted over a Unix stream socket, one newline terminated JSON
+// request per connection, answered with one JSON line:
+//   {"command":"submit_job","job_id":"stats","script":"./scripts/stats.js",
+//    "chunk_dir":"./stats_chunks","priority":0,"weight":2}
+//   {"command":"list_jobs"}
+// "combine":"merge" (with an optional "combine_batch") makes it a map-reduce
+// job whose results employees combine before uploading, see combine.c.
+// "runtime":"native" runs a shared object built against volcom_plugin.h in
+// place of a script; without "runtime", a script ending in .so is native.
+// "runtime":"quickjs" runs a script defining processChunk() in the VM embedded
+// in employees, see employee/quickjs_runtime.c. Scripts that need Node modules
+// such as tfjs-node stay on "node".
+
+#define JOB_CONTROL_MAX_REQUEST 65536
+#define JOB_CONTROL_TIMEOUT_SEC 1
+#define JOB_ID_MAX_LEN 48 // Job ids end up in employee file and socket names
+
+static job_t jobs[MAX_JOBS];
+
+// Smallest pass among active jobs, so a new job starts level with the others
+// instead of catching up on everything dispatched before it arrived
+static double current_virtual_time(void) {
+
+    double min_pass = 0.0;
+    bool found = false;
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].state != JOB_STATE_ACTIVE) continue;
+        if (!found || jobs[i].pass < min_pass) {
+            min_pass = jobs[i].pass;
+            found = true;
+        }
+    }
+    return min_pass;
+}
+
+static bool is_valid_job_id(const char* job_id) {
+
+    size_t len = strlen(job_id);
+    if (len == 0 || len > JOB_ID_MAX_LEN) return false;
+    for (size_t i = 0; i < len; i++) {
+        if (!isalnum((unsigned char)job_id[i]) && job_id[i] != '-' && job_id[i] != '_') return false;
+    }
+    return true;
+}
+
+static bool is_native_plugin(const char* script_path) {
+
+    size_t len = strlen(script_path);
+    return len > 3 && strcmp(script_path + len - 3, ".so") == 0;
+}
+
+int job_table_add(const char* job_id, const char* script_path, const char* chunk_dir,
+                  const char* runtime, int priority, int weight) {
+
+    if (!job_id || !script_path || !chunk_dir || !is_valid_job_id(job_id)) return -1;
+    if (job_table_find(job_id) >= 0) return -1;
+
+    // Reuse the first free slot, otherwise the oldest finished job
+    int slot = -1;
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].state == JOB_STATE_FREE) {
+            slot = i;
+            break;
+        }
+        if (jobs[i].state == JOB_STATE_DONE &&
+            (slot < 0 || jobs[i].finish_time < jobs[slot].finish_time)) {
+            slot = i;
+        }
+    }
+    if (slot < 0) return -1;
+
+    job_t *job = &jobs[slot];
+    if (job->result_stream_enabled) {
+        result_stream_flush(&job->result_stream);
+        result_stream_cleanup(&job->result_stream);
+    }
+    combine_tree_cleanup(&job->combined);
+
+    double vtime = current_virtual_time();
+    memset(job, 0, sizeof(*job));
+    strncpy(job->job_id, job_id, sizeof(job->job_id) - 1);
+    strncpy(job->script_path, script_path, sizeof(job->script_path) - 1);
+    strncpy(job->chunk_dir, chunk_dir, sizeof(job->chunk_dir) - 1);
+    if (!runtime) runtime = is_native_plugin(script_path) ? "native" : "node";
+    strncpy(job->runtime, runtime, sizeof(job->runtime) - 1);
+    job->priority = priority;
+    job->weight = weight > 0 ? weight : 1;
+    job->pass = vtime;
+    job->submit_time = time(NULL);
+    job->state = JOB_STATE_ACTIVE;
+
+    printf("[Employer] Job %s added (slot %d, priority %d, weight %d, script %s)\n",
+           job->job_id, slot, job->priority, job->weight, job->script_path);
+    return slot;
+}
+
+int job_table_find(const char* job_id) {
+
+    if (!job_id) return -1;
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].state != JOB_STATE_FREE && strcmp(jobs[i].job_id, job_id) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+job_t* job_table_get(int slot) {
+
+    if (slot < 0 || slot >= MAX_JOBS || jobs[slot].state == JOB_STATE_FREE) return NULL;
+    return &jobs[slot];
+}
+
+int job_table_pick_next(const bool* blocked) {
+
+    int best = -1;
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].state != JOB_STATE_ACTIVE || (blocked && blocked[i])) continue;
+        if (best < 0 ||
+            jobs[i].priority > jobs[best].priority ||
+            (jobs[i].priority == jobs[best].priority && jobs[i].pass < jobs[best].pass)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+void job_table_charge(int slot) {
+
+    job_t *job = job_table_get(slot);
+    if (!job) return;
+
+    job->pass += 1.0 / job->weight;
+    job->tasks_dispatched++;
+}
+
+int job_table_active_count(void) {
+
+    int active = 0;
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].state == JOB_STATE_ACTIVE) active++;
+    }
+    return active;
+}
+
+void job_table_cleanup(void) {
+
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].result_stream_enabled) {
+            result_stream_flush(&jobs[i].result_stream);
+            result_stream_cleanup(&jobs[i].result_stream);
+        }
+        combine_tree_cleanup(&jobs[i].combined);
+    }
+    memset(jobs, 0, sizeof(jobs));
+}
+
+// ============================================================================
+// CONTROL SOCKET
+// ============================================================================
+
+int job_control_listen(const char* socket_path) {
+
+    if (!socket_path) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("[Employer] control socket");
+        return -1;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+
+    unlink(socket_path);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 8) < 0) {
+        perror("[Employer] control socket bind/listen");
+        close(fd);
+        return -1;
+    }
+    chmod(socket_path, 0600); // Local submissions only
+
+    printf("[Employer] Accepting job submissions on %s\n", socket_path);
+    return fd;
+}
+
+void job_control_close(int listen_fd, const char* socket_path) {
+
+    if (listen_fd < 0) return;
+    close(listen_fd);
+    if (socket_path) unlink(socket_path);
+}
+
+static cJSON* job_to_json(const job_t* job) {
+
+    static const char *state_names[] = { "free", "active", "done" };
+
+    cJSON *item = cJSON_CreateObject();
+    cJSON_AddStringToObject(item, "job_id", job->job_id);
+    cJSON_AddStringToObject(item, "state", state_names[job->state]);
+    cJSON_AddStringToObject(item, "script", job->script_path);
+    cJSON_AddStringToObject(item, "runtime", job->runtime);
+    cJSON_AddNumberToObject(item, "priority", job->priority);
+    cJSON_AddNumberToObject(item, "weight", job->weight);
+    cJSON_AddNumberToObject(item, "tasks_queued", job->tasks_queued);
+    cJSON_AddNumberToObject(item, "tasks_dispatched", job->tasks_dispatched);
+    cJSON_AddNumberToObject(item, "tasks_completed", job->tasks_completed);
+    if (job->combine != COMBINE_NONE) {
+        cJSON_AddStringToObject(item, "combine", combine_name(job->combine));
+        cJSON_AddNumberToObject(item, "partials", job->combined.partials);
+    }
+    return item;
+}
+
+static int read_request_line(int fd, char* buffer, size_t size) {
+
+    size_t total = 0;
+    while (total < size - 1) {
+        ssize_t n = recv(fd, buffer + total, size - 1 - total, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        total += n;
+        if (memchr(buffer + total - n, '\n', n)) break;
+    }
+    buffer[total] = '\0';
+    return total > 0 ? 0 : -1;
+}
+
+static cJSON* handle_submit(const cJSON* request, job_submit_cb_t on_submit) {
+
+    cJSON *reply = cJSON_CreateObject();
+    const cJSON *job_id = cJSON_GetObjectItem(request, "job_id");
+    const cJSON *script = cJSON_GetObjectItem(request, "script");
+    const cJSON *chunk_dir = cJSON_GetObjectItem(request, "chunk_dir");
+    const cJSON *runtime = cJSON_GetObjectItem(request, "runtime");
+    const cJSON *priority = cJSON_GetObjectItem(request, "priority");
+    const cJSON *weight = cJSON_GetObjectItem(request, "weight");
+    const cJSON *combine = cJSON_GetObjectItem(request, "combine");
+    const cJSON *combine_batch = cJSON_GetObjectItem(request, "combine_batch");
+
+    const char *error = NULL;
+    combine_kind_t combine_kind = COMBINE_NONE;
+    script_runtime_t engine = SCRIPT_RUNTIME_NODE;
+    struct stat st;
+    if (!job_id || !cJSON_IsString(job_id) || !is_valid_job_id(job_id->valuestring)) {
+        error = "job_id must be 1-48 characters of [A-Za-z0-9_-]";
+    } else if (job_table_find(job_id->valuestring) >= 0) {
+        error = "job_id already in use";
+    } else if (!script || !cJSON_IsString(script) || access(script->valuestring, R_OK) != 0) {
+        error = "script must be a readable file";
+    } else if (!chunk_dir || !cJSON_IsString(chunk_dir) ||
+               stat(chunk_dir->valuestring, &st) != 0 || !(S_ISDIR(st.st_mode) || S_ISREG(st.st_mode))) {
+        error = "chunk_dir must be a directory or an input file";
+    } else if (runtime && (!cJSON_IsString(runtime) || script_runtime_parse(runtime->valuestring, &engine) != 0)) {
+        error = "unsupported runtime";
+    } else if (combine && (!cJSON_IsString(combine) || combine_parse(combine->valuestring, &combine_kind) != 0)) {
+        error = "unsupported combine function";
+    } else if (combine_batch && (!cJSON_IsNumber(combine_batch) || combine_batch->valueint <= 0)) {
+        error = "combine_batch must be a positive number";
+    }
+
+    int slot = -1;
+    if (!error) {
+        slot = job_table_add(job_id->valuestring, script->valuestring, chunk_dir->valuestring,
+                             runtime ? runtime->valuestring : NULL,
+                             (priority && cJSON_IsNumber(priority)) ? priority->valueint : 0,
+                             (weight && cJSON_IsNumber(weight)) ? weight->valueint : 1);
+        if (slot < 0) error = "job table full";
+    }
+    if (slot >= 0) {
+        jobs[slot].combine = combine_kind;
+        jobs[slot].combine_batch = combine_batch ? combine_batch->valueint : COMBINE_BATCH;
+    }
+
+    if (error) {
+        cJSON_AddStringToObject(reply, "status", "error");
+        cJSON_AddStringToObject(reply, "error", error);
+        return reply;
+    }
+
+    int queued = on_submit ? on_submit(slot) : 0;
+    if (queued <= 0) {
+        jobs[slot].state = JOB_STATE_DONE; // Nothing to do
+        jobs[slot].finish_time = time(NULL);
+    }
+
+    cJSON_AddStringToObject(reply, "status", "ok");
+    cJSON_AddStringToObject(reply, "job_id", jobs[slot].job_id);
+    cJSON_AddNumberToObject(reply, "tasks", queued > 0 ? queued : 0);
+    return reply;
+}
+
+int job_control_handle(int listen_fd, job_submit_cb_t on_submit) {
+
+    int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0) {
+        if (errno != EINTR && errno != EAGAIN) perror("[Employer] control accept");
+        return -1;
+    }
+
+    // A stalled client must not hold up the employer loop for long
+    struct timeval tv = { .tv_sec = JOB_CONTROL_TIMEOUT_SEC, .tv_usec = 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    char *request_buf = malloc(JOB_CONTROL_MAX_REQUEST);
+    if (!request_buf) {
+        close(fd);
+        return -1;
+    }
+
+    cJSON *reply = NULL;
+    cJSON *request = NULL;
+    if (read_request_line(fd, request_buf, JOB_CONTROL_MAX_REQUEST) == 0) {
+        request = cJSON_Parse(request_buf);
+    }
+    free(request_buf);
+
+    const cJSON *command = request ? cJSON_GetObjectItem(request, "command") : NULL;
+    if (!command || !cJSON_IsString(command)) {
+        reply = cJSON_CreateObject();
+        cJSON_AddStringToObject(reply, "status", "error");
+        cJSON_AddStringToObject(reply, "error", "expected a JSON object with a command");
+    } else if (strcmp(command->valuestring, "submit_job") == 0) {
+        reply = handle_submit(request, on_submit);
+    } else if (strcmp(command->valuestring, "list_jobs") == 0) {
+        reply = cJSON_CreateObject();
+        cJSON_AddStringToObject(reply, "status", "ok");
+        cJSON *list = cJSON_AddArrayToObject(reply, "jobs");
+        for (int i = 0; i < MAX_JOBS; i++) {
+            if (jobs[i].state != JOB_STATE_FREE) {
+                cJSON_AddItemToArray(list, job_to_json(&jobs[i]));
+            }
+        }
+    } else {
+        reply = cJSON_CreateObject();
+        cJSON_AddStringToObject(reply, "status", "error");
+        cJSON_AddStringToObject(reply, "error", "unknown command");
+    }
+    cJSON_Delete(request);
+
+    char *text = cJSON_PrintUnformatted(reply);
+    if (text) {
+        // One line per reply, sent in one piece
+        size_t len = strlen(text);
+        char *line = malloc(len + 2);
+        if (line) {
+            memcpy(line, text, len);
+            line[len] = '\n';
+            line[len + 1] = '\0';
+            if (send(fd, line, len + 1, MSG_NOSIGNAL) != (ssize_t)(len + 1)) {
+                printf("[Employer] Failed to answer control request\n");
+            }
+            free(line);
+        }
+        free(text);
+    }
+    cJSON_Delete(reply);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,596 @@
+#define _GNU_SOURCE
+
+#include "volcom_agents.h"
+#include "volcom_employer.h"
+#include "../volcom_utils/volcom_utils.h"
+#include "../volcom_net/volcom_net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+
+// Relay employer.
+//
+// One employer owning every employee connection caps the cluster at what its
+// NIC and event loop can push. A relay sits between a parent employer and a
+// group of employees: to the parent it is a single employee with many slots,
+// to its employees it is an ordinary employer. Job scripts and chunks arrive
+// on the one parent connection, are spooled to disk and queued on an employer
+// main loop running in relay mode, which discovers its own employees and
+// dispatches to them. Results come back through a callback and are forwarded
+// upstream on the same connection. Relays can be stacked into a tree.
+//
+// A relay announces itself on the parent's discovery port and listens for its
+// own employees on a different one, so it never discovers itself and relays
+// on the same level never discover each other.
+//
+// Combine jobs pass through unchanged: chunk acknowledgements and partials of
+// the local employees are forwarded as they are, the parent merges them.
+
+#define RELAY_PORT 12346
+#define RELAY_SPOOL_PATH "./relay_spool"
+#define RELAY_BROADCAST_INTERVAL 5
+#define RELAY_PREFETCH_FACTOR 2 // Chunks held per local slot, so employees never wait on the parent
+#define RELAY_MAX_PAYLOAD (100 * 1024 * 1024)
+#define RELAY_STATUS_INTERVAL 10
+
+typedef struct {
+    char job_id[64];
+    char script_path[MAX_FILENAME_LEN];
+    script_runtime_t engine;
+    combine_kind_t combine;
+    int combine_batch;
+} relay_job_t;
+
+static volatile bool relay_running = false;
+static int relay_port = RELAY_PORT;
+static char spool_dir[128] = RELAY_SPOOL_PATH; // Leaves room for the file names below
+static relay_job_t relay_jobs[MAX_JOBS]; // Script of each job, set by its initial_config
+static result_queue_t upstream_results;
+static int result_wakeup[2] = { -1, -1 };
+static long chunk_sequence = 0;
+static struct {
+    long chunks_received;
+    long results_forwarded;
+    long bytes_down;
+    long bytes_up;
+} relay_stats;
+
+static void relay_signal_handler(int sig) {
+
+    (void)sig;
+    relay_running = false;
+    employer_request_stop();
+}
+
+// Employer loop callback: a task of a relayed job finished on a local employee
+static void relay_on_result(const char* job_id, const char* task_id, const char* chunk_path,
+                            const char* result_path, result_kind_t kind, int task_count) {
+
+    result_info_t result = {0};
+    strncpy(result.task_id, task_id, sizeof(result.task_id) - 1);
+    if (result_path) strncpy(result.result_filepath, result_path, sizeof(result.result_filepath) - 1);
+    strncpy(result.job_id, job_id, sizeof(result.job_id) - 1);
+    result.kind = kind;
+    result.task_count = task_count;
+    if (chunk_path) unlink(chunk_path); // Spooled copy is no longer needed
+
+    if (add_result_to_queue(&upstream_results, &result) != 0) {
+        printf("[Relay] Result queue full, dropping result of %s (the parent will resend it)\n", task_id);
+        if (result_path) unlink(result_path);
+        return;
+    }
+    char wake = 1;
+    if (write(result_wakeup[1], &wake, 1) < 0 && errno != EAGAIN) {
+        perror("[Relay] result wakeup");
+    }
+}
+
+static relay_job_t* find_relay_job(const char* job_id, bool create) {
+
+    relay_job_t *free_slot = NULL;
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (relay_jobs[i].job_id[0] == '\0') {
+            if (!free_slot) free_slot = &relay_jobs[i];
+        } else if (strcmp(relay_jobs[i].job_id, job_id) == 0) {
+            return &relay_jobs[i];
+        }
+    }
+    if (!create || !free_slot) return NULL;
+    strncpy(free_slot->job_id, job_id, sizeof(free_slot->job_id) - 1);
+    return free_slot;
+}
+
+// Ids end up in spool file names
+static bool is_safe_name(const char* value) {
+
+    size_t len = strlen(value);
+    if (len == 0 || len > 48) return false;
+    for (size_t i = 0; i < len; i++) {
+        if (!isalnum((unsigned char)value[i]) && value[i] != '-' && value[i] != '_') return false;
+    }
+    return true;
+}
+
+// Whether the spooled script at path still has the content the parent hashed
+static bool script_matches(const char* path, const char* hash) {
+
+    char hex[SHA256_HEX_LEN + 1];
+    return sha256_file_hex(path, hex) == 0 && strcmp(hex, hash) == 0;
+}
+
+// Read the 4 byte payload size and stream the payload into path (NULL
+// discards it). Returns the payload size, or -1 if the connection failed.
+static long receive_payload(int fd, const char* path) {
+
+    uint32_t net_size;
+    if (recv(fd, &net_size, sizeof(net_size), MSG_WAITALL) != sizeof(net_size)) {
+        return -1;
+    }
+    uint32_t size = ntohl(net_size);
+    if (size > RELAY_MAX_PAYLOAD) {
+        printf("[Relay] Payload of %u bytes is too large\n", size);
+        return -1;
+    }
+
+    FILE *file = path ? fopen(path, "wb") : NULL;
+    if (path && !file) {
+        printf("[Relay] Cannot write %s: %s\n", path, strerror(errno));
+    }
+
+    char buffer[65536];
+    uint32_t received = 0;
+    while (received < size) {
+        size_t to_receive = size - received < sizeof(buffer) ? size - received : sizeof(buffer);
+        ssize_t n = recv(fd, buffer, to_receive, 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            if (file) fclose(file);
+            return -1;
+        }
+        if (file && fwrite(buffer, 1, n, file) != (size_t)n) {
+            printf("[Relay] Short write to %s\n", path);
+            fclose(file);
+            file = NULL;
+            unlink(path);
+        }
+        received += n;
+    }
+    if (file) fclose(file);
+
+    relay_stats.bytes_down += size;
+    return size;
+}
+
+// A job's runtime script, sent before its first chunk. With script_cached the
+// parent knows we already hold the content and sends no payload; if our copy is
+// gone or changed we ask for it again, and chunks that arrive until it does are
+// dropped for the parent to time out and resend.
+static int receive_job_script(int fd) {
+
+    cJSON *metadata = NULL;
+    if (recv_json(fd, &metadata) != PROTOCOL_OK) return -1;
+
+    const cJSON *job_id = cJSON_GetObjectItem(metadata, "job_id");
+    const cJSON *script_hash = cJSON_GetObjectItem(metadata, "script_hash");
+    const cJSON *combine = cJSON_GetObjectItem(metadata, "combine");
+    const cJSON *combine_batch = cJSON_GetObjectItem(metadata, "combine_batch");
+    bool has_hash = script_hash && cJSON_IsString(script_hash) && is_script_hash(script_hash->valuestring);
+    bool cached = has_hash && cJSON_IsTrue(cJSON_GetObjectItem(metadata, "script_cached"));
+    const char *id = (job_id && cJSON_IsString(job_id)) ? job_id->valuestring : DEFAULT_JOB_ID;
+    const cJSON *runtime = cJSON_GetObjectItem(metadata, "runtime");
+    script_runtime_t engine = SCRIPT_RUNTIME_NODE;
+    if (runtime && cJSON_IsString(runtime) && script_runtime_parse(runtime->valuestring, &engine) != 0) {
+        printf("[Relay] Unknown runtime '%s' for job %s, running it with node\n", runtime->valuestring, id);
+    }
+    const char *suffix = engine == SCRIPT_RUNTIME_NATIVE ? "so" : "js";
+
+    char script_path[MAX_FILENAME_LEN];
+    if (has_hash) {
+        snprintf(script_path, sizeof(script_path), "%s/script_%s.%s", spool_dir, script_hash->valuestring, suffix);
+    } else {
+        snprintf(script_path, sizeof(script_path), "%s/script_%s.%s", spool_dir, id, suffix);
+    }
+
+    relay_job_t *job = is_safe_name(id) ? find_relay_job(id, true) : NULL;
+    if (!job) {
+        printf("[Relay] Cannot host job %s, discarding its script\n", id);
+    }
+    // A cached script comes without payload, opening it for writing would truncate it.
+    // A hashed script lands next to its final name and only replaces it once verified.
+    char part_path[MAX_FILENAME_LEN + 8];
+    snprintf(part_path, sizeof(part_path), "%s.part", script_path);
+    long size = receive_payload(fd, job && !cached ? (has_hash ? part_path : script_path) : NULL);
+    if (size < 0) {
+        if (job && !cached && has_hash) unlink(part_path);
+        cJSON_Delete(metadata);
+        return -1;
+    }
+
+    if (job && has_hash && !cached) {
+        if (script_matches(part_path, script_hash->valuestring)) {
+            rename(part_path, script_path);
+        } else {
+            // Still run what the parent sent, just never under the hash it does not match
+            printf("[Relay] Script of job %s does not match its hash, not caching it\n", id);
+            snprintf(script_path, sizeof(script_path), "%s/script_%s.%s", spool_dir, id, suffix);
+            rename(part_path, script_path);
+        }
+    }
+
+    if (job && cached && !script_matches(script_path, script_hash->valuestring)) {
+        printf("[Relay] Cached script %s for job %s is missing, asking the parent for it\n", script_path, id);
+        job->script_path[0] = '\0';
+        int status = send_script_missing(fd, id, script_hash->valuestring);
+        cJSON_Delete(metadata);
+        return status;
+    }
+
+    if (job) {
+        strncpy(job->script_path, script_path, sizeof(job->script_path) - 1);
+        // Handed on to the local employees with the job's script
+        job->engine = engine;
+        job->combine = COMBINE_NONE;
+        if (combine && cJSON_IsString(combine) && combine_parse(combine->valuestring, &job->combine) != 0) {
+            printf("[Relay] Unknown combine function '%s' for job %s\n", combine->valuestring, id);
+        }
+        job->combine_batch = (combine_batch && cJSON_IsNumber(combine_batch) && combine_batch->valueint > 0)
+                             ? combine_batch->valueint : COMBINE_BATCH;
+        printf("[Relay] Job %s runs %s%s\n", id, script_path, cached ? " (cached)" : "");
+    }
+    cJSON_Delete(metadata);
+    return 0;
+}
+
+// Spool a chunk and queue it on the local employer loop
+static int receive_chunk(int fd) {
+
+    cJSON *metadata = NULL;
+    if (recv_json(fd, &metadata) != PROTOCOL_OK) return -1;
+
+    const cJSON *task_id = cJSON_GetObjectItem(metadata, "task_id");
+    const cJSON *job_id = cJSON_GetObjectItem(metadata, "job_id");
+    const cJSON *frame_no = cJSON_GetObjectItem(metadata, "frame_no");
+    const cJSON *lane_name = cJSON_GetObjectItem(metadata, "lane");
+    const char *id = (job_id && cJSON_IsString(job_id)) ? job_id->valuestring : DEFAULT_JOB_ID;
+    relay_job_t *job = find_relay_job(id, false);
+
+    char chunk_path[MAX_FILENAME_LEN];
+    snprintf(chunk_path, sizeof(chunk_path), "%s/chunk_%ld.dat", spool_dir, chunk_sequence++);
+
+    bool usable = task_id && cJSON_IsString(task_id) && job && job->script_path[0] != '\0';
+    if (receive_payload(fd, usable ? chunk_path : NULL) < 0) {
+        cJSON_Delete(metadata);
+        unlink(chunk_path);
+        return -1;
+    }
+    usable = usable && access(chunk_path, R_OK) == 0;
+    // Keep the parent's lane, the local scheduler only ever raises it
+    task_lane_t lane = TASK_LANE_BULK;
+    if (lane_name && cJSON_IsString(lane_name)) task_lane_parse(lane_name->valuestring, &lane);
+
+    if (!usable) {
+        printf("[Relay] Dropping chunk of job %s: no task id or no script received\n", id);
+    } else if (employer_relay_submit(id, job->script_path, job->engine, job->combine, job->combine_batch,
+                                     task_id->valuestring, chunk_path,
+                                     (frame_no && cJSON_IsNumber(frame_no)) ? frame_no->valueint : -1, lane) != 0) {
+        printf("[Relay] Relay inbox full, dropping chunk %s (the parent will resend it)\n", task_id->valuestring);
+        unlink(chunk_path);
+    } else {
+        relay_stats.chunks_received++;
+    }
+    cJSON_Delete(metadata);
+    return 0;
+}
+
+// A combine job's chunk acknowledgement, metadata with an empty payload
+static int send_ack_upstream(int fd, const result_info_t* result) {
+
+    cJSON *metadata = cJSON_CreateObject();
+    cJSON_AddStringToObject(metadata, "type", "task_result");
+    cJSON_AddStringToObject(metadata, "task_id", result->task_id);
+    cJSON_AddNumberToObject(metadata, "result_size", 0);
+    cJSON_AddStringToObject(metadata, "job_id", result->job_id);
+    cJSON_AddBoolToObject(metadata, "combined", true);
+    protocol_status_t status = send_json(fd, metadata);
+    cJSON_Delete(metadata);
+
+    uint32_t no_payload = 0;
+    if (status != PROTOCOL_OK || send(fd, &no_payload, sizeof(no_payload), 0) != sizeof(no_payload)) {
+        return -1;
+    }
+    return 0;
+}
+
+// Same framing as an employee's result: JSON metadata, 4 byte size, bytes
+static int send_result_upstream(int fd, const result_info_t* result) {
+
+    if (result->kind == RESULT_KIND_ACK) return send_ack_upstream(fd, result);
+
+    int file_fd = open(result->result_filepath, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (file_fd < 0 || fstat(file_fd, &st) != 0) {
+        printf("[Relay] Result %s of task %s is missing\n", result->result_filepath, result->task_id);
+        if (file_fd >= 0) close(file_fd);
+        return 0; // Nothing to forward, the parent times the task out
+    }
+
+    cJSON *metadata = cJSON_CreateObject();
+    cJSON_AddStringToObject(metadata, "type", "task_result");
+    cJSON_AddStringToObject(metadata, "task_id", result->task_id);
+    cJSON_AddNumberToObject(metadata, "result_size", (double)st.st_size);
+    cJSON_AddStringToObject(metadata, "job_id", result->job_id);
+    if (result->kind == RESULT_KIND_PARTIAL) {
+        cJSON_AddBoolToObject(metadata, "partial", true);
+        cJSON_AddNumberToObject(metadata, "task_count", result->task_count);
+    }
+    protocol_status_t status = send_json(fd, metadata);
+    cJSON_Delete(metadata);
+
+    uint32_t net_size = htonl((uint32_t)st.st_size);
+    if (status != PROTOCOL_OK || send(fd, &net_size, sizeof(net_size), 0) != sizeof(net_size)) {
+        close(file_fd);
+        return -1;
+    }
+
+    off_t offset = 0;
+    while (offset < st.st_size) {
+        ssize_t sent = sendfile(fd, file_fd, &offset, st.st_size - offset);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) {
+            close(file_fd);
+            return -1;
+        }
+    }
+    close(file_fd);
+
+    relay_stats.results_forwarded++;
+    relay_stats.bytes_up += st.st_size;
+    unlink(result->result_filepath);
+    return 0;
+}
+
+// Serve the parent employer until it disconnects or the relay stops
+static void serve_parent(int parent_fd) {
+
+    time_t last_status_update = time(NULL);
+
+    while (relay_running) {
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(parent_fd, &readfds);
+        FD_SET(result_wakeup[0], &readfds);
+        int max_fd = parent_fd > result_wakeup[0] ? parent_fd : result_wakeup[0];
+        struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+
+        int activity = select(max_fd + 1, &readfds, NULL, NULL, &timeout);
+        if (activity < 0 && errno != EINTR) {
+            perror("[Relay] select");
+            break;
+        }
+
+        // 1. Scripts, chunks and releases from the parent
+        if (activity > 0 && FD_ISSET(parent_fd, &readfds)) {
+            cJSON *peek = NULL;
+            if (recv_json_peek(parent_fd, &peek) != PROTOCOL_OK) {
+                printf("[Relay] Connection closed by parent employer\n");
+                break;
+            }
+            const cJSON *type = cJSON_GetObjectItem(peek, "message_type");
+            const char *message_type = (type && cJSON_IsString(type)) ? type->valuestring : "";
+            int status = 0;
+
+            if (strcmp(message_type, "initial_config") == 0) {
+                status = receive_job_script(parent_fd);
+            } else if (strcmp(message_type, "data_chunk") == 0) {
+                status = receive_chunk(parent_fd);
+            } else {
+                cJSON *message = NULL;
+                status = recv_json(parent_fd, &message) == PROTOCOL_OK ? 0 : -1;
+                const cJSON *job_id = cJSON_GetObjectItem(message, "job_id");
+                if (status == 0 && strcmp(message_type, "job_release") == 0 && job_id && cJSON_IsString(job_id)) {
+                    printf("[Relay] Parent finished job %s\n", job_id->valuestring);
+                    employer_relay_release(job_id->valuestring);
+                    relay_job_t *job = find_relay_job(job_id->valuestring, false);
+                    if (job) memset(job, 0, sizeof(*job)); // The parent resends the script with the next run
+                } else if (status == 0) {
+                    printf("[Relay] Ignoring message '%s' from parent\n", message_type);
+                }
+                cJSON_Delete(message);
+            }
+            cJSON_Delete(peek);
+            if (status != 0) {
+                printf("[Relay] Lost the parent connection while receiving\n");
+                break;
+            }
+        }
+
+        // 2. Forward finished results
+        char drain[64];
+        while (read(result_wakeup[0], drain, sizeof(drain)) > 0) {
+        }
+        result_info_t result;
+        bool failed = false;
+        while (get_result_from_queue(&upstream_results, &result) == 0) {
+            if (send_result_upstream(parent_fd, &result) != 0) {
+                // Kept for the next parent connection
+                add_result_to_queue(&upstream_results, &result);
+                failed = true;
+                break;
+            }
+        }
+        if (failed) {
+            printf("[Relay] Lost the parent connection while forwarding results\n");
+            break;
+        }
+
+        time_t now = time(NULL);
+        if (now - last_status_update >= RELAY_STATUS_INTERVAL) {
+            printf("[Relay] Status: %d local slots | %ld chunks in, %ld results out | %ld KB down, %ld KB up\n",
+                   employer_relay_capacity(), relay_stats.chunks_received, relay_stats.results_forwarded,
+                   relay_stats.bytes_down / 1024, relay_stats.bytes_up / 1024);
+            last_status_update = now;
+        }
+    }
+
+    close(parent_fd);
+}
+
+// Announce the relay to the parent, with the slots of its own employees
+static void* relay_broadcast_loop(void* arg) {
+    (void)arg;
+
+    char ip[64] = "Unknown";
+    get_local_ip(ip, sizeof(ip));
+    char hostname[64] = "relay";
+    gethostname(hostname, sizeof(hostname) - 1);
+
+    const char *address_setting = get_volcom_config_value("upstream_discovery_address");
+    const char *port_setting = get_volcom_config_value("upstream_discovery_port");
+    const char *address = address_setting ? address_setting : DISCOVERY_BROADCAST_ADDRESS;
+    int port = port_setting ? atoi(port_setting) : DISCOVERY_PORT;
+
+    while (relay_running) {
+        int slots = employer_relay_capacity() * RELAY_PREFETCH_FACTOR;
+        char message[512];
+        snprintf(message, sizeof(message),
+            "{"
+              "\"type\":\"volcom_broadcast\","
+              "\"mode\":\"relay\","
+              "\"employee_id\":\"relay_%s_%d\","
+              "\"ip\":\"%s\","
+              "\"port\":%d,"
+              "\"slots\":%d,"
+              "\"timestamp\":%ld"
+            "}",
+            hostname, relay_port, ip, relay_port, slots, time(NULL));
+        send_discovery_message(message, address, port);
+
+        for (int i = 0; i < RELAY_BROADCAST_INTERVAL && relay_running; i++) {
+            sleep(1);
+        }
+    }
+    return NULL;
+}
+
+static void* relay_employer_thread(void* arg) {
+
+    employer_main_loop(arg);
+    relay_running = false; // Nothing to relay to without the local loop
+    return NULL;
+}
+
+// Main relay entry point
+int run_relay_mode(void) {
+
+    printf("[Relay] Starting Relay Mode...\n");
+
+    const char *port_setting = get_volcom_config_value("relay_port");
+    if (port_setting && atoi(port_setting) > 0) {
+        relay_port = atoi(port_setting);
+    }
+    const char *spool_setting = get_volcom_config_value("relay_spool");
+    if (spool_setting) {
+        snprintf(spool_dir, sizeof(spool_dir), "%s", spool_setting);
+    }
+
+    // Employees below the relay announce on a different port than the parent's
+    const char *upstream_setting = get_volcom_config_value("upstream_discovery_port");
+    int upstream_port = upstream_setting ? atoi(upstream_setting) : DISCOVERY_PORT;
+    if (!get_volcom_config_value("discovery_port")) {
+        char local_port[16];
+        snprintf(local_port, sizeof(local_port), "%d", upstream_port + 1);
+        set_volcom_config_value("discovery_port", local_port);
+    }
+    if (atoi(get_volcom_config_value("discovery_port")) == upstream_port) {
+        fprintf(stderr, "[Relay] discovery_port must differ from upstream_discovery_port (%d)\n", upstream_port);
+        return -1;
+    }
+
+    // Cached scripts are executed from here, keep it to ourselves
+    if (mkdir(spool_dir, 0700) != 0 && errno != EEXIST) {
+        perror("[Relay] mkdir spool");
+        return -1;
+    }
+    if (init_result_queue(&upstream_results, MAX_TASK_ASSIGNMENTS) != 0) {
+        fprintf(stderr, "[Relay] Failed to initialize result queue\n");
+        return -1;
+    }
+    if (pipe2(result_wakeup, O_NONBLOCK | O_CLOEXEC) != 0) {
+        perror("[Relay] pipe");
+        cleanup_result_queue(&upstream_results);
+        return -1;
+    }
+
+    int server_fd = start_tcp_server(relay_port);
+    if (server_fd < 0 || employer_enable_relay(relay_on_result) != 0) {
+        fprintf(stderr, "[Relay] Failed to start on port %d\n", relay_port);
+        if (server_fd >= 0) close(server_fd);
+        close(result_wakeup[0]);
+        close(result_wakeup[1]);
+        cleanup_result_queue(&upstream_results);
+        return -1;
+    }
+
+    signal(SIGINT, relay_signal_handler);
+    signal(SIGTERM, relay_signal_handler);
+    signal(SIGPIPE, SIG_IGN); // A vanished parent shows up as a failed send
+    memset(&relay_stats, 0, sizeof(relay_stats));
+    relay_running = true;
+
+    pthread_t employer_thread, broadcaster_thread;
+    if (pthread_create(&employer_thread, NULL, relay_employer_thread, NULL) != 0) {
+        perror("pthread_create");
+        relay_running = false;
+    } else if (pthread_create(&broadcaster_thread, NULL, relay_broadcast_loop, NULL) != 0) {
+        perror("pthread_create");
+        relay_running = false;
+        employer_request_stop();
+        pthread_join(employer_thread, NULL);
+    } else {
+        printf("[Relay] Waiting for a parent employer on port %d (employees announce on port %s)\n",
+               relay_port, get_volcom_config_value("discovery_port"));
+
+        while (relay_running) {
+            fd_set readfds;
+            FD_ZERO(&readfds);
+            FD_SET(server_fd, &readfds);
+            struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+            if (select(server_fd + 1, &readfds, NULL, NULL, &timeout) <= 0) continue;
+
+            struct sockaddr_in parent_addr;
+            socklen_t addr_len = sizeof(parent_addr);
+            int parent_fd = accept(server_fd, (struct sockaddr*)&parent_addr, &addr_len);
+            if (parent_fd < 0) continue;
+
+            char parent_ip[INET_ADDRSTRLEN] = {0};
+            inet_ntop(AF_INET, &parent_addr.sin_addr, parent_ip, sizeof(parent_ip));
+            printf("[Relay] Parent employer connected from %s\n", parent_ip);
+            serve_parent(parent_fd);
+        }
+
+        employer_request_stop();
+        pthread_join(broadcaster_thread, NULL);
+        pthread_join(employer_thread, NULL);
+    }
+
+    close(server_fd);
+    close(result_wakeup[0]);
+    close(result_wakeup[1]);
+    result_wakeup[0] = result_wakeup[1] = -1;
+    cleanup_result_queue(&upstream_results);
+
+    printf("[Relay] Relay mode stopped (%ld chunks relayed, %ld results forwarded)\n",
+           relay_stats.chunks_received, relay_stats.results_forwarded);
+    return 0;
+}
@@ -0,0 +1,355 @@
+#define _GNU_SOURCE
+
+#include "volcom_agents.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// Memo cache of task results for the employer.
+//
+// Running a job again over the same input (a second pass over a video, a
+// restart without the journal, another job with the same script) would compute
+// every chunk again. The cache keeps each result under the SHA-256 of the job's
+// runtime and script followed by the chunk bytes, so a chunk that was computed
+// before completes as soon as it is queued, without being dispatched.
+//
+// Results are files <dir>/<key in hex>, copied in and out through a temporary
+// name and a rename. <dir>/index lists one entry per line with tab separated
+// fields (key, size, last use) and is rewritten from memory, at most every
+// RESULT_CACHE_SAVE_INTERVAL seconds, while it is behind. It only carries the
+// LRU order: result files it misses (a crash before the save) are adopted as
+// least recently used, entries whose file is gone are dropped. Once the files
+// exceed max_bytes, the least recently used ones are evicted.
+
+#define RESULT_CACHE_INDEX "index"
+#define RESULT_CACHE_INITIAL_ENTRIES 1024
+#define RESULT_CACHE_SAVE_INTERVAL 5
+#define RESULT_CACHE_COPY_BUFFER (64 * 1024)
+
+static size_t slot_of(const unsigned char* key, size_t capacity) {
+
+    uint64_t hash;
+    memcpy(&hash, key, sizeof(hash)); // A digest is already evenly spread
+    return (size_t)hash & (capacity - 1);
+}
+
+static result_cache_entry_t* find_entry(result_cache_t* cache, const unsigned char* key) {
+
+    size_t mask = cache->entry_capacity - 1;
+    for (size_t i = slot_of(key, cache->entry_capacity); cache->entries[i].used; i = (i + 1) & mask) {
+        if (memcmp(cache->entries[i].key, key, SHA256_DIGEST_LEN) == 0) return &cache->entries[i];
+    }
+    return NULL;
+}
+
+static int grow_index(result_cache_t* cache) {
+
+    size_t new_capacity = cache->entry_capacity ? cache->entry_capacity * 2 : RESULT_CACHE_INITIAL_ENTRIES;
+    result_cache_entry_t *grown = calloc(new_capacity, sizeof(result_cache_entry_t));
+    if (!grown) return -1;
+
+    for (size_t i = 0; i < cache->entry_capacity; i++) {
+        if (!cache->entries[i].used) continue;
+        size_t slot = slot_of(cache->entries[i].key, new_capacity);
+        while (grown[slot].used) slot = (slot + 1) & (new_capacity - 1);
+        grown[slot] = cache->entries[i];
+    }
+    free(cache->entries);
+    cache->entries = grown;
+    cache->entry_capacity = new_capacity;
+    return 0;
+}
+
+static result_cache_entry_t* insert_entry(result_cache_t* cache, const unsigned char* key) {
+
+    if ((cache->entry_count + 1) * 10 >= cache->entry_capacity * 7 && grow_index(cache) != 0) return NULL;
+
+    size_t mask = cache->entry_capacity - 1;
+    size_t slot = slot_of(key, cache->entry_capacity);
+    while (cache->entries[slot].used) slot = (slot + 1) & mask;
+    result_cache_entry_t *entry = &cache->entries[slot];
+    memset(entry, 0, sizeof(*entry));
+    memcpy(entry->key, key, SHA256_DIGEST_LEN);
+    entry->used = true;
+    cache->entry_count++;
+    return entry;
+}
+
+// Linear probing without tombstones: later entries of the run move back into
+// the gap unless that would put them before their home slot
+static void remove_entry(result_cache_t* cache, result_cache_entry_t* entry) {
+
+    size_t mask = cache->entry_capacity - 1;
+    size_t gap = (size_t)(entry - cache->entries);
+    cache->bytes -= entry->size;
+    cache->entry_count--;
+    for (size_t i = (gap + 1) & mask; cache->entries[i].used; i = (i + 1) & mask) {
+        size_t home = slot_of(cache->entries[i].key, cache->entry_capacity);
+        bool stays = gap < i ? (home > gap && home <= i) : (home > gap || home <= i);
+        if (!stays) {
+            cache->entries[gap] = cache->entries[i];
+            gap = i;
+        }
+    }
+    cache->entries[gap].used = false;
+}
+
+static void entry_path(const result_cache_t* cache, const unsigned char* key, char* path, size_t size) {
+
+    char hex[SHA256_HEX_LEN + 1];
+    sha256_hex(key, hex);
+    snprintf(path, size, "%s/%s", cache->dir, hex);
+}
+
+static bool parse_key(const char* hex, unsigned char* key) {
+
+    if (strlen(hex) != SHA256_HEX_LEN) return false;
+    for (int i = 0; i < SHA256_DIGEST_LEN; i++) {
+        unsigned int byte;
+        if (sscanf(hex + i * 2, "%2x", &byte) != 1) return false;
+        key[i] = (unsigned char)byte;
+    }
+    return true;
+}
+
+static void evict_to_fit(result_cache_t* cache) {
+
+    while (cache->bytes > cache->max_bytes && cache->entry_count > 0) {
+        result_cache_entry_t *oldest = NULL;
+        for (size_t i = 0; i < cache->entry_capacity; i++) {
+            if (cache->entries[i].used && (!oldest || cache->entries[i].last_used < oldest->last_used)) {
+                oldest = &cache->entries[i];
+            }
+        }
+        char path[MAX_FILENAME_LEN * 2];
+        entry_path(cache, oldest->key, path, sizeof(path));
+        unlink(path);
+        remove_entry(cache, oldest);
+        cache->evictions++;
+        cache->dirty = true;
+    }
+}
+
+// Copy src to dest through dest.tmp, so dest is never seen half written
+static int copy_file(const char* src, const char* dest, size_t* copied) {
+
+    char tmp_path[MAX_FILENAME_LEN * 2];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", dest);
+    int in = open(src, O_RDONLY | O_CLOEXEC);
+    if (in < 0) return -1;
+    int out = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        close(in);
+        return -1;
+    }
+
+    char *buffer = malloc(RESULT_CACHE_COPY_BUFFER);
+    size_t total = 0;
+    ssize_t len = buffer ? 0 : -1;
+    while (buffer && (len = read(in, buffer, RESULT_CACHE_COPY_BUFFER)) > 0) {
+        for (ssize_t written = 0, n; written < len; written += n) {
+            n = write(out, buffer + written, len - written);
+            if (n <= 0) {
+                len = -1;
+                break;
+            }
+        }
+        if (len < 0) break;
+        total += len;
+    }
+    free(buffer);
+    close(in);
+    if (close(out) != 0 || len < 0 || rename(tmp_path, dest) != 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+    if (copied) *copied = total;
+    return 0;
+}
+
+// Adopt an existing result file, the index supplies its last use if it has one
+static void index_file(result_cache_t* cache, const unsigned char* key, unsigned long last_used) {
+
+    char path[MAX_FILENAME_LEN * 2];
+    struct stat st;
+    entry_path(cache, key, path, sizeof(path));
+    if (find_entry(cache, key) || stat(path, &st) != 0 || !S_ISREG(st.st_mode)) return;
+
+    result_cache_entry_t *entry = insert_entry(cache, key);
+    if (!entry) return;
+    entry->size = (size_t)st.st_size;
+    entry->last_used = last_used;
+    cache->bytes += entry->size;
+    if (last_used >= cache->tick) cache->tick = last_used + 1;
+}
+
+static void load_index(result_cache_t* cache) {
+
+    char path[MAX_FILENAME_LEN * 2];
+    snprintf(path, sizeof(path), "%s/%s", cache->dir, RESULT_CACHE_INDEX);
+    FILE *file = fopen(path, "r");
+    if (file) {
+        char *line = NULL;
+        size_t line_capacity = 0;
+        while (getline(&line, &line_capacity, file) > 0) {
+            char hex[SHA256_HEX_LEN + 1];
+            unsigned long last_used;
+            unsigned char key[SHA256_DIGEST_LEN];
+            if (sscanf(line, "%64s\t%*u\t%lu", hex, &last_used) == 2 && parse_key(hex, key)) {
+                index_file(cache, key, last_used);
+            }
+        }
+        free(line);
+        fclose(file);
+    }
+
+    // Results stored after the last save, and leftovers of interrupted copies
+    DIR *dir = opendir(cache->dir);
+    if (!dir) return;
+    size_t indexed = cache->entry_count;
+    struct dirent *dirent;
+    while ((dirent = readdir(dir)) != NULL) {
+        unsigned char key[SHA256_DIGEST_LEN];
+        const char *suffix = strrchr(dirent->d_name, '.');
+        if (parse_key(dirent->d_name, key)) {
+            index_file(cache, key, 0);
+        } else if (suffix && strcmp(suffix, ".tmp") == 0) {
+            snprintf(path, sizeof(path), "%s/%s", cache->dir, dirent->d_name);
+            unlink(path);
+        }
+    }
+    closedir(dir);
+    if (cache->entry_count != indexed) cache->dirty = true;
+}
+
+static int save_index(result_cache_t* cache) {
+
+    char path[MAX_FILENAME_LEN * 2];
+    char tmp_path[MAX_FILENAME_LEN * 2 + 8];
+    snprintf(path, sizeof(path), "%s/%s", cache->dir, RESULT_CACHE_INDEX);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *file = fopen(tmp_path, "w");
+    if (!file) return -1;
+    for (size_t i = 0; i < cache->entry_capacity; i++) {
+        const result_cache_entry_t *entry = &cache->entries[i];
+        if (!entry->used) continue;
+        char hex[SHA256_HEX_LEN + 1];
+        sha256_hex(entry->key, hex);
+        fprintf(file, "%s\t%zu\t%lu\n", hex, entry->size, entry->last_used);
+    }
+    bool written = fflush(file) == 0 && fsync(fileno(file)) == 0;
+    if (fclose(file) != 0 || !written || rename(tmp_path, path) != 0) {
+        perror("[Employer] result cache index");
+        unlink(tmp_path);
+        return -1;
+    }
+    cache->dirty = false;
+    cache->last_saved = time(NULL);
+    return 0;
+}
+
+int result_cache_open(result_cache_t* cache, const char* dir, size_t max_bytes) {
+
+    if (!cache || !dir) return -1;
+
+    memset(cache, 0, sizeof(*cache));
+    strncpy(cache->dir, dir, sizeof(cache->dir) - 1);
+    cache->max_bytes = max_bytes;
+    if ((mkdir(dir, 0777) != 0 && errno != EEXIST) || grow_index(cache) != 0) {
+        perror("[Employer] result cache open");
+        result_cache_close(cache);
+        return -1;
+    }
+    load_index(cache);
+    evict_to_fit(cache); // max_bytes may have shrunk since the last run
+
+    printf("[Employer] Result cache %s: %zu results, %zu KB of %zu KB\n",
+           cache->dir, cache->entry_count, cache->bytes / 1024, cache->max_bytes / 1024);
+    return 0;
+}
+
+void result_cache_close(result_cache_t* cache) {
+
+    if (!cache || !cache->entries) return;
+
+    result_cache_sync(cache, true);
+    free(cache->entries);
+    cache->entries = NULL;
+    cache->entry_capacity = 0;
+    cache->entry_count = 0;
+}
+
+// On a hit the cached result is copied to dest_path and 0 returned
+int result_cache_lookup(result_cache_t* cache, const unsigned char key[SHA256_DIGEST_LEN], const char* dest_path,
+                        size_t* size) {
+
+    if (!cache || !cache->entries) return -1;
+
+    cache->lookups++;
+    result_cache_entry_t *entry = find_entry(cache, key);
+    if (!entry) return -1;
+
+    char path[MAX_FILENAME_LEN * 2];
+    entry_path(cache, key, path, sizeof(path));
+    if (copy_file(path, dest_path, size) != 0) {
+        remove_entry(cache, entry); // Deleted behind our back
+        cache->dirty = true;
+        return -1;
+    }
+    entry->last_used = cache->tick++;
+    cache->hits++;
+    cache->dirty = true;
+    return 0;
+}
+
+int result_cache_store(result_cache_t* cache, const unsigned char key[SHA256_DIGEST_LEN], const char* result_path) {
+
+    if (!cache || !cache->entries) return -1;
+
+    // Same script, same chunk: the result is already there
+    result_cache_entry_t *entry = find_entry(cache, key);
+    if (entry) {
+        entry->last_used = cache->tick++;
+        cache->dirty = true;
+        return 0;
+    }
+
+    char path[MAX_FILENAME_LEN * 2];
+    size_t size = 0;
+    entry_path(cache, key, path, sizeof(path));
+    if (copy_file(result_path, path, &size) != 0) return -1;
+    if (size > cache->max_bytes || !(entry = insert_entry(cache, key))) {
+        unlink(path);
+        return -1;
+    }
+    entry->size = size;
+    entry->last_used = cache->tick++;
+    cache->bytes += size;
+    cache->stores++;
+    cache->dirty = true;
+    evict_to_fit(cache);
+    return 0;
+}
+
+// Rewrite the index if it is behind, unless it was saved moments ago
+int result_cache_sync(result_cache_t* cache, bool force) {
+
+    if (!cache || !cache->entries || !cache->dirty) return 0;
+    if (!force && time(NULL) - cache->last_saved < RESULT_CACHE_SAVE_INTERVAL) return 0;
+    return save_index(cache);
+}
+
+void result_cache_print_stats(const result_cache_t* cache) {
+
+    if (!cache || cache->lookups == 0) return;
+    printf("[Employer] Result cache: %ld of %ld lookups hit (%.1f%%) | %zu results, %zu KB of %zu KB | "
+           "%ld stored, %ld evicted\n",
+           cache->hits, cache->lookups, 100.0 * cache->hits / cache->lookups, cache->entry_count,
+           cache->bytes / 1024, cache->max_bytes / 1024, cache->stores, cache->evictions);
+}
@@ -0,0 +1,384 @@
+#define _GNU_SOURCE
+
+#include "volcom_agents.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <sys/un.h>
+
+// Ordered result stream for frame based jobs.
+//
+// Results arrive from employees in completion order. The stream keeps a sorted
+// list of the frame numbers that were queued and releases results to the sink
+// strictly in that order as soon as every earlier frame is in. The window bounds
+// how far ahead of the oldest missing frame the employer may dispatch, so the
+// amount of buffered (not yet streamed) results never exceeds the window.
+
+#define RESULT_STREAM_INITIAL_CAPACITY 64
+
+// Try to (re)open the sink. FIFOs are opened and written non-blocking so that
+// a missing or slow reader does not stall the employer loop; results simply
+// stay buffered until a later flush finds room in the pipe.
+static int open_sink(result_stream_t* stream) {
+
+    if (stream->sink_fd >= 0) return 0;
+
+    if (strncmp(stream->sink_spec, "unix:", 5) == 0) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, stream->sink_spec + 5, sizeof(addr.sun_path) - 1);
+
+        if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            close(fd);
+            return -1;
+        }
+        stream->sink_fd = fd;
+        stream->sink_is_socket = true;
+        printf("[Employer] Result stream connected to Unix socket %s\n", addr.sun_path);
+        return 0;
+    }
+
+    struct stat st;
+    if (stat(stream->sink_spec, &st) == 0 && S_ISFIFO(st.st_mode)) {
+        int fd = open(stream->sink_spec, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) return -1; // ENXIO: no reader yet
+
+        stream->sink_fd = fd;
+        stream->sink_is_socket = false;
+        printf("[Employer] Result stream attached to FIFO %s\n", stream->sink_spec);
+        return 0;
+    }
+
+    int fd = open(stream->sink_spec, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror("[Employer] open result stream sink");
+        return -1;
+    }
+    stream->sink_fd = fd;
+    stream->sink_is_socket = false;
+    printf("[Employer] Result stream writing to %s\n", stream->sink_spec);
+    return 0;
+}
+
+// A reader that went away, as opposed to a sink that is only full for now
+static bool is_sink_gone(int error) {
+    return error == EPIPE || error == ECONNRESET || error == ENOTCONN;
+}
+
+// Copy one stored result into the sink followed by a record separator. When a
+// write fails, even before its first byte (a full pipe), the frame is kept as
+// the stream's partial and the next call picks it up at the byte it stopped
+// at; only a new reader, which never saw its start, gets it whole. Socket sinks are written with MSG_NOSIGNAL;
+// sendfile cannot take it, the employer ignores SIGPIPE for that
+// (run_employer_mode).
+static int emit_result(result_stream_t* stream, const result_stream_entry_t* entry, bool late) {
+
+    off_t offset = stream->has_partial ? stream->partial_offset : 0;
+    stream->has_partial = false;
+
+    int in_fd = open(entry->result_path, O_RDONLY | O_CLOEXEC);
+    if (in_fd < 0) {
+        printf("[Employer] Result stream: missing result file %s for frame %d\n",
+               entry->result_path, entry->frame_no);
+        return 0; // Skip the frame rather than stalling the stream forever
+    }
+
+    struct stat st;
+    if (fstat(in_fd, &st) != 0) {
+        close(in_fd);
+        return 0;
+    }
+
+    int status = 0;
+    while (offset < st.st_size) {
+        ssize_t sent = sendfile(stream->sink_fd, in_fd, &offset, st.st_size - offset);
+        if (sent <= 0) {
+            if (sent < 0 && errno == EINTR) continue;
+            status = -1;
+            break;
+        }
+    }
+    close(in_fd);
+
+    while (status == 0) {
+        ssize_t written = stream->sink_is_socket ? send(stream->sink_fd, "\n", 1, MSG_NOSIGNAL)
+                                                 : write(stream->sink_fd, "\n", 1);
+        if (written == 1) break;
+        if (written < 0 && errno == EINTR) continue;
+        status = -1;
+    }
+
+    if (status != 0) {
+        int error = errno;
+        if (error != EAGAIN && error != EWOULDBLOCK) perror("[Employer] Result stream write");
+        if (is_sink_gone(error)) {
+            close(stream->sink_fd);
+            stream->sink_fd = -1;
+            offset = 0;
+        }
+        // An in-order frame is still at the cursor and goes out whole to a new reader,
+        // a late one exists nowhere else
+        if (!is_sink_gone(error) || late) {
+            stream->partial = *entry;
+            stream->has_partial = true;
+            stream->partial_late = late;
+            stream->partial_offset = offset;
+        }
+        errno = error;
+        return -1;
+    }
+
+    stream->bytes_streamed += st.st_size + 1;
+    return 0;
+}
+
+// Finish the frame a failed write cut short, caller holds the mutex
+static int finish_partial(result_stream_t* stream) {
+
+    if (!stream->has_partial) return 0;
+    bool late = stream->partial_late;
+    result_stream_entry_t entry = stream->partial;
+    if (emit_result(stream, &entry, late) != 0) return -1;
+    if (!late) stream->cursor++;
+    stream->frames_streamed++;
+    return 0;
+}
+
+// Emit frames that arrived after their place in the stream had passed,
+// caller holds the mutex. Returns how many went out, or -1 once one did not.
+static int emit_late(result_stream_t* stream) {
+
+    int emitted = 0;
+    while (stream->late_count > 0) {
+        // Dequeued first: if the write fails, the frame lives on as the partial
+        result_stream_entry_t entry = stream->late[0];
+        stream->late_count--;
+        memmove(stream->late, stream->late + 1, stream->late_count * sizeof(result_stream_entry_t));
+        if (emit_result(stream, &entry, true) != 0) return -1;
+        stream->frames_streamed++;
+        emitted++;
+    }
+    return emitted;
+}
+
+// Binary search for the position of frame_no in the sorted entry list
+static int find_slot(const result_stream_t* stream, int frame_no) {
+
+    int lo = 0;
+    int hi = stream->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (stream->entries[mid].frame_no < frame_no) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Drop entries that were already streamed so the list does not grow forever
+static void compact_entries(result_stream_t* stream) {
+
+    if (stream->cursor < stream->capacity / 2) return;
+
+    memmove(stream->entries, stream->entries + stream->cursor,
+            (stream->count - stream->cursor) * sizeof(result_stream_entry_t));
+    stream->count -= stream->cursor;
+    stream->cursor = 0;
+}
+
+int result_stream_init(result_stream_t* stream, const char* sink_spec, int window) {
+
+    if (!stream || !sink_spec || window <= 0) return -1;
+
+    memset(stream, 0, sizeof(*stream));
+    stream->entries = malloc(sizeof(result_stream_entry_t) * RESULT_STREAM_INITIAL_CAPACITY);
+    if (!stream->entries) return -1;
+
+    stream->capacity = RESULT_STREAM_INITIAL_CAPACITY;
+    stream->window = window;
+    stream->sink_fd = -1;
+    strncpy(stream->sink_spec, sink_spec, sizeof(stream->sink_spec) - 1);
+    pthread_mutex_init(&stream->mutex, NULL);
+
+    // Failing here is fine, the sink is retried on every flush
+    open_sink(stream);
+    return 0;
+}
+
+void result_stream_cleanup(result_stream_t* stream) {
+
+    if (!stream || !stream->entries) return;
+
+    if (stream->sink_fd >= 0) {
+        close(stream->sink_fd);
+        stream->sink_fd = -1;
+    }
+    free(stream->entries);
+    stream->entries = NULL;
+    free(stream->late);
+    stream->late = NULL;
+    stream->late_count = 0;
+    pthread_mutex_destroy(&stream->mutex);
+}
+
+// Insert a new expected frame at slot, caller holds the mutex
+static int insert_entry_locked(result_stream_t* stream, int slot, int frame_no) {
+
+    if (stream->count >= stream->capacity) {
+        int new_capacity = stream->capacity * 2;
+        result_stream_entry_t* grown = realloc(stream->entries, sizeof(result_stream_entry_t) * new_capacity);
+        if (!grown) return -1;
+        stream->entries = grown;
+        stream->capacity = new_capacity;
+    }
+
+    memmove(&stream->entries[slot + 1], &stream->entries[slot],
+            (stream->count - slot) * sizeof(result_stream_entry_t));
+    memset(&stream->entries[slot], 0, sizeof(result_stream_entry_t));
+    stream->entries[slot].frame_no = frame_no;
+    stream->count++;
+    return 0;
+}
+
+int result_stream_expect(result_stream_t* stream, int frame_no) {
+
+    if (!stream || frame_no < 0) return -1;
+
+    pthread_mutex_lock(&stream->mutex);
+
+    int slot = find_slot(stream, frame_no);
+    int status = 0;
+    if (slot < stream->count && stream->entries[slot].frame_no == frame_no) {
+        status = 0; // Already expected
+    } else if (slot < stream->cursor) {
+        // Older than what was already streamed; it will be emitted out of order on submit
+        status = 0;
+    } else {
+        status = insert_entry_locked(stream, slot, frame_no);
+    }
+
+    pthread_mutex_unlock(&stream->mutex);
+    return status;
+}
+
+bool result_stream_in_window(result_stream_t* stream, int frame_no) {
+
+    if (!stream || frame_no < 0) return true;
+
+    pthread_mutex_lock(&stream->mutex);
+    int slot = find_slot(stream, frame_no);
+    bool in_window = slot < stream->cursor + stream->window;
+    pthread_mutex_unlock(&stream->mutex);
+
+    return in_window;
+}
+
+int result_stream_flush(result_stream_t* stream) {
+
+    if (!stream) return -1;
+
+    pthread_mutex_lock(&stream->mutex);
+
+    bool ready = stream->has_partial || stream->late_count > 0 ||
+                 (stream->cursor < stream->count && stream->entries[stream->cursor].is_ready);
+    if (!ready || open_sink(stream) != 0 || finish_partial(stream) != 0) {
+        pthread_mutex_unlock(&stream->mutex);
+        return 0;
+    }
+
+    int emitted = emit_late(stream);
+    if (emitted < 0) {
+        pthread_mutex_unlock(&stream->mutex);
+        return 0;
+    }
+    while (stream->cursor < stream->count && stream->entries[stream->cursor].is_ready) {
+        if (emit_result(stream, &stream->entries[stream->cursor], false) != 0) {
+            break; // Retried on the next flush, from where it stopped
+        }
+        stream->cursor++;
+        stream->frames_streamed++;
+        emitted++;
+    }
+
+    compact_entries(stream);
+
+    pthread_mutex_unlock(&stream->mutex);
+    return emitted;
+}
+
+int result_stream_submit(result_stream_t* stream, int frame_no, const char* result_path) {
+
+    if (!stream || frame_no < 0 || !result_path) return -1;
+
+    pthread_mutex_lock(&stream->mutex);
+
+    int slot = find_slot(stream, frame_no);
+    bool found = slot < stream->count && stream->entries[slot].frame_no == frame_no;
+
+    if (found && (slot < stream->cursor || stream->entries[slot].is_ready)) {
+        pthread_mutex_unlock(&stream->mutex);
+        return 0; // Duplicate result (e.g. a reassigned task finished twice)
+    }
+
+    if (!found && slot < stream->cursor) {
+        // Its position in the stream has already passed, emit it ahead of the in-order frames
+        if (stream->late_count == stream->late_capacity) {
+            int new_capacity = stream->late_capacity ? stream->late_capacity * 2 : 8;
+            result_stream_entry_t* grown = realloc(stream->late, sizeof(result_stream_entry_t) * new_capacity);
+            if (!grown) {
+                pthread_mutex_unlock(&stream->mutex);
+                return -1;
+            }
+            stream->late = grown;
+            stream->late_capacity = new_capacity;
+        }
+        printf("[Employer] Result stream: frame %d is late, emitting out of order\n", frame_no);
+        result_stream_entry_t* late = &stream->late[stream->late_count++];
+        memset(late, 0, sizeof(*late));
+        late->frame_no = frame_no;
+        late->is_ready = true;
+        strncpy(late->result_path, result_path, sizeof(late->result_path) - 1);
+        pthread_mutex_unlock(&stream->mutex);
+        return result_stream_flush(stream);
+    }
+
+    if (!found && insert_entry_locked(stream, slot, frame_no) != 0) {
+        pthread_mutex_unlock(&stream->mutex);
+        return -1;
+    }
+
+    result_stream_entry_t* entry = &stream->entries[slot];
+    strncpy(entry->result_path, result_path, sizeof(entry->result_path) - 1);
+    entry->is_ready = true;
+    stream->frames_buffered++;
+
+    pthread_mutex_unlock(&stream->mutex);
+
+    return result_stream_flush(stream);
+}
+
+int result_stream_pending(result_stream_t* stream) {
+
+    if (!stream) return 0;
+
+    pthread_mutex_lock(&stream->mutex);
+    int ready = 0;
+    for (int i = stream->cursor; i < stream->count; i++) {
+        if (stream->entries[i].is_ready) ready++;
+    }
+    pthread_mutex_unlock(&stream->mutex);
+
+    return ready;
+}
@@ -0,0 +1,278 @@
+#define _GNU_SOURCE
+
+#include "volcom_agents.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+// Continuous chunk ingestion for the employer.
+//
+// Instead of scanning the chunk directory once at startup, the directory is
+// watched with inotify. Producers either write chunk files in place (picked up
+// on IN_CLOSE_WRITE) or write them elsewhere and rename them in, which makes the
+// directory behave like a spool queue (IN_MOVED_TO). The inotify descriptor is
+// polled together with the employer sockets, so new chunks become tasks within
+// one loop iteration of appearing.
+//
+// Every file that became a task is remembered by name together with its inode
+// and mtime. A rescan after a queue overflow, or another close of a file that
+// was already queued, then skips it even after its task completed and left the
+// assignment table; a file replaced under the same name is queued again.
+
+#define INGEST_EVENT_BUFFER (64 * (sizeof(struct inotify_event) + NAME_MAX + 1))
+#define INGEST_RATE_SMOOTHING 0.3
+#define INGEST_FILES_INITIAL 256
+
+static bool is_chunk_file(const char* name) {
+
+    size_t len = strlen(name);
+    return len > 5 && strcmp(name + len - 5, ".json") == 0 && name[0] != '.';
+}
+
+// FNV-1a over the file name
+static size_t file_slot(const char* name, size_t capacity) {
+
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char *p = (const unsigned char*)name; *p; p++) {
+        hash = (hash ^ *p) * 1099511628211ULL;
+    }
+    return (size_t)hash & (capacity - 1);
+}
+
+static task_ingest_file_t* find_file(task_ingest_t* ingest, const char* name) {
+
+    if (ingest->file_capacity == 0) return NULL;
+
+    for (size_t slot = file_slot(name, ingest->file_capacity); ingest->files[slot].name;
+         slot = (slot + 1) & (ingest->file_capacity - 1)) {
+        if (strcmp(ingest->files[slot].name, name) == 0) return &ingest->files[slot];
+    }
+    return NULL;
+}
+
+// Double the set (kept at most 3/4 full so probe runs stay short)
+static int grow_files(task_ingest_t* ingest) {
+
+    size_t capacity = ingest->file_capacity ? ingest->file_capacity * 2 : INGEST_FILES_INITIAL;
+    task_ingest_file_t *files = calloc(capacity, sizeof(*files));
+    if (!files) return -1;
+
+    for (size_t i = 0; i < ingest->file_capacity; i++) {
+        if (!ingest->files[i].name) continue;
+        size_t slot = file_slot(ingest->files[i].name, capacity);
+        while (files[slot].name) slot = (slot + 1) & (capacity - 1);
+        files[slot] = ingest->files[i];
+    }
+    free(ingest->files);
+    ingest->files = files;
+    ingest->file_capacity = capacity;
+    return 0;
+}
+
+static void remember_file(task_ingest_t* ingest, const char* name, const struct stat* st) {
+
+    task_ingest_file_t *file = find_file(ingest, name);
+    if (!file) {
+        if ((ingest->file_count + 1) * 4 > ingest->file_capacity * 3 && grow_files(ingest) != 0) return;
+        char *copy = strdup(name);
+        if (!copy) return;
+        size_t slot = file_slot(name, ingest->file_capacity);
+        while (ingest->files[slot].name) slot = (slot + 1) & (ingest->file_capacity - 1);
+        file = &ingest->files[slot];
+        file->name = copy;
+        ingest->file_count++;
+    }
+    file->inode = st->st_ino;
+    file->mtime = st->st_mtim;
+}
+
+// Backward-shift deletion: pull later entries of the probe run into the hole
+// so lookups never stop early at a freed slot
+static void forget_file(task_ingest_t* ingest, const char* name) {
+
+    task_ingest_file_t *file = find_file(ingest, name);
+    if (!file) return;
+
+    size_t mask = ingest->file_capacity - 1;
+    size_t hole = (size_t)(file - ingest->files);
+    free(file->name);
+    file->name = NULL;
+    ingest->file_count--;
+
+    for (size_t slot = (hole + 1) & mask; ingest->files[slot].name; slot = (slot + 1) & mask) {
+        size_t home = file_slot(ingest->files[slot].name, ingest->file_capacity);
+        // Movable unless its home lies cyclically in (hole, slot]
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            ingest->files[hole] = ingest->files[slot];
+            ingest->files[slot].name = NULL;
+            hole = slot;
+        }
+    }
+}
+
+// Hand a chunk file to the callback unless it was queued before, unchanged.
+// Returns 0 if it became a task.
+static int ingest_file(task_ingest_t* ingest, const char* name, task_ingest_cb_t on_chunk) {
+
+    char path[PATH_MAX];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/%s", ingest->watch_dir, name);
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) return -1;
+
+    task_ingest_file_t *file = find_file(ingest, name);
+    if (file && file->inode == st.st_ino && file->mtime.tv_sec == st.st_mtim.tv_sec &&
+        file->mtime.tv_nsec == st.st_mtim.tv_nsec) {
+        return -1;
+    }
+
+    // Only remembered once queued, a full task table retries it on the next scan
+    if (on_chunk(ingest->watch_dir, name) != 0) return -1;
+    remember_file(ingest, name, &st);
+    return 0;
+}
+
+int task_ingest_init(task_ingest_t* ingest, const char* watch_dir) {
+
+    if (!ingest || !watch_dir) return -1;
+
+    memset(ingest, 0, sizeof(*ingest));
+    strncpy(ingest->watch_dir, watch_dir, sizeof(ingest->watch_dir) - 1);
+    ingest->last_rate_update = time(NULL);
+
+    ingest->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (ingest->inotify_fd < 0) {
+        perror("[Employer] inotify_init1");
+        return -1;
+    }
+
+    ingest->watch_fd = inotify_add_watch(ingest->inotify_fd, watch_dir,
+                                         IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM |
+                                         IN_DELETE_SELF | IN_MOVE_SELF);
+    if (ingest->watch_fd < 0) {
+        perror("[Employer] inotify_add_watch");
+        close(ingest->inotify_fd);
+        ingest->inotify_fd = -1;
+        return -1;
+    }
+
+    printf("[Employer] Watching %s for new chunk files\n", watch_dir);
+    return 0;
+}
+
+void task_ingest_cleanup(task_ingest_t* ingest) {
+
+    if (!ingest) return;
+
+    for (size_t i = 0; i < ingest->file_capacity; i++) {
+        free(ingest->files[i].name);
+    }
+    free(ingest->files);
+    ingest->files = NULL;
+    ingest->file_capacity = 0;
+    ingest->file_count = 0;
+
+    if (ingest->inotify_fd < 0) return;
+
+    inotify_rm_watch(ingest->inotify_fd, ingest->watch_fd);
+    close(ingest->inotify_fd);
+    ingest->inotify_fd = -1;
+}
+
+int task_ingest_process_events(task_ingest_t* ingest, task_ingest_cb_t on_chunk) {
+
+    if (!ingest || ingest->inotify_fd < 0 || !on_chunk) return -1;
+
+    char buffer[INGEST_EVENT_BUFFER] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int queued = 0;
+
+    for (;;) {
+        ssize_t len = read(ingest->inotify_fd, buffer, sizeof(buffer));
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) break;
+            perror("[Employer] inotify read");
+            return -1;
+        }
+        if (len == 0) break;
+
+        for (char *ptr = buffer; ptr < buffer + len; ) {
+            const struct inotify_event *event = (const struct inotify_event*)ptr;
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                printf("[Employer] Watched directory %s went away, ingestion stopped\n", ingest->watch_dir);
+                close(ingest->inotify_fd);
+                ingest->inotify_fd = -1;
+                return queued;
+            }
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were dropped; the caller rescans the directory
+                ingest->overflowed = true;
+                continue;
+            }
+
+            if (event->len == 0 || !is_chunk_file(event->name)) continue;
+
+            if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                forget_file(ingest, event->name);
+                continue;
+            }
+
+            if (ingest_file(ingest, event->name, on_chunk) == 0) {
+                queued++;
+            }
+        }
+    }
+
+    task_ingest_record(ingest, queued);
+    return queued;
+}
+
+// Queue every chunk file in the watched directory that is not queued yet: the
+// initial backlog, and again after the kernel dropped events
+int task_ingest_scan(task_ingest_t* ingest, task_ingest_cb_t on_chunk) {
+
+    if (!ingest || !on_chunk) return -1;
+
+    DIR *dir = opendir(ingest->watch_dir);
+    if (!dir) {
+        perror("[Employer] opendir");
+        return -1;
+    }
+    int queued = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (is_chunk_file(entry->d_name) && ingest_file(ingest, entry->d_name, on_chunk) == 0) {
+            queued++;
+        }
+    }
+    closedir(dir);
+
+    task_ingest_record(ingest, queued);
+    return queued;
+}
+
+void task_ingest_record(task_ingest_t* ingest, int files) {
+
+    if (!ingest) return;
+
+    ingest->files_ingested += files;
+    ingest->files_since_update += files;
+
+    // Smoothed intake rate, updated at most once per second
+    time_t now = time(NULL);
+    double elapsed = difftime(now, ingest->last_rate_update);
+    if (elapsed >= 1.0) {
+        double rate = ingest->files_since_update / elapsed;
+        ingest->intake_rate = INGEST_RATE_SMOOTHING * rate + (1.0 - INGEST_RATE_SMOOTHING) * ingest->intake_rate;
+        ingest->files_since_update = 0;
+        ingest->last_rate_update = now;
+    }
+}
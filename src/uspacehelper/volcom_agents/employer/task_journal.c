@@ -0,0 +1,571 @@
+#define _GNU_SOURCE
+
+#include "volcom_agents.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <libgen.h>
+
+// Crash-safe task journal for the employer.
+//
+// Every task state transition is appended to a text journal, one record per
+// line with tab separated fields:
+//   J <job_id> <runtime> <priority> <weight> <script> <chunk_dir> [<combine>:<batch>]
+//                                                                   job submitted
+//   D <job_id>                                                      job finished
+//   Q <task_id> <job_id> <frame_no> <chunk_file>                    task queued
+//   A <task_id> <employee_ip>                                       task assigned
+//   C <task_id> <job_id> <frame_no> <result_file>                   task completed
+//
+// Tasks of combine jobs get no C record: their results only exist inside the
+// job's in-memory aggregate, so after a restart they are computed again.
+//
+// Records are buffered and written + fdatasync'ed in batches (at most every
+// JOURNAL_SYNC_INTERVAL_MS or JOURNAL_BUFFER_BYTES), so a crash loses at most
+// the last batch, which only means those few chunks are computed again. A torn
+// last line is ignored on replay. The journal keeps an index of the live task
+// state, from which it is periodically rewritten (compacted) once the log has
+// grown well past the state it describes.
+
+#define JOURNAL_SYNC_INTERVAL_MS 200
+#define JOURNAL_BUFFER_BYTES (64 * 1024)
+#define JOURNAL_INITIAL_ENTRIES 1024
+#define JOURNAL_COMPACT_MIN_RECORDS 4096
+#define JOURNAL_COMPACT_FACTOR 3 // Compact once records exceed this many times the live state
+
+static uint32_t hash_task_id(const char* task_id) {
+
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (const unsigned char *p = (const unsigned char*)task_id; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static task_journal_entry_t* find_entry(task_journal_t* journal, const char* task_id) {
+
+    if (!journal->entries) return NULL;
+
+    size_t mask = journal->entry_capacity - 1;
+    for (size_t i = hash_task_id(task_id) & mask; journal->entries[i].task_id; i = (i + 1) & mask) {
+        if (strcmp(journal->entries[i].task_id, task_id) == 0) return &journal->entries[i];
+    }
+    return NULL;
+}
+
+static void free_entries(task_journal_entry_t* entries, size_t capacity) {
+
+    if (!entries) return;
+    for (size_t i = 0; i < capacity; i++) {
+        free(entries[i].task_id);
+        free(entries[i].job_id);
+        free(entries[i].path);
+    }
+    free(entries);
+}
+
+static int grow_index(task_journal_t* journal) {
+
+    size_t new_capacity = journal->entry_capacity ? journal->entry_capacity * 2 : JOURNAL_INITIAL_ENTRIES;
+    task_journal_entry_t *grown = calloc(new_capacity, sizeof(task_journal_entry_t));
+    if (!grown) return -1;
+
+    // Rehash, moving the string ownership over
+    for (size_t i = 0; i < journal->entry_capacity; i++) {
+        task_journal_entry_t *entry = &journal->entries[i];
+        if (!entry->task_id) continue;
+        size_t slot = hash_task_id(entry->task_id) & (new_capacity - 1);
+        while (grown[slot].task_id) slot = (slot + 1) & (new_capacity - 1);
+        grown[slot] = *entry;
+    }
+    free(journal->entries);
+    journal->entries = grown;
+    journal->entry_capacity = new_capacity;
+    return 0;
+}
+
+// Insert or update the index entry of a task
+static int index_task(task_journal_t* journal, const char* task_id, const char* job_id,
+                      int frame_no, const char* path, bool completed) {
+
+    task_journal_entry_t *entry = find_entry(journal, task_id);
+    if (!entry) {
+        if ((journal->entry_count + 1) * 10 >= journal->entry_capacity * 7 && grow_index(journal) != 0) {
+            return -1;
+        }
+        size_t mask = journal->entry_capacity - 1;
+        size_t slot = hash_task_id(task_id) & mask;
+        while (journal->entries[slot].task_id) slot = (slot + 1) & mask;
+        entry = &journal->entries[slot];
+        entry->task_id = strdup(task_id);
+        journal->entry_count++;
+    }
+
+    free(entry->job_id);
+    free(entry->path);
+    entry->job_id = strdup(job_id);
+    entry->path = strdup(path);
+    entry->frame_no = frame_no;
+    entry->completed = completed;
+    entry->dropped = false;
+    return (entry->task_id && entry->job_id && entry->path) ? 0 : -1;
+}
+
+// Free the index entries of forgotten jobs once they are no longer on disk
+static void purge_dropped(task_journal_t* journal) {
+
+    task_journal_entry_t *old_entries = journal->entries;
+    size_t old_capacity = journal->entry_capacity;
+
+    journal->entries = NULL;
+    journal->entry_capacity = 0;
+    journal->entry_count = 0;
+    if (grow_index(journal) != 0) {
+        journal->entries = old_entries; // Keep the old index, it is still correct
+        journal->entry_capacity = old_capacity;
+        return;
+    }
+
+    for (size_t i = 0; i < old_capacity; i++) {
+        task_journal_entry_t *entry = &old_entries[i];
+        if (!entry->task_id) continue;
+        if (!entry->dropped) {
+            index_task(journal, entry->task_id, entry->job_id, entry->frame_no, entry->path, entry->completed);
+        }
+    }
+    free_entries(old_entries, old_capacity);
+}
+
+static task_journal_job_t* find_job(task_journal_t* journal, const char* job_id) {
+
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (journal->jobs[i].live && strcmp(journal->jobs[i].job_id, job_id) == 0) return &journal->jobs[i];
+    }
+    return NULL;
+}
+
+static int index_job(task_journal_t* journal, const char* job_id, const char* runtime, int priority,
+                     int weight, const char* script_path, const char* chunk_dir,
+                     combine_kind_t combine, int combine_batch) {
+
+    task_journal_job_t *job = find_job(journal, job_id);
+    for (int i = 0; !job && i < MAX_JOBS; i++) {
+        if (!journal->jobs[i].live) job = &journal->jobs[i];
+    }
+    if (!job) return -1;
+
+    memset(job, 0, sizeof(*job));
+    job->live = true;
+    strncpy(job->job_id, job_id, sizeof(job->job_id) - 1);
+    strncpy(job->runtime, runtime, sizeof(job->runtime) - 1);
+    job->priority = priority;
+    job->weight = weight;
+    strncpy(job->script_path, script_path, sizeof(job->script_path) - 1);
+    strncpy(job->chunk_dir, chunk_dir, sizeof(job->chunk_dir) - 1);
+    job->combine = combine;
+    job->combine_batch = combine_batch;
+    return 0;
+}
+
+// "<combine>:<batch>" field of a J record
+static int parse_combine_field(const char* field, combine_kind_t* combine, int* combine_batch) {
+
+    char name[16];
+    int batch = 0;
+    if (sscanf(field, "%15[^:]:%d", name, &batch) != 2 || batch <= 0) return -1;
+    if (combine_parse(name, combine) != 0) return -1;
+    *combine_batch = batch;
+    return 0;
+}
+
+// Optional last field of a J record, empty for plain jobs
+static const char* format_combine_field(char* buffer, size_t size, combine_kind_t combine, int combine_batch) {
+
+    buffer[0] = '\0';
+    if (combine != COMBINE_NONE) snprintf(buffer, size, "\t%s:%d", combine_name(combine), combine_batch);
+    return buffer;
+}
+
+// Forget a finished job and its tasks (they are dropped at the next compaction)
+static void drop_job(task_journal_t* journal, const char* job_id) {
+
+    task_journal_job_t *job = find_job(journal, job_id);
+    if (job) job->live = false;
+
+    for (size_t i = 0; i < journal->entry_capacity; i++) {
+        task_journal_entry_t *entry = &journal->entries[i];
+        if (entry->task_id && entry->job_id && strcmp(entry->job_id, job_id) == 0) entry->dropped = true;
+    }
+}
+
+// Apply one journal line to the index. Returns -1 for malformed lines.
+static int apply_record(task_journal_t* journal, char* line) {
+
+    char *fields[8] = { NULL };
+    int count = 0;
+    char *save = NULL;
+    for (char *field = strtok_r(line, "\t", &save); field && count < 8; field = strtok_r(NULL, "\t", &save)) {
+        fields[count++] = field;
+    }
+    if (count < 2 || fields[0][1] != '\0') return -1;
+
+    switch (fields[0][0]) {
+        case 'J': {
+            combine_kind_t combine = COMBINE_NONE;
+            int combine_batch = 0;
+            if (count != 7 && count != 8) return -1;
+            if (count == 8 && parse_combine_field(fields[7], &combine, &combine_batch) != 0) return -1;
+            return index_job(journal, fields[1], fields[2], atoi(fields[3]), atoi(fields[4]), fields[5], fields[6],
+                             combine, combine_batch);
+        }
+        case 'D':
+            drop_job(journal, fields[1]);
+            return 0;
+        case 'Q':
+            if (count != 5) return -1;
+            return index_task(journal, fields[1], fields[2], atoi(fields[3]), fields[4], false);
+        case 'A':
+            return count == 3 ? 0 : -1; // Assignments die with the employer, the task is queued again
+        case 'C':
+            if (count != 5) return -1;
+            return index_task(journal, fields[1], fields[2], atoi(fields[3]), fields[4], true);
+        default:
+            return -1;
+    }
+}
+
+static int load_journal(task_journal_t* journal) {
+
+    FILE *file = fopen(journal->path, "r");
+    if (!file) return errno == ENOENT ? 0 : -1;
+
+    char *line = NULL;
+    size_t line_capacity = 0;
+    ssize_t len;
+    long malformed = 0;
+    off_t complete_bytes = 0;
+    bool torn = false;
+    while ((len = getline(&line, &line_capacity, file)) > 0) {
+        if (line[len - 1] != '\n') {
+            malformed++; // Torn write at crash time
+            torn = true;
+            break;
+        }
+        complete_bytes += len;
+        line[len - 1] = '\0';
+        if (apply_record(journal, line) == 0) {
+            journal->records_replayed++;
+        } else {
+            malformed++;
+        }
+    }
+    free(line);
+    fclose(file);
+
+    // Cut the torn tail so new records do not get glued onto it
+    if (torn && truncate(journal->path, complete_bytes) != 0) {
+        perror("[Employer] journal truncate");
+        return -1;
+    }
+
+    printf("[Employer] Journal %s: replayed %ld records (%zu tasks), skipped %ld\n",
+           journal->path, journal->records_replayed, journal->entry_count, malformed);
+    return 0;
+}
+
+int task_journal_open(task_journal_t* journal, const char* path) {
+
+    if (!journal || !path) return -1;
+
+    memset(journal, 0, sizeof(*journal));
+    journal->fd = -1;
+    strncpy(journal->path, path, sizeof(journal->path) - 1);
+
+    journal->buffer = malloc(JOURNAL_BUFFER_BYTES);
+    if (!journal->buffer || grow_index(journal) != 0 || load_journal(journal) != 0) {
+        perror("[Employer] journal open");
+        task_journal_close(journal);
+        return -1;
+    }
+    journal->buffer_capacity = JOURNAL_BUFFER_BYTES;
+
+    journal->fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (journal->fd < 0) {
+        perror("[Employer] journal open");
+        task_journal_close(journal);
+        return -1;
+    }
+
+    // The replayed history counts towards the next compaction
+    journal->records_written = journal->records_replayed;
+    return 0;
+}
+
+void task_journal_close(task_journal_t* journal) {
+
+    if (!journal) return;
+
+    if (journal->fd >= 0) {
+        task_journal_sync(journal, true);
+        close(journal->fd);
+        journal->fd = -1;
+    }
+    free(journal->buffer);
+    journal->buffer = NULL;
+    free_entries(journal->entries, journal->entry_capacity);
+    journal->entries = NULL;
+    journal->entry_capacity = 0;
+    journal->entry_count = 0;
+}
+
+static int compare_completed(const void* a, const void* b) {
+
+    const task_journal_entry_t *left = *(const task_journal_entry_t* const*)a;
+    const task_journal_entry_t *right = *(const task_journal_entry_t* const*)b;
+    int by_job = strcmp(left->job_id, right->job_id);
+    if (by_job != 0) return by_job;
+    return (left->frame_no > right->frame_no) - (left->frame_no < right->frame_no);
+}
+
+// Jobs, then unfinished tasks, then finished tasks grouped by job in frame
+// order. The index is in hash order, the ordered result stream is not.
+void task_journal_replay(task_journal_t* journal, task_journal_job_cb_t on_job, task_journal_task_cb_t on_task) {
+
+    if (!journal) return;
+
+    // Jobs first so that their tasks have somewhere to go
+    for (int i = 0; on_job && i < MAX_JOBS; i++) {
+        if (journal->jobs[i].live) on_job(&journal->jobs[i]);
+    }
+    if (!on_task || journal->entry_count == 0) return;
+
+    task_journal_entry_t **completed = malloc(journal->entry_count * sizeof(task_journal_entry_t*));
+    size_t completed_count = 0;
+    for (size_t i = 0; i < journal->entry_capacity; i++) {
+        task_journal_entry_t *entry = &journal->entries[i];
+        if (!entry->task_id || entry->dropped) continue;
+        if (entry->completed && entry->job_id && completed) {
+            completed[completed_count++] = entry;
+        } else {
+            on_task(entry); // Without memory for the sort, finished tasks come in hash order
+        }
+    }
+    if (!completed) return;
+
+    qsort(completed, completed_count, sizeof(task_journal_entry_t*), compare_completed);
+    for (size_t i = 0; i < completed_count; i++) {
+        on_task(completed[i]);
+    }
+    free(completed);
+}
+
+static long elapsed_ms(const struct timespec* since) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000 + (now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+static int write_all(int fd, const char* data, size_t len) {
+
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return -1;
+        data += written;
+        len -= written;
+    }
+    return 0;
+}
+
+int task_journal_sync(task_journal_t* journal, bool force) {
+
+    if (!journal || journal->fd < 0 || journal->buffer_len == 0) return 0;
+    if (!force && journal->buffer_len < journal->buffer_capacity / 2 &&
+        elapsed_ms(&journal->first_unsynced) < JOURNAL_SYNC_INTERVAL_MS) {
+        return 0;
+    }
+
+    if (write_all(journal->fd, journal->buffer, journal->buffer_len) != 0 || fdatasync(journal->fd) != 0) {
+        perror("[Employer] journal sync");
+        return -1;
+    }
+    journal->buffer_len = 0;
+    journal->syncs++;
+    return 1;
+}
+
+static int append_record(task_journal_t* journal, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+static int append_record(task_journal_t* journal, const char* format, ...) {
+
+    if (!journal || journal->fd < 0) return -1;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        size_t space = journal->buffer_capacity - journal->buffer_len;
+        va_list args;
+        va_start(args, format);
+        int len = vsnprintf(journal->buffer + journal->buffer_len, space, format, args);
+        va_end(args);
+
+        if (len < 0) return -1;
+        if ((size_t)len < space) {
+            if (journal->buffer_len == 0) clock_gettime(CLOCK_MONOTONIC, &journal->first_unsynced);
+            journal->buffer_len += len;
+            journal->records_written++;
+            return 0;
+        }
+        // Buffer full, push the batch out and retry once
+        if (journal->buffer_len == 0 || task_journal_sync(journal, true) < 0) return -1;
+    }
+    return -1;
+}
+
+// Fields are tab separated and records newline terminated
+static bool is_journal_safe(const char* value) {
+
+    return value && !strpbrk(value, "\t\n");
+}
+
+int task_journal_job_added(task_journal_t* journal, const job_t* job) {
+
+    if (!journal || !job || !is_journal_safe(job->script_path) || !is_journal_safe(job->chunk_dir)) return -1;
+
+    char combine[32];
+    index_job(journal, job->job_id, job->runtime, job->priority, job->weight, job->script_path, job->chunk_dir,
+              job->combine, job->combine_batch);
+    return append_record(journal, "J\t%s\t%s\t%d\t%d\t%s\t%s%s\n", job->job_id, job->runtime,
+                         job->priority, job->weight, job->script_path, job->chunk_dir,
+                         format_combine_field(combine, sizeof(combine), job->combine, job->combine_batch));
+}
+
+int task_journal_job_done(task_journal_t* journal, const char* job_id) {
+
+    if (!journal || !is_journal_safe(job_id)) return -1;
+
+    drop_job(journal, job_id);
+    return append_record(journal, "D\t%s\n", job_id);
+}
+
+int task_journal_queued(task_journal_t* journal, const char* task_id, const char* job_id, int frame_no, const char* chunk_file) {
+
+    if (!journal || !is_journal_safe(task_id) || !is_journal_safe(chunk_file)) return -1;
+
+    // Requeued after a restart, the record is already there
+    task_journal_entry_t *entry = find_entry(journal, task_id);
+    if (entry && !entry->completed && !entry->dropped && strcmp(entry->path, chunk_file) == 0) return 0;
+
+    index_task(journal, task_id, job_id, frame_no, chunk_file, false);
+    return append_record(journal, "Q\t%s\t%s\t%d\t%s\n", task_id, job_id, frame_no, chunk_file);
+}
+
+int task_journal_assigned(task_journal_t* journal, const char* task_id, const char* employee_ip) {
+
+    if (!journal || !is_journal_safe(task_id)) return -1;
+
+    return append_record(journal, "A\t%s\t%s\n", task_id, employee_ip);
+}
+
+int task_journal_completed(task_journal_t* journal, const char* task_id, const char* job_id, int frame_no, const char* result_path) {
+
+    if (!journal || !is_journal_safe(task_id) || !is_journal_safe(result_path)) return -1;
+
+    index_task(journal, task_id, job_id, frame_no, result_path, true);
+    return append_record(journal, "C\t%s\t%s\t%d\t%s\n", task_id, job_id, frame_no, result_path);
+}
+
+bool task_journal_is_completed(task_journal_t* journal, const char* task_id) {
+
+    if (!journal || !journal->entries) return false;
+
+    task_journal_entry_t *entry = find_entry(journal, task_id);
+    return entry && entry->completed && !entry->dropped;
+}
+
+// Rewrite the journal from the live index: one J per live job and one Q or C
+// per task of a live job. The new file is synced before it replaces the old one.
+int task_journal_maybe_compact(task_journal_t* journal) {
+
+    if (!journal || journal->fd < 0) return 0;
+
+    long live = 0;
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (journal->jobs[i].live) live++;
+    }
+    for (size_t i = 0; i < journal->entry_capacity; i++) {
+        if (journal->entries[i].task_id && !journal->entries[i].dropped) live++;
+    }
+    if (journal->records_written < JOURNAL_COMPACT_MIN_RECORDS ||
+        journal->records_written < live * JOURNAL_COMPACT_FACTOR) {
+        return 0;
+    }
+
+    if (task_journal_sync(journal, true) < 0) return -1;
+
+    char tmp_path[MAX_FILENAME_LEN + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", journal->path);
+    FILE *out = fopen(tmp_path, "w");
+    if (!out) {
+        perror("[Employer] journal compaction");
+        return -1;
+    }
+
+    for (int i = 0; i < MAX_JOBS; i++) {
+        const task_journal_job_t *job = &journal->jobs[i];
+        if (!job->live) continue;
+        char combine[32];
+        fprintf(out, "J\t%s\t%s\t%d\t%d\t%s\t%s%s\n", job->job_id, job->runtime, job->priority,
+                job->weight, job->script_path, job->chunk_dir,
+                format_combine_field(combine, sizeof(combine), job->combine, job->combine_batch));
+    }
+    for (size_t i = 0; i < journal->entry_capacity; i++) {
+        const task_journal_entry_t *entry = &journal->entries[i];
+        if (!entry->task_id || entry->dropped) continue;
+        fprintf(out, "%c\t%s\t%s\t%d\t%s\n", entry->completed ? 'C' : 'Q',
+                entry->task_id, entry->job_id, entry->frame_no, entry->path);
+    }
+
+    if (fflush(out) != 0 || fdatasync(fileno(out)) != 0) {
+        perror("[Employer] journal compaction");
+        fclose(out);
+        unlink(tmp_path);
+        return -1;
+    }
+    fclose(out);
+
+    if (rename(tmp_path, journal->path) != 0) {
+        perror("[Employer] journal compaction rename");
+        unlink(tmp_path);
+        return -1;
+    }
+
+    // Make the rename itself durable
+    char dir_path[MAX_FILENAME_LEN];
+    strncpy(dir_path, journal->path, sizeof(dir_path) - 1);
+    dir_path[sizeof(dir_path) - 1] = '\0';
+    int dir_fd = open(dirname(dir_path), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+
+    int fd = open(journal->path, O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (fd < 0) {
+        perror("[Employer] journal reopen");
+        return -1;
+    }
+    close(journal->fd);
+    journal->fd = fd;
+
+    purge_dropped(journal);
+
+    printf("[Employer] Journal compacted: %ld records down to %ld\n", journal->records_written, live);
+    journal->records_written = live;
+    journal->compactions++;
+    return 1;
+}
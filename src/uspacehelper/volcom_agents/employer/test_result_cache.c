@@ -0,0 +1,137 @@
+#include "volcom_agents.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST_CACHE_DIR "/tmp/test_volcom_result_cache"
+#define TEST_RESULT "/tmp/test_volcom_result.bin"
+#define TEST_COPY "/tmp/test_volcom_result_copy.bin"
+#define RESULT_SIZE 100
+
+// Keys whose first bytes agree share a home slot in the index: home picks the
+// slot, id tells keys of the same run apart
+static void make_key(unsigned char* key, unsigned char home, unsigned char id) {
+    memset(key, 0, SHA256_DIGEST_LEN);
+    key[0] = home;
+    key[SHA256_DIGEST_LEN - 1] = id;
+}
+
+static void key_path(const unsigned char* key, char* path, size_t size) {
+    char hex[SHA256_HEX_LEN + 1];
+    sha256_hex(key, hex);
+    snprintf(path, size, "%s/%s", TEST_CACHE_DIR, hex);
+}
+
+static bool is_cached(result_cache_t* cache, const unsigned char* key) {
+    return result_cache_lookup(cache, key, TEST_COPY, NULL) == 0;
+}
+
+static void remove_cache_dir(void) {
+    char command[256];
+    snprintf(command, sizeof(command), "rm -rf %s", TEST_CACHE_DIR);
+    if (system(command) != 0) printf("Could not remove %s\n", TEST_CACHE_DIR);
+}
+
+int main() {
+    printf("=== Result Cache Index Test ===\n");
+
+    FILE *result = fopen(TEST_RESULT, "wb");
+    if (!result) {
+        printf("✗ Cannot create %s\n", TEST_RESULT);
+        return 1;
+    }
+    for (int i = 0; i < RESULT_SIZE; i++) fputc('r', result);
+    fclose(result);
+    remove_cache_dir();
+
+    // Room for five results
+    result_cache_t cache;
+    if (result_cache_open(&cache, TEST_CACHE_DIR, 5 * RESULT_SIZE) != 0) {
+        printf("✗ Cannot open the cache\n");
+        return 1;
+    }
+
+    // Test 1: a probe run of three keys on slot 5, and a key homed on 6 pushed behind them
+    printf("1. Testing colliding keys...\n");
+    unsigned char a[SHA256_DIGEST_LEN], b[SHA256_DIGEST_LEN], c[SHA256_DIGEST_LEN], d[SHA256_DIGEST_LEN];
+    make_key(a, 5, 1);
+    make_key(b, 5, 2);
+    make_key(c, 5, 3);
+    make_key(d, 6, 4);
+    if (result_cache_store(&cache, a, TEST_RESULT) != 0 || result_cache_store(&cache, b, TEST_RESULT) != 0 ||
+        result_cache_store(&cache, c, TEST_RESULT) != 0 || result_cache_store(&cache, d, TEST_RESULT) != 0) {
+        printf("✗ Store failed\n");
+        return 1;
+    }
+    if (!is_cached(&cache, a) || !is_cached(&cache, b) || !is_cached(&cache, c) || !is_cached(&cache, d)) {
+        printf("✗ Stored key not found\n");
+        return 1;
+    }
+    printf("✓ All colliding keys found\n");
+
+    // Test 2: removing b from the middle of the run shifts c and d back,
+    // every key after the gap must still be found
+    printf("2. Testing removal in the middle of a probe run...\n");
+    char path[MAX_FILENAME_LEN * 2];
+    key_path(b, path, sizeof(path));
+    unlink(path); // The next lookup finds the file gone and drops the entry
+    if (is_cached(&cache, b) || cache.entry_count != 3) {
+        printf("✗ Missing result still indexed (%zu entries)\n", cache.entry_count);
+        return 1;
+    }
+    if (!is_cached(&cache, a) || !is_cached(&cache, c) || !is_cached(&cache, d)) {
+        printf("✗ Key behind the removed entry lost\n");
+        return 1;
+    }
+    if (cache.bytes != 3 * RESULT_SIZE) {
+        printf("✗ Expected %d cached bytes, got %zu\n", 3 * RESULT_SIZE, cache.bytes);
+        return 1;
+    }
+    printf("✓ Run closed over the gap\n");
+
+    // Test 3: the least recently used key goes first once the cache is full.
+    // Uses so far: a, c, d; touching a again leaves c the oldest
+    printf("3. Testing LRU eviction...\n");
+    unsigned char e[SHA256_DIGEST_LEN], f[SHA256_DIGEST_LEN], g[SHA256_DIGEST_LEN];
+    make_key(e, 5, 5);
+    make_key(f, 7, 6);
+    make_key(g, 5, 7);
+    if (!is_cached(&cache, a) || result_cache_store(&cache, e, TEST_RESULT) != 0 ||
+        result_cache_store(&cache, f, TEST_RESULT) != 0 || result_cache_store(&cache, g, TEST_RESULT) != 0) {
+        printf("✗ Store failed\n");
+        return 1;
+    }
+    key_path(c, path, sizeof(path));
+    if (is_cached(&cache, c) || access(path, F_OK) == 0 || cache.evictions != 1) {
+        printf("✗ Least recently used result not evicted\n");
+        return 1;
+    }
+    if (!is_cached(&cache, a) || !is_cached(&cache, d) || !is_cached(&cache, e) ||
+        !is_cached(&cache, f) || !is_cached(&cache, g)) {
+        printf("✗ Recently used result evicted or lost\n");
+        return 1;
+    }
+    printf("✓ Oldest result evicted, the rest still found\n");
+
+    // Test 4: the saved index restores the entries and their order
+    printf("4. Testing reopening the cache...\n");
+    result_cache_close(&cache);
+    if (result_cache_open(&cache, TEST_CACHE_DIR, 5 * RESULT_SIZE) != 0 || cache.entry_count != 5) {
+        printf("✗ Expected 5 results after reopening, got %zu\n", cache.entry_count);
+        return 1;
+    }
+    if (!is_cached(&cache, a) || !is_cached(&cache, d) || !is_cached(&cache, g)) {
+        printf("✗ Result lost across reopening\n");
+        return 1;
+    }
+    printf("✓ Index reloaded\n");
+
+    result_cache_close(&cache);
+    remove_cache_dir();
+    unlink(TEST_RESULT);
+    unlink(TEST_COPY);
+
+    printf("\n=== All Tests Passed ===\n");
+    return 0;
+}
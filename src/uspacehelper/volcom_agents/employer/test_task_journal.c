@@ -0,0 +1,199 @@
+#include "volcom_agents.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define TEST_JOURNAL "/tmp/test_volcom_journal.log"
+#define TEST_SINK "/tmp/test_volcom_stream.out"
+#define TEST_RESULT_DIR "/tmp"
+
+// A job with three queued tasks, one of them completed
+#define COMPLETE_RECORDS \
+    "J\tjob\tnode\t1\t1\t/tmp/script.js\t/tmp/chunks\n" \
+    "Q\tt0\tjob\t0\t/tmp/chunks/c0\n" \
+    "Q\tt1\tjob\t1\t/tmp/chunks/c1\n" \
+    "Q\tt2\tjob\t2\t/tmp/chunks/c2\n" \
+    "A\tt0\t10.0.0.2\n" \
+    "C\tt0\tjob\t0\t/tmp/results/r0\n"
+// Crash in the middle of writing t1's completion
+#define TORN_RECORD "C\tt1\tjob\t1\t/tmp/res"
+
+static int replayed_jobs;
+static int replayed_tasks;
+
+static void count_job(const task_journal_job_t* job) {
+    (void)job;
+    replayed_jobs++;
+}
+
+static void count_task(const task_journal_entry_t* entry) {
+    (void)entry;
+    replayed_tasks++;
+}
+
+// Frames 0, 1 and 3 finished in the order 3, 0, 1; frame 2 is still pending
+#define FRAME_RECORDS \
+    "J\tvid\tnode\t1\t1\t/tmp/script.js\t/tmp/chunks\n" \
+    "Q\tf0\tvid\t0\t/tmp/chunks/f0\n" \
+    "Q\tf1\tvid\t1\t/tmp/chunks/f1\n" \
+    "Q\tf2\tvid\t2\t/tmp/chunks/f2\n" \
+    "Q\tf3\tvid\t3\t/tmp/chunks/f3\n" \
+    "C\tf3\tvid\t3\t" TEST_RESULT_DIR "/test_volcom_frame3\n" \
+    "C\tf0\tvid\t0\t" TEST_RESULT_DIR "/test_volcom_frame0\n" \
+    "C\tf1\tvid\t1\t" TEST_RESULT_DIR "/test_volcom_frame1\n"
+
+// Replays into the stream the way the employer does: every frame is expected
+// while replaying, finished ones are only submitted afterwards
+static result_stream_t stream;
+static int completed_frames[8];
+static char completed_paths[8][MAX_FILENAME_LEN];
+static int completed_count;
+static bool pending_after_completed;
+
+static void stream_task(const task_journal_entry_t* entry) {
+    result_stream_expect(&stream, entry->frame_no);
+    if (!entry->completed) {
+        if (completed_count > 0) pending_after_completed = true;
+        return;
+    }
+    if (completed_count < 8) {
+        completed_frames[completed_count] = entry->frame_no;
+        strncpy(completed_paths[completed_count], entry->path, MAX_FILENAME_LEN - 1);
+        completed_count++;
+    }
+}
+
+static int write_text(const char* path, const char* text) {
+    FILE *file = fopen(path, "w");
+    if (!file) return -1;
+    fputs(text, file);
+    return fclose(file);
+}
+
+static int check_sink(const char* expected) {
+    char contents[256] = { 0 };
+    FILE *file = fopen(TEST_SINK, "r");
+    size_t n = file ? fread(contents, 1, sizeof(contents) - 1, file) : 0;
+    if (file) fclose(file);
+    contents[n] = '\0';
+    if (strcmp(contents, expected) != 0) {
+        printf("✗ Expected sink \"%s\", got \"%s\"\n", expected, contents);
+        return -1;
+    }
+    return 0;
+}
+
+static long file_size(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+int main() {
+    printf("=== Task Journal Replay Test ===\n");
+
+    FILE *file = fopen(TEST_JOURNAL, "w");
+    if (!file) {
+        printf("✗ Cannot create %s\n", TEST_JOURNAL);
+        return 1;
+    }
+    fputs(COMPLETE_RECORDS TORN_RECORD, file);
+    fclose(file);
+
+    // Test 1: every complete record is applied, the torn one is not
+    printf("1. Testing replay with a torn final record...\n");
+    task_journal_t journal;
+    if (task_journal_open(&journal, TEST_JOURNAL) != 0) {
+        printf("✗ Cannot open the journal\n");
+        return 1;
+    }
+    if (journal.records_replayed != 6 || journal.entry_count != 3) {
+        printf("✗ Expected 6 records and 3 tasks, got %ld and %zu\n", journal.records_replayed, journal.entry_count);
+        return 1;
+    }
+    if (!task_journal_is_completed(&journal, "t0") || task_journal_is_completed(&journal, "t1")) {
+        printf("✗ Torn completion applied, or complete one lost\n");
+        return 1;
+    }
+    task_journal_replay(&journal, count_job, count_task);
+    if (replayed_jobs != 1 || replayed_tasks != 3) {
+        printf("✗ Expected 1 job and 3 tasks replayed, got %d and %d\n", replayed_jobs, replayed_tasks);
+        return 1;
+    }
+    printf("✓ Complete records replayed, torn record ignored\n");
+
+    // Test 2: the torn tail is cut off so the next record starts on its own line
+    printf("2. Testing the torn tail is truncated...\n");
+    if (file_size(TEST_JOURNAL) != (long)strlen(COMPLETE_RECORDS)) {
+        printf("✗ Expected %zu bytes after open, got %ld\n", strlen(COMPLETE_RECORDS), file_size(TEST_JOURNAL));
+        return 1;
+    }
+    if (task_journal_completed(&journal, "t1", "job", 1, "/tmp/results/r1") != 0) {
+        printf("✗ Cannot append a record\n");
+        return 1;
+    }
+    task_journal_close(&journal);
+    printf("✓ Torn tail removed\n");
+
+    // Test 3: a second replay sees the new record intact and nothing malformed
+    printf("3. Testing replay after appending...\n");
+    if (task_journal_open(&journal, TEST_JOURNAL) != 0 || journal.records_replayed != 7) {
+        printf("✗ Expected 7 records after reopening, got %ld\n", journal.records_replayed);
+        return 1;
+    }
+    if (!task_journal_is_completed(&journal, "t0") || !task_journal_is_completed(&journal, "t1") ||
+        task_journal_is_completed(&journal, "t2")) {
+        printf("✗ Wrong completion state after reopening\n");
+        return 1;
+    }
+    printf("✓ Appended record replayed\n");
+    task_journal_close(&journal);
+
+    // Test 4: frames finished out of order are replayed in frame order and
+    // streamed only up to the first pending frame
+    printf("4. Testing ordered replay of finished frames...\n");
+    char frame_path[MAX_FILENAME_LEN];
+    for (int frame = 0; frame < 4; frame++) {
+        char text[16];
+        snprintf(frame_path, sizeof(frame_path), "%s/test_volcom_frame%d", TEST_RESULT_DIR, frame);
+        snprintf(text, sizeof(text), "frame%d", frame);
+        if (write_text(frame_path, text) != 0) {
+            printf("✗ Cannot create %s\n", frame_path);
+            return 1;
+        }
+    }
+    unlink(TEST_SINK);
+    if (write_text(TEST_JOURNAL, FRAME_RECORDS) != 0 || task_journal_open(&journal, TEST_JOURNAL) != 0 ||
+        result_stream_init(&stream, TEST_SINK, 16) != 0) {
+        printf("✗ Cannot set up the journal and the stream\n");
+        return 1;
+    }
+    task_journal_replay(&journal, NULL, stream_task);
+    if (completed_count != 3 || completed_frames[0] != 0 || completed_frames[1] != 1 || completed_frames[2] != 3 ||
+        pending_after_completed) {
+        printf("✗ Finished frames not replayed last and in frame order\n");
+        return 1;
+    }
+    for (int i = 0; i < completed_count; i++) {
+        result_stream_submit(&stream, completed_frames[i], completed_paths[i]);
+    }
+    if (check_sink("frame0\nframe1\n") != 0) return 1;
+
+    // The pending frame finishing releases the one buffered behind it
+    snprintf(frame_path, sizeof(frame_path), "%s/test_volcom_frame2", TEST_RESULT_DIR);
+    result_stream_submit(&stream, 2, frame_path);
+    if (check_sink("frame0\nframe1\nframe2\nframe3\n") != 0) return 1;
+    printf("✓ Sink received the frames in order\n");
+
+    result_stream_cleanup(&stream);
+    task_journal_close(&journal);
+    for (int frame = 0; frame < 4; frame++) {
+        snprintf(frame_path, sizeof(frame_path), "%s/test_volcom_frame%d", TEST_RESULT_DIR, frame);
+        unlink(frame_path);
+    }
+    unlink(TEST_SINK);
+    unlink(TEST_JOURNAL);
+
+    printf("\n=== All Tests Passed ===\n");
+    return 0;
+}
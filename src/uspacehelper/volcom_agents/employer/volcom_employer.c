@@ -16,6 +16,7 @@
 #include <sys/select.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <time.h>
 #include <signal.h>
@@ -23,7 +24,7 @@
 #include <dirent.h>
 
 // TODO: Get those from config
-#define PORT 9876
+#define PORT 9876 // Discovery port, "discovery_port" in the config
 #define BUFFER_SIZE 2048
 #define STALE_THRESHOLD 15
 #define MAX_EMPLOYEES 100
@@ -32,6 +33,23 @@
 #define MAX_CHUNKS 1024
 #define MAX_FILENAME_LEN 256
 #define EMPLOYEE_PORT 12345
+#define RESULT_STREAM_SINK RESULTS_PATH "/ordered_results.ndjson" // File, FIFO or "unix:<path>"
+#define RESULT_STREAM_WINDOW 64 // Max frames dispatched ahead of the oldest missing one
+#define FRAME_HEADER_PROBE_BYTES 512
+#define DEFAULT_JOB_SCRIPT CHUNKED_SET_PATH "object-detection.js"
+#define CONTROL_SOCKET_PATH "/tmp/volcom_employer_control" // Local job submission socket
+#define JOURNAL_PATH RESULTS_PATH "/employer.journal"
+#define RESULT_CACHE_PATH RESULTS_PATH "/cache"
+#define RESULT_CACHE_MB 1024 // Result files kept for repeated chunks, "result_cache_mb" in the config
+#define INPUT_CHUNK_SIZE (256 * 1024) // Target bytes per range of an input file job
+#define MAX_ACTIVE_TASKS_PER_EMPLOYEE 3 // Unless the node advertises its own "slots"
+// Placement: score = affinity_weight * affinity - (1 - affinity_weight) * load
+#define PLACEMENT_AFFINITY 0.5        // 0 = least loaded only, 1 = affinity only
+#define AFFINITY_WARM_RUNTIME 0.6     // Job runtime already running (no cold start)
+#define AFFINITY_CACHED_SCRIPT 0.2    // Script already on the employee (no transfer)
+#define AFFINITY_FRAME_NEIGHBOUR 0.4  // A nearby frame of the job was placed there
+#define FRAME_NEIGHBOUR_DISTANCE 8
+#define RELAY_INBOX_SIZE 256 // Chunks handed down by a parent employer, not yet queued
 
 static task_assignment_t task_assignments[MAX_TASK_ASSIGNMENTS];
 static int assignment_count = 0;
@@ -43,9 +61,73 @@ static employee_node_t* employees[MAX_EMPLOYEES];
 static int employee_count = 0;
 static pthread_mutex_t employee_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+// Job the chunk directory (and watch mode) feeds into
+static int default_job_slot = -1;
+
+// Mapped input of jobs fed from a single file instead of a chunk directory
+static chunk_source_t job_inputs[MAX_JOBS];
+
+// Placement counters, reported with the status line
+static struct {
+    long placements;
+    long warm_placements;
+    long neighbour_placements;
+    long cold_starts;
+    long script_transfers;
+    long script_cache_hits;
+    long script_cache_misses;   // Offered from the cache, the employee no longer had it
+} placement_stats;
+static double placement_affinity = PLACEMENT_AFFINITY;
+
+// Share of an employee's workers this employer gets when several use it
+static int share_weight = 1;
+
+// Crash-safe log of task state, replayed on startup
+static task_journal_t journal;
+static bool journal_enabled = false;
+
+// Finished frames from the journal, streamed once every frame of their job is expected
+typedef struct {
+    int job_slot;
+    int frame_no;
+    char result_path[MAX_FILENAME_LEN];
+} replayed_result_t;
+
+static replayed_result_t* replayed_results = NULL;
+static int replayed_result_count = 0;
+static int replayed_result_capacity = 0;
+
+// Results of earlier runs, looked up when a task is queued
+static result_cache_t result_cache;
+static bool result_cache_enabled = false;
+
+// Relay mode: jobs and chunks come from a parent employer (see relay.c). The
+// relay's connection thread fills the inbox, the main loop drains it.
+typedef struct {
+    char job_id[64];
+    char script_path[MAX_FILENAME_LEN];
+    script_runtime_t engine;
+    char task_id[64];
+    char chunk_path[MAX_FILENAME_LEN];
+    int frame_no;
+    task_lane_t lane;
+    combine_kind_t combine;
+    int combine_batch;
+    bool release; // Parent finished the job, retire it once its tasks are done
+} relay_request_t;
+
+static bool relay_mode = false;
+static employer_result_cb_t relay_result_cb = NULL;
+static int relay_wakeup[2] = { -1, -1 };
+static relay_request_t relay_inbox[RELAY_INBOX_SIZE];
+static int relay_inbox_count = 0;
+static pthread_mutex_t relay_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 // Forward declarations
-static int send_initial_config(employee_node_t* employee);
+static int send_job_config(employee_node_t* employee, int job_slot);
 static int receive_result_from_employee(employee_node_t* employee);
+static int send_range_to_employee(int sockfd, const chunk_source_t* source, const task_assignment_t* task,
+                                  const char* job_id, task_lane_t lane);
 
 // TODO: Move
 // Signal handler
@@ -66,7 +148,7 @@ static void remove_stale_employees(void) {
     while (i < employee_count) {
         if (current_time - employees[i]->last_seen > STALE_THRESHOLD) {
             printf("[Employer] Removing stale employee %s (%s)\n", 
-                   employees[i]->employee_id, employees[i]->ip_address);
+                   employees[i]->employee_id, employees[i]->endpoint);
 
             if(employees[i]->sockfd >= 0) close(employees[i]->sockfd);
             free(employees[i]);
@@ -83,21 +165,53 @@ static void remove_stale_employees(void) {
     pthread_mutex_unlock(&employee_mutex);
 }
 
+// Forget what a (re)connected employee has; its runtimes and cache may be gone
+static void reset_employee_affinity(employee_node_t* employee) {
+
+    employee->configured_jobs = 0;
+    employee->warm_jobs = 0;
+    memset(employee->cached_scripts, 0, sizeof(employee->cached_scripts));
+    employee->cached_script_next = 0;
+    for (int slot = 0; slot < MAX_JOBS; slot++) {
+        employee->last_frame_no[slot] = -1;
+    }
+}
+
 // Add or update employee
 static employee_node_t* add_or_update_employee(const char* ip, const cJSON* broadcast_data) {
 
+    // Several employees (or relays) can share a host, each on its own port
+    const cJSON *port_json = cJSON_GetObjectItem(broadcast_data, "port");
+    int port = (port_json && cJSON_IsNumber(port_json) && port_json->valueint > 0 && port_json->valueint < 65536)
+             ? port_json->valueint : EMPLOYEE_PORT;
+    const cJSON *slots_json = cJSON_GetObjectItem(broadcast_data, "slots");
+    int max_tasks = MAX_ACTIVE_TASKS_PER_EMPLOYEE;
+    if (slots_json && cJSON_IsNumber(slots_json)) {
+        max_tasks = slots_json->valueint < 0 ? 0 : slots_json->valueint;
+        if (max_tasks > MAX_TASK_ASSIGNMENTS) max_tasks = MAX_TASK_ASSIGNMENTS;
+    }
+    const cJSON *cold_start_json = cJSON_GetObjectItem(broadcast_data, "cold_start_ms");
+    long cold_start_ms = (cold_start_json && cJSON_IsNumber(cold_start_json)) ? (long)cold_start_json->valuedouble : -1;
+    char endpoint[INET_ADDRSTRLEN + 8];
+    snprintf(endpoint, sizeof(endpoint), "%s:%d", ip, port);
+
     pthread_mutex_lock(&employee_mutex);
     time_t current_time = time(NULL);
 
     // Check if employee already exists
     for (int i = 0; i < employee_count; i++) {
-        if (strcmp(employees[i]->ip_address, ip) == 0) {
+        if (strcmp(employees[i]->endpoint, endpoint) == 0) {
             employees[i]->last_seen = current_time;
+            employees[i]->max_tasks = max_tasks; // A relay's capacity follows its own employees
+            if (cold_start_ms >= 0 && cold_start_ms != employees[i]->cold_start_ms) {
+                printf("[Employer] Employee %s runtime cold start: %ld ms\n", endpoint, cold_start_ms);
+            }
+            employees[i]->cold_start_ms = cold_start_ms;
             // If connection was dropped, try to reconnect
             if (employees[i]->sockfd < 0) {
-                employees[i]->sockfd = create_tcp_connection(ip, EMPLOYEE_PORT);
+                employees[i]->sockfd = create_tcp_connection(ip, port);
                 if (employees[i]->sockfd >= 0) {
-                    printf("[Employer] Re-established connection with employee %s\n", ip);
+                    printf("[Employer] Re-established connection with employee %s\n", endpoint);
                     employees[i]->state = EMPLOYEE_STATE_NEW; // Reset state on reconnect
                 }
             }
@@ -114,7 +228,12 @@ static employee_node_t* add_or_update_employee(const char* ip, const cJSON* broa
             return NULL;
         }
 
+        memset(new_employee, 0, sizeof(*new_employee));
         strncpy(new_employee->ip_address, ip, sizeof(new_employee->ip_address) - 1);
+        strncpy(new_employee->endpoint, endpoint, sizeof(new_employee->endpoint) - 1);
+        new_employee->port = port;
+        new_employee->max_tasks = max_tasks;
+        new_employee->cold_start_ms = cold_start_ms;
 
         // Extract employee info from broadcast data
         const cJSON *id = cJSON_GetObjectItem(broadcast_data, "employee_id");
@@ -130,13 +249,14 @@ static employee_node_t* add_or_update_employee(const char* ip, const cJSON* broa
         new_employee->tasks_completed = 0;
         new_employee->tasks_failed = 0;
         new_employee->state = EMPLOYEE_STATE_NEW; // Initial state
+        reset_employee_affinity(new_employee);
 
         // Establish persistent TCP connection
-        new_employee->sockfd = create_tcp_connection(ip, EMPLOYEE_PORT);
+        new_employee->sockfd = create_tcp_connection(ip, port);
         if (new_employee->sockfd < 0) {
-            printf("[Employer] Warning: Failed to establish persistent connection with %s\n", ip);
+            printf("[Employer] Warning: Failed to establish persistent connection with %s\n", endpoint);
         } else {
-            printf("[Employer] Persistent connection established with %s\n", ip);
+            printf("[Employer] Persistent connection established with %s (%d slots)\n", endpoint, max_tasks);
         }
 
         employees[employee_count] = new_employee;
@@ -169,6 +289,15 @@ int add_task_assignment(const task_assignment_t* assignment) {
     return 0;
 }
 
+// Employee buffer lane for a task: urgent for jobs with a positive priority,
+// retry once it was resent, never below the lane a relayed task arrived in
+static task_lane_t dispatch_lane(const task_assignment_t* task, const job_t* job) {
+
+    task_lane_t lane = task->retry_count > 0 ? TASK_LANE_RETRY : TASK_LANE_BULK;
+    if (job->priority > 0) lane = TASK_LANE_URGENT;
+    return task->lane > lane ? task->lane : lane;
+}
+
 int send_pending_tasks(void) {
 
     pthread_mutex_lock(&assignment_mutex);
@@ -179,18 +308,34 @@ int send_pending_tasks(void) {
             // Find the employee for this task
             employee_node_t* employee = NULL;
             for (int j = 0; j < employee_count; j++) {
-                if (strcmp(employees[j]->ip_address, task_assignments[i].employee_ip) == 0) {
+                if (strcmp(employees[j]->endpoint, task_assignments[i].employee_ip) == 0) {
                     employee = employees[j];
                     break;
                 }
             }
 
-            if (employee && employee->sockfd >= 0 && employee->state == EMPLOYEE_STATE_CONFIGURED) {
+            job_t* job = job_table_get(task_assignments[i].job_slot);
+            if (job && employee && employee->sockfd >= 0 && employee->state == EMPLOYEE_STATE_CONFIGURED) {
+                // The job's runtime is started on the employee before its first chunk
+                int result = 0;
+                uint64_t job_bit = 1ULL << task_assignments[i].job_slot;
+                if (!(employee->configured_jobs & job_bit)) {
+                    result = send_job_config(employee, task_assignments[i].job_slot);
+                }
+
                 // Send task to employee using the persistent connection
-                int result = send_file_to_employee(employee->sockfd, 
-                                                 task_assignments[i].chunk_file,
-                                                 task_assignments[i].task_id,
-                                                 employee->ip_address);
+                task_lane_t lane = dispatch_lane(&task_assignments[i], job);
+                if (result == 0 && task_assignments[i].chunk_length > 0) {
+                    result = send_range_to_employee(employee->sockfd, &job_inputs[task_assignments[i].job_slot],
+                                                    &task_assignments[i], job->job_id, lane);
+                } else if (result == 0) {
+                    result = send_file_to_employee(employee->sockfd,
+                                                   task_assignments[i].chunk_file,
+                                                   task_assignments[i].task_id,
+                                                   employee->endpoint,
+                                                   task_assignments[i].frame_no,
+                                                   job->job_id, lane);
+                }
                 
                 if (result == 0) {
                     task_assignments[i].is_sent = true;
@@ -204,6 +349,7 @@ int send_pending_tasks(void) {
                     close(employee->sockfd);
                     employee->sockfd = -1;
                     employee->is_available = false;
+                    if (employee->active_tasks > 0) employee->active_tasks--;
                     
                     task_assignments[i].retry_count++;
                     printf("[Employer] Failed to send task %s to %s (retry %d). Connection lost.\n", 
@@ -246,16 +392,19 @@ int handle_task_timeouts(void) {
                 printf("[Employer] Task %s timed out on %s, will reassign\n", 
                        task_assignments[i].task_id, task_assignments[i].employee_ip);
                 
-                // Mark for reassignment
+                // Mark for reassignment. A mapped task already gave its slot
+                // back when the employee acknowledged it.
+                bool was_mapped = task_assignments[i].is_mapped;
                 task_assignments[i].is_sent = false;
+                task_assignments[i].is_mapped = false;
                 task_assignments[i].retry_count++;
                 
                 // Update employee reliability
                 pthread_mutex_lock(&employee_mutex);
                 for (int j = 0; j < employee_count; j++) {
-                    if (strcmp(employees[j]->ip_address, task_assignments[i].employee_ip) == 0) {
+                    if (strcmp(employees[j]->endpoint, task_assignments[i].employee_ip) == 0) {
                         employees[j]->reliability_score -= 10;
-                        if(employees[j]->active_tasks > 0) employees[j]->active_tasks--;
+                        if(!was_mapped && employees[j]->active_tasks > 0) employees[j]->active_tasks--;
                         break;
                     }
                 }
@@ -271,14 +420,73 @@ int handle_task_timeouts(void) {
     return timeout_count;
 }
 
-// Send the initial configuration script to a new employee
-static int send_initial_config(employee_node_t* employee) {
-    // Assuming the script is named "script"
-    const char *filename = "/object-detection.js";
-    char config_filepath[512];  // Make sure the buffer is large enough
+// SHA-256 over bytes [offset, offset + length) of a file, the whole file for a length of 0
+static int hash_file_range(sha256_ctx_t* ctx, const char* path, off_t offset, size_t length) {
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    unsigned char buffer[16 * 1024];
+    bool whole = length == 0;
+    ssize_t n = 0;
+    while (whole || length > 0) {
+        size_t want = (whole || length > sizeof(buffer)) ? sizeof(buffer) : length;
+        if ((n = pread(fd, buffer, want, offset)) <= 0) break;
+        sha256_update(ctx, buffer, (size_t)n);
+        offset += n;
+        if (!whole) length -= (size_t)n;
+    }
+    close(fd);
+    return (n < 0 || length > 0) ? -1 : 0;
+}
+
+// Memo key of a task: the job's runtime and script, then the chunk bytes
+static int task_memo_key(job_t* job, const char* chunk_file, off_t offset, size_t length, unsigned char* key) {
+
+    sha256_ctx_t ctx;
+    if (!job->memo_config_set) {
+        sha256_init(&ctx);
+        sha256_update(&ctx, job->runtime, strlen(job->runtime) + 1);
+        if (hash_file_range(&ctx, job->script_path, 0, 0) != 0) return -1;
+        sha256_final(&ctx, job->memo_config);
+        job->memo_config_set = true;
+    }
+    sha256_init(&ctx);
+    sha256_update(&ctx, job->memo_config, sizeof(job->memo_config));
+    if (hash_file_range(&ctx, chunk_file, offset, length) != 0) return -1;
+    sha256_final(&ctx, key);
+    return 0;
+}
+
+static int find_cached_script(const employee_node_t* employee, const char* hash) {
+
+    for (int i = 0; hash[0] != '\0' && i < MAX_CACHED_SCRIPTS; i++) {
+        if (strcmp(employee->cached_scripts[i], hash) == 0) return i;
+    }
+    return -1;
+}
+
+static bool employee_has_script(const employee_node_t* employee, const char* hash) {
+
+    return find_cached_script(employee, hash) >= 0;
+}
+
+// Send a job's runtime script to an employee, which starts a runtime for it.
+// If the employee already holds a script with the same content hash, only the
+// metadata is sent and the employee loads the script from its cache.
+static int send_job_config(employee_node_t* employee, int job_slot) {
+
+    job_t *job = job_table_get(job_slot);
+    if (!job) return -1;
 
-    snprintf(config_filepath, sizeof(config_filepath), "%s%s", CHUNKED_SET_PATH, filename);
-    printf("[Employer] Sending initial config '%s' to %s\n", config_filepath, employee->ip_address);
+    const char *config_filepath = job->script_path;
+    // Employees cache the script under its SHA-256
+    if (job->script_hash[0] == '\0' && sha256_file_hex(config_filepath, job->script_hash) != 0) {
+        job->script_hash[0] = '\0';
+    }
+    bool cached = employee_has_script(employee, job->script_hash);
+    printf("[Employer] Sending config '%s' for job %s to %s%s\n", config_filepath, job->job_id, employee->endpoint,
+           cached ? " (cached)" : "");
 
     // 1. Send metadata
     // TODO: get file type not hardcoded
@@ -287,13 +495,39 @@ static int send_initial_config(employee_node_t* employee) {
     cJSON_AddStringToObject(metadata, "task_id", "init_script");
     cJSON_AddStringToObject(metadata, "chunk_filename", "script.js");
     cJSON_AddStringToObject(metadata, "sender_id", "employer");
+    cJSON_AddStringToObject(metadata, "job_id", job->job_id);
+    cJSON_AddStringToObject(metadata, "runtime", job->runtime);
+    cJSON_AddNumberToObject(metadata, "weight", share_weight);
+    if (job->script_hash[0] != '\0') {
+        cJSON_AddStringToObject(metadata, "script_hash", job->script_hash);
+        cJSON_AddBoolToObject(metadata, "script_cached", cached);
+    }
+    if (job->combine != COMBINE_NONE) {
+        cJSON_AddStringToObject(metadata, "combine", combine_name(job->combine));
+        cJSON_AddNumberToObject(metadata, "combine_batch", job->combine_batch);
+    }
     if (send_json(employee->sockfd, metadata) != PROTOCOL_OK) {
-        printf("[Employer] Failed to send initial_config metadata to %s\n", employee->ip_address);
+        printf("[Employer] Failed to send initial_config metadata to %s\n", employee->endpoint);
         cJSON_Delete(metadata);
         return -1;
     }
     cJSON_Delete(metadata);
 
+    // A runtime that loads its script from the employee's cache is counted as a
+    // cache hit, cold starts are the runtimes that had to fetch it first
+    uint64_t job_bit = 1ULL << job_slot;
+    if (cached) {
+        uint32_t no_payload = 0;
+        if (send(employee->sockfd, &no_payload, sizeof(no_payload), 0) != sizeof(no_payload)) {
+            printf("[Employer] Failed to send config file size to %s\n", employee->endpoint);
+            return -1;
+        }
+        placement_stats.script_cache_hits++;
+        employee->configured_jobs |= job_bit;
+        employee->warm_jobs |= job_bit;
+        return 0;
+    }
+
     // 2. Send file content (reusing parts of send_file_to_employee logic)
     FILE *file = fopen(config_filepath, "rb");
     if (!file) {
@@ -307,7 +541,7 @@ static int send_initial_config(employee_node_t* employee) {
 
     uint32_t net_size = htonl((uint32_t)file_size);
     if (send(employee->sockfd, &net_size, sizeof(net_size), 0) != sizeof(net_size)) {
-        printf("[Employer] Failed to send config file size to %s\n", employee->ip_address);
+        printf("[Employer] Failed to send config file size to %s\n", employee->endpoint);
         fclose(file);
         return -1;
     }
@@ -324,7 +558,7 @@ static int send_initial_config(employee_node_t* employee) {
 
         ssize_t bytes_sent = send(employee->sockfd, buffer, bytes_read, 0);
         if (bytes_sent <= 0) {
-            printf("[Employer] Failed to send config file data to %s.\n", employee->ip_address);
+            printf("[Employer] Failed to send config file data to %s.\n", employee->endpoint);
             fclose(file);
             return -1;
         }
@@ -332,14 +566,121 @@ static int send_initial_config(employee_node_t* employee) {
     }
     fclose(file);
 
-    printf("[Employer] Successfully sent initial config to %s\n", employee->ip_address);
-    employee->state = EMPLOYEE_STATE_CONFIGURED; // Update state
+    printf("[Employer] Successfully sent config for job %s to %s\n", job->job_id, employee->endpoint);
+    placement_stats.script_transfers++;
+    placement_stats.cold_starts++; // Also after a cache miss, the offered copy was not counted
+    job->cold_starts++;
+    employee->configured_jobs |= job_bit;
+    employee->warm_jobs |= job_bit;
+    if (job->script_hash[0] != '\0' && !employee_has_script(employee, job->script_hash)) {
+        strcpy(employee->cached_scripts[employee->cached_script_next], job->script_hash);
+        employee->cached_script_next = (employee->cached_script_next + 1) % MAX_CACHED_SCRIPTS;
+    }
     return 0;
 }
 
+// The employee no longer holds a script it was offered from its cache: forget
+// that it has it and ship the script. Chunks sent in the meantime wait in the
+// employee's buffer until the runtime starts.
+static int resend_job_script(employee_node_t* employee, const cJSON* message) {
+
+    const cJSON *job_id = cJSON_GetObjectItem(message, "job_id");
+    int job_slot = cJSON_IsString(job_id) ? job_table_find(job_id->valuestring) : -1;
+    job_t *job = job_table_get(job_slot);
+    if (!job) return 0; // Finished in the meantime
+
+    int cached = find_cached_script(employee, job->script_hash);
+    if (cached >= 0) employee->cached_scripts[cached][0] = '\0';
+    placement_stats.script_cache_misses++;
+    printf("[Employer] %s is missing the script of job %s, sending it again\n", employee->endpoint, job->job_id);
+    return send_job_config(employee, job_slot);
+}
+
+// Tell employees hosting a finished job's runtime that they can stop it
+static void release_job_on_employees(int job_slot) {
+
+    job_t *job = job_table_get(job_slot);
+    uint64_t job_bit = 1ULL << job_slot;
+
+    pthread_mutex_lock(&employee_mutex);
+    for (int i = 0; i < employee_count; i++) {
+        employees[i]->warm_jobs &= ~job_bit;
+        employees[i]->last_frame_no[job_slot] = -1;
+        if (!(employees[i]->configured_jobs & job_bit)) continue;
+        employees[i]->configured_jobs &= ~job_bit;
+        if (employees[i]->sockfd < 0 || !job) continue;
+
+        cJSON *message = cJSON_CreateObject();
+        cJSON_AddStringToObject(message, "message_type", "job_release");
+        cJSON_AddStringToObject(message, "job_id", job->job_id);
+        if (send_json(employees[i]->sockfd, message) != PROTOCOL_OK) {
+            printf("[Employer] Failed to release job %s on %s\n", job->job_id, employees[i]->endpoint);
+        }
+        cJSON_Delete(message);
+    }
+    pthread_mutex_unlock(&employee_mutex);
+}
+
+
+// Announce a data chunk on the persistent connection; the payload follows as
+// a 4 byte size and the raw bytes
+static int send_chunk_metadata(int sockfd, const char* filepath, const char* task_id, const char* employee_ip,
+                               int frame_no, const char* job_id, const chunk_range_t* range, task_lane_t lane) {
+
+    cJSON *metadata = create_task_metadata(task_id, filepath, "employer", employee_ip, "pending");
+    cJSON_AddStringToObject(metadata, "message_type", "data_chunk"); // Specify message type
+    if (frame_no >= 0) {
+        cJSON_AddNumberToObject(metadata, "frame_no", frame_no);
+    }
+    if (job_id) {
+        cJSON_AddStringToObject(metadata, "job_id", job_id);
+    }
+    if (range) {
+        cJSON_AddNumberToObject(metadata, "chunk_offset", (double)range->offset);
+        cJSON_AddNumberToObject(metadata, "chunk_length", (double)range->length);
+    }
+    if (lane != TASK_LANE_BULK) {
+        cJSON_AddStringToObject(metadata, "lane", task_lane_name(lane));
+    }
+    if (send_json(sockfd, metadata) != PROTOCOL_OK) {
+        printf("[Employer] Failed to send metadata to %s\n", employee_ip);
+        cJSON_Delete(metadata);
+        return -1;
+    }
+    cJSON_Delete(metadata);
+    return 0;
+}
+
+// Send a byte range of a job's mapped input file. The bytes go from the page
+// cache to the socket with sendfile, no chunk file is written.
+static int send_range_to_employee(int sockfd, const chunk_source_t* source, const task_assignment_t* task,
+                                  const char* job_id, task_lane_t lane) {
+
+    if (sockfd < 0 || !source || source->fd < 0 || !task) {
+        return -1;
+    }
+
+    chunk_range_t range = { .offset = task->chunk_offset, .length = task->chunk_length };
+    if (send_chunk_metadata(sockfd, task->chunk_file, task->task_id, task->employee_ip,
+                            task->frame_no, job_id, &range, lane) != 0) {
+        return -1;
+    }
+
+    uint32_t net_size = htonl((uint32_t)range.length);
+    if (send(sockfd, &net_size, sizeof(net_size), 0) != sizeof(net_size) ||
+        chunk_range_send(sockfd, source, &range) != 0) {
+        printf("[Employer] Failed to send chunk %s to %s. Connection may be lost.\n", task->task_id, task->employee_ip);
+        return -1;
+    }
+
+    printf("[Employer] Sent %s bytes %lld-%lld (%zu bytes) to %s\n", task->chunk_file,
+           (long long)range.offset, (long long)(range.offset + range.length), range.length, task->employee_ip);
+    return 0;
+}
 
 // Modified to use a persistent connection and send data chunks
-int send_file_to_employee(int sockfd, const char* filepath, const char* task_id, const char* employee_ip) {
+int send_file_to_employee(int sockfd, const char* filepath, const char* task_id, const char* employee_ip,
+                          int frame_no, const char* job_id, task_lane_t lane) {
 
     if (sockfd < 0 || !filepath || !task_id) {
         return -1;
@@ -348,14 +689,9 @@ int send_file_to_employee(int sockfd, const char* filepath, const char* task_id,
     printf("[Employer] Using persistent connection to send data chunk %s to %s\n", task_id, employee_ip);
     
     // Send task metadata
-    cJSON *metadata = create_task_metadata(task_id, filepath, "employer", employee_ip, "pending");
-    cJSON_AddStringToObject(metadata, "message_type", "data_chunk"); // Specify message type
-    if (send_json(sockfd, metadata) != PROTOCOL_OK) {
-        printf("[Employer] Failed to send metadata to %s\n", employee_ip);
-        cJSON_Delete(metadata);
+    if (send_chunk_metadata(sockfd, filepath, task_id, employee_ip, frame_no, job_id, NULL, lane) != 0) {
         return -1;
     }
-    cJSON_Delete(metadata);
     
     // Send file content
     FILE *file = fopen(filepath, "rb");
@@ -409,55 +745,381 @@ int send_file_to_employee(int sockfd, const char* filepath, const char* task_id,
     return 0;
 }
 
+// Read and drop a result payload, keeping the connection in sync
+static int discard_payload(int sockfd, uint32_t size) {
+
+    char discard_buffer[1024];
+    size_t total_discarded = 0;
+    while (total_discarded < size) {
+        size_t to_read = sizeof(discard_buffer);
+        if (total_discarded + to_read > size) to_read = size - total_discarded;
+        ssize_t discarded = recv(sockfd, discard_buffer, to_read, 0);
+        if (discarded <= 0) return -1;
+        total_discarded += discarded;
+    }
+    return 0;
+}
+
+// A combine job's chunk was folded into the employee's pending partial. Its
+// slot is free again, but the task only completes with the partial.
+static void handle_task_ack(employee_node_t* employee, const char* task_id) {
+
+    job_t *job = NULL;
+    pthread_mutex_lock(&assignment_mutex);
+    for (int i = 0; i < assignment_count; i++) {
+        task_assignment_t *task = &task_assignments[i];
+        if (!task->is_completed && !task->is_mapped && strcmp(task->task_id, task_id) == 0) {
+            task->is_mapped = true;
+            job = job_table_get(task->job_slot);
+            if (employee->active_tasks > 0) {
+                employee->active_tasks--;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&assignment_mutex);
+
+    if (job && job->relayed && relay_result_cb) {
+        relay_result_cb(job->job_id, task_id, NULL, NULL, RESULT_KIND_ACK, 0);
+    }
+}
+
+static cJSON* load_json_file(const char* path) {
+
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *text = size >= 0 ? malloc(size + 1) : NULL;
+    cJSON *json = NULL;
+    if (text && fread(text, 1, size, file) == (size_t)size) {
+        text[size] = '\0';
+        json = cJSON_Parse(text);
+    }
+    free(text);
+    fclose(file);
+    return json;
+}
+
+static bool is_covered(const int* covered, int found, int assignment) {
+    for (int n = 0; n < found; n++) {
+        if (covered[n] == assignment) return true;
+    }
+    return false;
+}
+
+// A partial result {"tasks":[...],"value":...} covers the listed chunks of one
+// combine job. Every chunk may be counted only once: if one of them already
+// completed (it timed out and ran again elsewhere), the whole partial is
+// dropped and its other chunks are computed again. So is a partial that lists
+// a chunk twice.
+static void accept_partial(employee_node_t* employee, const char* partial_id, const char* partial_path,
+                           uint32_t size) {
+
+    cJSON *partial = load_json_file(partial_path);
+    const cJSON *tasks = cJSON_GetObjectItem(partial, "tasks");
+    cJSON *value = cJSON_DetachItemFromObject(partial, "value");
+    if (!cJSON_IsArray(tasks) || !value) {
+        printf("[Employer] Malformed partial %s from %s\n", partial_id, employee->endpoint);
+        cJSON_Delete(value);
+        cJSON_Delete(partial);
+        return;
+    }
+
+    int task_count = cJSON_GetArraySize(tasks);
+    int *covered = calloc(task_count > 0 ? task_count : 1, sizeof(int));
+    int found = 0;
+    char repeated[sizeof(task_assignments[0].task_id)] = ""; // Its value would count that task twice
+    job_t *job = NULL;
+
+    pthread_mutex_lock(&assignment_mutex);
+    const cJSON *task_id = NULL;
+    cJSON_ArrayForEach(task_id, tasks) {
+        if (!covered || !cJSON_IsString(task_id)) continue;
+        for (int i = 0; i < assignment_count; i++) {
+            if (!task_assignments[i].is_completed &&
+                strcmp(task_assignments[i].task_id, task_id->valuestring) == 0) {
+                if (is_covered(covered, found, i)) strcpy(repeated, task_assignments[i].task_id);
+                else covered[found++] = i;
+                break;
+            }
+        }
+    }
+
+    bool accepted = covered && !repeated[0] && found == task_count;
+    for (int n = 0; n < found; n++) {
+        task_assignment_t *task = &task_assignments[covered[n]];
+        if (!job) job = job_table_get(task->job_slot);
+        if (accepted) {
+            task->is_completed = true;
+            task->is_mapped = false;
+            task->completed_time = time(NULL);
+            // Relayed chunks are spool copies (see relay.c), done with once covered
+            if (job && job->relayed) unlink(task->chunk_file);
+        } else if (task->is_mapped && strcmp(task->employee_ip, employee->endpoint) == 0) {
+            task->is_mapped = false;
+            task->is_sent = false;
+            task->retry_count++;
+        }
+    }
+    if (job) job->result_bytes += size;
+    if (job && accepted) job->tasks_completed += found;
+    pthread_mutex_unlock(&assignment_mutex);
+    free(covered);
+    cJSON_Delete(partial);
+
+    if (repeated[0]) {
+        printf("[Employer] Dropped partial %s from %s: it lists task %s twice, recomputing its tasks\n",
+               partial_id, employee->endpoint, repeated);
+        cJSON_Delete(value);
+        unlink(partial_path);
+        return;
+    }
+    if (!job || !accepted) {
+        printf("[Employer] Dropped partial %s from %s: %d of its %d tasks are already done, recomputing the rest\n",
+               partial_id, employee->endpoint, task_count - found, task_count);
+        cJSON_Delete(value);
+        unlink(partial_path);
+        return;
+    }
+
+    // A relay hands the partial up, its parent does the merging
+    if (job->relayed && relay_result_cb) {
+        cJSON_Delete(value);
+        relay_result_cb(job->job_id, partial_id, NULL, partial_path, RESULT_KIND_PARTIAL, task_count);
+        return;
+    }
+
+    if (combine_tree_add(&job->combined, value) != 0) {
+        printf("[Employer] Out of memory merging partial %s of job %s\n", partial_id, job->job_id);
+    }
+    unlink(partial_path);
+    printf("[Employer] Merged partial %s (%d tasks) into job %s\n", partial_id, task_count, job->job_id);
+}
+
+// Results and result frames received, for the status line
+static long results_received = 0;
+static long result_frames_received = 0;
+static long partial_sequence = 0;
+
+static void result_path_for(const char* task_id, result_kind_t kind, char* path, size_t path_size) {
+    if (kind == RESULT_KIND_PARTIAL) {
+        snprintf(path, path_size, "%s/partial_%ld.json", RESULTS_PATH, partial_sequence++);
+    } else {
+        snprintf(path, path_size, "%s/result_%s", RESULTS_PATH, task_id);
+    }
+}
+
+// A result saved to path is in: complete its task (or the partial's tasks).
+// employee is NULL for results taken from the result cache.
+static void complete_result(employee_node_t* employee, const char* task_id, result_kind_t kind, const char* path,
+                            uint32_t size) {
+
+    if (employee) results_received++;
+    if (kind == RESULT_KIND_PARTIAL) {
+        accept_partial(employee, task_id, path, size);
+        return;
+    }
+
+    if (employee) {
+        printf("[Employer] Successfully received result for task %s. Saved to %s\n", task_id, path);
+    } else {
+        printf("[Employer] Result for task %s found in the result cache. Saved to %s\n", task_id, path);
+    }
+
+    // Update task and employee status
+    int frame_no = -1;
+    job_t *job = NULL;
+    char chunk_file[MAX_FILENAME_LEN] = "";
+    bool memoize = false;
+    unsigned char memo_key[SHA256_DIGEST_LEN];
+    pthread_mutex_lock(&assignment_mutex);
+    for (int i = 0; i < assignment_count; i++) {
+        if (!task_assignments[i].is_completed && strcmp(task_assignments[i].task_id, task_id) == 0) {
+            task_assignments[i].is_completed = true;
+            task_assignments[i].completed_time = time(NULL);
+            frame_no = task_assignments[i].frame_no;
+            strncpy(chunk_file, task_assignments[i].chunk_file, sizeof(chunk_file) - 1);
+            job = job_table_get(task_assignments[i].job_slot);
+            if (job) {
+                job->tasks_completed++;
+                job->result_bytes += size;
+            }
+            // Combine jobs keep results only in memory, their tasks run again after a restart
+            if (job && journal_enabled && job->combine == COMBINE_NONE) {
+                task_journal_completed(&journal, task_id, job->job_id, frame_no, path);
+            }
+            memoize = employee && task_assignments[i].memo_keyed;
+            memcpy(memo_key, task_assignments[i].memo_key, sizeof(memo_key));
+            if (employee && employee->active_tasks > 0) {
+                employee->active_tasks--;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&assignment_mutex);
+
+    // Before the result file is handed on and possibly moved
+    if (memoize && result_cache_enabled) {
+        result_cache_store(&result_cache, memo_key, path);
+    }
+
+    // A relay hands the result up to its parent instead of keeping it
+    if (job && job->relayed && relay_result_cb) {
+        relay_result_cb(job->job_id, task_id, chunk_file, path, RESULT_KIND_TASK, 1);
+        return;
+    }
+
+    // An employee without combine support sent the whole chunk result
+    if (job && job->combine != COMBINE_NONE) {
+        cJSON *value = load_json_file(path);
+        if (value && combine_tree_add(&job->combined, value) == 0) {
+            unlink(path);
+        }
+        return;
+    }
+
+    // Hand frame results to the ordered stream so downstream encoding can start
+    if (job && job->result_stream_enabled && frame_no >= 0) {
+        int streamed = result_stream_submit(&job->result_stream, frame_no, path);
+        if (streamed > 0) {
+            printf("[Employer] Streamed %d ordered frame result(s) up to frame %d\n", streamed, frame_no);
+        }
+    }
+}
+
+static result_kind_t result_kind_of(const cJSON* metadata) {
+    if (cJSON_IsTrue(cJSON_GetObjectItem(metadata, "combined"))) return RESULT_KIND_ACK;
+    if (cJSON_IsTrue(cJSON_GetObjectItem(metadata, "partial"))) return RESULT_KIND_PARTIAL;
+    return RESULT_KIND_TASK;
+}
+
+// Several results in one frame: "results" lists their metadata, the payloads
+// follow back to back in that order
+static int receive_result_batch(employee_node_t* employee, const cJSON* batch) {
+
+    uint32_t net_size;
+    if (recv(employee->sockfd, &net_size, sizeof(net_size), MSG_WAITALL) != sizeof(net_size)) {
+        printf("[Employer] Failed to receive result batch size from %s\n", employee->endpoint);
+        return -1;
+    }
+    uint32_t total_size = ntohl(net_size);
+    // The sender never frames more than this, a larger size is a broken peer
+    if (total_size > PROTOCOL_FRAME_MAX) {
+        printf("[Employer] Result batch of %u bytes from %s is too large\n", total_size, employee->endpoint);
+        return -1;
+    }
+    char *payload = total_size > 0 ? malloc(total_size) : NULL;
+    if (total_size > 0 && !payload) {
+        printf("[Employer] Out of memory for a %u byte result batch from %s\n", total_size, employee->endpoint);
+        return discard_payload(employee->sockfd, total_size);
+    }
+    if (total_size > 0 && recv(employee->sockfd, payload, total_size, MSG_WAITALL) != (ssize_t)total_size) {
+        printf("[Employer] Failed to receive result batch from %s\n", employee->endpoint);
+        free(payload);
+        return -1;
+    }
+    result_frames_received++;
+
+    const cJSON *results = cJSON_GetObjectItem(batch, "results");
+    const cJSON *entry = NULL;
+    uint32_t offset = 0;
+    cJSON_ArrayForEach(entry, results) {
+        const cJSON *task_id_json = cJSON_GetObjectItem(entry, "task_id");
+        const cJSON *size_json = cJSON_GetObjectItem(entry, "result_size");
+        uint32_t size = cJSON_IsNumber(size_json) ? (uint32_t)size_json->valuedouble : 0;
+        if (!cJSON_IsString(task_id_json) || size > total_size - offset) {
+            printf("[Employer] Malformed result batch from %s\n", employee->endpoint);
+            break;
+        }
+        const char *task_id = task_id_json->valuestring;
+        result_kind_t kind = result_kind_of(entry);
+        const char *data = payload + offset;
+        offset += size;
+
+        if (kind == RESULT_KIND_ACK) {
+            results_received++;
+            handle_task_ack(employee, task_id);
+            continue;
+        }
+        char result_filepath[512];
+        result_path_for(task_id, kind, result_filepath, sizeof(result_filepath));
+        FILE *file = fopen(result_filepath, "wb");
+        if (!file || fwrite(data, 1, size, file) != size) {
+            perror("write result file");
+            if (file) fclose(file);
+            continue;
+        }
+        fclose(file);
+        complete_result(employee, task_id, kind, result_filepath, size);
+    }
+    free(payload);
+    return 0;
+}
+
 static int receive_result_from_employee(employee_node_t* employee) {
 
     cJSON *metadata = NULL;
     if (recv_json(employee->sockfd, &metadata) != PROTOCOL_OK) {
-        printf("[Employer] Failed to receive result metadata from %s\n", employee->ip_address);
+        printf("[Employer] Failed to receive result metadata from %s\n", employee->endpoint);
         return -1;
     }
 
     const cJSON *type = cJSON_GetObjectItem(metadata, "type");
     const cJSON *task_id_json = cJSON_GetObjectItem(metadata, "task_id");
 
+    if (cJSON_IsString(type) && strcmp(type->valuestring, "result_batch") == 0) {
+        int status = receive_result_batch(employee, metadata);
+        cJSON_Delete(metadata);
+        return status;
+    }
+
+    if (cJSON_IsString(type) && strcmp(type->valuestring, "script_missing") == 0) {
+        int status = resend_job_script(employee, metadata);
+        cJSON_Delete(metadata);
+        return status;
+    }
+
     if (!type || !cJSON_IsString(type) || strcmp(type->valuestring, "task_result") != 0 || !task_id_json || !cJSON_IsString(task_id_json)) {
-        printf("[Employer] Invalid result metadata from %s\n", employee->ip_address);
+        printf("[Employer] Invalid result metadata from %s\n", employee->endpoint);
         cJSON_Delete(metadata);
         return 0; // Not a fatal error, just wrong message type
     }
 
     char task_id[MAX_FILENAME_LEN];
     strncpy(task_id, task_id_json->valuestring, sizeof(task_id) - 1);
+    result_kind_t kind = result_kind_of(metadata);
     cJSON_Delete(metadata);
 
     // Receive file size
     uint32_t net_size;
     if (recv(employee->sockfd, &net_size, sizeof(net_size), MSG_WAITALL) != sizeof(net_size)) {
-        printf("[Employer] Failed to receive result file size from %s\n", employee->ip_address);
+        printf("[Employer] Failed to receive result file size from %s\n", employee->endpoint);
         return -1;
     }
     uint32_t file_size = ntohl(net_size);
+    result_frames_received++;
+
+    if (kind == RESULT_KIND_ACK) {
+        if (discard_payload(employee->sockfd, file_size) != 0) return -1;
+        results_received++;
+        handle_task_ack(employee, task_id);
+        return 0;
+    }
 
     // Construct result filepath
     char result_filepath[512];
-    snprintf(result_filepath, sizeof(result_filepath), "%s/result_%s", RESULTS_PATH, task_id);
+    result_path_for(task_id, kind, result_filepath, sizeof(result_filepath));
 
     FILE* file = fopen(result_filepath, "wb");
     if (!file) {
         perror("fopen result file");
         // Consume and discard the data from the socket to avoid desync
-        char discard_buffer[1024];
-        size_t total_discarded = 0;
-        while (total_discarded < file_size) {
-            size_t to_read = sizeof(discard_buffer);
-            if (total_discarded + to_read > file_size) to_read = file_size - total_discarded;
-            ssize_t discarded = recv(employee->sockfd, discard_buffer, to_read, 0);
-            if (discarded <= 0) break;
-            total_discarded += discarded;
-        }
+        discard_payload(employee->sockfd, file_size);
         return 0; // Not a connection error
     }
-
     // Receive file content
     char buffer[4096];
     size_t total_received = 0;
@@ -466,7 +1128,7 @@ static int receive_result_from_employee(employee_node_t* employee) {
         if (total_received + to_receive > file_size) to_receive = file_size - total_received;
         ssize_t bytes_received = recv(employee->sockfd, buffer, to_receive, 0);
         if (bytes_received <= 0) {
-            printf("[Employer] Failed to receive result file data from %s\n", employee->ip_address);
+            printf("[Employer] Failed to receive result file data from %s\n", employee->endpoint);
             fclose(file);
             return -1; // Connection error
         }
@@ -475,23 +1137,8 @@ static int receive_result_from_employee(employee_node_t* employee) {
     }
     fclose(file);
 
-    printf("[Employer] Successfully received result for task %s. Saved to %s\n", task_id, result_filepath);
-
-    // Update task and employee status
-    pthread_mutex_lock(&assignment_mutex);
-    for (int i = 0; i < assignment_count; i++) {
-        if (!task_assignments[i].is_completed && strcmp(task_assignments[i].task_id, task_id) == 0) {
-            task_assignments[i].is_completed = true;
-            task_assignments[i].completed_time = time(NULL);
-            if (employee->active_tasks > 0) {
-                employee->active_tasks--;
-            }
-            break;
-        }
-    }
-    pthread_mutex_unlock(&assignment_mutex);
-
-    return 0; // Success
+    complete_result(employee, task_id, kind, result_filepath, file_size);
+    return 0;
 }
 
 // Distributes unassigned tasks to available employees
@@ -507,7 +1154,7 @@ static void distribute_new_tasks(const char* task_file_path) {
     while (attempts < employee_count) {
         employee_node_t* current_employee = employees[last_used_employee];
 
-         if (current_employee->sockfd >= 0 && current_employee->state == EMPLOYEE_STATE_CONFIGURED && current_employee->active_tasks < 3) {
+         if (current_employee->sockfd >= 0 && current_employee->state == EMPLOYEE_STATE_CONFIGURED && current_employee->active_tasks < current_employee->max_tasks) {
 
             char task_id[MAX_FILENAME_LEN];
             snprintf(task_id, sizeof(task_id), "task_%ld", time(NULL));
@@ -515,18 +1162,20 @@ static void distribute_new_tasks(const char* task_file_path) {
             printf("[Employer] Assigning %s to employee %s (%s)\n", 
                    task_file_path, 
                    current_employee->employee_id,
-                   current_employee->ip_address);
+                   current_employee->endpoint);
 
             // Create task assignment
             task_assignment_t assignment;
             strncpy(assignment.task_id, task_id, sizeof(assignment.task_id) - 1);
             strncpy(assignment.chunk_file, task_file_path, sizeof(assignment.chunk_file) - 1);
             strncpy(assignment.employee_id, current_employee->employee_id, sizeof(assignment.employee_id) - 1);
-            strncpy(assignment.employee_ip, current_employee->ip_address, sizeof(assignment.employee_ip) - 1);
+            strncpy(assignment.employee_ip, current_employee->endpoint, sizeof(assignment.employee_ip) - 1);
             assignment.assigned_time = time(NULL);
             assignment.is_completed = false;
             assignment.is_sent = false;
             assignment.retry_count = 0;
+            assignment.frame_no = -1;
+            assignment.job_slot = default_job_slot;
 
             // Add to task queue
             if (add_task_assignment(&assignment) == 0) {
@@ -550,38 +1199,769 @@ static void distribute_new_tasks(const char* task_file_path) {
 }
 
 
-// Scan CHUNKED_SET_PATH for .json files and queue them as tasks
-void populate_chunked_tasks() {
-    DIR *dir = opendir(CHUNKED_SET_PATH);
+// Work out the frame number of a chunk. The "frameNumber" field sits at the
+// top of the frame JSON files, so only a small header is probed instead of
+// parsing the whole (base64 image) payload. Falls back to the digits of a
+// "frame_<n>" file name.
+static int detect_frame_no(const char* filepath, const char* filename) {
+
+    FILE *file = fopen(filepath, "rb");
+    if (file) {
+        char header[FRAME_HEADER_PROBE_BYTES + 1];
+        size_t n = fread(header, 1, FRAME_HEADER_PROBE_BYTES, file);
+        fclose(file);
+        header[n] = '\0';
+
+        char *field = strstr(header, "\"frameNumber\"");
+        if (field) {
+            char *colon = strchr(field, ':');
+            if (colon) {
+                char *end = NULL;
+                long value = strtol(colon + 1, &end, 10);
+                if (end != colon + 1 && value >= 0) return (int)value;
+            }
+        }
+    }
+
+    const char *name = strstr(filename, "frame");
+    if (name) {
+        while (*name && (*name < '0' || *name > '9')) name++;
+        if (*name) return atoi(name);
+    }
+
+    return -1;
+}
+
+static bool task_assignment_exists(const char* task_id) {
+
+    pthread_mutex_lock(&assignment_mutex);
+    bool exists = false;
+    for (int i = 0; i < assignment_count; i++) {
+        if (!task_assignments[i].is_completed && strcmp(task_assignments[i].task_id, task_id) == 0) {
+            exists = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&assignment_mutex);
+    return exists;
+}
+
+// Drop completed assignments so a long-running (watch mode) employer never
+// runs out of slots in the assignment table (same for relays)
+static int compact_completed_assignments(void) {
+
+    pthread_mutex_lock(&assignment_mutex);
+    int kept = 0;
+    for (int i = 0; i < assignment_count; i++) {
+        if (!task_assignments[i].is_completed) {
+            if (kept != i) task_assignments[kept] = task_assignments[i];
+            kept++;
+        }
+    }
+    int removed = assignment_count - kept;
+    assignment_count = kept;
+    pthread_mutex_unlock(&assignment_mutex);
+    return removed;
+}
+
+// Each frame job gets its own ordered stream
+static void ensure_result_stream(int job_slot) {
+
+    job_t *job = job_table_get(job_slot);
+    if (!job || job->result_stream_enabled) return;
+
+    const char *sink = get_volcom_config_value("result_stream_sink");
+    const char *window = get_volcom_config_value("result_stream_window");
+    char job_sink[MAX_FILENAME_LEN];
+    if (job_slot == default_job_slot) {
+        snprintf(job_sink, sizeof(job_sink), "%s", sink ? sink : RESULT_STREAM_SINK);
+    } else {
+        snprintf(job_sink, sizeof(job_sink), "%s/%s_ordered_results.ndjson", RESULTS_PATH, job->job_id);
+    }
+    if (result_stream_init(&job->result_stream, job_sink,
+                           window ? atoi(window) : RESULT_STREAM_WINDOW) == 0) {
+        job->result_stream_enabled = true;
+    }
+}
+
+// Add a task to the assignment table. Returns 0 if a new task was queued.
+static int queue_task(int job_slot, const char* task_id, const char* filepath, int frame_no,
+                      off_t offset, size_t length, task_lane_t lane) {
+
+    job_t *job = job_table_get(job_slot);
+    if (!job || task_assignment_exists(task_id)) return -1;
+
+    task_assignment_t assignment = {0};
+    strncpy(assignment.task_id, task_id, sizeof(assignment.task_id) - 1);
+    strncpy(assignment.chunk_file, filepath, sizeof(assignment.chunk_file) - 1);
+    assignment.is_completed = false;
+    assignment.is_sent = false;
+    assignment.retry_count = 0;
+    assignment.frame_no = frame_no;
+    assignment.job_slot = job_slot;
+    assignment.chunk_offset = offset;
+    assignment.chunk_length = length;
+    assignment.lane = lane;
+    // Combine jobs fold results into partials, there is no per-chunk result to keep
+    if (result_cache_enabled && job->combine == COMBINE_NONE &&
+        task_memo_key(job, filepath, offset, length, assignment.memo_key) == 0) {
+        assignment.memo_keyed = true;
+    }
+    // employee_id and employee_ip will be set when assigned
+    if (add_task_assignment(&assignment) != 0) {
+        printf("[Employer] Task table full, could not queue %s\n", task_id);
+        return -1;
+    }
+    job->tasks_queued++;
+
+    if (journal_enabled) {
+        task_journal_queued(&journal, assignment.task_id, job->job_id, frame_no, assignment.chunk_file);
+    }
+
+    // Relayed frames are put in order by the parent, combine jobs have no per-frame results
+    if (frame_no >= 0 && !job->relayed && job->combine == COMBINE_NONE) {
+        ensure_result_stream(job_slot);
+        if (job->result_stream_enabled) {
+            result_stream_expect(&job->result_stream, frame_no);
+        }
+    }
+
+    // Computed before: complete it now instead of dispatching it
+    if (assignment.memo_keyed) {
+        char result_filepath[512];
+        size_t result_size = 0;
+        result_path_for(assignment.task_id, RESULT_KIND_TASK, result_filepath, sizeof(result_filepath));
+        if (result_cache_lookup(&result_cache, assignment.memo_key, result_filepath, &result_size) == 0) {
+            complete_result(NULL, assignment.task_id, RESULT_KIND_TASK, result_filepath, (uint32_t)result_size);
+        }
+    }
+    return 0;
+}
+
+// Queue a single chunk file of a job as a task. Returns 0 if a new task was queued.
+static int queue_job_chunk(int job_slot, const char* dir, const char* filename) {
+
+    job_t *job = job_table_get(job_slot);
+    if (!job) return -1;
+
+    char filepath[512];
+    snprintf(filepath, sizeof(filepath), "%s/%s", dir, filename);
+
+    // Chunk names only have to be unique within a job
+    char task_id[MAX_FILENAME_LEN * 2];
+    if (job_slot == default_job_slot) {
+        snprintf(task_id, sizeof(task_id), "%s", filename);
+    } else {
+        snprintf(task_id, sizeof(task_id), "%s:%s", job->job_id, filename);
+    }
+    task_id[sizeof(((task_assignment_t*)0)->task_id) - 1] = '\0'; // As stored in the table
+
+    // Finished before a restart, the result is already on disk
+    if (journal_enabled && task_journal_is_completed(&journal, task_id)) return -1;
+
+    return queue_task(job_slot, task_id, filepath, detect_frame_no(filepath, filename), 0, 0, TASK_LANE_BULK);
+}
+
+// Ingest callback: files arriving in the watched directory belong to the default job
+static int queue_chunk_file(const char* dir, const char* filename) {
+
+    return queue_job_chunk(default_job_slot, dir, filename);
+}
+
+static bool is_input_file_job(const job_t* job) {
+
+    struct stat st;
+    return job && stat(job->chunk_dir, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+// Split a job's input file into record-aligned ranges and queue one task per
+// range. The split is deterministic, so after a restart the same task ids come
+// out and finished ranges are skipped.
+static int populate_job_ranges(int job_slot) {
+
+    job_t *job = job_table_get(job_slot);
+    chunk_source_t *source = &job_inputs[job_slot];
+    if (!job) return 0;
+
+    record_format_t format;
+    size_t record_size;
+    const char *format_setting = get_volcom_config_value("input_format");
+    if (format_setting ? parse_record_format(format_setting, &format, &record_size) != 0
+                       : record_format_for_path(job->chunk_dir, &format, &record_size) != 0) {
+        printf("[Employer] Unknown input_format '%s' for %s\n", format_setting ? format_setting : "(auto)", job->chunk_dir);
+        return 0;
+    }
+    const char *size_setting = get_volcom_config_value("input_chunk_size");
+    size_t target_size = size_setting ? strtoul(size_setting, NULL, 10) : INPUT_CHUNK_SIZE;
+
+    chunk_source_close(source);
+    if (chunk_source_open(source, job->chunk_dir, format, record_size) != 0) return 0;
+
+    const char *name = strrchr(job->chunk_dir, '/');
+    name = name ? name + 1 : job->chunk_dir;
+    // Only a frame container is a sequence of frames whose results go out in order
+    bool frames = format == RECORD_FORMAT_FRAMES;
+
+    int queued = 0;
+    chunk_range_t range;
+    off_t offset = 0;
+    int index = 0;
+    int status;
+    while ((status = chunk_source_next(source, offset, target_size, &range)) == 1) {
+        char task_id[MAX_FILENAME_LEN * 2];
+        if (job_slot == default_job_slot) {
+            snprintf(task_id, sizeof(task_id), "%s@%d", name, index);
+        } else {
+            snprintf(task_id, sizeof(task_id), "%s:%s@%d", job->job_id, name, index);
+        }
+        task_id[sizeof(((task_assignment_t*)0)->task_id) - 1] = '\0'; // As stored in the table
+
+        if (!(journal_enabled && task_journal_is_completed(&journal, task_id)) &&
+            queue_task(job_slot, task_id, job->chunk_dir, frames ? index : -1, range.offset, range.length,
+                       TASK_LANE_BULK) == 0) {
+            queued++;
+        }
+        offset += range.length;
+        index++;
+    }
+    if (status < 0) {
+        printf("[Employer] Stopped splitting %s at offset %lld, the rest is not record aligned\n",
+               job->chunk_dir, (long long)offset);
+    }
+
+    printf("[Employer] Split %s (%zu bytes) into %d ranges, %d queued\n", job->chunk_dir, source->size, index, queued);
+    return queued;
+}
+
+// Scan a job's chunk directory for .json files and queue them as tasks
+static int populate_job_tasks(int job_slot) {
+
+    job_t *job = job_table_get(job_slot);
+    if (!job) return 0;
+    if (is_input_file_job(job)) return populate_job_ranges(job_slot);
+
+    DIR *dir = opendir(job->chunk_dir);
     if (!dir) {
         perror("opendir");
-        return;
+        return 0;
     }
+    int queued = 0;
     struct dirent *entry;
     while ((entry = readdir(dir)) != NULL) {
         if (strstr(entry->d_name, ".json")) {
-            char filepath[512];
-            snprintf(filepath, sizeof(filepath), "%s/%s", CHUNKED_SET_PATH, entry->d_name);
-
-            task_assignment_t assignment = {0};
-            strncpy(assignment.task_id, entry->d_name, sizeof(assignment.task_id) - 1);
-            strncpy(assignment.chunk_file, filepath, sizeof(assignment.chunk_file) - 1);
-            assignment.is_completed = false;
-            assignment.is_sent = false;
-            assignment.retry_count = 0;
-            // employee_id and employee_ip will be set when assigned
-            add_task_assignment(&assignment);
+            if (queue_job_chunk(job_slot, job->chunk_dir, entry->d_name) == 0) {
+                queued++;
+            }
         }
     }
     closedir(dir);
+    return queued;
+}
+
+// Scan CHUNKED_SET_PATH for .json files and queue them as tasks
+int populate_chunked_tasks() {
+    return populate_job_tasks(default_job_slot);
+}
+
+// Journal replay: restore jobs that were submitted before the restart
+static void replay_journal_job(const task_journal_job_t* entry) {
+
+    if (job_table_find(entry->job_id) >= 0) return; // Default job already exists
+
+    int job_slot = job_table_add(entry->job_id, entry->script_path, entry->chunk_dir, entry->runtime,
+                                 entry->priority, entry->weight);
+    if (job_slot < 0) {
+        printf("[Employer] Journal: could not restore job %s\n", entry->job_id);
+        return;
+    }
+    job_table_get(job_slot)->combine = entry->combine;
+    job_table_get(job_slot)->combine_batch = entry->combine_batch;
+    // Picks up chunks whose queued record was lost, finished ones are skipped
+    populate_job_tasks(job_slot);
+}
+
+// Journal replay: requeue unfinished tasks, account for finished ones and feed
+// their results back into the ordered stream
+static void replay_journal_task(const task_journal_entry_t* entry) {
+
+    int job_slot = job_table_find(entry->job_id);
+    job_t *job = job_table_get(job_slot);
+    if (!job) return;
+
+    if (!entry->completed) {
+        // Ranges of an input file are requeued when the file is split again
+        if (!is_input_file_job(job)) {
+            queue_task(job_slot, entry->task_id, entry->path, entry->frame_no, 0, 0, TASK_LANE_BULK);
+        }
+        return;
+    }
+
+    job->tasks_queued++;
+    job->tasks_completed++;
+    if (entry->frame_no < 0) return;
+    ensure_result_stream(job_slot);
+    if (!job->result_stream_enabled) return;
+
+    // Submitting now would stream this frame before the lower pending ones are
+    // expected; the journal hands finished tasks over in frame order
+    result_stream_expect(&job->result_stream, entry->frame_no);
+    if (replayed_result_count == replayed_result_capacity) {
+        int new_capacity = replayed_result_capacity ? replayed_result_capacity * 2 : 64;
+        replayed_result_t *grown = realloc(replayed_results, new_capacity * sizeof(replayed_result_t));
+        if (!grown) {
+            printf("[Employer] Journal: cannot hold frame %d of job %s for the stream\n", entry->frame_no, job->job_id);
+            return;
+        }
+        replayed_results = grown;
+        replayed_result_capacity = new_capacity;
+    }
+    replayed_result_t *replayed = &replayed_results[replayed_result_count++];
+    replayed->job_slot = job_slot;
+    replayed->frame_no = entry->frame_no;
+    strncpy(replayed->result_path, entry->path, sizeof(replayed->result_path) - 1);
+    replayed->result_path[sizeof(replayed->result_path) - 1] = '\0';
+}
+
+// Journal replay: stream the finished frames, after all pending frames were queued
+static void submit_replayed_results(void) {
+
+    for (int i = 0; i < replayed_result_count; i++) {
+        job_t *job = job_table_get(replayed_results[i].job_slot);
+        if (!job || !job->result_stream_enabled) continue;
+        result_stream_submit(&job->result_stream, replayed_results[i].frame_no, replayed_results[i].result_path);
+    }
+    free(replayed_results);
+    replayed_results = NULL;
+    replayed_result_count = 0;
+    replayed_result_capacity = 0;
+}
+
+// How much placing a task of job_slot (frame_no) on employee saves, in [0, 1]
+static double placement_affinity_of(const employee_node_t* employee, const job_t* job, int job_slot, int frame_no) {
+
+    double affinity = 0.0;
+    if (employee->warm_jobs & (1ULL << job_slot)) {
+        affinity += AFFINITY_WARM_RUNTIME;
+    } else if (employee_has_script(employee, job->script_hash)) {
+        affinity += AFFINITY_CACHED_SCRIPT;
+    }
+    int last_frame = employee->last_frame_no[job_slot];
+    if (frame_no >= 0 && last_frame >= 0 && abs(frame_no - last_frame) <= FRAME_NEIGHBOUR_DISTANCE) {
+        affinity += AFFINITY_FRAME_NEIGHBOUR;
+    }
+    return affinity > 1.0 ? 1.0 : affinity;
+}
+
+// Best employee with a free slot for a task: affinity (warm runtime, cached
+// script, neighbouring frames) traded against load by placement_affinity.
+// Caller holds employee_mutex.
+static employee_node_t* select_employee_for_placement(const job_t* job, int job_slot, int frame_no) {
+
+    employee_node_t* best = NULL;
+    double best_score = 0.0;
+    for (int j = 0; j < employee_count; j++) {
+        employee_node_t* candidate = employees[j];
+        if (candidate->sockfd < 0 || candidate->state != EMPLOYEE_STATE_CONFIGURED ||
+            candidate->active_tasks >= candidate->max_tasks) {
+            continue;
+        }
+        double load = (double)candidate->active_tasks / candidate->max_tasks;
+        double score = placement_affinity * placement_affinity_of(candidate, job, job_slot, frame_no)
+                     - (1.0 - placement_affinity) * load;
+        if (!best || score > best_score ||
+            (score == best_score && candidate->active_tasks < best->active_tasks)) {
+            best = candidate;
+            best_score = score;
+        }
+    }
+    return best;
+}
+
+// Hand out unassigned tasks to employees with free capacity. Each free slot
+// goes to the job chosen by weighted fair share (job_table_pick_next), so
+// chunks of concurrent jobs are interleaved by weight rather than by queue order.
+// The task is then placed where it is cheapest to run (see
+// select_employee_for_placement).
+static int assign_pending_tasks(void) {
+
+    bool blocked[MAX_JOBS] = { false }; // Jobs with nothing dispatchable this round
+    bool picked[MAX_TASK_ASSIGNMENTS] = { false }; // Placed this round, sent right after
+    int assigned = 0;
+
+    pthread_mutex_lock(&assignment_mutex);
+    pthread_mutex_lock(&employee_mutex);
+    for (;;) {
+        bool has_capacity = false;
+        for (int j = 0; j < employee_count && !has_capacity; j++) {
+            has_capacity = employees[j]->sockfd >= 0 && employees[j]->state == EMPLOYEE_STATE_CONFIGURED &&
+                           employees[j]->active_tasks < employees[j]->max_tasks;
+        }
+        if (!has_capacity) break;
+
+        int job_slot = job_table_pick_next(blocked);
+        if (job_slot < 0) break;
+        job_t *job = job_table_get(job_slot);
+
+        // Oldest unassigned task of that job
+        int task = -1;
+        for (int i = 0; i < assignment_count; i++) {
+            if (task_assignments[i].job_slot != job_slot || task_assignments[i].is_sent ||
+                task_assignments[i].is_completed || picked[i]) {
+                continue;
+            }
+            // Keep frames within the reorder window so buffered results stay bounded
+            if (job->result_stream_enabled && !result_stream_in_window(&job->result_stream, task_assignments[i].frame_no)) {
+                continue;
+            }
+            task = i;
+            break;
+        }
+        if (task < 0) {
+            blocked[job_slot] = true;
+            continue;
+        }
+
+        picked[task] = true;
+        int frame_no = task_assignments[task].frame_no;
+        employee_node_t* emp = select_employee_for_placement(job, job_slot, frame_no);
+        uint64_t job_bit = 1ULL << job_slot;
+        placement_stats.placements++;
+        if (emp->warm_jobs & job_bit) {
+            placement_stats.warm_placements++;
+        }
+        if (frame_no >= 0 && emp->last_frame_no[job_slot] >= 0 &&
+            abs(frame_no - emp->last_frame_no[job_slot]) <= FRAME_NEIGHBOUR_DISTANCE) {
+            placement_stats.neighbour_placements++;
+        }
+        // The runtime starts with the first chunk, later tasks in this round see it warm
+        emp->warm_jobs |= job_bit;
+        if (frame_no >= 0) {
+            emp->last_frame_no[job_slot] = frame_no;
+        }
+
+        strncpy(task_assignments[task].employee_id, emp->employee_id, sizeof(task_assignments[task].employee_id) - 1);
+        strncpy(task_assignments[task].employee_ip, emp->endpoint, sizeof(task_assignments[task].employee_ip) - 1);
+        task_assignments[task].assigned_time = time(NULL);
+        emp->active_tasks++;
+        job_table_charge(job_slot);
+        assigned++;
+        if (journal_enabled) {
+            task_journal_assigned(&journal, task_assignments[task].task_id, emp->endpoint);
+        }
+        printf("[Employer] Task %s (job %s) assigned to %s\n", task_assignments[task].task_id, job->job_id, emp->endpoint);
+    }
+    pthread_mutex_unlock(&employee_mutex);
+    pthread_mutex_unlock(&assignment_mutex);
+
+    return assigned;
+}
+
+// Control socket callback: queue the chunk set of a newly submitted job
+static int submit_job_tasks(int job_slot) {
+
+    if (journal_enabled) {
+        task_journal_job_added(&journal, job_table_get(job_slot));
+    }
+    return populate_job_tasks(job_slot);
+}
+
+// Write a combine job's merged result to results/<job_id>_combined.json
+static void write_combined_result(const job_t* job) {
+
+    cJSON *value = combine_tree_result(&job->combined);
+    cJSON *combined = cJSON_CreateObject();
+    cJSON_AddStringToObject(combined, "job_id", job->job_id);
+    cJSON_AddNumberToObject(combined, "tasks", job->tasks_completed);
+    cJSON_AddNumberToObject(combined, "partials", job->combined.partials);
+    if (value) cJSON_AddItemToObject(combined, "value", value);
+    char *text = cJSON_PrintUnformatted(combined);
+
+    char path[MAX_FILENAME_LEN * 2];
+    snprintf(path, sizeof(path), "%s/%s_combined.json", RESULTS_PATH, job->job_id);
+    FILE *file = text ? fopen(path, "w") : NULL;
+    if (file) {
+        fprintf(file, "%s\n", text);
+        fclose(file);
+        printf("[Employer] Job %s combined %d tasks from %ld partials (%lld KB received) into %s\n",
+               job->job_id, job->tasks_completed, job->combined.partials, job->result_bytes / 1024, path);
+    } else {
+        printf("[Employer] Failed to write the combined result of job %s\n", job->job_id);
+    }
+    free(text);
+    cJSON_Delete(combined);
+}
+
+// Retire jobs whose tasks are all done. The default job stays open in watch mode.
+static void finish_completed_jobs(bool watch_mode) {
+
+    for (int slot = 0; slot < MAX_JOBS; slot++) {
+        job_t *job = job_table_get(slot);
+        if (!job || job->state != JOB_STATE_ACTIVE) continue;
+        if (watch_mode && slot == default_job_slot) continue;
+        if (job->relayed) continue; // More chunks may come until the parent releases it
+        if (job->tasks_queued == 0 || job->tasks_completed < job->tasks_queued) continue;
+
+        job->state = JOB_STATE_DONE;
+        job->finish_time = time(NULL);
+        if (job->result_stream_enabled) {
+            result_stream_flush(&job->result_stream);
+        }
+        if (job->combine != COMBINE_NONE) {
+            write_combined_result(job);
+            combine_tree_cleanup(&job->combined);
+        }
+        printf("[Employer] Job %s finished: %d tasks in %ld s (makespan), %d runtime cold starts\n",
+               job->job_id, job->tasks_completed, (long)(job->finish_time - job->submit_time), job->cold_starts);
+        // The default job's chunks stay in CHUNKED_SET_PATH, so its completions are kept
+        if (journal_enabled && slot != default_job_slot) {
+            task_journal_job_done(&journal, job->job_id);
+        }
+        release_job_on_employees(slot);
+        chunk_source_close(&job_inputs[slot]);
+    }
+}
+
+// Queue the chunks and releases handed down by the parent employer
+static int drain_relay_inbox(void) {
+
+    static relay_request_t batch[RELAY_INBOX_SIZE];
+
+    char drain[64];
+    while (read(relay_wakeup[0], drain, sizeof(drain)) > 0) {
+    }
+
+    pthread_mutex_lock(&relay_mutex);
+    int count = relay_inbox_count;
+    memcpy(batch, relay_inbox, count * sizeof(relay_request_t));
+    relay_inbox_count = 0;
+    pthread_mutex_unlock(&relay_mutex);
+
+    int queued = 0;
+    for (int i = 0; i < count; i++) {
+        relay_request_t *request = &batch[i];
+        int slot = job_table_find(request->job_id);
+        job_t *job = job_table_get(slot);
+
+        if (request->release) {
+            if (!job || !job->relayed) continue;
+            job->relayed = false;
+            printf("[Employer] Parent released job %s\n", job->job_id);
+            if (job->tasks_queued == 0) {
+                job->state = JOB_STATE_DONE;
+                job->finish_time = time(NULL);
+            }
+            continue;
+        }
+
+        if (!job) {
+            // The job's chunks share the spool directory
+            char spool_dir[MAX_FILENAME_LEN];
+            snprintf(spool_dir, sizeof(spool_dir), "%s", request->chunk_path);
+            char *slash = strrchr(spool_dir, '/');
+            if (slash) *slash = '\0';
+            slot = job_table_add(request->job_id, request->script_path, slash ? spool_dir : ".",
+                                 script_runtime_name(request->engine), 0, 1);
+            job = job_table_get(slot);
+            if (!job) {
+                printf("[Employer] No room for relayed job %s, dropping chunk %s\n", request->job_id, request->task_id);
+                continue;
+            }
+        } else if (job->state == JOB_STATE_DONE) {
+            // Parent sent another run of a job retired here
+            job->state = JOB_STATE_ACTIVE;
+        }
+        if (strcmp(job->script_path, request->script_path) != 0) {
+            strncpy(job->script_path, request->script_path, sizeof(job->script_path) - 1);
+            job->script_hash[0] = '\0';
+            job->memo_config_set = false;
+        }
+        job->relayed = true;
+        job->combine = request->combine;
+        job->combine_batch = request->combine_batch;
+
+        if (queue_task(slot, request->task_id, request->chunk_path, request->frame_no, 0, 0, request->lane) == 0) {
+            queued++;
+        } else {
+            // Resent by the parent after a timeout, the first copy is still running here
+            printf("[Employer] Relayed task %s already queued\n", request->task_id);
+        }
+    }
+    return queued;
+}
+
+// Run as a relay below a parent employer: results of relayed jobs go to
+// on_result, no local jobs are started and the loop runs until stopped.
+// Call before employer_main_loop.
+int employer_enable_relay(employer_result_cb_t on_result) {
+
+    if (!on_result) return -1;
+    if (relay_wakeup[0] < 0 && pipe2(relay_wakeup, O_NONBLOCK | O_CLOEXEC) != 0) {
+        perror("[Employer] relay pipe");
+        return -1;
+    }
+    relay_result_cb = on_result;
+    relay_mode = true;
+    return 0;
+}
+
+static int relay_enqueue(const relay_request_t* request) {
+
+    pthread_mutex_lock(&relay_mutex);
+    if (relay_inbox_count >= RELAY_INBOX_SIZE) {
+        pthread_mutex_unlock(&relay_mutex);
+        return -1;
+    }
+    relay_inbox[relay_inbox_count++] = *request;
+    pthread_mutex_unlock(&relay_mutex);
+
+    char wake = 1;
+    if (write(relay_wakeup[1], &wake, 1) < 0 && errno != EAGAIN) {
+        perror("[Employer] relay wakeup");
+    }
+    return 0;
+}
+
+// Queue a chunk received from the parent as a task of job_id. Thread safe.
+int employer_relay_submit(const char* job_id, const char* script_path, script_runtime_t engine,
+                          combine_kind_t combine, int combine_batch, const char* task_id, const char* chunk_path,
+                          int frame_no, task_lane_t lane) {
+
+    if (!relay_mode || !job_id || !script_path || !task_id || !chunk_path) return -1;
+
+    relay_request_t request = {0};
+    strncpy(request.job_id, job_id, sizeof(request.job_id) - 1);
+    strncpy(request.script_path, script_path, sizeof(request.script_path) - 1);
+    request.engine = engine;
+    strncpy(request.task_id, task_id, sizeof(request.task_id) - 1);
+    strncpy(request.chunk_path, chunk_path, sizeof(request.chunk_path) - 1);
+    request.frame_no = frame_no;
+    request.lane = lane;
+    request.combine = combine;
+    request.combine_batch = combine_batch;
+    return relay_enqueue(&request);
+}
+
+// The parent will send no more chunks of job_id. Thread safe.
+int employer_relay_release(const char* job_id) {
+
+    if (!relay_mode || !job_id) return -1;
+
+    relay_request_t request = {0};
+    strncpy(request.job_id, job_id, sizeof(request.job_id) - 1);
+    request.release = true;
+    return relay_enqueue(&request);
+}
+
+// Task slots of all connected employees, advertised to the parent
+int employer_relay_capacity(void) {
+
+    int slots = 0;
+    pthread_mutex_lock(&employee_mutex);
+    for (int i = 0; i < employee_count; i++) {
+        if (employees[i]->sockfd >= 0) {
+            slots += employees[i]->max_tasks;
+        }
+    }
+    pthread_mutex_unlock(&employee_mutex);
+    return slots;
+}
+
+void employer_request_stop(void) {
+
+    agent_status.is_active = false;
 }
 
 // Main employer loop - refactored for continuous discovery and dynamic task queue
 void* employer_main_loop(void* arg) {
     (void)arg; // Unused
 
-    // Scan chunked set directory and queue all .json files as tasks
-    populate_chunked_tasks();
+    for (int slot = 0; slot < MAX_JOBS; slot++) {
+        job_inputs[slot].fd = -1;
+    }
+
+    memset(&placement_stats, 0, sizeof(placement_stats));
+    const char *affinity_setting = get_volcom_config_value("placement_affinity");
+    if (affinity_setting) {
+        placement_affinity = atof(affinity_setting);
+        if (placement_affinity < 0.0) placement_affinity = 0.0;
+        if (placement_affinity > 1.0) placement_affinity = 1.0;
+    }
+    const char *weight_setting = get_volcom_config_value("share_weight");
+    if (weight_setting && atoi(weight_setting) >= 1) {
+        share_weight = atoi(weight_setting);
+    }
+
+    // The default job reads either the chunk directory or, with input_file set,
+    // record-aligned ranges of a single input file
+    const char *input_file = get_volcom_config_value("input_file");
+
+    // In watch mode the chunk directory is a spool queue: the watch is set up
+    // before the initial scan so nothing written in between is missed, and the
+    // employer keeps running after the current backlog drains.
+    const char *ingest_mode = get_volcom_config_value("ingest_mode");
+    bool watch_mode = !relay_mode && !input_file && ingest_mode && strcmp(ingest_mode, "watch") == 0;
+    task_ingest_t ingest;
+    ingest.inotify_fd = -1;
+    if (watch_mode && task_ingest_init(&ingest, CHUNKED_SET_PATH) != 0) {
+        printf("[Employer] Falling back to a one-shot scan of %s\n", CHUNKED_SET_PATH);
+        watch_mode = false;
+    }
+
+    // The chunk directory is the default job; more jobs arrive on the control
+    // socket. A relay only runs the jobs its parent hands down.
+    const char *default_script = get_volcom_config_value("default_job_script");
+    const char *default_runtime = get_volcom_config_value("default_job_runtime");
+    script_runtime_t default_engine;
+    if (default_runtime && script_runtime_parse(default_runtime, &default_engine) != 0) {
+        printf("[Employer] Unknown runtime '%s' for the default job, choosing by its script\n", default_runtime);
+        default_runtime = NULL;
+    }
+    if (!relay_mode) {
+        default_job_slot = job_table_add(DEFAULT_JOB_ID, default_script ? default_script : DEFAULT_JOB_SCRIPT,
+                                         input_file ? input_file : CHUNKED_SET_PATH, default_runtime, 0, 1);
+        job_t *default_job = job_table_get(default_job_slot);
+        const char *combine_setting = get_volcom_config_value("combine");
+        const char *batch_setting = get_volcom_config_value("combine_batch");
+        if (default_job && combine_setting && combine_parse(combine_setting, &default_job->combine) != 0) {
+            printf("[Employer] Unknown combine function '%s', keeping per-chunk results\n", combine_setting);
+        }
+        if (default_job) {
+            default_job->combine_batch = (batch_setting && atoi(batch_setting) > 0) ? atoi(batch_setting) : COMBINE_BATCH;
+        }
+    }
+
+    // Resume from the journal: restore jobs, requeue unfinished tasks and skip
+    // finished ones when the chunk directory is scanned below
+    mkdir(RESULTS_PATH, 0777);
+
+    // Results of earlier runs let repeated chunks complete without dispatch
+    const char *cache_setting = get_volcom_config_value("result_cache");
+    if (!relay_mode && (!cache_setting || strcmp(cache_setting, "off") != 0)) {
+        const char *cache_dir = get_volcom_config_value("result_cache_dir");
+        const char *cache_mb = get_volcom_config_value("result_cache_mb");
+        size_t cache_bytes = (size_t)(cache_mb && atoi(cache_mb) > 0 ? atoi(cache_mb) : RESULT_CACHE_MB) * 1024 * 1024;
+        result_cache_enabled = result_cache_open(&result_cache, cache_dir ? cache_dir : RESULT_CACHE_PATH,
+                                                 cache_bytes) == 0;
+    }
+
+    const char *journal_setting = get_volcom_config_value("journal");
+    if (!relay_mode && (!journal_setting || strcmp(journal_setting, "off") != 0)) {
+        const char *journal_path = get_volcom_config_value("journal_path");
+        if (task_journal_open(&journal, journal_path ? journal_path : JOURNAL_PATH) == 0) {
+            journal_enabled = true;
+            task_journal_replay(&journal, replay_journal_job, replay_journal_task);
+        } else {
+            printf("[Employer] Running without a journal, a restart will recompute all tasks\n");
+        }
+    }
+
+    // Scan chunked set directory (or split the input file) and queue the tasks
+    if (watch_mode) {
+        task_ingest_scan(&ingest, queue_chunk_file);
+    } else if (!relay_mode) {
+        populate_chunked_tasks();
+    }
+    submit_replayed_results();
 
     int discovery_sockfd;
     struct sockaddr_in addr;
@@ -608,11 +1988,13 @@ void* employer_main_loop(void* arg) {
         return NULL;
     }
 
-    // Bind socket
+    // Bind socket. Relays and their parent on one host listen on different ports.
+    const char *port_setting = get_volcom_config_value("discovery_port");
+    int discovery_port = port_setting ? atoi(port_setting) : PORT;
     memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = INADDR_ANY;
-    addr.sin_port = htons(PORT);
+    addr.sin_port = htons(discovery_port);
 
     if (bind(discovery_sockfd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
         perror("bind");
@@ -620,7 +2002,7 @@ void* employer_main_loop(void* arg) {
         return NULL;
     }
 
-    printf("[Employer] Listening for employee broadcasts on port %d\n", PORT);
+    printf("[Employer] Listening for employee broadcasts on port %d\n", discovery_port);
 
     agent_status.mode = AGENT_MODE_EMPLOYER;
     agent_status.start_time = time(NULL);
@@ -632,6 +2014,10 @@ void* employer_main_loop(void* arg) {
     time_t last_status_update = time(NULL);
     int completed_tasks_count = 0;
 
+    const char *control_path = get_volcom_config_value("control_socket");
+    if (!control_path) control_path = CONTROL_SOCKET_PATH;
+    int control_fd = relay_mode ? -1 : job_control_listen(control_path);
+
     // Main loop for continuous discovery and task management
     while (agent_status.is_active) {
         fd_set readfds;
@@ -640,6 +2026,21 @@ void* employer_main_loop(void* arg) {
         FD_SET(discovery_sockfd, &readfds); // Add UDP listener
         int max_fd = discovery_sockfd;
 
+        if (watch_mode && ingest.inotify_fd >= 0) {
+            FD_SET(ingest.inotify_fd, &readfds); // New chunk files
+            if (ingest.inotify_fd > max_fd) max_fd = ingest.inotify_fd;
+        }
+
+        if (control_fd >= 0) {
+            FD_SET(control_fd, &readfds); // Job submissions
+            if (control_fd > max_fd) max_fd = control_fd;
+        }
+
+        if (relay_mode) {
+            FD_SET(relay_wakeup[0], &readfds); // Chunks from the parent employer
+            if (relay_wakeup[0] > max_fd) max_fd = relay_wakeup[0];
+        }
+
         // Add all active employee sockets to the set
         pthread_mutex_lock(&employee_mutex);
         for (int i = 0; i < employee_count; i++) {
@@ -683,13 +2084,36 @@ void* employer_main_loop(void* arg) {
             }
         }
 
+        // 1b. Turn newly arrived chunk files into tasks
+        if (watch_mode && ingest.inotify_fd >= 0 && activity > 0 && FD_ISSET(ingest.inotify_fd, &readfds)) {
+            int queued = task_ingest_process_events(&ingest, queue_chunk_file);
+            if (ingest.overflowed) {
+                ingest.overflowed = false;
+                int rescanned = task_ingest_scan(&ingest, queue_chunk_file);
+                if (rescanned > 0) queued += rescanned;
+            }
+            if (queued > 0) {
+                printf("[Employer] Ingested %d new chunk file(s)\n", queued);
+            }
+        }
+
+        // 1c. Accept job submissions
+        if (control_fd >= 0 && activity > 0 && FD_ISSET(control_fd, &readfds)) {
+            job_control_handle(control_fd, submit_job_tasks);
+        }
+
+        // 1d. Queue chunks handed down by the parent employer
+        if (relay_mode && activity > 0 && FD_ISSET(relay_wakeup[0], &readfds)) {
+            drain_relay_inbox();
+        }
+
         // 2. Check for incoming results from employees
         pthread_mutex_lock(&employee_mutex);
         for (int i = 0; i < employee_count; i++) {
             if (employees[i]->sockfd >= 0 && FD_ISSET(employees[i]->sockfd, &readfds)) {
                 if (receive_result_from_employee(employees[i]) != 0) {
                     // Handle error/disconnection
-                    printf("[Employer] Connection lost with employee %s while receiving result.\n", employees[i]->ip_address);
+                    printf("[Employer] Connection lost with employee %s while receiving result.\n", employees[i]->endpoint);
                     close(employees[i]->sockfd);
                     employees[i]->sockfd = -1;
                 }
@@ -697,50 +2121,41 @@ void* employer_main_loop(void* arg) {
         }
         pthread_mutex_unlock(&employee_mutex);
 
-        // 3. Send initial configs to new employees
+        // 3. New or reconnected employees host no job runtimes yet; each job's
+        //    config is shipped with its first chunk (see send_pending_tasks)
         pthread_mutex_lock(&employee_mutex);
         for (int i = 0; i < employee_count; i++) {
-            if (employees[i]->sockfd >= 0) {
-                if (employees[i]->state == EMPLOYEE_STATE_NEW) {
-                    if (send_initial_config(employees[i]) != 0) {
-                        printf("[Employer] Failed to send initial config to %s. Marking as failed.\n", employees[i]->ip_address);
-                        close(employees[i]->sockfd);
-                        employees[i]->sockfd = -1; // Mark as disconnected
-                    }
-                }
+            if (employees[i]->sockfd >= 0 && employees[i]->state == EMPLOYEE_STATE_NEW) {
+                reset_employee_affinity(employees[i]);
+                employees[i]->state = EMPLOYEE_STATE_CONFIGURED;
             }
         }
         pthread_mutex_unlock(&employee_mutex);
 
-        // 4. Assign unassigned tasks to available employees
-        pthread_mutex_lock(&assignment_mutex);
-        for (int i = 0; i < assignment_count; i++) {
-            if (!task_assignments[i].is_sent && !task_assignments[i].is_completed) {
-                // Find an available employee
-                pthread_mutex_lock(&employee_mutex);
-                for (int j = 0; j < employee_count; j++) {
-                    employee_node_t* emp = employees[j];
-                    if (emp->sockfd >= 0 && emp->state == EMPLOYEE_STATE_CONFIGURED && emp->active_tasks < 3) {
-                        // Assign task to this employee
-                        strncpy(task_assignments[i].employee_id, emp->employee_id, sizeof(task_assignments[i].employee_id) - 1);
-                        strncpy(task_assignments[i].employee_ip, emp->ip_address, sizeof(task_assignments[i].employee_ip) - 1);
-                        task_assignments[i].assigned_time = time(NULL);
-                        emp->active_tasks++;
-                        printf("[Employer] Task %s assigned to %s\n", task_assignments[i].task_id, emp->ip_address);
-                        break;
-                    }
-                }
-                pthread_mutex_unlock(&employee_mutex);
-            }
-        }
-        pthread_mutex_unlock(&assignment_mutex);
+        // 4. Assign unassigned tasks to available employees (weighted fair share across jobs)
+        assign_pending_tasks();
 
         // 5. Manage Ongoing Tasks
         send_pending_tasks();
         handle_task_timeouts();
 
-        // 6. Maintain Employee List
+        // 6. Maintain Employee List and retire finished jobs
         remove_stale_employees();
+        finish_completed_jobs(watch_mode);
+
+        // Results a full stream sink held back go out once the reader catches up
+        for (int slot = 0; slot < MAX_JOBS; slot++) {
+            job_t *job = job_table_get(slot);
+            if (job && job->result_stream_enabled) result_stream_flush(&job->result_stream);
+        }
+
+        // Make this round's journal records durable (batched)
+        if (journal_enabled) {
+            task_journal_sync(&journal, false);
+        }
+        if (result_cache_enabled) {
+            result_cache_sync(&result_cache, false);
+        }
 
         // 7. Report Status
         completed_tasks_count = count_completed_tasks();
@@ -749,11 +2164,59 @@ void* employer_main_loop(void* arg) {
         if (current_time - last_status_update >= 10) {
             printf("[Employer] Status: %d employees | %d/%d tasks completed.\n", 
                    employee_count, completed_tasks_count, total_task_count);
+            if (result_frames_received > 0) {
+                printf("[Employer] Results: %ld in %ld frames\n", results_received, result_frames_received);
+            }
+            if (result_cache_enabled) {
+                result_cache_print_stats(&result_cache);
+            }
+            if (watch_mode) {
+                task_ingest_record(&ingest, 0);
+                printf("[Employer] Intake: %ld files ingested | %.2f files/s | backlog %d tasks\n",
+                       ingest.files_ingested, ingest.intake_rate,
+                       total_task_count - completed_tasks_count);
+            }
+            if (watch_mode || relay_mode) {
+                compact_completed_assignments();
+            }
+            if (placement_stats.placements > 0) {
+                printf("[Employer] Placement: %ld tasks | %.0f%% on warm runtimes, %.0f%% next to earlier frames | "
+                       "%ld cold starts, %ld script transfers, %ld served from employee cache (%ld missing)\n",
+                       placement_stats.placements,
+                       100.0 * placement_stats.warm_placements / placement_stats.placements,
+                       100.0 * placement_stats.neighbour_placements / placement_stats.placements,
+                       placement_stats.cold_starts, placement_stats.script_transfers, placement_stats.script_cache_hits,
+                       placement_stats.script_cache_misses);
+            }
+            if (journal_enabled) {
+                task_journal_maybe_compact(&journal);
+                printf("[Employer] Journal: %ld records since compaction, %ld syncs, %ld compactions\n",
+                       journal.records_written, journal.syncs, journal.compactions);
+            }
+            for (int slot = 0; slot < MAX_JOBS; slot++) {
+                job_t *job = job_table_get(slot);
+                if (!job || job->state != JOB_STATE_ACTIVE) continue;
+                printf("[Employer] Job %s: priority %d, weight %d | %d/%d tasks completed, %d dispatches\n",
+                       job->job_id, job->priority, job->weight, job->tasks_completed, job->tasks_queued,
+                       job->tasks_dispatched);
+                if (job->result_stream_enabled) {
+                    printf("[Employer] Job %s result stream: %ld frames streamed, %d waiting on earlier frames\n",
+                           job->job_id, job->result_stream.frames_streamed, result_stream_pending(&job->result_stream));
+                }
+                if (job->combine != COMBINE_NONE) {
+                    printf("[Employer] Job %s combine: %ld partials merged, %lld KB of results received\n",
+                           job->job_id, job->combined.partials, job->result_bytes / 1024);
+                    // A watched default job never finishes, keep its combined file current
+                    if (watch_mode && slot == default_job_slot && !job->relayed) {
+                        write_combined_result(job);
+                    }
+                }
+            }
             last_status_update = current_time;
         }
 
-        // 8. Check for Completion
-        if (total_task_count > 0 && completed_tasks_count >= total_task_count) {
+        // 8. Check for Completion (watch mode and relays run until stopped)
+        if (!watch_mode && !relay_mode && job_table_active_count() == 0) {
             printf("[Employer] All tasks completed! Shutting down in 10 seconds.\n");
             sleep(10);
             agent_status.is_active = false;
@@ -773,6 +2236,32 @@ void* employer_main_loop(void* arg) {
     employee_count = 0;
     pthread_mutex_unlock(&employee_mutex);
 
+    if (watch_mode) {
+        task_ingest_cleanup(&ingest);
+    }
+
+    job_control_close(control_fd, control_path);
+    job_table_cleanup();
+    for (int slot = 0; slot < MAX_JOBS; slot++) {
+        chunk_source_close(&job_inputs[slot]);
+    }
+    if (journal_enabled) {
+        task_journal_close(&journal);
+        journal_enabled = false;
+    }
+    if (result_cache_enabled) {
+        result_cache_print_stats(&result_cache);
+        result_cache_close(&result_cache);
+        result_cache_enabled = false;
+    }
+    default_job_slot = -1;
+    if (relay_mode) {
+        close(relay_wakeup[0]);
+        close(relay_wakeup[1]);
+        relay_wakeup[0] = relay_wakeup[1] = -1;
+        relay_mode = false;
+    }
+
     close(discovery_sockfd);
     return NULL;
 }
@@ -801,6 +2290,7 @@ int run_employer_mode(char* task_files[]) {
     (void)task_files; // No longer used
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    signal(SIGPIPE, SIG_IGN); // A result stream reader that exits shows up as a failed write
 
     agent_status.is_active = true;
 
@@ -3,6 +3,25 @@
 
 #define _GNU_SOURCE
 
+#include "../volcom_agents.h"
+
+// Called by a relay's main loop for every result of a job its parent handed down.
+// Combine jobs report RESULT_KIND_ACK per chunk (no chunk or result path) and
+// RESULT_KIND_PARTIAL per uploaded partial (task_id names the partial).
+typedef void (*employer_result_cb_t)(const char* job_id, const char* task_id, const char* chunk_path,
+                                     const char* result_path, result_kind_t kind, int task_count);
+
 int run_employer_mode(char* task_files[]);
+void* employer_main_loop(void* arg);
+void employer_request_stop(void);
+
+// Relay mode: this employer takes its jobs from a parent employer
+int employer_enable_relay(employer_result_cb_t on_result);
+int employer_relay_submit(const char* job_id, const char* script_path, script_runtime_t engine,
+                          combine_kind_t combine, int combine_batch, const char* task_id, const char* chunk_path,
+                          int frame_no, task_lane_t lane);
+int employer_relay_release(const char* job_id);
+int employer_relay_capacity(void);
+int run_relay_mode(void);
 
-#endif
\ No newline at end of file
+#endif
@@ -2,49 +2,104 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
 
 // Task Buffer Implementation
 int init_task_buffer(task_buffer_t* buffer, int capacity) {
-    if (!buffer) return -1;
+    if (!buffer || capacity <= 0) return -1;
     buffer->tasks = malloc(sizeof(received_task_t) * capacity);
-    if (!buffer->tasks) return -1;
+    buffer->next = malloc(sizeof(int) * capacity);
+    if (!buffer->tasks || !buffer->next) {
+        free(buffer->tasks);
+        free(buffer->next);
+        buffer->tasks = NULL;
+        buffer->next = NULL;
+        return -1;
+    }
     buffer->capacity = capacity;
-    buffer->head = 0;
-    buffer->tail = 0;
+    for (int slot = 0; slot < capacity; slot++) {
+        buffer->next[slot] = slot + 1 < capacity ? slot + 1 : -1;
+    }
+    buffer->free_slot = 0;
+    for (int lane = 0; lane < TASK_LANE_COUNT; lane++) {
+        buffer->head[lane] = -1;
+        buffer->tail[lane] = -1;
+        buffer->lane_count[lane] = 0;
+        buffer->passed[lane] = 0;
+        buffer->taken[lane] = 0;
+    }
     buffer->count = 0;
+    buffer->wakeups = 0;
     pthread_mutex_init(&buffer->mutex, NULL);
+    pthread_cond_init(&buffer->changed, NULL);
     return 0;
 }
 
 void cleanup_task_buffer(task_buffer_t* buffer) {
     if (buffer && buffer->tasks) {
         free(buffer->tasks);
+        free(buffer->next);
         pthread_mutex_destroy(&buffer->mutex);
+        pthread_cond_destroy(&buffer->changed);
     }
 }
 
 int add_task_to_buffer(task_buffer_t* buffer, const received_task_t* task) {
     pthread_mutex_lock(&buffer->mutex);
-    if (buffer->count >= buffer->capacity) {
+    int slot = buffer->free_slot;
+    if (slot < 0) {
         pthread_mutex_unlock(&buffer->mutex);
         return -1; // Buffer full
     }
-    buffer->tasks[buffer->head] = *task;
-    buffer->head = (buffer->head + 1) % buffer->capacity;
+    int lane = (int)task->lane;
+    if (lane < 0 || lane >= TASK_LANE_COUNT) lane = TASK_LANE_BULK;
+    buffer->free_slot = buffer->next[slot];
+    buffer->tasks[slot] = *task;
+    buffer->next[slot] = -1;
+    if (buffer->head[lane] < 0) buffer->head[lane] = slot;
+    else buffer->next[buffer->tail[lane]] = slot;
+    buffer->tail[lane] = slot;
+    buffer->lane_count[lane]++;
     buffer->count++;
+    pthread_cond_broadcast(&buffer->changed);
     pthread_mutex_unlock(&buffer->mutex);
     return 0;
 }
 
+// Take the next task, the buffer is locked and not empty. The highest waiting
+// lane is served unless a lane has been passed over too often, then the one
+// passed over the most (the higher one on a tie).
+static void take_task_locked(task_buffer_t* buffer, received_task_t* task) {
+    int lane = -1;
+    for (int i = TASK_LANE_COUNT - 1; i >= 0; i--) {
+        if (buffer->lane_count[i] == 0) continue;
+        if (lane < 0) lane = i;
+        if (buffer->passed[i] >= TASK_LANE_STARVE_LIMIT && buffer->passed[i] > buffer->passed[lane]) lane = i;
+    }
+    for (int i = 0; i < TASK_LANE_COUNT; i++) {
+        if (i != lane && buffer->lane_count[i] > 0) buffer->passed[i]++;
+    }
+    buffer->passed[lane] = 0;
+    buffer->taken[lane]++;
+
+    int slot = buffer->head[lane];
+    *task = buffer->tasks[slot];
+    buffer->head[lane] = buffer->next[slot];
+    buffer->next[slot] = buffer->free_slot;
+    buffer->free_slot = slot;
+    buffer->lane_count[lane]--;
+    buffer->count--;
+}
+
 int get_task_from_buffer(task_buffer_t* buffer, received_task_t* task) {
     pthread_mutex_lock(&buffer->mutex);
     if (buffer->count == 0) {
         pthread_mutex_unlock(&buffer->mutex);
         return -1; // Buffer empty
     }
-    *task = buffer->tasks[buffer->tail];
-    buffer->tail = (buffer->tail + 1) % buffer->capacity;
-    buffer->count--;
+    take_task_locked(buffer, task);
     pthread_mutex_unlock(&buffer->mutex);
     return 0;
 }
@@ -56,6 +111,121 @@ bool is_task_buffer_empty(const task_buffer_t* buffer) {
     return is_empty;
 }
 
+int get_task_buffer_count(const task_buffer_t* buffer) {
+    pthread_mutex_lock((pthread_mutex_t*)&buffer->mutex);
+    int count = buffer->count;
+    pthread_mutex_unlock((pthread_mutex_t*)&buffer->mutex);
+    return count;
+}
+
+// Blocking consumers: read task_buffer_wakeups before checking whatever
+// wake_task_buffer announces (a connection, a stop), then wait with it; a
+// wake in between makes the wait return at once instead of being missed.
+unsigned long task_buffer_wakeups(task_buffer_t* buffer) {
+    pthread_mutex_lock(&buffer->mutex);
+    unsigned long wakeups = buffer->wakeups;
+    pthread_mutex_unlock(&buffer->mutex);
+    return wakeups;
+}
+
+// Take the next task, waiting up to timeout_ms for one. Returns -1 on timeout
+// or a wake since wakeups was read.
+int wait_task_from_buffer(task_buffer_t* buffer, received_task_t* task, unsigned long wakeups, int timeout_ms) {
+    struct timespec deadline;
+    deadline_after_ms(&deadline, timeout_ms);
+    pthread_mutex_lock(&buffer->mutex);
+    while (buffer->count == 0) {
+        if (buffer->wakeups != wakeups ||
+            pthread_cond_timedwait(&buffer->changed, &buffer->mutex, &deadline) == ETIMEDOUT) {
+            pthread_mutex_unlock(&buffer->mutex);
+            return -1;
+        }
+    }
+    take_task_locked(buffer, task);
+    pthread_mutex_unlock(&buffer->mutex);
+    return 0;
+}
+
+// Wait for a wake since wakeups was read, ignoring tasks
+void wait_task_buffer_wakeup(task_buffer_t* buffer, unsigned long wakeups, int timeout_ms) {
+    struct timespec deadline;
+    deadline_after_ms(&deadline, timeout_ms);
+    pthread_mutex_lock(&buffer->mutex);
+    while (buffer->wakeups == wakeups) {
+        if (pthread_cond_timedwait(&buffer->changed, &buffer->mutex, &deadline) == ETIMEDOUT) break;
+    }
+    pthread_mutex_unlock(&buffer->mutex);
+}
+
+void wake_task_buffer(task_buffer_t* buffer) {
+    pthread_mutex_lock(&buffer->mutex);
+    buffer->wakeups++;
+    pthread_cond_broadcast(&buffer->changed);
+    pthread_mutex_unlock(&buffer->mutex);
+}
+
+// Lane names as carried in data_chunk metadata
+int task_lane_parse(const char* name, task_lane_t* lane) {
+    if (!name || !lane) return -1;
+    for (int i = 0; i < TASK_LANE_COUNT; i++) {
+        if (strcmp(name, task_lane_name((task_lane_t)i)) == 0) {
+            *lane = (task_lane_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char* task_lane_name(task_lane_t lane) {
+    switch (lane) {
+        case TASK_LANE_URGENT: return "urgent";
+        case TASK_LANE_RETRY: return "retry";
+        default: return "bulk";
+    }
+}
+
+// Runtime names as carried in initial_config metadata and job requests
+int script_runtime_parse(const char* name, script_runtime_t* engine) {
+    if (!name || !engine) return -1;
+    for (int i = 0; i < SCRIPT_RUNTIME_COUNT; i++) {
+        if (strcmp(name, script_runtime_name((script_runtime_t)i)) == 0) {
+            *engine = (script_runtime_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char* script_runtime_name(script_runtime_t engine) {
+    switch (engine) {
+        case SCRIPT_RUNTIME_NATIVE: return "native";
+        case SCRIPT_RUNTIME_QUICKJS: return "quickjs";
+        default: return "node";
+    }
+}
+
+// Script hashes in initial_config are SHA-256 in lowercase hex. Employees and
+// relays name cached scripts after them, so both accept exactly this form.
+bool is_script_hash(const char* value) {
+    if (!value || strlen(value) != SHA256_HEX_LEN) return false;
+    for (size_t i = 0; i < SHA256_HEX_LEN; i++) {
+        if (!isdigit((unsigned char)value[i]) && (value[i] < 'a' || value[i] > 'f')) return false;
+    }
+    return true;
+}
+
+// Ask the employer to send a script again that it announced as cached but
+// that is missing or changed here; it answers with a full initial_config
+int send_script_missing(int sockfd, const char* job_id, const char* script_hash) {
+    cJSON *message = cJSON_CreateObject();
+    cJSON_AddStringToObject(message, "type", "script_missing");
+    cJSON_AddStringToObject(message, "job_id", job_id);
+    cJSON_AddStringToObject(message, "script_hash", script_hash);
+    protocol_status_t status = send_json(sockfd, message);
+    cJSON_Delete(message);
+    return status == PROTOCOL_OK ? 0 : -1;
+}
+
 // Result Queue Implementation
 int init_result_queue(result_queue_t* queue, int capacity) {
     if (!queue) return -1;
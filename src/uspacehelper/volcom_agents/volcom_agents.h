@@ -6,12 +6,54 @@
 #include <stdbool.h>
 #include <time.h>
 #include <pthread.h>
+#include <sys/types.h>
 #include <netinet/in.h> // For INET_ADDRSTRLEN
+#include "../volcom_net/volcom_net.h" // For unix_socket_conn_t
+#include "../volcom_utils/volcom_utils.h" // For pool_buffer_t
 
 #define MAX_FILENAME_LEN 256
 #define MAX_EMPLOYEES 100
 #define MAX_TASK_ASSIGNMENTS 1000
 #define TASK_TIMEOUT_SECONDS 300 // 5 minutes
+#define MAX_JOBS 64 // Fits the per-employee configured_jobs bitmask
+#define DEFAULT_JOB_ID "default"
+#define MAX_CACHED_SCRIPTS 16 // Script hashes remembered per employee
+#define COMBINE_BATCH 32 // Default chunks folded into one partial by an employee
+#define COMBINE_FLUSH_SECONDS 5 // An idle employee uploads its partial after this long
+#define COMBINE_TREE_LEVELS 32
+#define TASK_LANE_STARVE_LIMIT 8 // Picks a waiting lane can be passed over before it is served
+
+struct cJSON;
+
+// Combine functions for map-reduce jobs (combine.c)
+typedef enum {
+    COMBINE_NONE,
+    COMBINE_MERGE           // Structural JSON merge: sum numbers, concat arrays, min/max keys
+} combine_kind_t;
+
+// Partials merged pairwise like a binary counter, levels[i] aggregates 2^i partials
+typedef struct {
+    struct cJSON* levels[COMBINE_TREE_LEVELS];
+    long partials;
+} combine_tree_t;
+
+// Priority lanes of an employee's chunk buffer, higher lanes are taken first.
+// Bulk is 0 so that zeroed tasks and older employers land in it.
+typedef enum {
+    TASK_LANE_BULK,
+    TASK_LANE_RETRY,        // Resent after a timeout or a lost connection
+    TASK_LANE_URGENT,       // Jobs with a positive priority
+    TASK_LANE_COUNT
+} task_lane_t;
+
+// What runs a job's script on the employee. Node is 0, the runtime of jobs
+// from employers that do not say.
+typedef enum {
+    SCRIPT_RUNTIME_NODE,
+    SCRIPT_RUNTIME_NATIVE,  // Shared object built against volcom_plugin.h
+    SCRIPT_RUNTIME_QUICKJS, // Embedded VM (quickjs_runtime.c), Node with volcom_runner.js when built without it
+    SCRIPT_RUNTIME_COUNT
+} script_runtime_t;
 
 // Structure to hold information about a received task
 typedef struct received_task_s {
@@ -23,6 +65,14 @@ typedef struct received_task_s {
     time_t received_time;
     bool is_processed;
     int frame_no; // Frame number for image/video tasks, -1 if not provided
+    char job_id[64]; // Job the task belongs to (DEFAULT_JOB_ID if not provided)
+    task_lane_t lane;     // data_chunk only: chunk buffer lane
+    char script_hash[SHA256_HEX_LEN + 1]; // initial_config only: SHA-256 of the script in hex
+    bool script_cached;   // initial_config only: no payload, load the script by hash
+    script_runtime_t engine; // initial_config only: what runs the script
+    combine_kind_t combine; // initial_config only: fold results into partials
+    int combine_batch;      // initial_config only: chunks per partial
+    pool_buffer_t* data_buffer; // data_chunk only: pool buffer holding data, passed to the runtime by descriptor when it has a memfd
 } received_task_t;
 
 // Agent modes
@@ -61,7 +111,11 @@ int stop_resource_broadcasting(void);
 int listen_for_tasks(void);
 int process_received_task(const received_task_t* task);
 int send_task_result(const char* task_id, const char* result_file);
-int send_file_to_employee(int sockfd, const char* filepath, const char* task_id, const char* employee_ip);
+int send_file_to_employee(int sockfd, const char* filepath, const char* task_id, const char* employee_ip,
+                          int frame_no, const char* job_id, task_lane_t lane);
+struct volcom_rcsmngr_s;
+pid_t run_plugin_in_cgroup(struct volcom_rcsmngr_s *manager, const char *job_id, script_runtime_t engine,
+                           const char *plugin_path, const char *socket_path, int ready_fd);
 
 // Employer-specific functions
 // Forward-declare structs that depend on each other
@@ -78,33 +132,138 @@ typedef enum {
 typedef struct employee_node_s {
     char employee_id[64];
     char ip_address[INET_ADDRSTRLEN];
+    int port;                 // TCP port the employee (or relay) listens on
+    char endpoint[INET_ADDRSTRLEN + 8]; // "ip:port", identifies the node
     time_t last_seen;
     int active_tasks;
+    int max_tasks;            // Concurrent tasks the node accepts (relays advertise more)
+    long cold_start_ms;       // Its latest runtime's time to first ready worker, -1 if not reported
     int reliability_score;
     int tasks_completed;
     int tasks_failed;
     bool is_available;
     int sockfd; // Persistent socket connection
     employee_state_t state; // Current state of the employee
+    uint64_t configured_jobs; // Bit per job slot whose runtime config was shipped
+    // Placement affinity
+    uint64_t warm_jobs;       // Bit per job slot with a runtime started or starting
+    char cached_scripts[MAX_CACHED_SCRIPTS][SHA256_HEX_LEN + 1]; // Script hashes the employee holds
+    int cached_script_next;
+    int last_frame_no[MAX_JOBS]; // Last frame of each job placed here, -1 if none
 } employee_node_t;
 
 // Structure to hold information about a task result to be sent
+typedef enum {
+    RESULT_KIND_TASK,       // Result of one chunk
+    RESULT_KIND_ACK,        // Chunk folded into a pending partial, no payload
+    RESULT_KIND_PARTIAL     // Combined result of the chunks listed in it
+} result_kind_t;
+
 typedef struct {
     char task_id[MAX_FILENAME_LEN];
-    char result_filepath[MAX_FILENAME_LEN];
+    char result_filepath[MAX_FILENAME_LEN]; // Where the result is spilled under memory pressure
     char employer_ip[INET_ADDRSTRLEN];
+    unsigned employer_id;   // Connection the result goes back to
+    char job_id[64];
+    result_kind_t kind;
+    int task_count;         // RESULT_KIND_PARTIAL: chunks in the partial
+    protocol_frame_t payload; // Result held in memory, owned by the entry; empty when spilled
 } result_info_t;
 
-// A simple circular buffer for received tasks
+// Received tasks in capacity slots shared by the lanes, each lane a FIFO
+// chained through next. The highest waiting lane is served, except that a
+// lane passed over TASK_LANE_STARVE_LIMIT times in a row goes first.
 typedef struct task_buffer_s {
-    received_task_t* tasks;
-    int capacity;
-    int head;
-    int tail;
+    received_task_t* tasks;     // capacity slots
+    int* next;                  // Following slot in the same lane or the free list, -1 at the end
+    int capacity;               // Tasks held across all lanes
+    int free_slot;              // First unused slot, -1 when full
+    int head[TASK_LANE_COUNT];  // Oldest task of the lane, -1 when empty
+    int tail[TASK_LANE_COUNT];  // Newest task of the lane
+    int lane_count[TASK_LANE_COUNT];
+    int passed[TASK_LANE_COUNT]; // Picks of other lanes while this one waited
+    long taken[TASK_LANE_COUNT];
     int count;
     pthread_mutex_t mutex;
+    pthread_cond_t changed;     // A task was added or wake_task_buffer was called
+    unsigned long wakeups;      // Counts wake_task_buffer calls
 } task_buffer_t;
 
+// A job runtime hosted by an employee: a pool of script processes (Node) per
+// job, each with its own Unix socket, connection and worker thread. Workers
+// take the next chunk from the job's buffer as soon as they are free, and a
+// slow job cannot hold up the chunks of another one.
+#define MAX_JOB_RUNTIMES 8
+#define MAX_RUNTIME_WORKERS 16
+// A worker keeps up to pipeline_depth messages in its script's socket, so the
+// script starts the next one while the previous response is handled. A message
+// is one chunk, or a batch of up to WORKER_BATCH_MAX for scripts that take them.
+#define WORKER_PIPELINE_MAX 4
+#define WORKER_BATCH_MAX 16
+
+struct job_runtime_s;
+
+typedef struct {
+    struct job_runtime_s* runtime;
+    int index;
+    char socket_path[108];          // sizeof(sun_path)
+    pid_t pid;
+    unix_socket_conn_t conn;
+    volatile bool is_started;
+    volatile bool is_connected;
+    bool has_thread;                // Thread must be joined before the slot is reused
+    pthread_t thread;
+    pthread_t collector;            // Receives the script's responses while the worker thread sends
+    bool has_collector;
+    // Chunks sent to the script (or about to be) and not yet answered, oldest
+    // first, in a ring of in_flight_capacity; the first in_flight_sent of them
+    // have been sent. message_frames holds how many each message carried, in
+    // the same order. Under window_mutex.
+    received_task_t* in_flight;
+    int in_flight_capacity;
+    int in_flight_head;
+    volatile int in_flight_count;
+    int in_flight_sent;
+    int message_frames[WORKER_PIPELINE_MAX];
+    struct timespec message_sent[WORKER_PIPELINE_MAX];
+    int message_head;
+    int message_count;
+    struct timespec last_response;
+    int max_batch;                  // Chunks per message the script takes, "max_batch" in its ready line
+    int batch_frames;               // Chunks the next message may carry, adapted to batch_latency_ms
+    double frame_ms;                // Recent compute time per chunk
+    struct timespec busy_since;     // Since the window was last empty, for the worker share
+    pthread_mutex_t window_mutex;
+    pthread_cond_t window_changed;
+    long chunks_processed;
+} runtime_worker_t;
+
+typedef struct job_runtime_s {
+    char job_id[64];
+    char file_tag[80];              // Names the job's sockets and files, job_id plus the slot when another employer runs the same id
+    unsigned employer_id;           // Connection of the employer the job belongs to
+    char employer_ip[INET_ADDRSTRLEN]; // Lets the employer adopt the job again after reconnecting
+    int share_waiting;              // Workers holding a chunk until their employer's turn, under the share lock
+    char script_path[512];
+    script_runtime_t engine;        // Node workers, or plugin hosts (plugin_host.c) for native and quickjs
+    bool in_use;                    // Slot holds a runtime (possibly still stopping)
+    volatile bool stopping;         // Released by the employer or shutting down
+    struct task_buffer_s chunk_buffer; // Shared by the workers
+    runtime_worker_t workers[MAX_RUNTIME_WORKERS];
+    int worker_count;
+    int workers_running;            // Threads not yet exited, the last one frees the slot
+    // Combine jobs: results folded since the last upload, under partial_mutex
+    combine_kind_t combine;
+    int combine_batch;
+    pthread_mutex_t partial_mutex;
+    struct cJSON* partial;
+    struct cJSON* partial_tasks;    // Task ids folded into partial
+    int partial_count;
+    time_t partial_started;
+    long partial_seq;
+    long cold_start_ms;             // From starting the scripts until the first worker was ready
+} job_runtime_t;
+
 // A simple circular queue for results waiting to be sent
 typedef struct {
     result_info_t* results;
@@ -128,9 +287,176 @@ typedef struct {
     time_t completed_time;
     bool is_sent;
     bool is_completed;
+    bool is_mapped;      // Combine job: folded into a partial the employee has not uploaded yet
     int retry_count;
+    int frame_no; // Frame number for image/video tasks, -1 if not a frame
+    int job_slot; // Index into the job table
+    task_lane_t lane;    // Lowest lane to send it in, set from the parent's for relayed tasks
+    off_t chunk_offset;  // Byte range of chunk_file for input file jobs,
+    size_t chunk_length; // a length of 0 means the whole file
+    bool memo_keyed;     // memo_key is set, the result goes into the result cache
+    unsigned char memo_key[SHA256_DIGEST_LEN];
 } task_assignment_t;
 
+// Ordered result stream (employer side): reorders results by frame number
+typedef struct {
+    int frame_no;
+    bool is_ready;
+    char result_path[MAX_FILENAME_LEN * 2];
+} result_stream_entry_t;
+
+typedef struct {
+    result_stream_entry_t* entries; // Sorted by frame_no
+    int capacity;
+    int count;
+    int cursor;                     // First entry not yet streamed
+    int window;                     // Max frames dispatched ahead of the cursor
+    int sink_fd;
+    bool sink_is_socket;
+    // A frame a failed write cut short, finished before any other goes out
+    result_stream_entry_t partial;
+    bool has_partial;
+    bool partial_late;              // Emitted out of order, not the entry at cursor
+    long long partial_offset;       // Bytes of it already in the sink
+    result_stream_entry_t* late;    // Frames past the cursor waiting for the sink, oldest first
+    int late_count;
+    int late_capacity;
+    char sink_spec[MAX_FILENAME_LEN]; // File/FIFO path or "unix:<path>"
+    long frames_buffered;
+    long frames_streamed;
+    long long bytes_streamed;
+    pthread_mutex_t mutex;
+} result_stream_t;
+
+// Continuous chunk ingestion (employer side): inotify watch on the chunk directory
+typedef int (*task_ingest_cb_t)(const char* dir, const char* filename);
+
+// A chunk file already turned into a task, as it was when it was queued
+typedef struct {
+    char* name;             // NULL marks a free slot
+    ino_t inode;
+    struct timespec mtime;
+} task_ingest_file_t;
+
+typedef struct {
+    int inotify_fd;
+    int watch_fd;
+    char watch_dir[MAX_FILENAME_LEN];
+    bool overflowed;        // Kernel queue overflowed, directory needs a rescan
+    task_ingest_file_t* files; // Open-addressed set of queued files, keyed by name
+    size_t file_capacity;
+    size_t file_count;
+    long files_ingested;
+    long files_since_update;
+    double intake_rate;     // Smoothed files per second
+    time_t last_rate_update;
+} task_ingest_t;
+
+// Task journal (employer side): append-only log of task state transitions
+typedef struct {
+    char* task_id;
+    char* job_id;
+    char* path;             // Chunk file while pending, result file once completed
+    int frame_no;
+    bool completed;
+    bool dropped;           // Job finished and was forgotten
+} task_journal_entry_t;
+
+typedef struct {
+    bool live;
+    char job_id[64];
+    char runtime[16];
+    int priority;
+    int weight;
+    char script_path[MAX_FILENAME_LEN];
+    char chunk_dir[MAX_FILENAME_LEN];
+    combine_kind_t combine;
+    int combine_batch;
+} task_journal_job_t;
+
+typedef struct {
+    int fd;
+    char path[MAX_FILENAME_LEN];
+    char* buffer;           // Records not yet written and synced
+    size_t buffer_len;
+    size_t buffer_capacity;
+    struct timespec first_unsynced;
+    task_journal_entry_t* entries; // Open addressing index keyed by task_id
+    size_t entry_capacity;
+    size_t entry_count;
+    task_journal_job_t jobs[MAX_JOBS];
+    long records_replayed;
+    long records_written;   // Since the last compaction
+    long syncs;
+    long compactions;
+} task_journal_t;
+
+typedef void (*task_journal_job_cb_t)(const task_journal_job_t* job);
+typedef void (*task_journal_task_cb_t)(const task_journal_entry_t* entry);
+
+// Result memo cache (employer side): results of finished tasks kept on disk,
+// keyed by a SHA-256 over the job's runtime and script plus the chunk bytes
+typedef struct {
+    unsigned char key[SHA256_DIGEST_LEN];
+    bool used;
+    size_t size;
+    unsigned long last_used; // Tick of the last store or hit, the smallest is evicted first
+} result_cache_entry_t;
+
+typedef struct {
+    char dir[MAX_FILENAME_LEN];
+    size_t max_bytes;
+    result_cache_entry_t* entries; // Open addressing index keyed by key
+    size_t entry_capacity;
+    size_t entry_count;
+    size_t bytes;
+    unsigned long tick;
+    bool dirty;             // The index file is behind
+    time_t last_saved;
+    long lookups;
+    long hits;
+    long stores;
+    long evictions;
+} result_cache_t;
+
+// Jobs (employer side): each job has its own runtime script, chunk set,
+// priority and fair-share weight. Jobs are owned by the employer loop thread.
+typedef enum {
+    JOB_STATE_FREE,
+    JOB_STATE_ACTIVE,
+    JOB_STATE_DONE
+} job_state_t;
+
+typedef struct {
+    char job_id[64];
+    char script_path[MAX_FILENAME_LEN];
+    char chunk_dir[MAX_FILENAME_LEN];
+    char runtime[16];       // Runtime that executes the script ("node", "quickjs", or "native" for a plugin)
+    int priority;           // Higher priority jobs are served first
+    int weight;             // Share of dispatches among jobs of equal priority
+    job_state_t state;
+    double pass;            // Weighted fair-share virtual time
+    int tasks_queued;
+    int tasks_dispatched;
+    int tasks_completed;
+    time_t submit_time;
+    time_t finish_time;
+    char script_hash[SHA256_HEX_LEN + 1]; // SHA-256 of script_path in hex, empty until first shipped
+    bool memo_config_set;
+    unsigned char memo_config[SHA256_DIGEST_LEN]; // SHA-256 of runtime and script, see result_cache.c
+    int cold_starts;        // Runtimes started for this job that had to fetch its script
+    bool relayed;           // Fed by a parent employer, kept open until it releases the job
+    combine_kind_t combine; // Employees upload combined partials instead of per-chunk results
+    int combine_batch;
+    combine_tree_t combined;
+    long long result_bytes; // Result payload bytes received
+    result_stream_t result_stream;
+    bool result_stream_enabled;
+} job_t;
+
+// Called for every job submitted on the control socket, returns tasks queued
+typedef int (*job_submit_cb_t)(int job_slot);
+
 int discover_employees(void);
 int get_employee_list(employee_node_t** employees, int* count);
 int select_employee_for_task(const char* task_id, char* selected_employee_id);
@@ -149,6 +475,17 @@ void cleanup_task_buffer(struct task_buffer_s* buffer);
 int add_task_to_buffer(struct task_buffer_s* buffer, const received_task_t* task);
 int get_task_from_buffer(struct task_buffer_s* buffer, received_task_t* task);
 bool is_task_buffer_empty(const struct task_buffer_s* buffer);
+int get_task_buffer_count(const struct task_buffer_s* buffer);
+unsigned long task_buffer_wakeups(struct task_buffer_s* buffer);
+int wait_task_from_buffer(struct task_buffer_s* buffer, received_task_t* task, unsigned long wakeups, int timeout_ms);
+void wait_task_buffer_wakeup(struct task_buffer_s* buffer, unsigned long wakeups, int timeout_ms);
+void wake_task_buffer(struct task_buffer_s* buffer);
+int task_lane_parse(const char* name, task_lane_t* lane);
+const char* task_lane_name(task_lane_t lane);
+int script_runtime_parse(const char* name, script_runtime_t* engine);
+const char* script_runtime_name(script_runtime_t engine);
+bool is_script_hash(const char* value);
+int send_script_missing(int sockfd, const char* job_id, const char* script_hash);
 
 int init_result_queue(result_queue_t* queue, int capacity);
 void cleanup_result_queue(result_queue_t* queue);
@@ -156,6 +493,66 @@ int add_result_to_queue(result_queue_t* queue, const result_info_t* result);
 int get_result_from_queue(result_queue_t* queue, result_info_t* result);
 bool is_result_queue_empty(const result_queue_t* queue);
 
+// Ordered result stream functions
+int result_stream_init(result_stream_t* stream, const char* sink_spec, int window);
+void result_stream_cleanup(result_stream_t* stream);
+int result_stream_expect(result_stream_t* stream, int frame_no);
+bool result_stream_in_window(result_stream_t* stream, int frame_no);
+int result_stream_submit(result_stream_t* stream, int frame_no, const char* result_path);
+int result_stream_flush(result_stream_t* stream);
+int result_stream_pending(result_stream_t* stream);
+
+// Continuous ingestion functions
+int task_ingest_init(task_ingest_t* ingest, const char* watch_dir);
+void task_ingest_cleanup(task_ingest_t* ingest);
+int task_ingest_process_events(task_ingest_t* ingest, task_ingest_cb_t on_chunk);
+int task_ingest_scan(task_ingest_t* ingest, task_ingest_cb_t on_chunk);
+void task_ingest_record(task_ingest_t* ingest, int files);
+
+// Task journal functions
+int task_journal_open(task_journal_t* journal, const char* path);
+void task_journal_close(task_journal_t* journal);
+void task_journal_replay(task_journal_t* journal, task_journal_job_cb_t on_job, task_journal_task_cb_t on_task);
+int task_journal_job_added(task_journal_t* journal, const job_t* job);
+int task_journal_job_done(task_journal_t* journal, const char* job_id);
+int task_journal_queued(task_journal_t* journal, const char* task_id, const char* job_id, int frame_no, const char* chunk_file);
+int task_journal_assigned(task_journal_t* journal, const char* task_id, const char* employee_ip);
+int task_journal_completed(task_journal_t* journal, const char* task_id, const char* job_id, int frame_no, const char* result_path);
+bool task_journal_is_completed(task_journal_t* journal, const char* task_id);
+int task_journal_sync(task_journal_t* journal, bool force);
+int task_journal_maybe_compact(task_journal_t* journal);
+
+// Result cache functions
+int result_cache_open(result_cache_t* cache, const char* dir, size_t max_bytes);
+void result_cache_close(result_cache_t* cache);
+int result_cache_lookup(result_cache_t* cache, const unsigned char key[SHA256_DIGEST_LEN], const char* dest_path,
+                        size_t* size);
+int result_cache_store(result_cache_t* cache, const unsigned char key[SHA256_DIGEST_LEN], const char* result_path);
+int result_cache_sync(result_cache_t* cache, bool force);
+void result_cache_print_stats(const result_cache_t* cache);
+
+// Job table and control socket functions
+int job_table_add(const char* job_id, const char* script_path, const char* chunk_dir,
+                  const char* runtime, int priority, int weight);
+int job_table_find(const char* job_id);
+job_t* job_table_get(int slot);
+int job_table_pick_next(const bool* blocked);
+void job_table_charge(int slot);
+int job_table_active_count(void);
+void job_table_cleanup(void);
+int job_control_listen(const char* socket_path);
+int job_control_handle(int listen_fd, job_submit_cb_t on_submit);
+void job_control_close(int listen_fd, const char* socket_path);
+
+// Combine functions
+int combine_parse(const char* name, combine_kind_t* kind);
+const char* combine_name(combine_kind_t kind);
+int combine_merge(struct cJSON* into, const struct cJSON* from);
+void combine_tree_init(combine_tree_t* tree);
+int combine_tree_add(combine_tree_t* tree, struct cJSON* value);
+struct cJSON* combine_tree_result(const combine_tree_t* tree);
+void combine_tree_cleanup(combine_tree_t* tree);
+
 // Hybrid mode placeholder
 int run_hybrid_mode(void);
 int start_agent(char* task_files[]);
@@ -0,0 +1,47 @@
+#ifndef VOLCOM_PLUGIN_H
+#define VOLCOM_PLUGIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Native task plugin ABI.
+//
+// A job with runtime "native" ships a shared object instead of a script. Each
+// worker of the job's runtime is a plugin host process (employee/plugin_host.c)
+// that loads it and calls process() once per chunk, with no Node process and
+// no JSON in between. The plugin exports VOLCOM_PLUGIN_ENTRY, returning a
+// description built against VOLCOM_PLUGIN_ABI_VERSION; hosts refuse any other
+// version. Only this header is needed to build one:
+//
+//   cc -shared -fPIC -O2 -I<volcom_agents> my_plugin.c -o my_plugin.so
+
+#define VOLCOM_PLUGIN_ABI_VERSION 1
+#define VOLCOM_PLUGIN_ENTRY "volcom_plugin_entry"
+
+// process() return values, anything negative is a failed chunk
+#define VOLCOM_PLUGIN_OK 0
+#define VOLCOM_PLUGIN_GROW 1 // out->len is the size needed, process() is called again with room for it
+
+typedef struct {
+    void* data;
+    size_t len;
+    size_t capacity;    // Output only: bytes data can hold
+} volcom_plugin_buffer_t;
+
+typedef struct {
+    uint32_t abi_version;
+    const char* name;
+    // Once per host process, before the first chunk. state is passed back to
+    // process() and destroy(). Non-zero fails the worker.
+    int (*init)(void** state, const char* job_id);
+    // One chunk. in->data is the chunk as received (mapped from the employee's
+    // buffer when it was passed by descriptor) and only valid during the call.
+    // Write at most out->capacity bytes to out->data and set out->len.
+    int (*process)(void* state, const volcom_plugin_buffer_t* in, volcom_plugin_buffer_t* out);
+    // When the runtime stops. May be NULL.
+    void (*destroy)(void* state);
+} volcom_plugin_t;
+
+typedef const volcom_plugin_t* (*volcom_plugin_entry_fn)(void);
+
+#endif // VOLCOM_PLUGIN_H
@@ -4,6 +4,7 @@
 #include "volcom_rcsmngr/volcom_rcsmngr.h"
 #include "volcom_scheduler/volcom_scheduler.h"
 #include "volcom_agents/volcom_agents.h"
+#include "volcom_utils/volcom_utils.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -11,6 +12,8 @@
 #include <signal.h>
 #include <sys/wait.h>
 
+#define VOLCOM_AGENT_CONFIG "./volcom.conf" // Optional key=value agent settings
+
 static struct volcom_rcsmngr_s manager;
 
 // Function declarations
@@ -305,6 +308,11 @@ int main(int argc, char *argv[]) {
         configure_by_cmd(&config);
     }
 
+    // Agent settings (result stream sink etc.) override the built-in defaults
+    if (access(VOLCOM_AGENT_CONFIG, R_OK) == 0) {
+        load_volcom_config(VOLCOM_AGENT_CONFIG);
+    }
+
     if (volcom_rcsmngr_init(&manager, "volcom") != 0) {
         fprintf(stderr, "[ERRROR][MAIN] Failed to initialize resource manager\n");
         return -1;
@@ -324,6 +332,13 @@ int main(int argc, char *argv[]) {
                     fprintf(stderr, "[ERRPR][EMPLOYER] Employer mode failed\n");
             }
             cleanup_agent();
+        } else if (strcmp(argv[2], "relay") == 0) {
+            printf("[RELAY] Launching in Relay Mode...\n");
+            init_agent(AGENT_MODE_EMPLOYER);
+            if (run_relay_mode() != 0) {
+                fprintf(stderr, "[ERRPR][RELAY] Relay mode failed\n");
+            }
+            cleanup_agent();
         } else{
             printf("[EMPLOYEE] Launching in Employee Mode...\n");
             init_agent(AGENT_MODE_EMPLOYEE);
@@ -1,3 +1,5 @@
+#define _GNU_SOURCE
+
 #include "volcom_net.h"
 #include <unistd.h>
 #include <string.h>
@@ -5,16 +7,23 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <netinet/in.h>
+#include <errno.h>
+#include <limits.h>
 #include <time.h>
 
+#define PROTOCOL_FRAME_MAP_MIN (64 * 1024) // Smaller descriptor payloads are copied, not mapped
+
 // Unix socket server state
 static int unix_server_sockfd = -1;
 static struct sockaddr_un unix_server_addr;
 
-// Unix socket client state
-static int unix_client_sockfd = -1;
-static struct sockaddr_un unix_client_addr;
+// Connection behind the single-client API
+static unix_socket_conn_t unix_client = { .sockfd = -1 };
 
 // Protocol implementation (moved from utils/protocol.c)
 protocol_status_t send_json(int sockfd, cJSON *json) {
@@ -71,6 +80,290 @@ protocol_status_t recv_json(int sockfd, cJSON **json_out) {
     return *json_out ? PROTOCOL_OK : PROTOCOL_ERR;
 }
 
+// sendmsg until every iovec is out; msg's iovecs are consumed. calls, when
+// given, is increased by the number of sendmsg calls made.
+static protocol_status_t sendmsg_all(int sockfd, struct msghdr *msg, long *calls) {
+    while (msg->msg_iovlen > 0) {
+        ssize_t sent = sendmsg(sockfd, msg, MSG_NOSIGNAL);
+        if (calls) (*calls)++;
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return PROTOCOL_ERR;
+        // The descriptor went with the first bytes
+        msg->msg_control = NULL;
+        msg->msg_controllen = 0;
+        // Skip what went out, a short write resumes inside the header or body
+        while (msg->msg_iovlen > 0 && (size_t)sent >= msg->msg_iov->iov_len) {
+            sent -= msg->msg_iov->iov_len;
+            msg->msg_iov++;
+            msg->msg_iovlen--;
+        }
+        if (msg->msg_iovlen > 0) {
+            msg->msg_iov->iov_base = (char *)msg->msg_iov->iov_base + sent;
+            msg->msg_iov->iov_len -= sent;
+        }
+    }
+    return PROTOCOL_OK;
+}
+
+// A JSON message followed by a payload (u32 size, then the pieces back to
+// back), as send_json and a size-prefixed payload would send them, but in
+// one sendmsg unless the socket takes a short write
+protocol_status_t send_json_payload(int sockfd, cJSON *json, const struct iovec *pieces, int count, long *calls) {
+    if (sockfd < 0 || !json || count < 0 || (count > 0 && !pieces)) return PROTOCOL_ERR;
+
+    char *json_str = cJSON_PrintUnformatted(json);
+    if (!json_str) return PROTOCOL_ERR;
+    uint32_t net_json_len = htonl((uint32_t)strlen(json_str));
+    size_t payload_len = 0;
+    for (int i = 0; i < count; i++) payload_len += pieces[i].iov_len;
+    uint32_t net_payload_len = htonl((uint32_t)payload_len);
+
+    struct iovec *iov = malloc(sizeof(*iov) * (size_t)(count + 3));
+    if (!iov || payload_len > PROTOCOL_FRAME_MAX) {
+        free(iov);
+        free(json_str);
+        return PROTOCOL_ERR;
+    }
+    iov[0] = (struct iovec){ .iov_base = &net_json_len, .iov_len = sizeof(net_json_len) };
+    iov[1] = (struct iovec){ .iov_base = json_str, .iov_len = strlen(json_str) };
+    iov[2] = (struct iovec){ .iov_base = &net_payload_len, .iov_len = sizeof(net_payload_len) };
+    if (count > 0) memcpy(&iov[3], pieces, sizeof(*iov) * (size_t)count);
+    struct msghdr msg = { .msg_iov = iov, .msg_iovlen = (size_t)count + 3 };
+
+    protocol_status_t status = sendmsg_all(sockfd, &msg, calls);
+    free(iov);
+    free(json_str);
+    return status;
+}
+
+// Send header and body with one sendmsg (plus an SCM_RIGHTS descriptor when
+// fd >= 0). A peer that went away fails the call instead of raising SIGPIPE.
+static protocol_status_t send_frame_msg(int sockfd, uint32_t header, const void *body, uint32_t body_len, int fd) {
+    uint32_t net_header = htonl(header);
+    struct iovec iov[2] = {
+        { .iov_base = &net_header, .iov_len = sizeof(net_header) },
+        { .iov_base = (void *)body, .iov_len = body_len }
+    };
+    struct msghdr msg = { .msg_iov = iov, .msg_iovlen = 2 };
+
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    if (fd >= 0) {
+        memset(&control, 0, sizeof(control));
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    return sendmsg_all(sockfd, &msg, NULL);
+}
+
+protocol_status_t send_frame(int sockfd, const void *data, uint32_t len) {
+    if (sockfd < 0 || (!data && len > 0) || len > PROTOCOL_FRAME_MAX) return PROTOCOL_ERR;
+    return send_frame_msg(sockfd, len, data, len, -1);
+}
+
+// Pass the payload held by fd (e.g. a memfd). The peer reads it through
+// /proc/<pid>/fd/<fd> or the passed descriptor, so fd must stay open until
+// the peer has answered.
+protocol_status_t send_frame_fd(int sockfd, int fd) {
+    if (sockfd < 0 || fd < 0) return PROTOCOL_ERR;
+
+    char path[64];
+    int path_len = snprintf(path, sizeof(path), "/proc/%d/fd/%d", (int)getpid(), fd);
+    if (path_len < 0 || (size_t)path_len >= sizeof(path)) return PROTOCOL_ERR;
+    return send_frame_msg(sockfd, PROTOCOL_FRAME_FD | (uint32_t)path_len, path, (uint32_t)path_len, fd);
+}
+
+static protocol_status_t recv_exact(int sockfd, void *buf, size_t len) {
+    size_t recvd = 0;
+    while (recvd < len) {
+        ssize_t n = recv(sockfd, (char *)buf + recvd, len - recvd, MSG_WAITALL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0) return PROTOCOL_CONN_CLOSED;
+        if (n < 0) return PROTOCOL_ERR;
+        recvd += n;
+    }
+    return PROTOCOL_OK;
+}
+
+// Read a frame header, picking up a descriptor passed with it
+static protocol_status_t recv_frame_header(int sockfd, uint32_t *header, int *fd_out) {
+    uint32_t net_header;
+    struct iovec iov = { .iov_base = &net_header, .iov_len = sizeof(net_header) };
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1,
+                          .msg_control = control.buf, .msg_controllen = sizeof(control.buf) };
+
+    *fd_out = -1;
+    ssize_t n;
+    do {
+        n = recvmsg(sockfd, &msg, MSG_WAITALL | MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    if (n == 0) return PROTOCOL_CONN_CLOSED;
+    if (n < 0) return PROTOCOL_ERR;
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+            cmsg->cmsg_len >= CMSG_LEN(sizeof(int))) {
+            memcpy(fd_out, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+
+    if ((size_t)n < sizeof(net_header)) {
+        protocol_status_t status = recv_exact(sockfd, (char *)&net_header + n, sizeof(net_header) - n);
+        if (status != PROTOCOL_OK) {
+            if (*fd_out >= 0) close(*fd_out);
+            *fd_out = -1;
+            return status;
+        }
+    }
+    *header = ntohl(net_header);
+    return PROTOCOL_OK;
+}
+
+// Map the payload held by fd, exactly its size: the file belongs to the
+// sender and is never resized here. The kernel zero-fills the rest of the last
+// page, which NUL-terminates the mapping like an inline frame. Small payloads,
+// and ones that end on a page boundary (no byte left for the NUL), are read
+// into a private buffer instead.
+static protocol_status_t map_frame_fd(int fd, protocol_frame_t *frame) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size > PROTOCOL_FRAME_MAX) return PROTOCOL_ERR;
+
+    size_t len = (size_t)st.st_size;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    if (len >= PROTOCOL_FRAME_MAP_MIN && len % page != 0) {
+        void *map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            frame->data = map;
+            frame->len = (uint32_t)len;
+            frame->mapped_len = len;
+            return PROTOCOL_OK;
+        }
+    }
+
+    char *buf = malloc(len + 1);
+    if (!buf) return PROTOCOL_ERR;
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(fd, buf + done, len - done, (off_t)done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            free(buf);
+            return PROTOCOL_ERR;
+        }
+        done += n;
+    }
+    buf[len] = '\0';
+    frame->data = buf;
+    frame->len = (uint32_t)len;
+    frame->mapped_len = 0;
+    return PROTOCOL_OK;
+}
+
+// Drop a frame's receive buffer before the frame is complete
+static void discard_frame_buffer(protocol_frame_t *frame, char *buf) {
+    if (frame->release) {
+        frame->release(frame->owner);
+    } else {
+        free(buf);
+    }
+    frame->release = NULL;
+    frame->owner = NULL;
+}
+
+// Read one frame. Inline payloads land in a buffer of exactly their size (one
+// sized receive); descriptor frames are mapped. Release with free_frame.
+protocol_status_t recv_frame(int sockfd, protocol_frame_t *frame) {
+    return recv_frame_alloc(sockfd, frame, NULL, NULL);
+}
+
+// recv_frame with inline payloads received into buffers from alloc
+protocol_status_t recv_frame_alloc(int sockfd, protocol_frame_t *frame, frame_alloc_fn alloc, void *ctx) {
+    if (sockfd < 0 || !frame) return PROTOCOL_ERR;
+    memset(frame, 0, sizeof(*frame));
+
+    uint32_t header = 0;
+    int fd = -1;
+    protocol_status_t status = recv_frame_header(sockfd, &header, &fd);
+    if (status != PROTOCOL_OK) return status;
+
+    bool by_fd = (header & PROTOCOL_FRAME_FD) != 0;
+    uint32_t len = header & ~PROTOCOL_FRAME_FD;
+    if (len > PROTOCOL_FRAME_MAX || (by_fd && len >= PATH_MAX)) {
+        if (fd >= 0) close(fd);
+        return PROTOCOL_ERR;
+    }
+
+    char *buf = (alloc && !by_fd) ? alloc(ctx, (size_t)len + 1, frame) : NULL;
+    if (!buf) {
+        frame->release = NULL;
+        frame->owner = NULL;
+        buf = malloc((size_t)len + 1);
+    }
+    if (!buf) {
+        if (fd >= 0) close(fd);
+        return PROTOCOL_ERR;
+    }
+    status = recv_exact(sockfd, buf, len);
+    if (status != PROTOCOL_OK) {
+        discard_frame_buffer(frame, buf);
+        if (fd >= 0) close(fd);
+        return status;
+    }
+    buf[len] = '\0';
+
+    if (!by_fd) {
+        if (fd >= 0) close(fd); // Stray descriptor on an inline frame
+        frame->data = buf;
+        frame->len = len;
+        return PROTOCOL_OK;
+    }
+
+    // Without a passed descriptor, only our spool files are opened by path
+    if (fd < 0) {
+        if (strncmp(buf, PROTOCOL_FRAME_SHM_PREFIX, strlen(PROTOCOL_FRAME_SHM_PREFIX)) != 0 ||
+            strstr(buf, "/..") != NULL) {
+            free(buf);
+            return PROTOCOL_ERR;
+        }
+        fd = open(buf, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+        if (fd >= 0) unlink(buf);
+    }
+    free(buf);
+    if (fd < 0) return PROTOCOL_ERR;
+
+    status = map_frame_fd(fd, frame);
+    close(fd); // The mapping keeps the pages
+    return status;
+}
+
+void free_frame(protocol_frame_t *frame) {
+    if (!frame || !frame->data) return;
+    if (frame->release) {
+        frame->release(frame->owner);
+    } else if (frame->mapped_len > 0) {
+        munmap(frame->data, frame->mapped_len);
+    } else {
+        free(frame->data);
+    }
+    frame->data = NULL;
+    frame->len = 0;
+    frame->mapped_len = 0;
+    frame->release = NULL;
+    frame->owner = NULL;
+}
+
 // Metadata creation utilities
 cJSON* create_task_metadata(const char *task_id, const char *chunk_filename, 
                            const char *sender_id, const char *receiver_id, const char *status) {
@@ -222,11 +515,12 @@ protocol_status_t recv_json_peek(int sockfd, cJSON** json) {
         return PROTOCOL_ERR;
     }
 
-    // We need to peek at the length prefix + the data
+    // We need to peek at the length prefix + the data. The sender may write
+    // them separately, so wait until all of it is there.
     char* buffer = malloc(sizeof(uint32_t) + len + 1);
     if (!buffer) return PROTOCOL_ERR;
 
-    bytes_read = recv(sockfd, buffer, sizeof(uint32_t) + len, MSG_PEEK);
+    bytes_read = recv(sockfd, buffer, sizeof(uint32_t) + len, MSG_PEEK | MSG_WAITALL);
     if (bytes_read != (ssize_t)(sizeof(uint32_t) + len)) {
         free(buffer);
         return PROTOCOL_ERR;
@@ -245,8 +539,9 @@ protocol_status_t recv_json_peek(int sockfd, cJSON** json) {
 }
 
 
-// Function to send a UDP broadcast message
-void send_udp_broadcast(const char* message) {
+// Send a discovery message to an address: the broadcast address on a LAN, or a
+// unicast address (e.g. 127.0.0.1) when several agents share one host
+void send_discovery_message(const char* message, const char* address, int port) {
     int sockfd;
     struct sockaddr_in broadcast_addr;
     int broadcast = 1;
@@ -265,8 +560,12 @@ void send_udp_broadcast(const char* message) {
 
     memset(&broadcast_addr, 0, sizeof(broadcast_addr));
     broadcast_addr.sin_family = AF_INET;
-    broadcast_addr.sin_port = htons(9876); // Port for volcom discovery
-    broadcast_addr.sin_addr.s_addr = inet_addr("255.255.255.255");
+    broadcast_addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, address, &broadcast_addr.sin_addr) != 1) {
+        printf("Invalid discovery address %s\n", address);
+        close(sockfd);
+        return;
+    }
 
     if (sendto(sockfd, message, strlen(message), 0, (struct sockaddr*)&broadcast_addr, sizeof(broadcast_addr)) < 0) {
         perror("sendto");
@@ -275,6 +574,11 @@ void send_udp_broadcast(const char* message) {
     close(sockfd);
 }
 
+// Function to send a UDP broadcast message
+void send_udp_broadcast(const char* message) {
+    send_discovery_message(message, DISCOVERY_BROADCAST_ADDRESS, DISCOVERY_PORT);
+}
+
 // Unix Socket Server Functions
 bool unix_socket_server_init(struct unix_socket_config_s *config) {
 
@@ -389,34 +693,94 @@ void unix_socket_server_cleanup(void) {
 }
 
 // Unix Socket Client Functions
-bool unix_socket_client_init(struct unix_socket_config_s *config) {
+void unix_socket_conn_init(unix_socket_conn_t* conn, const char* socket_path) {
 
-    if (!config) {
-        fprintf(stderr, "Invalid Unix socket client config\n");
+    memset(conn, 0, sizeof(*conn));
+    conn->sockfd = -1;
+    conn->addr.sun_family = AF_UNIX;
+    strncpy(conn->addr.sun_path, socket_path, sizeof(conn->addr.sun_path) - 1);
+}
+
+// Connect (again) to the path given to unix_socket_conn_init
+bool unix_socket_conn_connect(unix_socket_conn_t* conn) {
+
+    unix_socket_conn_close(conn);
+    conn->sockfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (conn->sockfd < 0) return false;
+
+    if (connect(conn->sockfd, (struct sockaddr *)&conn->addr, sizeof(conn->addr)) < 0) {
+        int saved_errno = errno;
+        unix_socket_conn_close(conn);
+        errno = saved_errno;
         return false;
     }
+    return true;
+}
 
-    if ((unix_client_sockfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
-        perror("Unix socket client creation failed");
-        return false;
+// Send the whole message, a peer that went away fails the call instead of raising SIGPIPE
+bool unix_socket_conn_send(unix_socket_conn_t* conn, const char* message) {
+
+    if (conn->sockfd < 0 || !message) return false;
+
+    size_t message_len = strlen(message);
+    size_t total_sent = 0;
+    while (total_sent < message_len) {
+        ssize_t sent = send(conn->sockfd, message + total_sent, message_len - total_sent, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) {
+            perror("Unix socket client send failed");
+            return false;
+        }
+        total_sent += sent;
     }
+    return true;
+}
+
+ssize_t unix_socket_conn_receive(unix_socket_conn_t* conn, char* buffer, size_t buffer_size) {
 
-    memset(&unix_client_addr, 0, sizeof(unix_client_addr));
-    unix_client_addr.sun_family = AF_UNIX;
-    strncpy(unix_client_addr.sun_path, config->socket_path, sizeof(unix_client_addr.sun_path) - 1);
+    if (conn->sockfd < 0 || !buffer || buffer_size == 0) return -1;
 
+    ssize_t received_bytes;
+    do {
+        received_bytes = recv(conn->sockfd, buffer, buffer_size - 1, 0);
+    } while (received_bytes < 0 && errno == EINTR);
+
+    if (received_bytes < 0) {
+        perror("Unix socket client receive failed");
+        return -1;
+    }
+    buffer[received_bytes] = '\0';
+    return received_bytes;
+}
+
+void unix_socket_conn_close(unix_socket_conn_t* conn) {
+
+    if (conn->sockfd >= 0) {
+        close(conn->sockfd);
+        conn->sockfd = -1;
+    }
+}
+
+bool unix_socket_client_init(struct unix_socket_config_s *config) {
+
+    if (!config) {
+        fprintf(stderr, "Invalid Unix socket client config\n");
+        return false;
+    }
+
+    unix_socket_conn_init(&unix_client, config->socket_path);
     printf("Unix socket client initialized for path: %s\n", config->socket_path);
     return true;
 }
 
 bool unix_socket_client_connect(void) {
 
-    if (unix_client_sockfd < 0) {
+    if (unix_client.addr.sun_family != AF_UNIX) {
         fprintf(stderr, "Unix socket client not initialized\n");
         return false;
     }
 
-    if (connect(unix_client_sockfd, (struct sockaddr *)&unix_client_addr, sizeof(unix_client_addr)) < 0) {
+    if (!unix_socket_conn_connect(&unix_client)) {
         perror("Unix socket client connect failed");
         return false;
     }
@@ -427,53 +791,28 @@ bool unix_socket_client_connect(void) {
 
 bool unix_socket_client_send_message(const char* message) {
 
-    if (unix_client_sockfd < 0 || !message) {
+    if (unix_client.sockfd < 0 || !message) {
         fprintf(stderr, "Unix socket client not connected or invalid message\n");
         return false;
     }
-
-    size_t message_len = strlen(message);
-    ssize_t sent_bytes = send(unix_client_sockfd, message, message_len, 0);
-    
-    if (sent_bytes < 0) {
-        perror("Unix socket client send failed");
-        return false;
-    }
-
-    if ((size_t)sent_bytes != message_len) {
-        fprintf(stderr, "Unix socket client partial send: %zd/%zu bytes\n", sent_bytes, message_len);
-        return false;
-    }
-
-    return true;
+    return unix_socket_conn_send(&unix_client, message);
 }
 
 ssize_t unix_socket_client_receive_message(char* buffer, size_t buffer_size) {
 
-    if (unix_client_sockfd < 0 || !buffer || buffer_size == 0) {
+    if (unix_client.sockfd < 0 || !buffer || buffer_size == 0) {
         fprintf(stderr, "Invalid parameters for Unix socket client receive\n");
         return -1;
     }
 
-    ssize_t received_bytes = recv(unix_client_sockfd, buffer, buffer_size - 1, 0);
-    if (received_bytes < 0) {
-        perror("Unix socket client receive failed");
-        return -1;
-    }
-
+    ssize_t received_bytes = unix_socket_conn_receive(&unix_client, buffer, buffer_size);
     if (received_bytes == 0) {
         printf("Unix socket client: Server disconnected\n");
-        return 0;
     }
-
-    buffer[received_bytes] = '\0';  // Null-terminate
     return received_bytes;
 }
 
 void unix_socket_client_cleanup(void) {
-    
-    if (unix_client_sockfd >= 0) {
-        close(unix_client_sockfd);
-        unix_client_sockfd = -1;
-    }
+
+    unix_socket_conn_close(&unix_client);
 }
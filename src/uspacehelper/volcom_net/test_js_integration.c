@@ -3,21 +3,13 @@
 int main() {
     printf("=== Testing JavaScript Integration ===\n");
     
-    struct unix_socket_config_s client_config = {
-        .socket_path = "/tmp/volcom_unix_socket",
-        .buffer_size = 1024,
-        .timeout_sec = 5
-    };
+    // The runtime scripts speak length-prefixed frames (send_frame/recv_frame)
+    unix_socket_conn_t conn;
+    unix_socket_conn_init(&conn, "/tmp/volcom_unix_socket");
     
     printf("Connecting to JavaScript server...\n");
-    if (!unix_socket_client_init(&client_config)) {
-        printf("Failed to initialize client\n");
-        return 1;
-    }
-    
-    if (!unix_socket_client_connect()) {
+    if (!unix_socket_conn_connect(&conn)) {
         printf("Failed to connect to JavaScript server\n");
-        unix_socket_client_cleanup();
         return 1;
     }
     
@@ -32,20 +24,20 @@ int main() {
         "\"size\": 1024"
     "}";
     
-    if (unix_socket_client_send_message(success_message)) {
+    if (send_frame(conn.sockfd, success_message, strlen(success_message)) == PROTOCOL_OK) {
         printf("Success message sent!\n");
         
         // Receive response
-        char response[1024];
-        ssize_t bytes = unix_socket_client_receive_message(response, sizeof(response));
-        if (bytes > 0) {
-            printf("JavaScript server response: %s\n", response);
+        protocol_frame_t response;
+        if (recv_frame(conn.sockfd, &response) == PROTOCOL_OK) {
+            printf("JavaScript server response (%u bytes): %s\n", response.len, response.data);
+            free_frame(&response);
         }
     } else {
         printf("Failed to send success message\n");
     }
     
-    unix_socket_client_cleanup();
+    unix_socket_conn_close(&conn);
     printf("Test completed!\n");
     
     return 0;
@@ -14,6 +14,7 @@
 #include <unistd.h>
 #include <stdbool.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <ifaddrs.h>
@@ -27,6 +28,8 @@
 #define MAX_FILENAME_LEN 256
 #define MAX_EMPLOYEES 100
 #define MAX_TASK_ASSIGNMENTS 1000
+#define DISCOVERY_PORT 9876 // Employers listen here for employee announcements
+#define DISCOVERY_BROADCAST_ADDRESS "255.255.255.255"
 
 // Protocol definitions
 #define PROTOCOL_VERSION 1
@@ -41,6 +44,38 @@ typedef enum {
 protocol_status_t send_json(int sockfd, cJSON *json);
 protocol_status_t recv_json(int sockfd, cJSON **json_out);
 protocol_status_t recv_json_peek(int sockfd, cJSON **json_out);
+protocol_status_t send_json_payload(int sockfd, cJSON *json, const struct iovec *pieces, int count, long *calls);
+
+// Runtime socket framing (employee <-> script runtime): a u32 length in network
+// order, then that many payload bytes, in both directions.
+// With PROTOCOL_FRAME_FD set in the length, the body is not the payload but a
+// path to a file holding it (/proc/<pid>/fd/<n> of a memfd, or a file under
+// PROTOCOL_FRAME_SHM_PREFIX), and the descriptor itself rides along with
+// SCM_RIGHTS when the sender has one. The payload then crosses the process
+// boundary without being copied through the socket.
+#define PROTOCOL_FRAME_MAX (64 * 1024 * 1024)
+#define PROTOCOL_FRAME_FD 0x80000000u
+#define PROTOCOL_FRAME_SHM_PREFIX "/dev/shm/volcom_"
+
+// A memfd chunk must stay unchanged until the runtime has replied to it; the
+// employee reuses the memfd for a later chunk afterwards.
+typedef struct protocol_frame_s {
+    char *data;         // Payload, NUL-terminated
+    uint32_t len;
+    size_t mapped_len;  // Non-zero when data maps a descriptor passed by the peer
+    void (*release)(void *owner); // Set by a frame_alloc_fn: free_frame hands owner back instead of freeing data
+    void *owner;
+} protocol_frame_t;
+
+// Supplies the buffer an inline payload of size bytes (NUL included) is
+// received into, or NULL to fall back to malloc
+typedef char *(*frame_alloc_fn)(void *ctx, size_t size, protocol_frame_t *frame);
+
+protocol_status_t send_frame(int sockfd, const void *data, uint32_t len);
+protocol_status_t send_frame_fd(int sockfd, int fd);
+protocol_status_t recv_frame(int sockfd, protocol_frame_t *frame);
+protocol_status_t recv_frame_alloc(int sockfd, protocol_frame_t *frame, frame_alloc_fn alloc, void *ctx);
+void free_frame(protocol_frame_t *frame);
 
 // Metadata creation utilities
 cJSON* create_task_metadata(const char *task_id, const char *chunk_filename, 
@@ -54,6 +89,7 @@ void close_tcp_connection(int sockfd);
 
 // UDP broadcast management
 int setup_udp_listener(int port);
+void send_discovery_message(const char* message, const char* address, int port);
 int receive_udp_broadcast(int sockfd, char* buffer, size_t buffer_size, char* sender_ip);
 
 // Connection handler
@@ -134,6 +170,20 @@ bool unix_socket_server_send_message(int client_fd, const char* message);
 ssize_t unix_socket_server_receive_message(int client_fd, char* buffer, size_t buffer_size);
 void unix_socket_server_cleanup(void);
 
+// A Unix socket client connection. Each caller owns its connections, so one
+// process can talk to several script processes at once.
+typedef struct unix_socket_conn_s {
+    int sockfd;
+    struct sockaddr_un addr;
+} unix_socket_conn_t;
+
+void unix_socket_conn_init(unix_socket_conn_t* conn, const char* socket_path);
+bool unix_socket_conn_connect(unix_socket_conn_t* conn);
+bool unix_socket_conn_send(unix_socket_conn_t* conn, const char* message);
+ssize_t unix_socket_conn_receive(unix_socket_conn_t* conn, char* buffer, size_t buffer_size);
+void unix_socket_conn_close(unix_socket_conn_t* conn);
+
+// Single client connection kept for the tests and tools
 bool unix_socket_client_init(struct unix_socket_config_s *config);
 bool unix_socket_client_connect(void);
 bool unix_socket_client_send_message(const char* message);
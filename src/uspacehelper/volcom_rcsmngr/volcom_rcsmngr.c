@@ -436,6 +436,75 @@ int volcom_set_memory_limit(const char *cgroup_path, unsigned long limit_bytes)
     return 0;
 }
 
+// Current memory.max of a cgroup, 0 when it is "max" (unlimited)
+int volcom_get_memory_limit(const char *cgroup_path, unsigned long *limit_bytes) {
+
+    char memory_max_path[MAX_PATH_LEN];
+    snprintf(memory_max_path, MAX_PATH_LEN, "%s/memory.max", cgroup_path);
+
+    FILE *fp = fopen(memory_max_path, "r");
+    if (!fp) {
+        return -1;
+    }
+
+    char value[32] = {0};
+    if (!fgets(value, sizeof(value), fp)) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+
+    *limit_bytes = strncmp(value, "max", 3) == 0 ? 0 : strtoul(value, NULL, 10);
+    return 0;
+}
+
+int volcom_get_memory_current(const char *cgroup_path, unsigned long *current_bytes) {
+
+    char memory_current_path[MAX_PATH_LEN];
+    snprintf(memory_current_path, MAX_PATH_LEN, "%s/memory.current", cgroup_path);
+
+    FILE *fp = fopen(memory_current_path, "r");
+    if (!fp) {
+        return -1;
+    }
+
+    unsigned long value = 0;
+    int matched = fscanf(fp, "%lu", &value);
+    fclose(fp);
+    if (matched != 1) {
+        return -1;
+    }
+    *current_bytes = value;
+    return 0;
+}
+
+// Parse a PSI file, /proc/pressure/<resource> or <cgroup>/<resource>.pressure.
+// The host's cpu file has no "full" line before Linux 5.13; it reads as 0.
+int volcom_read_pressure(const char *pressure_path, struct volcom_pressure_s *pressure) {
+
+    FILE *fp = fopen(pressure_path, "r");
+    if (!fp) {
+        return -1;
+    }
+
+    memset(pressure, 0, sizeof(*pressure));
+    char line[256];
+    int parsed = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        char kind[8];
+        double avg10;
+        if (sscanf(line, "%7s avg10=%lf", kind, &avg10) != 2) continue;
+        if (strcmp(kind, "some") == 0) {
+            pressure->some_avg10 = avg10;
+            parsed++;
+        } else if (strcmp(kind, "full") == 0) {
+            pressure->full_avg10 = avg10;
+        }
+    }
+    fclose(fp);
+    return parsed > 0 ? 0 : -1;
+}
+
 int volcom_set_cpu_limit(const char *cgroup_path, int cpu_shares, int cpu_count) {
     char cpu_weight_path[MAX_PATH_LEN];
     char cpu_max_path[MAX_PATH_LEN];
@@ -29,6 +29,13 @@ struct cgroup_info_s {
     int pid_capacity;
 };
 
+// Pressure stall information of one resource: share of the last 10 s in
+// which some (or all) runnable tasks were stalled on it, in percent
+struct volcom_pressure_s {
+    double some_avg10;
+    double full_avg10;
+};
+
 // Cgroup manager structure
 struct volcom_rcsmngr_s {
     char root_cgroup_path[MAX_PATH_LEN];
@@ -58,6 +65,9 @@ void volcom_rcsmngr_cleanup(struct volcom_rcsmngr_s *manager);
 // Utility functions
 int volcom_check_cgroup_v2_support(void);
 int volcom_set_memory_limit(const char *cgroup_path, unsigned long limit_bytes);
+int volcom_get_memory_limit(const char *cgroup_path, unsigned long *limit_bytes);
+int volcom_get_memory_current(const char *cgroup_path, unsigned long *current_bytes);
+int volcom_read_pressure(const char *pressure_path, struct volcom_pressure_s *pressure);
 int volcom_set_cpu_limit(const char *cgroup_path, int cpu_shares, int cpu_count);
 int volcom_enable_controllers(const char *cgroup_path, const char *controllers);
 
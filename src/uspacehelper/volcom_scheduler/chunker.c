@@ -0,0 +1,226 @@
+#define _GNU_SOURCE
+
+#include "volcom_scheduler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+
+// Record-aware chunking engine.
+//
+// The input file is mapped read-only and scanned in place to find chunk
+// boundaries; nothing is copied and no chunk files are written. A chunk is just
+// an (offset, length) range of the input that starts and ends on a record
+// boundary, so a JSON line or a frame is never cut in half. Ranges are sent to
+// employees with sendfile() straight from the page cache backing the mapping.
+
+#define FRAME_HEADER_BYTES 4
+
+// "ndjson", "frames" or "fixed:<record size>"
+int parse_record_format(const char* spec, record_format_t* format, size_t* record_size) {
+    if (!spec || !format || !record_size) return -1;
+
+    if (strcmp(spec, "ndjson") == 0 || strcmp(spec, "jsonl") == 0) {
+        *format = RECORD_FORMAT_NDJSON;
+        *record_size = 0;
+        return 0;
+    }
+    if (strcmp(spec, "frames") == 0) {
+        *format = RECORD_FORMAT_FRAMES;
+        *record_size = 0;
+        return 0;
+    }
+    if (strncmp(spec, "fixed:", 6) == 0) {
+        char *end = NULL;
+        unsigned long size = strtoul(spec + 6, &end, 10);
+        if (end == spec + 6 || *end != '\0' || size == 0) return -1;
+        *format = RECORD_FORMAT_FIXED;
+        *record_size = size;
+        return 0;
+    }
+    return -1;
+}
+
+// Pick a format from the file extension: .ndjson/.jsonl, .frames, or raw bytes
+int record_format_for_path(const char* path, record_format_t* format, size_t* record_size) {
+    if (!path || !format || !record_size) return -1;
+
+    const char *ext = strrchr(path, '.');
+    if (ext && (strcmp(ext, ".ndjson") == 0 || strcmp(ext, ".jsonl") == 0)) {
+        return parse_record_format("ndjson", format, record_size);
+    }
+    if (ext && strcmp(ext, ".frames") == 0) {
+        return parse_record_format("frames", format, record_size);
+    }
+    *format = RECORD_FORMAT_FIXED;
+    *record_size = 1;
+    return 0;
+}
+
+int chunk_source_open(chunk_source_t* source, const char* path, record_format_t format, size_t record_size) {
+    if (!source || !path) return -1;
+    if (format == RECORD_FORMAT_FIXED && record_size == 0) record_size = 1; // Plain bytes
+
+    memset(source, 0, sizeof(*source));
+    source->fd = -1;
+    source->format = format;
+    source->record_size = record_size;
+    strncpy(source->path, path, sizeof(source->path) - 1);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        printf("Cannot open input file %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        printf("Input %s is not a regular file\n", path);
+        close(fd);
+        return -1;
+    }
+
+    size_t size = st.st_size;
+    if (format == RECORD_FORMAT_FIXED && size % record_size != 0) {
+        printf("Input %s ends with a partial %zu byte record, ignoring the last %zu bytes\n",
+               path, record_size, size % record_size);
+        size -= size % record_size;
+    }
+
+    if (size > 0) {
+        void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            perror("mmap input");
+            close(fd);
+            return -1;
+        }
+        // Boundaries are found in one forward pass
+        madvise(map, size, MADV_SEQUENTIAL);
+        source->data = map;
+    }
+
+    source->fd = fd;
+    source->size = size;
+    return 0;
+}
+
+void chunk_source_close(chunk_source_t* source) {
+    if (!source || source->fd < 0) return;
+
+    if (source->data) {
+        munmap((void*)source->data, source->size);
+        source->data = NULL;
+    }
+    close(source->fd);
+    source->fd = -1;
+    source->size = 0;
+}
+
+// Find the chunk starting at offset: at least one record, and whole records up
+// to target_size bytes. Returns 1 when a chunk was found, 0 at the end of the
+// input and -1 if the input is malformed at offset.
+int chunk_source_next(const chunk_source_t* source, off_t offset, size_t target_size, chunk_range_t* range) {
+    if (!source || !range || offset < 0) return -1;
+    if ((size_t)offset >= source->size) return 0;
+    if (target_size == 0) target_size = 1;
+
+    const char *data = source->data;
+    size_t start = offset;
+    size_t end = start;
+    int records = 0;
+
+    switch (source->format) {
+        case RECORD_FORMAT_NDJSON:
+            // Add lines until the target is reached; a line longer than the
+            // target becomes a chunk of its own
+            while (end < source->size && (records == 0 || end - start < target_size)) {
+                const char *newline = memchr(data + end, '\n', source->size - end);
+                end = newline ? (size_t)(newline - data) + 1 : source->size;
+                records++;
+            }
+            break;
+
+        case RECORD_FORMAT_FRAMES:
+            while (end < source->size && (records == 0 || end - start < target_size)) {
+                if (source->size - end < FRAME_HEADER_BYTES) {
+                    printf("Truncated frame header at offset %zu in %s\n", end, source->path);
+                    return -1;
+                }
+                uint32_t net_length;
+                memcpy(&net_length, data + end, sizeof(net_length));
+                size_t frame_length = ntohl(net_length);
+                if (frame_length > source->size - end - FRAME_HEADER_BYTES) {
+                    printf("Frame at offset %zu in %s runs past the end of the file\n", end, source->path);
+                    return -1;
+                }
+                end += FRAME_HEADER_BYTES + frame_length;
+                records++;
+            }
+            break;
+
+        case RECORD_FORMAT_FIXED: {
+            size_t count = target_size / source->record_size;
+            if (count == 0) count = 1;
+            size_t remaining = (source->size - start) / source->record_size;
+            if (count > remaining) count = remaining;
+            end = start + count * source->record_size;
+            records = (int)count;
+            break;
+        }
+
+        default:
+            return -1;
+    }
+
+    range->offset = offset;
+    range->length = end - start;
+    range->record_count = records;
+    return 1;
+}
+
+// Split the whole input into consecutive ranges. Returns the number of ranges,
+// or -1 if the input is malformed or does not fit into max_ranges.
+int chunk_source_split(const chunk_source_t* source, size_t target_size, chunk_range_t* ranges, int max_ranges) {
+    if (!source || !ranges || max_ranges <= 0) return -1;
+
+    int count = 0;
+    off_t offset = 0;
+    chunk_range_t range;
+    int status;
+    while ((status = chunk_source_next(source, offset, target_size, &range)) == 1) {
+        if (count >= max_ranges) {
+            printf("Input %s needs more than %d chunks\n", source->path, max_ranges);
+            return -1;
+        }
+        range.index = count;
+        ranges[count++] = range;
+        offset += range.length;
+    }
+
+    return status < 0 ? -1 : count;
+}
+
+// Send the bytes of a range to a socket without copying them through user space
+int chunk_range_send(int sockfd, const chunk_source_t* source, const chunk_range_t* range) {
+    if (sockfd < 0 || !source || source->fd < 0 || !range) return -1;
+    if ((size_t)range->offset + range->length > source->size) return -1;
+
+    off_t offset = range->offset;
+    size_t remaining = range->length;
+    while (remaining > 0) {
+        ssize_t sent = sendfile(sockfd, source->fd, &offset, remaining);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) {
+            perror("sendfile chunk");
+            return -1;
+        }
+        remaining -= sent;
+    }
+    return 0;
+}
@@ -10,19 +10,195 @@
 
 #define MAX_TASKS 100
 #define MAX_CHUNKS 1000
+#define PRIORITY_AGING_SECONDS 30 // A waiting chunk gains one priority level per interval
+#define CHUNK_INDEX_SIZE 2048     // Power of two, at least twice MAX_CHUNKS
+
+// Ordering data of a chunk, kept next to chunks[] so heap comparisons never
+// have to look up the owning task
+typedef struct {
+    int priority;
+    time_t deadline;        // 0 = no deadline
+    time_t enqueued_time;
+    unsigned long sequence; // Arrival order, breaks ties
+    int heap_pos;           // Position in ready_heap, -1 when not ready
+    int task_slot;          // Index of the owning task in tasks[]
+} chunk_order_t;
 
 // Global state
 static task_descriptor_t tasks[MAX_TASKS];
 static chunk_info_t chunks[MAX_CHUNKS];
+static chunk_order_t chunk_order[MAX_CHUNKS];
+static int task_open_chunks[MAX_TASKS]; // Chunks of each task not completed yet
 static int task_count = 0;
 static int chunk_count = 0;
 static scheduling_policy_t current_policy = SCHEDULE_ROUND_ROBIN;
 
+// Ready queue: binary heap of indices into chunks[] of chunks that are neither
+// assigned nor completed, ordered by the current policy
+static int ready_heap[MAX_CHUNKS];
+static int ready_count = 0;
+static unsigned long next_sequence = 0;
+static scheduler_stats_t stats;
+
+// chunk_id -> index into chunks[] (stored + 1, 0 = empty), open addressing
+static int chunk_index[CHUNK_INDEX_SIZE];
+
+// ============================================================================
+// READY QUEUE
+// ============================================================================
+
+// Does chunk a go before chunk b under the current policy?
+//
+// Deadline aware is EDF: earliest deadline first, chunks without a deadline
+// last. Priority based uses aging, effective priority = priority + waited /
+// PRIORITY_AGING_SECONDS. The comparison of two effective priorities does not
+// depend on the current time, so the heap stays valid as chunks age. The other
+// policies dispatch in arrival order.
+static bool chunk_before(int a, int b) {
+    const chunk_order_t *x = &chunk_order[a];
+    const chunk_order_t *y = &chunk_order[b];
+
+    switch (current_policy) {
+        case SCHEDULE_DEADLINE_AWARE:
+            if (x->deadline != y->deadline) {
+                if (x->deadline == 0) return false;
+                if (y->deadline == 0) return true;
+                return x->deadline < y->deadline;
+            }
+            if (x->priority != y->priority) return x->priority > y->priority;
+            break;
+
+        case SCHEDULE_PRIORITY_BASED: {
+            long long key_x = (long long)x->priority * PRIORITY_AGING_SECONDS - x->enqueued_time;
+            long long key_y = (long long)y->priority * PRIORITY_AGING_SECONDS - y->enqueued_time;
+            if (key_x != key_y) return key_x > key_y;
+            break;
+        }
+
+        default:
+            break;
+    }
+    return x->sequence < y->sequence;
+}
+
+static void heap_set(int pos, int chunk) {
+    ready_heap[pos] = chunk;
+    chunk_order[chunk].heap_pos = pos;
+}
+
+static void heap_sift_up(int pos) {
+    int chunk = ready_heap[pos];
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (!chunk_before(chunk, ready_heap[parent])) break;
+        heap_set(pos, ready_heap[parent]);
+        pos = parent;
+    }
+    heap_set(pos, chunk);
+}
+
+static void heap_sift_down(int pos) {
+    int chunk = ready_heap[pos];
+    for (;;) {
+        int child = 2 * pos + 1;
+        if (child >= ready_count) break;
+        if (child + 1 < ready_count && chunk_before(ready_heap[child + 1], ready_heap[child])) child++;
+        if (!chunk_before(ready_heap[child], chunk)) break;
+        heap_set(pos, ready_heap[child]);
+        pos = child;
+    }
+    heap_set(pos, chunk);
+}
+
+static void ready_push(int chunk) {
+    if (chunk_order[chunk].heap_pos >= 0 || ready_count >= MAX_CHUNKS) return;
+    heap_set(ready_count++, chunk);
+    heap_sift_up(ready_count - 1);
+}
+
+static void ready_remove(int chunk) {
+    int pos = chunk_order[chunk].heap_pos;
+    if (pos < 0) return;
+
+    chunk_order[chunk].heap_pos = -1;
+    ready_count--;
+    if (pos == ready_count) return;
+
+    // Move the last chunk into the hole; it may belong above or below it
+    int moved = ready_heap[ready_count];
+    heap_set(pos, moved);
+    heap_sift_down(pos);
+    if (chunk_order[moved].heap_pos == pos) heap_sift_up(pos);
+}
+
+// Rebuild the heap from scratch, after the policy changed or chunks[] moved
+static void ready_rebuild(void) {
+    ready_count = 0;
+    for (int i = 0; i < chunk_count; i++) {
+        chunk_order[i].heap_pos = -1;
+        if (!chunks[i].is_completed && chunks[i].assigned_employee[0] == '\0') {
+            heap_set(ready_count++, i);
+        }
+    }
+    for (int pos = ready_count / 2 - 1; pos >= 0; pos--) {
+        heap_sift_down(pos);
+    }
+}
+
+// The most urgent ready chunk, taken out of the queue
+static int ready_pop(void) {
+    if (ready_count == 0) return -1;
+
+    int chunk = ready_heap[0];
+    ready_remove(chunk);
+    return chunk;
+}
+
+// ============================================================================
+// CHUNK INDEX
+// ============================================================================
+
+// FNV-1a over the chunk id
+static unsigned int chunk_slot(const char* chunk_id) {
+    unsigned int hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char*)chunk_id; *p; p++) {
+        hash = (hash ^ *p) * 16777619u;
+    }
+    return hash & (CHUNK_INDEX_SIZE - 1);
+}
+
+static void chunk_index_add(int chunk) {
+    unsigned int slot = chunk_slot(chunks[chunk].chunk_id);
+    while (chunk_index[slot] != 0) slot = (slot + 1) & (CHUNK_INDEX_SIZE - 1);
+    chunk_index[slot] = chunk + 1;
+}
+
+// Rebuild the index from scratch, after chunks[] moved
+static void chunk_index_rebuild(void) {
+    memset(chunk_index, 0, sizeof(chunk_index));
+    for (int i = 0; i < chunk_count; i++) {
+        chunk_index_add(i);
+    }
+}
+
+static int find_chunk(const char* chunk_id) {
+    for (unsigned int slot = chunk_slot(chunk_id); chunk_index[slot] != 0;
+         slot = (slot + 1) & (CHUNK_INDEX_SIZE - 1)) {
+        int chunk = chunk_index[slot] - 1;
+        if (strcmp(chunks[chunk].chunk_id, chunk_id) == 0) return chunk;
+    }
+    return -1;
+}
+
 // Scheduler initialization
 int init_scheduler(void) {
     printf("Initializing task scheduler...\n");
     task_count = 0;
     chunk_count = 0;
+    ready_count = 0;
+    next_sequence = 0;
+    memset(chunk_index, 0, sizeof(chunk_index));
+    memset(&stats, 0, sizeof(stats));
     current_policy = SCHEDULE_ROUND_ROBIN;
     return 0;
 }
@@ -31,6 +207,8 @@ void cleanup_scheduler(void) {
     printf("Cleaning up scheduler...\n");
     task_count = 0;
     chunk_count = 0;
+    ready_count = 0;
+    memset(chunk_index, 0, sizeof(chunk_index));
 }
 
 // Task management
@@ -47,6 +225,7 @@ int add_task(const task_descriptor_t* task) {
     }
     
     memcpy(&tasks[task_count], task, sizeof(task_descriptor_t));
+    task_open_chunks[task_count] = 0;
     task_count++;
     
     printf("Task %s added to scheduler\n", task->task_id);
@@ -58,20 +237,24 @@ int remove_task(const char* task_id) {
     
     for (int i = 0; i < task_count; i++) {
         if (strcmp(tasks[i].task_id, task_id) == 0) {
-            // Remove chunks associated with this task
+            // Remove chunks associated with this task, in one compacting pass
+            int kept = 0;
             for (int j = 0; j < chunk_count; j++) {
-                if (strcmp(chunks[j].task_id, task_id) == 0) {
-                    // Shift chunks array
-                    memmove(&chunks[j], &chunks[j + 1], 
-                           (chunk_count - j - 1) * sizeof(chunk_info_t));
-                    chunk_count--;
-                    j--; // Recheck this position
-                }
+                if (chunk_order[j].task_slot == i) continue;
+                if (chunk_order[j].task_slot > i) chunk_order[j].task_slot--; // Tasks shift down below
+                chunks[kept] = chunks[j];
+                chunk_order[kept] = chunk_order[j];
+                kept++;
             }
+            chunk_count = kept;
+            chunk_index_rebuild(); // Chunk indices moved
+            ready_rebuild();
             
             // Remove task
             memmove(&tasks[i], &tasks[i + 1], 
                    (task_count - i - 1) * sizeof(task_descriptor_t));
+            memmove(&task_open_chunks[i], &task_open_chunks[i + 1],
+                   (task_count - i - 1) * sizeof(int));
             task_count--;
             
             printf("Task %s removed from scheduler\n", task_id);
@@ -94,56 +277,86 @@ task_descriptor_t* get_task(const char* task_id) {
     return NULL;
 }
 
+// qsort comparator over task pointers matching chunk_before()
+static int compare_task_urgency(const void* a, const void* b) {
+    const task_descriptor_t *x = *(task_descriptor_t* const*)a;
+    const task_descriptor_t *y = *(task_descriptor_t* const*)b;
+
+    switch (current_policy) {
+        case SCHEDULE_DEADLINE_AWARE:
+            if (x->deadline != y->deadline) {
+                if (x->deadline == 0) return 1;
+                if (y->deadline == 0) return -1;
+                return x->deadline < y->deadline ? -1 : 1;
+            }
+            if (x->priority != y->priority) return x->priority > y->priority ? -1 : 1;
+            break;
+
+        case SCHEDULE_PRIORITY_BASED: {
+            long long key_x = (long long)x->priority * PRIORITY_AGING_SECONDS - x->created_time;
+            long long key_y = (long long)y->priority * PRIORITY_AGING_SECONDS - y->created_time;
+            if (key_x != key_y) return key_x > key_y ? -1 : 1;
+            break;
+        }
+
+        default:
+            break;
+    }
+    // Keep table (arrival) order otherwise
+    return (x > y) - (x < y);
+}
+
 int get_pending_tasks(task_descriptor_t** tasks_out, int max_tasks) {
     if (!tasks_out) return -1;
     
     int pending_count = 0;
     for (int i = 0; i < task_count && pending_count < max_tasks; i++) {
-        // Check if task has incomplete chunks
-        bool has_incomplete = false;
-        for (int j = 0; j < chunk_count; j++) {
-            if (strcmp(chunks[j].task_id, tasks[i].task_id) == 0 && !chunks[j].is_completed) {
-                has_incomplete = true;
-                break;
-            }
-        }
-        
-        if (has_incomplete || !tasks[i].is_chunked) {
+        if (task_open_chunks[i] > 0 || !tasks[i].is_chunked) {
             tasks_out[pending_count] = &tasks[i];
             pending_count++;
         }
     }
     
+    // Most urgent first, in the order the ready queue would dispatch them
+    qsort(tasks_out, pending_count, sizeof(task_descriptor_t*), compare_task_urgency);
     return pending_count;
 }
 
 // Chunk management
+// Chunks are ranges of the task's input file that end on record boundaries
+// (see chunker.c); chunk_size is the target size of a range.
 int create_chunks(const char* task_id, size_t chunk_size) {
     if (!task_id) return -1;
     
     task_descriptor_t* task = get_task(task_id);
     if (!task) return -1;
     
-    // Check if file exists
-    struct stat st;
-    if (stat(task->input_file, &st) != 0) {
+    chunk_source_t source;
+    if (chunk_source_open(&source, task->input_file, task->record_format, task->record_size) != 0) {
         printf("Input file %s not found\n", task->input_file);
         return -1;
     }
     
-    size_t file_size = st.st_size;
-    int total_chunks = (file_size + chunk_size - 1) / chunk_size;
+    int capacity = MAX_CHUNKS - chunk_count;
+    chunk_range_t *ranges = malloc(sizeof(chunk_range_t) * (capacity > 0 ? capacity : 1));
+    int total_chunks = ranges ? chunk_source_split(&source, chunk_size, ranges, capacity) : -1;
+    chunk_source_close(&source);
+    if (total_chunks < 0) {
+        free(ranges);
+        return -1;
+    }
     
     // Create chunk entries
-    for (int i = 0; i < total_chunks && chunk_count < MAX_CHUNKS; i++) {
+    for (int i = 0; i < total_chunks; i++) {
         chunk_info_t chunk;
+        memset(&chunk, 0, sizeof(chunk));
         snprintf(chunk.chunk_id, sizeof(chunk.chunk_id), "%s_chunk_%d", task_id, i);
         strncpy(chunk.task_id, task_id, sizeof(chunk.task_id) - 1);
-        snprintf(chunk.chunk_file, sizeof(chunk.chunk_file), 
-                "/tmp/%s_chunk_%d.dat", task_id, i);
+        strncpy(chunk.chunk_file, task->input_file, sizeof(chunk.chunk_file) - 1);
         
-        chunk.chunk_size = (i == total_chunks - 1) ? 
-                          (file_size - i * chunk_size) : chunk_size;
+        chunk.chunk_offset = ranges[i].offset;
+        chunk.chunk_size = ranges[i].length;
+        chunk.record_count = ranges[i].record_count;
         chunk.chunk_index = i;
         chunk.total_chunks = total_chunks;
         chunk.assigned_employee[0] = '\0';
@@ -151,55 +364,118 @@ int create_chunks(const char* task_id, size_t chunk_size) {
         chunk.is_completed = false;
         
         chunks[chunk_count] = chunk;
+        chunk_order[chunk_count].priority = task->priority;
+        chunk_order[chunk_count].deadline = task->deadline;
+        // Work waits from the moment its task was submitted
+        chunk_order[chunk_count].enqueued_time = task->created_time ? task->created_time : time(NULL);
+        chunk_order[chunk_count].sequence = next_sequence++;
+        chunk_order[chunk_count].heap_pos = -1;
+        chunk_order[chunk_count].task_slot = (int)(task - tasks);
+        chunk_index_add(chunk_count);
+        ready_push(chunk_count);
         chunk_count++;
+        stats.chunks_queued++;
     }
+    free(ranges);
     
+    task_open_chunks[task - tasks] += total_chunks;
     task->is_chunked = true;
     printf("Created %d chunks for task %s\n", total_chunks, task_id);
     return total_chunks;
 }
 
+// Peek at the most urgent ready chunk, O(1); it leaves the queue when it is assigned
 int get_next_chunk(chunk_info_t* chunk_info) {
     if (!chunk_info) return -1;
     
-    for (int i = 0; i < chunk_count; i++) {
-        if (!chunks[i].is_completed && chunks[i].assigned_employee[0] == '\0') {
-            memcpy(chunk_info, &chunks[i], sizeof(chunk_info_t));
-            return 0;
-        }
+    if (ready_count == 0) {
+        return -1; // No available chunks
     }
     
-    return -1; // No available chunks
+    memcpy(chunk_info, &chunks[ready_heap[0]], sizeof(chunk_info_t));
+    return 0;
+}
+
+static void assign_chunk_at(int i, const char* employee_id) {
+    strncpy(chunks[i].assigned_employee, employee_id, 
+           sizeof(chunks[i].assigned_employee) - 1);
+    chunks[i].assigned_time = time(NULL);
+    ready_remove(i);
+    stats.chunks_dispatched++;
+    
+    if (chunk_order[i].deadline != 0 && chunks[i].assigned_time > chunk_order[i].deadline) {
+        stats.late_dispatches++;
+    }
+    printf("Chunk %s assigned to employee %s\n", chunks[i].chunk_id, employee_id);
 }
 
 int assign_chunk(const char* chunk_id, const char* employee_id) {
     if (!chunk_id || !employee_id) return -1;
     
-    for (int i = 0; i < chunk_count; i++) {
-        if (strcmp(chunks[i].chunk_id, chunk_id) == 0) {
-            strncpy(chunks[i].assigned_employee, employee_id, 
-                   sizeof(chunks[i].assigned_employee) - 1);
-            chunks[i].assigned_time = time(NULL);
-            printf("Chunk %s assigned to employee %s\n", chunk_id, employee_id);
-            return 0;
-        }
+    int i = find_chunk(chunk_id);
+    if (i < 0) {
+        return -1; // Chunk not found
+    }
+    
+    assign_chunk_at(i, employee_id);
+    return 0;
+}
+
+// Pop the most urgent ready chunk and assign it, O(log n)
+int take_next_chunk(const char* employee_id, chunk_info_t* chunk_info) {
+    if (!employee_id || !chunk_info) return -1;
+    
+    int i = ready_pop();
+    if (i < 0) {
+        return -1; // No available chunks
     }
     
-    return -1; // Chunk not found
+    assign_chunk_at(i, employee_id);
+    memcpy(chunk_info, &chunks[i], sizeof(chunk_info_t));
+    return 0;
+}
+
+// Put an assigned chunk back into the ready queue (employee lost, timeout)
+int release_chunk(const char* chunk_id) {
+    if (!chunk_id) return -1;
+    
+    int i = find_chunk(chunk_id);
+    if (i < 0 || chunks[i].is_completed) {
+        return -1;
+    }
+    
+    chunks[i].assigned_employee[0] = '\0';
+    chunks[i].assigned_time = 0;
+    ready_push(i);
+    return 0;
 }
 
 int mark_chunk_completed(const char* chunk_id) {
     if (!chunk_id) return -1;
     
-    for (int i = 0; i < chunk_count; i++) {
-        if (strcmp(chunks[i].chunk_id, chunk_id) == 0) {
-            chunks[i].is_completed = true;
-            printf("Chunk %s marked as completed\n", chunk_id);
-            return 0;
-        }
+    int i = find_chunk(chunk_id);
+    if (i < 0) {
+        return -1; // Chunk not found
+    }
+    if (chunks[i].is_completed) {
+        return 0;
     }
     
-    return -1; // Chunk not found
+    chunks[i].is_completed = true;
+    ready_remove(i);
+    task_open_chunks[chunk_order[i].task_slot]--;
+    stats.chunks_completed++;
+    
+    time_t now = time(NULL);
+    if (chunk_order[i].deadline != 0 && now > chunk_order[i].deadline) {
+        double lateness = difftime(now, chunk_order[i].deadline);
+        stats.deadline_misses++;
+        stats.total_lateness_sec += lateness;
+        if (lateness > stats.max_lateness_sec) stats.max_lateness_sec = lateness;
+        printf("Chunk %s completed %.0f s after its deadline\n", chunk_id, lateness);
+    }
+    printf("Chunk %s marked as completed\n", chunk_id);
+    return 0;
 }
 
 int get_chunk_status(const char* task_id, int* completed, int* total) {
@@ -278,6 +554,7 @@ int select_best_employee(employee_info_t* employees, int count, const task_descr
 // Scheduling policies
 int set_scheduling_policy(scheduling_policy_t policy) {
     current_policy = policy;
+    ready_rebuild(); // Keys depend on the policy
     printf("Scheduling policy set to %d\n", policy);
     return 0;
 }
@@ -285,3 +562,11 @@ int set_scheduling_policy(scheduling_policy_t policy) {
 scheduling_policy_t get_scheduling_policy(void) {
     return current_policy;
 }
+
+int get_scheduler_stats(scheduler_stats_t* out) {
+    if (!out) return -1;
+    
+    memcpy(out, &stats, sizeof(scheduler_stats_t));
+    out->chunks_ready = ready_count;
+    return 0;
+}
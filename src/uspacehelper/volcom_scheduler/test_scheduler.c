@@ -0,0 +1,124 @@
+#include "volcom_scheduler.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST_INPUT "/tmp/test_volcom_scheduler.bin"
+
+static int add_test_task(const char* task_id, int priority, time_t created, time_t deadline) {
+    task_descriptor_t task;
+    memset(&task, 0, sizeof(task));
+    strncpy(task.task_id, task_id, sizeof(task.task_id) - 1);
+    strncpy(task.input_file, TEST_INPUT, sizeof(task.input_file) - 1);
+    task.priority = priority;
+    task.created_time = created;
+    task.deadline = deadline;
+
+    if (add_task(&task) != 0) return -1;
+    return create_chunks(task_id, 100); // Zeroed format splits bytes: 2 chunks of the 200 byte input
+}
+
+// Pop every ready chunk and compare the owning tasks against the expected order
+static int check_dispatch_order(const char* const* expected, int count) {
+    chunk_info_t chunk;
+    for (int i = 0; i < count; i++) {
+        if (take_next_chunk("employee", &chunk) != 0) {
+            printf("✗ Dispatch %d: expected %s, queue is empty\n", i, expected[i]);
+            return -1;
+        }
+        if (strcmp(chunk.task_id, expected[i]) != 0) {
+            printf("✗ Dispatch %d: expected %s, got %s\n", i, expected[i], chunk.task_id);
+            return -1;
+        }
+    }
+    if (take_next_chunk("employee", &chunk) == 0) {
+        printf("✗ Queue should be empty, got %s\n", chunk.chunk_id);
+        return -1;
+    }
+    return 0;
+}
+
+int main() {
+    printf("=== Scheduler Ready Queue Test ===\n");
+
+    FILE *input = fopen(TEST_INPUT, "wb");
+    if (!input) {
+        printf("✗ Cannot create %s\n", TEST_INPUT);
+        return 1;
+    }
+    for (int i = 0; i < 200; i++) fputc('x', input);
+    fclose(input);
+
+    time_t now = time(NULL);
+
+    // Test 1: EDF, chunks without a deadline last, ties to the higher priority
+    printf("1. Testing deadline aware (EDF) order...\n");
+    init_scheduler();
+    set_scheduling_policy(SCHEDULE_DEADLINE_AWARE);
+    if (add_test_task("none", 9, now, 0) != 2 ||
+        add_test_task("late", 1, now, now + 300) != 2 ||
+        add_test_task("soon", 1, now, now + 60) != 2 ||
+        add_test_task("soon_hi", 5, now, now + 60) != 2) {
+        printf("✗ Could not create tasks\n");
+        return 1;
+    }
+    const char *edf[] = { "soon_hi", "soon_hi", "soon", "soon", "late", "late", "none", "none" };
+    if (check_dispatch_order(edf, 8) != 0) return 1;
+    printf("✓ Earliest deadline dispatched first\n");
+
+    // Test 2: aging, a low priority task that waited long enough overtakes
+    printf("2. Testing priority aging order...\n");
+    cleanup_scheduler();
+    init_scheduler();
+    set_scheduling_policy(SCHEDULE_PRIORITY_BASED);
+    // Effective priorities: old_low 1 + 120/30 = 5, new_high 3, new_low 1
+    if (add_test_task("new_low", 1, now, 0) != 2 ||
+        add_test_task("new_high", 3, now, 0) != 2 ||
+        add_test_task("old_low", 1, now - 120, 0) != 2) {
+        printf("✗ Could not create tasks\n");
+        return 1;
+    }
+    const char *aged[] = { "old_low", "old_low", "new_high", "new_high", "new_low", "new_low" };
+    if (check_dispatch_order(aged, 6) != 0) return 1;
+    printf("✓ Aged priority dispatched first\n");
+
+    // Test 3: release puts a chunk back in order, completion updates pending tasks
+    printf("3. Testing release, completion and pending tasks...\n");
+    if (release_chunk("new_high_chunk_1") != 0 || release_chunk("old_low_chunk_0") != 0) {
+        printf("✗ Release failed\n");
+        return 1;
+    }
+    const char *released[] = { "old_low", "new_high" };
+    if (check_dispatch_order(released, 2) != 0) return 1;
+
+    mark_chunk_completed("old_low_chunk_0");
+    mark_chunk_completed("old_low_chunk_1");
+    task_descriptor_t *pending[8];
+    int pending_count = get_pending_tasks(pending, 8);
+    if (pending_count != 2 || strcmp(pending[0]->task_id, "new_high") != 0) {
+        printf("✗ Expected 2 pending tasks led by new_high, got %d\n", pending_count);
+        return 1;
+    }
+    printf("✓ Released chunk requeued, finished task no longer pending\n");
+
+    // Test 4: the chunk index stays valid after chunks move
+    printf("4. Testing chunk lookup after removing a task...\n");
+    if (remove_task("new_low") != 0 || mark_chunk_completed("new_high_chunk_0") != 0 ||
+        mark_chunk_completed("new_low_chunk_0") == 0) {
+        printf("✗ Chunk index out of date\n");
+        return 1;
+    }
+    int completed, total;
+    get_chunk_status("new_high", &completed, &total);
+    if (completed != 1 || total != 2) {
+        printf("✗ Expected 1 of 2 chunks completed, got %d of %d\n", completed, total);
+        return 1;
+    }
+    printf("✓ Chunks found by id after the table shifted\n");
+
+    cleanup_scheduler();
+    unlink(TEST_INPUT);
+
+    printf("\n=== All Tests Passed ===\n");
+    return 0;
+}
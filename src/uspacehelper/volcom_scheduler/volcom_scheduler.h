@@ -5,6 +5,15 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <time.h>
+#include <sys/types.h>
+
+// Record layouts the chunker can split on. The zero value splits on plain
+// bytes, so a zeroed descriptor never assumes a record structure.
+typedef enum {
+    RECORD_FORMAT_FIXED,    // Fixed-size records of record_size bytes
+    RECORD_FORMAT_NDJSON,   // One JSON document per line
+    RECORD_FORMAT_FRAMES    // Frame container: 4 byte big-endian length + payload, repeated
+} record_format_t;
 
 // Task scheduling structures
 typedef struct {
@@ -17,13 +26,17 @@ typedef struct {
     time_t created_time;
     time_t deadline;
     bool is_chunked;
+    record_format_t record_format;
+    size_t record_size;     // RECORD_FORMAT_FIXED only, 0 = plain bytes
 } task_descriptor_t;
 
 typedef struct {
     char chunk_id[64];
     char task_id[64];
-    char chunk_file[256];
+    char chunk_file[256];   // Input file the chunk is a range of
+    off_t chunk_offset;
     size_t chunk_size;
+    int record_count;
     int chunk_index;
     int total_chunks;
     char assigned_employee[64];
@@ -44,10 +57,52 @@ int get_pending_tasks(task_descriptor_t** tasks, int max_tasks);
 // Chunk management
 int create_chunks(const char* task_id, size_t chunk_size);
 int get_next_chunk(chunk_info_t* chunk_info);
+int take_next_chunk(const char* employee_id, chunk_info_t* chunk_info);
 int assign_chunk(const char* chunk_id, const char* employee_id);
 int mark_chunk_completed(const char* chunk_id);
+int release_chunk(const char* chunk_id);
 int get_chunk_status(const char* task_id, int* completed, int* total);
 
+// Ready queue and deadline accounting
+typedef struct {
+    int chunks_queued;
+    int chunks_ready;           // Waiting in the ready queue right now
+    int chunks_dispatched;
+    int chunks_completed;
+    int late_dispatches;        // Assigned after their deadline had passed
+    int deadline_misses;        // Completed after their deadline
+    double total_lateness_sec;
+    double max_lateness_sec;
+} scheduler_stats_t;
+
+int get_scheduler_stats(scheduler_stats_t* stats);
+
+// Chunking engine: an input file mapped read-only, split into byte ranges
+// that always end on a record boundary
+typedef struct {
+    int fd;
+    const char* data;       // Mapping of the whole file, NULL when empty
+    size_t size;            // Bytes of whole records (a partial fixed-size tail is ignored)
+    record_format_t format;
+    size_t record_size;
+    char path[256];
+} chunk_source_t;
+
+typedef struct {
+    off_t offset;
+    size_t length;
+    int index;
+    int record_count;
+} chunk_range_t;
+
+int parse_record_format(const char* spec, record_format_t* format, size_t* record_size);
+int record_format_for_path(const char* path, record_format_t* format, size_t* record_size);
+int chunk_source_open(chunk_source_t* source, const char* path, record_format_t format, size_t record_size);
+void chunk_source_close(chunk_source_t* source);
+int chunk_source_next(const chunk_source_t* source, off_t offset, size_t target_size, chunk_range_t* range);
+int chunk_source_split(const chunk_source_t* source, size_t target_size, chunk_range_t* ranges, int max_ranges);
+int chunk_range_send(int sockfd, const chunk_source_t* source, const chunk_range_t* range);
+
 // Task distribution
 typedef struct {
     char employee_id[64];
@@ -0,0 +1,237 @@
+#define _GNU_SOURCE
+#include "volcom_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+
+// Buffer pools.
+//
+// Payloads on the employee come and go at the frame rate, mostly at a few
+// recurring sizes. A pool hands out buffers rounded up to a power-of-two size
+// class and keeps released ones on per-class free lists, so the steady state
+// allocates nothing. The budget caps what the pool holds; a request that does
+// not fit first evicts cached buffers of other classes, then waits for a
+// release, and gives up (NULL) when timeout_ms passes. Callers decide what
+// exhaustion means: stall the sender, spill, or fall back to plain memory.
+
+#define BUFFER_POOL_PAGE 4096
+
+static size_t class_capacity(const buffer_pool_t* pool, int size_class) {
+    return pool->min_size << size_class;
+}
+
+static int size_class_for(const buffer_pool_t* pool, size_t size) {
+    for (int size_class = 0; size_class < BUFFER_POOL_CLASSES; size_class++) {
+        if (size <= class_capacity(pool, size_class)) return size_class;
+    }
+    return -1;
+}
+
+static int resize_memfd(pool_buffer_t* buffer, size_t size) {
+    if (buffer->size == size) return 0;
+    if (ftruncate(buffer->fd, (off_t)size) != 0) return -1;
+    buffer->size = size;
+    return 0;
+}
+
+static pool_buffer_t* allocate_buffer(buffer_pool_t* pool, size_t capacity, int size_class) {
+    pool_buffer_t *buffer = calloc(1, sizeof(*buffer));
+    if (!buffer) return NULL;
+    buffer->capacity = capacity;
+    buffer->size_class = size_class;
+    buffer->pool = pool;
+    buffer->fd = -1;
+
+    if (pool->backing == BUFFER_POOL_HEAP) {
+        buffer->data = malloc(capacity);
+        if (!buffer->data) {
+            free(buffer);
+            return NULL;
+        }
+        return buffer;
+    }
+
+    // The whole capacity stays mapped; only the file size follows the request
+    buffer->fd = memfd_create(pool->name, MFD_CLOEXEC);
+    if (buffer->fd < 0 || ftruncate(buffer->fd, (off_t)capacity) != 0) {
+        if (buffer->fd >= 0) close(buffer->fd);
+        free(buffer);
+        return NULL;
+    }
+    buffer->size = capacity;
+    void *map = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, buffer->fd, 0);
+    if (map == MAP_FAILED) {
+        close(buffer->fd);
+        free(buffer);
+        return NULL;
+    }
+    buffer->data = map;
+    return buffer;
+}
+
+static void destroy_buffer(pool_buffer_t* buffer) {
+    if (buffer->fd >= 0) {
+        munmap(buffer->data, buffer->capacity);
+        close(buffer->fd);
+    } else {
+        free(buffer->data);
+    }
+    free(buffer);
+}
+
+// Free cached buffers until needed more bytes fit in the budget. Called with
+// the mutex held.
+static void evict_cached(buffer_pool_t* pool, size_t needed) {
+    for (int size_class = BUFFER_POOL_CLASSES - 1; size_class >= 0; size_class--) {
+        while (pool->free_lists[size_class] && pool->in_use + pool->cached + needed > pool->budget) {
+            pool_buffer_t *buffer = pool->free_lists[size_class];
+            pool->free_lists[size_class] = buffer->next;
+            pool->cached -= buffer->capacity;
+            destroy_buffer(buffer);
+        }
+    }
+}
+
+int buffer_pool_init(buffer_pool_t* pool, const char* name, buffer_pool_backing_t backing,
+                     size_t min_size, size_t budget) {
+    if (!pool || min_size == 0) return -1;
+    memset(pool, 0, sizeof(*pool));
+    pool->name = name ? name : "volcom_pool";
+    pool->backing = backing;
+    pool->min_size = min_size;
+    pool->budget = budget;
+    if (pthread_mutex_init(&pool->mutex, NULL) != 0) return -1;
+    if (pthread_cond_init(&pool->released, NULL) != 0) {
+        pthread_mutex_destroy(&pool->mutex);
+        return -1;
+    }
+    return 0;
+}
+
+void deadline_after_ms(struct timespec* deadline, int timeout_ms) {
+    clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_sec += timeout_ms / 1000;
+    deadline->tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+// A buffer of at least size bytes, or NULL when the budget stays exhausted
+// for timeout_ms (0 fails at once, negative waits for as long as it takes).
+pool_buffer_t* buffer_pool_acquire(buffer_pool_t* pool, size_t size, int timeout_ms) {
+    if (!pool || size == 0) return NULL;
+
+    int size_class = size_class_for(pool, size);
+    size_t capacity = size_class >= 0 ? class_capacity(pool, size_class)
+                                      : (size + BUFFER_POOL_PAGE - 1) / BUFFER_POOL_PAGE * BUFFER_POOL_PAGE;
+    if (capacity > pool->budget) {
+        pthread_mutex_lock(&pool->mutex);
+        pool->refused++;
+        pthread_mutex_unlock(&pool->mutex);
+        return NULL;
+    }
+
+    struct timespec deadline;
+    deadline_after_ms(&deadline, timeout_ms);
+
+    pthread_mutex_lock(&pool->mutex);
+    bool waited = false;
+    pool_buffer_t *buffer = NULL;
+    for (;;) {
+        if (size_class >= 0 && pool->free_lists[size_class]) {
+            buffer = pool->free_lists[size_class];
+            pool->free_lists[size_class] = buffer->next;
+            pool->cached -= capacity;
+            pool->reused++;
+            break;
+        }
+        evict_cached(pool, capacity);
+        if (pool->in_use + pool->cached + capacity <= pool->budget) break;
+
+        int wait_status = 0;
+        if (timeout_ms < 0) {
+            wait_status = pthread_cond_wait(&pool->released, &pool->mutex);
+        } else if (timeout_ms > 0) {
+            wait_status = pthread_cond_timedwait(&pool->released, &pool->mutex, &deadline);
+        }
+        if (timeout_ms == 0 || wait_status == ETIMEDOUT) {
+            pool->refused++;
+            pthread_mutex_unlock(&pool->mutex);
+            return NULL;
+        }
+        if (!waited) pool->waited++;
+        waited = true;
+    }
+    // Reserve before allocating outside the lock
+    pool->in_use += capacity;
+    if (pool->in_use > pool->peak) pool->peak = pool->in_use;
+    if (!buffer) pool->allocated++;
+    pthread_mutex_unlock(&pool->mutex);
+
+    if (!buffer) buffer = allocate_buffer(pool, capacity, size_class);
+    if (buffer && buffer->fd >= 0 && resize_memfd(buffer, size) != 0) {
+        destroy_buffer(buffer);
+        buffer = NULL;
+    }
+    if (!buffer) {
+        pthread_mutex_lock(&pool->mutex);
+        pool->in_use -= capacity;
+        pthread_cond_broadcast(&pool->released);
+        pthread_mutex_unlock(&pool->mutex);
+        return NULL;
+    }
+    buffer->size = size;
+    buffer->next = NULL;
+    return buffer;
+}
+
+void buffer_pool_release(pool_buffer_t* buffer) {
+    if (!buffer) return;
+    buffer_pool_t *pool = buffer->pool;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->in_use -= buffer->capacity;
+    if (buffer->size_class >= 0 && pool->in_use + pool->cached + buffer->capacity <= pool->budget) {
+        buffer->next = pool->free_lists[buffer->size_class];
+        pool->free_lists[buffer->size_class] = buffer;
+        pool->cached += buffer->capacity;
+        buffer = NULL;
+    }
+    pthread_cond_broadcast(&pool->released);
+    pthread_mutex_unlock(&pool->mutex);
+
+    if (buffer) destroy_buffer(buffer); // Oversized, or the budget shrank
+}
+
+void buffer_pool_print_stats(buffer_pool_t* pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->mutex);
+    printf("Buffer pool %s: %lu reused, %lu allocated, %lu waited, %lu refused, "
+           "peak %zu KB of %zu KB, %zu KB cached\n",
+           pool->name, pool->reused, pool->allocated, pool->waited, pool->refused,
+           pool->peak / 1024, pool->budget / 1024, pool->cached / 1024);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+// Frees the cached buffers; buffers still handed out must not be released after
+void buffer_pool_cleanup(buffer_pool_t* pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->mutex);
+    for (int size_class = 0; size_class < BUFFER_POOL_CLASSES; size_class++) {
+        while (pool->free_lists[size_class]) {
+            pool_buffer_t *buffer = pool->free_lists[size_class];
+            pool->free_lists[size_class] = buffer->next;
+            destroy_buffer(buffer);
+        }
+    }
+    pool->cached = 0;
+    pthread_mutex_unlock(&pool->mutex);
+    pthread_cond_destroy(&pool->released);
+    pthread_mutex_destroy(&pool->mutex);
+}
@@ -0,0 +1,79 @@
+#include "volcom_utils.h"
+#include <stdio.h>
+#include <string.h>
+
+// Known answers from FIPS 180-4 (NIST example values)
+#define EMPTY_DIGEST     "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"
+#define ABC_DIGEST       "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"
+#define TWO_BLOCK_MSG    "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"
+#define TWO_BLOCK_DIGEST "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"
+#define MILLION_A_DIGEST "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"
+
+static int check_digest(const char* name, sha256_ctx_t* ctx, const char* expected) {
+    unsigned char digest[SHA256_DIGEST_LEN];
+    char hex[SHA256_HEX_LEN + 1];
+    sha256_final(ctx, digest);
+    sha256_hex(digest, hex);
+    if (strcmp(hex, expected) != 0) {
+        printf("✗ %s: expected %s, got %s\n", name, expected, hex);
+        return -1;
+    }
+    printf("✓ %s\n", name);
+    return 0;
+}
+
+static int check_message(const char* name, const char* message, const char* expected) {
+    sha256_ctx_t ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, message, strlen(message));
+    return check_digest(name, &ctx, expected);
+}
+
+int main() {
+    printf("=== SHA-256 Known Answer Test ===\n");
+
+    // Test 1: single block messages, the padding fits behind the message
+    printf("1. Testing one block messages...\n");
+    if (check_message("Empty message", "", EMPTY_DIGEST) != 0) return 1;
+    if (check_message("\"abc\"", "abc", ABC_DIGEST) != 0) return 1;
+
+    // Test 2: 448 bit message, the length no longer fits and spills into a second block
+    printf("2. Testing the 448 bit message...\n");
+    if (check_message("448 bit message", TWO_BLOCK_MSG, TWO_BLOCK_DIGEST) != 0) return 1;
+
+    // Test 3: the same message split at every offset, through the partial block buffer
+    printf("3. Testing split updates...\n");
+    size_t len = strlen(TWO_BLOCK_MSG);
+    for (size_t split = 0; split <= len; split++) {
+        sha256_ctx_t ctx;
+        unsigned char digest[SHA256_DIGEST_LEN];
+        char hex[SHA256_HEX_LEN + 1];
+        sha256_init(&ctx);
+        sha256_update(&ctx, TWO_BLOCK_MSG, split);
+        sha256_update(&ctx, TWO_BLOCK_MSG + split, len - split);
+        sha256_final(&ctx, digest);
+        sha256_hex(digest, hex);
+        if (strcmp(hex, TWO_BLOCK_DIGEST) != 0) {
+            printf("✗ Split at %zu: got %s\n", split, hex);
+            return 1;
+        }
+    }
+    printf("✓ Digest independent of the update boundaries\n");
+
+    // Test 4: one million 'a', fed in pieces that are not a multiple of the block size
+    printf("4. Testing one million 'a'...\n");
+    char piece[1000];
+    memset(piece, 'a', sizeof(piece));
+    sha256_ctx_t ctx;
+    sha256_init(&ctx);
+    size_t remaining = 1000000;
+    while (remaining > 0) {
+        size_t n = remaining < 997 ? remaining : 997;
+        sha256_update(&ctx, piece, n);
+        remaining -= n;
+    }
+    if (check_digest("One million 'a'", &ctx, MILLION_A_DIGEST) != 0) return 1;
+
+    printf("\n=== All Tests Passed ===\n");
+    return 0;
+}
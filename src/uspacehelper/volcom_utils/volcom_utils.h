@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
 
 // System initialization and cleanup
 int init_volcom_utils(void);
@@ -40,4 +42,72 @@ void cleanup_task_info(task_info_t* task_info);
 // Result sending utilities
 int send_result(int sockfd, const char* task_id, const char* result_file);
 
+// Absolute CLOCK_REALTIME deadline timeout_ms from now, for condition waits
+void deadline_after_ms(struct timespec* deadline, int timeout_ms);
+
+// Buffer pools (buffer_pool.c): size-classed buffers recycled under a fixed
+// byte budget. Class i holds buffers of min_size << i; larger requests get a
+// buffer of their own that is freed on release. Buffers in use and cached
+// ones both count against the budget.
+#define BUFFER_POOL_CLASSES 12
+
+typedef enum {
+    BUFFER_POOL_HEAP,   // Plain memory
+    BUFFER_POOL_MEMFD   // Each buffer maps a memfd, sized to the request, that can be passed to another process
+} buffer_pool_backing_t;
+
+typedef struct buffer_pool_s buffer_pool_t;
+
+typedef struct pool_buffer_s {
+    char* data;
+    size_t size;        // Bytes asked for by the current owner
+    size_t capacity;
+    int fd;             // BUFFER_POOL_MEMFD: the memfd, truncated to size
+    int size_class;     // -1 for buffers larger than the largest class
+    buffer_pool_t* pool;
+    struct pool_buffer_s* next; // Free list
+} pool_buffer_t;
+
+struct buffer_pool_s {
+    const char* name;
+    buffer_pool_backing_t backing;
+    size_t min_size;
+    size_t budget;
+    size_t in_use;      // Capacity of the buffers handed out
+    size_t cached;      // Capacity of the buffers on the free lists
+    size_t peak;
+    pool_buffer_t* free_lists[BUFFER_POOL_CLASSES];
+    pthread_mutex_t mutex;
+    pthread_cond_t released;
+    unsigned long reused;
+    unsigned long allocated;
+    unsigned long waited;   // Acquisitions that had to wait for a release
+    unsigned long refused;  // Acquisitions that gave up, budget exhausted
+};
+
+int buffer_pool_init(buffer_pool_t* pool, const char* name, buffer_pool_backing_t backing,
+                     size_t min_size, size_t budget);
+pool_buffer_t* buffer_pool_acquire(buffer_pool_t* pool, size_t size, int timeout_ms);
+void buffer_pool_release(pool_buffer_t* buffer);
+void buffer_pool_print_stats(buffer_pool_t* pool);
+void buffer_pool_cleanup(buffer_pool_t* pool);
+
+// SHA-256 (sha256.c)
+#define SHA256_DIGEST_LEN 32
+#define SHA256_BLOCK_LEN 64
+#define SHA256_HEX_LEN (SHA256_DIGEST_LEN * 2)
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;    // Bytes hashed so far
+    unsigned char buffer[SHA256_BLOCK_LEN];
+    size_t buffer_len;
+} sha256_ctx_t;
+
+void sha256_init(sha256_ctx_t* ctx);
+void sha256_update(sha256_ctx_t* ctx, const void* data, size_t len);
+void sha256_final(sha256_ctx_t* ctx, unsigned char digest[SHA256_DIGEST_LEN]);
+void sha256_hex(const unsigned char digest[SHA256_DIGEST_LEN], char* hex);
+int sha256_file_hex(const char* path, char* hex);
+
 #endif // VOLCOM_UTILS_H